@@ -0,0 +1,71 @@
+/**
+  ******************************************************************************
+  * @file           : air_quality.h
+  * @brief          : Streaming gas baseline and air-quality index
+  ******************************************************************************
+  * The MOX plate's resistance falls when reducing gases or VOCs are present.
+  * It also falls with humidity, and it drifts over weeks as the sensor ages,
+  * so a fixed threshold on the raw resistance is not reliable. The engine
+  * works on log2 of the resistance in Q16 fixed point. In that domain a
+  * ratio becomes a difference and the humidity effect is close to linear.
+  *
+  * Every sample is moved to the AQ_HUM_REF humidity by hum_slope per %rH.
+  * The compensated value is then compared to a baseline, the cleanest air
+  * seen recently. The baseline rises quickly towards cleaner readings and
+  * decays slowly towards dirtier ones. Slow ageing is tracked this way,
+  * while a leak lasting minutes to hours still shows. The index is the
+  * shortfall of the sample below the baseline: AQ_INDEX_PER_HALVING points
+  * for each halving of the resistance, clamped to AQ_INDEX_MAX. 0 means air
+  * as clean as the baseline.
+  *
+  * An update costs one fx_log2() and a handful of integer operations; the
+  * float build converts its two inputs and nothing else.
+  * The state is the 20 bytes of struct aq_engine.
+  ******************************************************************************/
+
+#ifndef AIR_QUALITY_H_
+#define AIR_QUALITY_H_
+
+#include <stdint.h>
+#include "bme680.h"
+#include "fixmath.h"
+
+/* Index scale: points per halving of the compensated resistance */
+#define AQ_INDEX_PER_HALVING	200
+#define AQ_INDEX_MAX			500
+
+/* Humidity the readings are compensated to, in milli %rH */
+#define AQ_HUM_REF				40000
+
+/* Typical MOX sensitivity: about 3 % less resistance per %rH, as log2 in
+ * Q16 per %rH. Fit it per sensor from a humidity sweep in clean air. */
+#define AQ_HUM_SLOPE			2836
+
+/* Baseline tracking in samples, as shifts: about 8 samples towards
+ * cleaner air, about 2048 (1.7 h at the 3 s sample period) towards
+ * dirtier air */
+#define AQ_RISE_SHIFT			3
+#define AQ_DECAY_SHIFT			11
+
+/* Samples after power-up during which the baseline follows the readings
+ * both ways and the index stays 0 */
+#ifndef AQ_WARMUP_SAMPLES
+#define AQ_WARMUP_SAMPLES		10
+#endif
+
+struct aq_engine {
+	int32_t hum_slope;			/* Q16 log2 per %rH, 0 for no compensation */
+	int32_t baseline;			/* compensated fx_log2() of ohm, fx_exp2() undoes it */
+	uint16_t index;				/* last index, 0 to AQ_INDEX_MAX */
+	uint16_t warmup;			/* samples taken so far, up to AQ_WARMUP_SAMPLES */
+	uint32_t samples;			/* gas readings used */
+	uint32_t skipped;			/* readings without a valid, heat-stable gas value */
+};
+
+/* Static initialiser with the default humidity slope */
+#define AQ_ENGINE_INIT		{ .hum_slope = AQ_HUM_SLOPE }
+
+void aq_init(struct aq_engine *aq, int32_t hum_slope);
+uint16_t aq_update(struct aq_engine *aq, const struct bme680_field_data *data);
+
+#endif /* AIR_QUALITY_H_ */
@@ -0,0 +1,52 @@
+/**
+  ******************************************************************************
+  * @file           : app_bench.h
+  * @brief          : Benchmarks, replay, capture and gas scan of the firmware
+  ******************************************************************************
+  * Each part is built only when its flag is defined, and prints over the
+  * text console unless noted:
+  *   - BME680_COMP_BENCH: compensation, formatting and derived metrics in
+  *     DWT cycles, after each telemetry report
+  *   - BME680_I2C_BENCH: HAL against i2c_ll per transaction, at start-up
+  *   - BME680_OS_REPLAY: the oversampling controller's saving on node 0's
+  *     first OS_REPLAY_SAMPLES samples
+  *   - BME680_FRAME_LOG: node 0's raw field bursts to USART2 (frame_log.h)
+  *   - BME680_GAS_SCAN: the gas resistance of every step of gas_profile
+  * main.c and app_tasks.c call them under the same flags.
+  ******************************************************************************/
+
+#ifndef APP_BENCH_H_
+#define APP_BENCH_H_
+
+#include <stdint.h>
+#include "bme680.h"
+#include "meas_engine.h"
+#ifdef BME680_FRAME_LOG
+#include "frame_log.h"
+#endif
+
+#ifdef BME680_COMP_BENCH
+void BME680_CompBench(void);
+#endif
+#ifdef BME680_I2C_BENCH
+void BME680_I2CBenchRun(const char *name, uint8_t dev_id, uint8_t reg_addr, uint8_t *data, uint16_t len,
+		uint8_t write);
+void BME680_I2CBench(void);
+#endif
+#ifdef BME680_OS_REPLAY
+void BME680_OsReplay(const struct bme680_field_data *sample);
+#endif
+#ifdef BME680_FRAME_LOG
+extern struct frame_log frame_log;
+
+void BME680_Capture(const uint8_t *buff, const struct bme680_dev *dev);
+void BME680_LogWrite(const void *buf, uint16_t len, void *ctx);
+#endif
+#ifdef BME680_GAS_SCAN
+/* Heater steps, one per sample; main.c loads them into node 0 */
+extern const struct bme680_heatr_profile gas_profile;
+
+void BME680_Scan(const struct meas_gas_scan *scan, void *ctx);
+#endif
+
+#endif /* APP_BENCH_H_ */
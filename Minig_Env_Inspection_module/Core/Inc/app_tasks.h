@@ -0,0 +1,94 @@
+/**
+  ******************************************************************************
+  * @file           : app_tasks.h
+  * @brief          : Task bodies of the firmware and the state they share
+  ******************************************************************************
+  * main.c brings up the hardware, the sensor array and the scheduler. The
+  * tasks it adds run here:
+  *   - sample: services the I2C queue and the sensor array
+  *   - compensate: takes node 0's latest sample and its derived metrics
+  *   - state: runs the state machine once per compensated sample
+  *   - display: draws the sample on the OLED
+  *   - telemetry: a binary frame per sample, or the text console report
+  * The sensor array hands samples to BME680_Ready(). Node 0's sample goes
+  * to the tasks through the globals below; the tasks run to completion in
+  * the main loop, so nothing else guards them.
+  ******************************************************************************/
+
+#ifndef APP_TASKS_H_
+#define APP_TASKS_H_
+
+#include <stdint.h>
+#include "bme680.h"
+#include "sensor_array.h"
+#include "derived.h"
+#include "os_ctrl.h"
+#include "task_sched.h"
+#include "log_ring.h"
+#include "telemetry.h"
+#include "fixfmt.h"
+
+/* Field values as the scaled integers fixfmt.h prints, in both builds:
+ * centi degC, milli %rH, Pa and ohm. Shown with two decimals as degC,
+ * %rH, hPa and kOhm. */
+#define FIELD_TEMP(v)		((int32_t)((v) * (100 / BME680_TEMP_SCALE)))
+#define FIELD_HUM(v)		((uint32_t)((v) * (1000 / BME680_HUM_SCALE)))
+#define FIELD_PRES(v)		((uint32_t)((v) / BME680_PRES_SCALE))
+#define FIELD_GAS(v)		((uint32_t)((v) / BME680_GAS_SCALE))
+#define FIELDS				4
+
+/* OLED rows, 10 pixels apart: the title and five values */
+#define DISPLAY_ROWS		6
+
+/* Derived metrics are integers in both builds (see derived.h); two
+ * decimals of a value in hundredths */
+#define CENTI_FMT			"%s%lu.%02lu"
+#define CENTI_ABS(v)		((uint32_t)(((int32_t)(v) < 0) ? -(int32_t)(v) : (int32_t)(v)))
+#define CENTI_ARG(v)		(((int32_t)(v) < 0) ? "-" : ""), (unsigned long)(CENTI_ABS(v) / 100), \
+							(unsigned long)(CENTI_ABS(v) % 100)
+
+/* Three decimals of a value in thousandths; with CENTI_FMT this keeps the
+ * controller statistics off float printf */
+#define MILLI_FMT			"%s%lu.%03lu"
+#define MILLI_ARG(v)		(((int32_t)(v) < 0) ? "-" : ""), (unsigned long)(CENTI_ABS(v) / 1000), \
+							(unsigned long)(CENTI_ABS(v) % 1000)
+
+/* Pressure of the level the reported height is taken from. Sea level
+ * gives the altitude; the pressure read at the shaft collar gives minus
+ * the depth below it. */
+#define BME680_REF_PA		DERIVED_SEA_LEVEL_PA
+
+extern volatile uint8_t set_required_settings;
+extern volatile int8_t rslt;
+extern struct bme680_dev gas_sensor;
+extern struct sensor_array sensors;
+extern struct bme680_field_data data;
+extern uint32_t data_ms;
+extern uint32_t sample_seq;
+extern uint8_t state;
+extern uint32_t state_seq;
+extern struct derived_data derived;
+extern struct os_ctrl os_ctrl;
+extern struct task_sched tasks;
+extern struct log_ring uart_log;
+extern struct telem telem;
+
+void myprintf(const char *fmt, ...);
+
+void BME680_TaskSample(void *ctx);
+void BME680_TaskCompensate(void *ctx);
+void BME680_TaskState(void *ctx);
+void BME680_TaskDisplay(void *ctx);
+void BME680_TaskTelemetry(void *ctx);
+void BME680_Idle(void);
+void BME680_Ready(uint8_t idx, int8_t result, const struct bme680_field_data *sample, void *ctx);
+void BME680_FormatRow(char *row, uint8_t line, const struct bme680_field_data *sample,
+		const struct derived_data *metrics);
+void BME680_Fields(const struct bme680_field_data *sample, char field[FIELDS][FMT_VALUE_LEN]);
+void BME680_TelemWrite(const void *buf, uint16_t len, void *ctx);
+void BME680_TelemSend(uint8_t node, const struct bme680_field_data *sample, const struct derived_data *metrics,
+		uint32_t t_ms, uint8_t sm_state, uint16_t gas_index);
+void BME680_Tasks(void);
+void BME680_Stats(void);
+
+#endif /* APP_TASKS_H_ */
@@ -65,6 +65,41 @@ extern "C"
  */
 int8_t bme680_init(struct bme680_dev *dev);
 
+/*!
+ *  @brief This API soft resets the sensor and verifies its chip-id without
+ *  reading the calibration data. bme680_init() is bme680_probe() followed
+ *  by bme680_read_calib(); callers holding a cached calibration block can
+ *  probe, copy it into dev->calib and call bme680_build_comp_plan() instead.
+ *
+ *  @param[in,out] dev : Structure instance of bme680_dev
+ *
+ *  @return Result of API execution status
+ *  @retval zero -> Success / +ve value -> Warning / -ve value -> Error
+ */
+int8_t bme680_probe(struct bme680_dev *dev);
+
+/*!
+ *  @brief This API reads the calibration data from the sensor into dev->calib
+ *  and builds the compensation plan from it.
+ *
+ *  @param[in,out] dev : Structure instance of bme680_dev
+ *
+ *  @return Result of API execution status
+ *  @retval zero -> Success / +ve value -> Warning / -ve value -> Error
+ */
+int8_t bme680_read_calib(struct bme680_dev *dev);
+
+/*!
+ *  @brief This API precomputes the calibration-only terms of the integer
+ *  compensation into dev->plan. It must be called whenever dev->calib is
+ *  loaded from somewhere other than the sensor.
+ *
+ *  @param[in,out] dev : Structure instance of bme680_dev
+ *
+ *  @return void
+ */
+void bme680_build_comp_plan(struct bme680_dev *dev);
+
 /*!
  * @brief This API writes the given data to the register address
  * of the sensor.
@@ -155,6 +190,33 @@ void bme680_set_profile_dur(uint16_t duration, struct bme680_dev *dev);
  */
 void bme680_get_profile_dur(uint16_t *duration, const struct bme680_dev *dev);
 
+/*!
+ * @brief This API loads every step of a heater profile into the sensor in two
+ * register bursts and selects step 0. The profile is kept by reference and
+ * reloaded by bme680_set_sensor_settings(); pass NULL to return to the single
+ * set-point in dev->gas_sett. The sensor must be in forced mode.
+ *
+ * @param[in] profile : Heater profile, must stay valid while in use.
+ * @param[in,out] dev : Structure instance of bme680_dev.
+ *
+ * @return Result of API execution status
+ * @retval zero -> Success / +ve value -> Warning / -ve value -> Error
+ */
+int8_t bme680_set_heatr_profile(const struct bme680_heatr_profile *profile, struct bme680_dev *dev);
+
+/*!
+ * @brief This API selects the heater step used by the next forced
+ * measurement. Only ctrl_gas_1 (nb_conv) is written; dev->gas_sett is
+ * updated so bme680_get_profile_dur() reports the duration of this step.
+ *
+ * @param[in] step : Profile step, below dev->heatr_prof->len.
+ * @param[in,out] dev : Structure instance of bme680_dev.
+ *
+ * @return Result of API execution status
+ * @retval zero -> Success / +ve value -> Warning / -ve value -> Error
+ */
+int8_t bme680_set_heatr_step(uint8_t step, struct bme680_dev *dev);
+
 /*!
  * @brief This API reads the pressure, temperature and humidity and gas data
  * from the sensor, compensates the data and store it in the bme680_data
@@ -168,6 +230,93 @@ void bme680_get_profile_dur(uint16_t *duration, const struct bme680_dev *dev);
  */
 int8_t bme680_get_sensor_data(struct bme680_field_data *data, struct bme680_dev *dev);
 
+/*!
+ * @brief This API triggers a single forced mode conversion and returns
+ * without waiting for the sensor to finish. The caller is expected to
+ * collect the result with bme680_poll_sensor_data() once the profile
+ * duration reported by bme680_get_profile_dur() has elapsed.
+ *
+ * @param[in] dev : Structure instance of bme680_dev.
+ *
+ * @return Result of API execution status
+ * @retval zero -> Success / +ve value -> Warning / -ve value -> Error
+ * @retval BME680_W_MEAS_BUSY -> a conversion is still in progress
+ */
+int8_t bme680_start_meas(struct bme680_dev *dev);
+
+/*!
+ * @brief This API reads the field registers exactly once and, if a new
+ * conversion is available, compensates it into the bme680_field_data
+ * structure. Unlike bme680_get_sensor_data() it never delays or retries.
+ *
+ * @param[out] data: Structure instance to hold the data.
+ * @param[in] dev : Structure instance of bme680_dev.
+ *
+ * @return Result of API execution status
+ * @retval zero -> Success / +ve value -> Warning / -ve value -> Error
+ * @retval BME680_W_NO_NEW_DATA -> the conversion has not completed yet
+ */
+int8_t bme680_poll_sensor_data(struct bme680_field_data *data, struct bme680_dev *dev);
+
+/*!
+ * @brief This API starts an asynchronous burst read of the field registers
+ * through dev->read_async. Once cplt reports success, the buffer is handed
+ * to bme680_compensate_field().
+ *
+ * @param[out] buff : Buffer of BME680_FIELD_LENGTH bytes, must stay valid
+ * until cplt has been called.
+ * @param[in] cplt : Completion callback.
+ * @param[in] ctx : Context pointer passed to cplt.
+ * @param[in] dev : Structure instance of bme680_dev.
+ *
+ * @return Result of API execution status
+ * @retval zero -> Success / +ve value -> Warning / -ve value -> Error
+ */
+int8_t bme680_start_field_read(uint8_t *buff, bme680_com_cplt_fptr_t cplt, void *ctx, struct bme680_dev *dev);
+
+/*!
+ * @brief This API decodes a burst of the field registers and compensates it
+ * when it carries new data.
+ *
+ * @param[in] buff : BME680_FIELD_LENGTH bytes read from BME680_FIELD0_ADDR.
+ * @param[out] data : Structure instance to hold the data.
+ * @param[in] dev : Structure instance of bme680_dev.
+ *
+ * @return Result of API execution status
+ * @retval zero -> Success / +ve value -> Warning / -ve value -> Error
+ * @retval BME680_W_NO_NEW_DATA -> the burst does not hold a new conversion
+ */
+int8_t bme680_compensate_field(const uint8_t *buff, struct bme680_field_data *data, struct bme680_dev *dev);
+
+/*!
+ * @brief This API compensates count raw frames held as structure-of-arrays,
+ * using the same arithmetic as bme680_compensate_field(). It needs only the
+ * calibration and compensation plan in dev, no bus access, so it can be used
+ * to reprocess captured frames off-target. On return dev->calib.t_fine holds
+ * the value of the last frame.
+ *
+ * @param[in] raw : Raw ADC arrays, count entries each.
+ * @param[out] comp : Compensated output arrays, count entries each.
+ * @param[in] count : Number of frames.
+ * @param[in,out] dev : Structure instance of bme680_dev.
+ *
+ * @return Result of API execution status
+ * @retval zero -> Success / -ve value -> Error
+ */
+int8_t bme680_compensate_batch(const struct bme680_raw_batch *raw, struct bme680_comp_batch *comp,
+	uint32_t count, struct bme680_dev *dev);
+
+/*!
+ * @brief This API clears the readout statistics in dev->stats. A trigger
+ * still waiting for its readout stays pending.
+ *
+ * @param[in,out] dev : Structure instance of bme680_dev.
+ *
+ * @return Result of API execution status
+ * @retval zero -> Success / -ve value -> Error
+ */
+int8_t bme680_clear_meas_stats(struct bme680_dev *dev);
+
 /*!
  * @brief This API is used to set the oversampling, filter and T,P,H, gas selection
  * settings in the sensor.
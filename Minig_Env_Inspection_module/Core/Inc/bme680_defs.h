@@ -92,10 +92,11 @@
 #endif
 
 /** BME680 configuration macros */
-/** Enable or un-comment the macro to provide floating point data output */
-//#ifndef BME680_FLOAT_POINT_COMPENSATION
+/** Enable or un-comment the macro to provide floating point data output,
+ * or pass -DBME680_FLOAT_POINT_COMPENSATION to build the FPU pipeline */
+#ifndef BME680_FLOAT_POINT_COMPENSATION
 /* #define BME680_FLOAT_POINT_COMPENSATION */
-//#endif
+#endif
 
 /** BME680 General config */
 #define BME680_POLL_PERIOD_MS		UINT8_C(10)
@@ -130,6 +131,7 @@
 /* Warnings */
 #define BME680_W_DEFINE_PWR_MODE	INT8_C(1)
 #define BME680_W_NO_NEW_DATA        INT8_C(2)
+#define BME680_W_MEAS_BUSY          INT8_C(3)
 
 /* Info's */
 #define BME680_I_MIN_CORRECTION		UINT8_C(1)
@@ -158,6 +160,19 @@
 #define BME680_CONF_T_P_MODE_ADDR		UINT8_C(0x74)
 #define BME680_CONF_ODR_FILT_ADDR		UINT8_C(0x75)
 
+/** Shadowed register window: res_heat_x, gas_wait_x and the control registers */
+#define BME680_SHADOW_START		UINT8_C(0x5a)
+#define BME680_SHADOW_LEN		UINT8_C(28)
+/* 0x6e, 0x6f and 0x73 are never written through the shadow */
+#define BME680_SHADOW_VALID_MSK		UINT32_C(0x0dcfffff)
+
+/** Measurement statistics: latency bin n counts readouts younger than
+ * BME680_LAT_BIN0_MS << n, the last bin everything older */
+#define BME680_LAT_BINS			UINT8_C(8)
+#define BME680_LAT_BIN0_MS		UINT32_C(16)
+/* Poll bin n counts readouts that needed n retries, the last bin n or more */
+#define BME680_POLL_BINS		UINT8_C(8)
+
 /** Coefficient's address */
 #define BME680_COEFF_ADDR1	UINT8_C(0x89)
 #define BME680_COEFF_ADDR2	UINT8_C(0xe1)
@@ -204,6 +219,10 @@
 /** SPI memory page settings */
 #define BME680_MEM_PAGE0	UINT8_C(0x10)
 #define BME680_MEM_PAGE1	UINT8_C(0x00)
+/* dev->mem_page after a failed page switch: the next access rewrites it */
+#define BME680_MEM_PAGE_UNKNOWN	UINT8_C(0xff)
+/* spi_mem_page after power-on and soft reset */
+#define BME680_MEM_PAGE_RESET	BME680_MEM_PAGE1
 
 /** Ambient humidity shift value for compensation */
 #define BME680_HUM_REG_SHIFT_VAL	UINT8_C(4)
@@ -233,6 +252,9 @@
 #define BME680_NBCONV_MIN		UINT8_C(0)
 #define BME680_NBCONV_MAX		UINT8_C(10)
 
+/** Number of heater set-points (res_heat_x/gas_wait_x) */
+#define BME680_HEATR_STEPS		UINT8_C(10)
+
 /** Mask definitions */
 #define BME680_GAS_MEAS_MSK	UINT8_C(0x30)
 #define BME680_NBCONV_MSK	UINT8_C(0X0F)
@@ -344,12 +366,43 @@
  */
 typedef int8_t (*bme680_com_fptr_t)(uint8_t dev_id, uint8_t reg_addr, uint8_t *data, uint16_t len);
 
+/*!
+ * Asynchronous transfer completion callback
+ * @param[in] rslt: Zero on success, non-zero on bus error
+ * @param[in] ctx: Context pointer handed to the asynchronous read
+ */
+typedef void (*bme680_com_cplt_fptr_t)(int8_t rslt, void *ctx);
+
+/*!
+ * Asynchronous communication function pointer. Starts the transfer and
+ * returns immediately; cplt is invoked (possibly from interrupt context)
+ * once reg_data has been filled.
+ */
+typedef int8_t (*bme680_com_async_fptr_t)(uint8_t dev_id, uint8_t reg_addr, uint8_t *data, uint16_t len,
+	bme680_com_cplt_fptr_t cplt, void *ctx);
+
 /*!
  * Delay function pointer
  * @param[in] period: Time period in milliseconds
  */
 typedef void (*bme680_delay_fptr_t)(uint32_t period);
 
+/*!
+ * Millisecond tick function pointer
+ * @return Free running millisecond counter
+ */
+typedef uint32_t (*bme680_tick_fptr_t)(void);
+
+struct bme680_dev;
+
+/*!
+ * Raw field capture function pointer, called with every BME680_FIELD_LENGTH
+ * byte burst read from BME680_FIELD0_ADDR before it is compensated
+ * @param[in] buff: Raw field registers
+ * @param[in] dev: Device the burst was read from
+ */
+typedef void (*bme680_field_fptr_t)(const uint8_t *buff, const struct bme680_dev *dev);
+
 /*!
  * @brief Interface selection Enumerations
  */
@@ -372,29 +425,40 @@ struct	bme680_field_data {
 	/*! Measurement index to track order */
 	uint8_t meas_index;
 
-/*#ifndef BME680_FLOAT_POINT_COMPENSATION
+#ifndef BME680_FLOAT_POINT_COMPENSATION
 	/*! Temperature in degree celsius x100 */
-	//int16_t temperature;
+	int16_t temperature;
 	/*! Pressure in Pascal */
-	//uint32_t pressure;
+	uint32_t pressure;
 	/*! Humidity in % relative humidity x1000 */
-	//uint32_t humidity;
+	uint32_t humidity;
 	/*! Gas resistance in Ohms */
-	//uint32_t gas_resistance;
-//#else
+	uint32_t gas_resistance;
+#else
 	/*! Temperature in degree celsius */
 	float temperature;
 	/*! Pressure in Pascal */
 	float pressure;
-	/*! Humidity in % relative humidity x1000 */
+	/*! Humidity in % relative humidity */
 	float humidity;
 	/*! Gas resistance in Ohms */
 	float gas_resistance;
-
-//#endif
-
+#endif
 };
 
+/** Field data units per degree Celsius, Pascal, %rH and Ohm */
+#ifndef BME680_FLOAT_POINT_COMPENSATION
+#define BME680_TEMP_SCALE	100
+#define BME680_PRES_SCALE	1
+#define BME680_HUM_SCALE	1000
+#define BME680_GAS_SCALE	1
+#else
+#define BME680_TEMP_SCALE	1.0f
+#define BME680_PRES_SCALE	1.0f
+#define BME680_HUM_SCALE	1.0f
+#define BME680_GAS_SCALE	1.0f
+#endif
+
 /*!
  * @brief Structure to hold the Calibration data
  */
@@ -461,6 +525,119 @@ struct	bme680_calib_data {
 	int8_t range_sw_err;
 };
 
+#ifndef BME680_FLOAT_POINT_COMPENSATION
+/*!
+ * @brief Compensation plan: the calibration-only terms of calc_temperature,
+ * calc_pressure, calc_humidity and calc_heater_res, evaluated once after the
+ * calibration is loaded so that each sample only does the data-dependent work.
+ * Every term is the exact integer value the original expression produced.
+ */
+struct	bme680_comp_plan {
+	/*! par_t1 << 1 */
+	int32_t t1_x2;
+	/*! par_t2 */
+	int32_t t2;
+	/*! par_t3 << 4 */
+	int32_t t3_x16;
+	/*! par_p1 */
+	int32_t p1;
+	/*! par_p2 */
+	int32_t p2;
+	/*! par_p3 << 5 */
+	int32_t p3_x32;
+	/*! par_p4 << 16 */
+	int32_t p4_x65536;
+	/*! par_p5 << 1 */
+	int32_t p5_x2;
+	/*! par_p6 */
+	int32_t p6;
+	/*! par_p7 << 7 */
+	int32_t p7_x128;
+	/*! par_p8 */
+	int32_t p8;
+	/*! par_p9 */
+	int32_t p9;
+	/*! par_p10 */
+	int32_t p10;
+	/*! par_h1 * 16 */
+	int32_t h1_x16;
+	/*! par_h2 */
+	int32_t h2;
+	/*! par_h3 */
+	int32_t h3;
+	/*! par_h4 */
+	int32_t h4;
+	/*! par_h5 */
+	int32_t h5;
+	/*! par_h6 << 7 */
+	int32_t h6_x128;
+	/*! par_h7 */
+	int32_t h7;
+	/*! par_gh1 + 784 */
+	int32_t gh1_784;
+	/*! (par_gh2 + 154009) * 5 */
+	int32_t gh2_x5;
+	/*! ((amb_temp * par_gh3) / 1000) * 256 for amb_temp below */
+	int32_t heat_amb;
+	/*! res_heat_range + 4 */
+	int32_t heat_range_div;
+	/*! (131 * res_heat_val) + 65536 */
+	int32_t heat_val;
+	/*! Ambient temperature heat_amb was built for */
+	int8_t amb_temp;
+	/*! Per gas range: var1 - 16777216, so the divisor is (gas_adc << 15) + gas_ofs */
+	int32_t gas_ofs[16];
+	/*! Per gas range: (lookupTable2 * var1) >> 9, the dividend less divisor / 2 */
+	int64_t gas_var3[16];
+	/*! gas_var3 in single precision, for the quotient estimate */
+	float gas_var3f[16];
+};
+#endif
+
+/*!
+ * @brief Raw ADC frames for bme680_compensate_batch(), one array per field
+ * (structure-of-arrays). gas_adc and gas_range may be NULL when no gas
+ * conversions were captured.
+ */
+struct	bme680_raw_batch {
+	/*! 20-bit temperature ADC values */
+	const uint32_t *temp_adc;
+	/*! 20-bit pressure ADC values */
+	const uint32_t *pres_adc;
+	/*! 16-bit humidity ADC values */
+	const uint16_t *hum_adc;
+	/*! 10-bit gas resistance ADC values */
+	const uint16_t *gas_adc;
+	/*! 4-bit gas range values */
+	const uint8_t *gas_range;
+};
+
+/*!
+ * @brief Compensated output arrays of bme680_compensate_batch(), in the same
+ * units as bme680_field_data. gas_resistance may be NULL.
+ */
+struct	bme680_comp_batch {
+#ifndef BME680_FLOAT_POINT_COMPENSATION
+	/*! Temperature in degree celsius x100 */
+	int16_t *temperature;
+	/*! Pressure in Pascal */
+	uint32_t *pressure;
+	/*! Humidity in % relative humidity x1000 */
+	uint32_t *humidity;
+	/*! Gas resistance in Ohms */
+	uint32_t *gas_resistance;
+#else
+	/*! Temperature in degree celsius */
+	float *temperature;
+	/*! Pressure in Pascal */
+	float *pressure;
+	/*! Humidity in % relative humidity */
+	float *humidity;
+	/*! Gas resistance in Ohms */
+	float *gas_resistance;
+#endif
+};
+
 /*!
  * @brief BME680 sensor settings structure which comprises of ODR,
  * over-sampling and filter settings.
@@ -493,6 +670,67 @@ struct	bme680_gas_sett {
 	uint16_t heatr_dur;
 };
 
+/*!
+ * @brief BME680 heater profile: up to BME680_HEATR_STEPS set-points, loaded
+ * into res_heat_0..9/gas_wait_0..9 at once and selected through nb_conv
+ */
+struct	bme680_heatr_profile {
+	/*! Heater temperature of each step in degree Celsius */
+	uint16_t heatr_temp[BME680_HEATR_STEPS];
+	/*! Heating duration of each step in ms */
+	uint16_t heatr_dur[BME680_HEATR_STEPS];
+	/*! Number of steps in use, 1 to BME680_HEATR_STEPS */
+	uint8_t len;
+};
+
+/*!
+ * @brief Readout statistics, updated by every decoded field burst.
+ * Latency is measured from the forced mode trigger to the readout that
+ * carried its data and needs bme680_dev.get_tick.
+ */
+struct bme680_meas_stats {
+	/*! Readouts that carried a new conversion */
+	uint32_t samples;
+	/*! Readouts whose meas_index did not follow the previous one */
+	uint32_t gaps;
+	/*! Conversions lost in those gaps */
+	uint32_t missed;
+	/*! Readouts with new data but the same meas_index as the previous one */
+	uint32_t repeats;
+	/*! Readouts without new data */
+	uint32_t stale;
+	/*! Readouts with new data but no trigger seen by the driver */
+	uint32_t untriggered;
+	/*! Triggers issued while the previous one was still waiting for its readout */
+	uint32_t unread;
+	/*! Readouts per trigger-to-readout latency bin */
+	uint32_t lat_hist[BME680_LAT_BINS];
+	/*! Sum and maximum of the latencies in ms */
+	uint32_t lat_sum;
+	uint32_t lat_max;
+	/*! Readouts per number of polls without new data before them */
+	uint32_t poll_hist[BME680_POLL_BINS];
+	/*! Tick of the pending trigger */
+	uint32_t t_trigger;
+	/*! Polls without new data since that trigger */
+	uint8_t retries;
+	/*! A trigger is waiting for its readout */
+	uint8_t pending;
+	/*! meas_index of the last new conversion, valid once samples > 0 */
+	uint8_t last_index;
+};
+
+/*!
+ * @brief Shadow copy of the registers BME680_SHADOW_START onwards, kept in
+ * step by bme680_get_regs() and bme680_set_regs()
+ */
+struct bme680_shadow {
+	/*! Last value read from or written to each register */
+	uint8_t reg[BME680_SHADOW_LEN];
+	/*! Bit n set when reg[n] matches the sensor */
+	uint32_t valid;
+};
+
 /*!
  * @brief BME680 device structure
  */
@@ -509,10 +747,16 @@ struct	bme680_dev {
 	int8_t amb_temp;
 	/*! Sensor calibration data */
 	struct bme680_calib_data calib;
+#ifndef BME680_FLOAT_POINT_COMPENSATION
+	/*! Calibration terms precomputed by bme680_build_comp_plan() */
+	struct bme680_comp_plan plan;
+#endif
 	/*! Sensor settings */
 	struct bme680_tph_sett tph_sett;
 	/*! Gas Sensor settings */
 	struct bme680_gas_sett gas_sett;
+	/*! Heater profile loaded by bme680_set_heatr_profile(), NULL for a single set-point */
+	const struct bme680_heatr_profile *heatr_prof;
 	/*! Sensor power modes */
 	uint8_t power_mode;
 	/*! New sensor fields */
@@ -523,8 +767,18 @@ struct	bme680_dev {
 	bme680_com_fptr_t read;
 	/*! Bus write function pointer */
 	bme680_com_fptr_t write;
+	/*! Optional asynchronous bus read function pointer, NULL if unsupported */
+	bme680_com_async_fptr_t read_async;
 	/*! delay function pointer */
 	bme680_delay_fptr_t delay_ms;
+	/*! Optional raw field capture hook, NULL if unused */
+	bme680_field_fptr_t field_hook;
+	/*! Shadow copy of the writable configuration registers */
+	struct bme680_shadow shadow;
+	/*! Optional millisecond tick for the readout latency, NULL if unused */
+	bme680_tick_fptr_t get_tick;
+	/*! Readout statistics */
+	struct bme680_meas_stats stats;
 	/*! Communication function result */
 	int8_t com_rslt;
 };
@@ -0,0 +1,64 @@
+/**
+  ******************************************************************************
+  * @file           : calib_cache.h
+  * @brief          : Flash backed cache of the decoded BME680 calibration block
+  ******************************************************************************
+  * The decoded bme680_calib_data is kept in flash sector 7 (reserved in
+  * STM32F411VETX_FLASH.ld), keyed by chip-id and I2C address and protected by
+  * a CRC32. chip-id is 0x61 on every BME680, so the record also holds the
+  * raw second coefficient block, which is trimmed per part. A warm boot
+  * probes the sensor and reads that block in one burst; if it matches, the
+  * rest comes from flash and the first coefficient burst and the three
+  * single register reads of get_calib_data() are skipped. A sensor swapped
+  * in at the same address fails the match and is read in full.
+  *
+  * calib_cache_invalidate() retires the record without an erase, so the
+  * next boot reads the sensor again (BME680_CALIB_REFRESH in main.c).
+  * tools/bme680_sim/sim_run -B counts the bus transactions of a cold, a
+  * cached and a swapped-sensor boot.
+  ******************************************************************************/
+
+#ifndef CALIB_CACHE_H_
+#define CALIB_CACHE_H_
+
+#include <stdint.h>
+#include "bme680.h"
+
+#define CALIB_CACHE_ADDR		0x08060000UL	/* start of FLASH_SECTOR_7 */
+#define CALIB_CACHE_MAGIC		0x424C4143UL	/* "CALB" */
+
+/* Bump CALIB_CACHE_FORMAT when the record changes. The size of the decoded
+ * block is part of the version too, so a change to bme680_calib_data retires
+ * old records even if nobody bumps the format. */
+#define CALIB_CACHE_FORMAT		2
+#define CALIB_CACHE_VERSION		((uint16_t)((CALIB_CACHE_FORMAT << 10) | sizeof(struct bme680_calib_data)))
+
+struct calib_record {
+	uint32_t magic;
+	uint16_t version;
+	uint8_t chip_id;
+	uint8_t dev_id;
+	uint8_t ident[BME680_COEFF_ADDR2_LEN];	/* raw coefficient block 2 of the part */
+	struct bme680_calib_data calib;
+	uint32_t crc;			/* CRC32 of every byte above */
+};
+
+/* Where the record is read; host builds point it at RAM */
+#ifndef CALIB_CACHE_RECORD
+#define CALIB_CACHE_RECORD		((const struct calib_record *)CALIB_CACHE_ADDR)
+#endif
+
+/* Outcome of the last calib_cache_init() */
+enum calib_cache_src {
+	CALIB_FROM_CACHE,		/* loaded from flash, no coefficient reads */
+	CALIB_FROM_SENSOR,		/* read from the sensor and written back */
+	CALIB_FROM_SENSOR_NOSAVE	/* read from the sensor, flash update failed */
+};
+
+int8_t calib_cache_init(struct bme680_dev *dev, enum calib_cache_src *src);
+uint8_t calib_cache_valid(const struct calib_record *rec, uint8_t chip_id, uint8_t dev_id, const uint8_t *ident);
+int8_t calib_cache_save(const struct bme680_dev *dev, const uint8_t *ident);
+int8_t calib_cache_invalidate(void);
+uint32_t calib_cache_crc32(const uint8_t *buf, uint32_t len);
+
+#endif /* CALIB_CACHE_H_ */
@@ -0,0 +1,25 @@
+/**
+  ******************************************************************************
+  * @file           : cyccnt.h
+  * @brief          : DWT cycle counter helpers for on-target benchmarks
+  ******************************************************************************/
+
+#ifndef CYCCNT_H_
+#define CYCCNT_H_
+
+#include "main.h"
+
+/* Enables the DWT cycle counter; it then counts SYSCLK cycles (96 MHz) */
+static inline void cyccnt_init(void)
+{
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+	DWT->CYCCNT = 0;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+static inline uint32_t cyccnt_read(void)
+{
+	return DWT->CYCCNT;
+}
+
+#endif /* CYCCNT_H_ */
@@ -0,0 +1,46 @@
+/**
+  ******************************************************************************
+  * @file           : fixfmt.h
+  * @brief          : Integer-only formatting of scaled fixed-point values
+  ******************************************************************************
+  * A value is an integer with a given number of decimals. Centi degC is 2,
+  * and Pa read as hPa is also 2. It is printed with prec decimals. Fewer
+  * decimals than it has round half away from zero, and more are padded
+  * with zeros. A result that rounds to zero prints no sign. width pads the
+  * result with spaces on the left, or with zeros after the sign
+  * (FMT_ZERO), or with spaces on the right (FMT_LEFT).
+  *
+  * Calls append at p and return the new end, so a row is built by chaining
+  * them. end is one past the buffer. Output that does not fit is cut off,
+  * and the buffer is always NUL terminated. Nothing here touches printf or
+  * float, so the firmware links without -u _printf_float. Against snprintf
+  * on the same integers, see tools/fmt_bench and BME680_CompBench().
+  *
+  * fmt_printf() and fmt_vprintf() stand in for snprintf where the firmware
+  * prints text. They take the flags '-' and '0', a width, the length
+  * modifiers 'l' and 'h', and the conversions d, i, u, x, X, c, s and %.
+  * Precision, '*', floats and 64-bit values are not handled; such a
+  * conversion is copied to the output as written. Unlike newlib's printf
+  * family, nothing here allocates, so they link in a BME680_ZERO_HEAP
+  * build (see sysmem.c).
+  ******************************************************************************/
+
+#ifndef FIXFMT_H_
+#define FIXFMT_H_
+
+#include <stdarg.h>
+#include <stdint.h>
+
+#define FMT_LEFT		0x01	/* pad on the right */
+#define FMT_ZERO		0x02	/* pad with zeros between sign and digits */
+
+/* Room for any one value: sign, 10 digits, point and 9 zeros of prec */
+#define FMT_VALUE_LEN	24
+
+char *fmt_str(char *p, char *end, const char *s);
+char *fmt_udec(char *p, char *end, uint32_t value, uint8_t decimals, uint8_t prec, uint8_t width, uint8_t flags);
+char *fmt_dec(char *p, char *end, int32_t value, uint8_t decimals, uint8_t prec, uint8_t width, uint8_t flags);
+char *fmt_vprintf(char *p, char *end, const char *fmt, va_list args);
+char *fmt_printf(char *p, char *end, const char *fmt, ...);
+
+#endif /* FIXFMT_H_ */
@@ -0,0 +1,64 @@
+/**
+  ******************************************************************************
+  * @file           : frame_log.h
+  * @brief          : Raw BME680 field-frame capture format and recorder
+  ******************************************************************************
+  * A capture is one frame_log_header followed by frame_log_frame records. The
+  * header carries the decoded calibration of the recorded sensor, so a capture
+  * replays without the sensor. Each frame holds the BME680_FIELD_LENGTH byte
+  * burst exactly as read from BME680_FIELD0_ADDR, the tick it was read at and
+  * a rolling sequence number to spot dropped frames.
+  *
+  * Records are written in the target's native layout: little-endian with
+  * natural alignment. The calib_size and frame_size fields let a reader on
+  * another ABI reject a capture instead of misreading it.
+  ******************************************************************************/
+
+#ifndef FRAME_LOG_H_
+#define FRAME_LOG_H_
+
+#include <stdint.h>
+#include "bme680.h"
+
+#define FRAME_LOG_MAGIC		0x46454D42UL	/* "BMEF" */
+#define FRAME_LOG_VERSION	1
+
+struct frame_log_header {
+	uint32_t magic;
+	uint16_t version;
+	uint16_t frame_size;		/* sizeof(struct frame_log_frame) */
+	uint16_t calib_size;		/* sizeof(struct bme680_calib_data) */
+	uint8_t chip_id;
+	uint8_t dev_id;
+	struct bme680_calib_data calib;	/* t_fine is zero */
+};
+
+struct frame_log_frame {
+	uint32_t t_ms;				/* tick of the read */
+	uint8_t seq;				/* increments by one per frame */
+	uint8_t field[BME680_FIELD_LENGTH];
+};
+
+/* Output function; len bytes of buf are appended to the capture */
+typedef void (*frame_log_write_fptr_t)(const void *buf, uint16_t len, void *ctx);
+
+struct frame_log {
+	frame_log_write_fptr_t write;
+	void *ctx;
+	uint8_t seq;
+	uint32_t frames;
+};
+
+/* Read-only view over a capture held in memory */
+struct frame_log_view {
+	const struct frame_log_header *hdr;
+	const struct frame_log_frame *frame;
+	uint32_t count;
+};
+
+void frame_log_begin(struct frame_log *log, const struct bme680_dev *dev, frame_log_write_fptr_t write, void *ctx);
+void frame_log_add(struct frame_log *log, uint32_t t_ms, const uint8_t *field);
+int8_t frame_log_open(struct frame_log_view *view, const void *buf, uint32_t len);
+void frame_log_load(const struct frame_log_view *view, struct bme680_dev *dev);
+
+#endif /* FRAME_LOG_H_ */
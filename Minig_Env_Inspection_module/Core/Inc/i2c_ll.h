@@ -0,0 +1,49 @@
+/**
+  ******************************************************************************
+  * @file           : i2c_ll.h
+  * @brief          : Interrupt-driven register-level I2C master for short transfers
+  ******************************************************************************
+  * Runs a register read or write on I2C1/I2C2 straight from the event and
+  * error interrupts with the LL register accessors. It has none of the HAL
+  * handle locking, state checks or flag polling. Each bus has one fixed
+  * job descriptor; i2c_transport owns it and starts a job only on an idle
+  * bus, so no further checks are needed.
+  *
+  * A write sends the register address and then the data. A read sends the
+  * register address, a repeated START and then receives the data, using
+  * the single, two and N byte endings of RM0383. The I2Cx_EV/ER handlers
+  * pass their interrupt here first and go to the HAL only when no job is
+  * running, so the HAL DMA transfers on the same bus are left alone. The
+  * result is reported from interrupt context through
+  * i2c_ll_done_callback(), which i2c_transport implements.
+  ******************************************************************************/
+
+#ifndef I2C_LL_H_
+#define I2C_LL_H_
+
+#include <stdint.h>
+
+/* How a job ended */
+enum i2c_ll_status {
+	I2C_LL_OK,
+	I2C_LL_NACK,				/* address or data not acknowledged */
+	I2C_LL_ERROR				/* bus error, arbitration lost or overrun */
+};
+
+/* Jobs run, their interrupts and the CPU cycles spent in i2c_ll_start()
+ * and those interrupts, completion callbacks excluded */
+struct i2c_ll_stats {
+	uint32_t jobs;
+	uint32_t irqs;
+	uint32_t cycles;
+};
+
+extern struct i2c_ll_stats i2c_ll_stats;
+
+int8_t i2c_ll_start(uint8_t bus, uint8_t addr, uint8_t reg_addr, uint8_t *data, uint16_t len, uint8_t read);
+void i2c_ll_abort(uint8_t bus);
+uint8_t i2c_ll_ev_irq(uint8_t bus);
+uint8_t i2c_ll_er_irq(uint8_t bus);
+void i2c_ll_done_callback(uint8_t bus, uint8_t status);
+
+#endif /* I2C_LL_H_ */
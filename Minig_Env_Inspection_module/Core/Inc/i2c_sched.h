@@ -0,0 +1,76 @@
+/**
+  ******************************************************************************
+  * @file           : i2c_sched.h
+  * @brief          : Prioritised transaction queues in front of i2c_transport
+  ******************************************************************************
+  * Each bus has one FIFO per traffic class. Whenever the bus is idle the
+  * oldest transaction of the most urgent non-empty class is started, so a
+  * sensor read waits for at most the transaction already on the wire, never
+  * for a whole display frame. Bulk writes are expected to be queued in
+  * chunks (see SSD1306_UpdateScreenAsync()) so there is a chance to
+  * preempt them between chunks.
+  *
+  * Transactions are only started from thread context: from
+  * i2c_sched_service(), called from the main loop, and from the
+  * synchronous calls while they wait, as a start may run a bus recovery.
+  * Completions arrive from the I2C/DMA interrupts, or in place when a
+  * transfer fails to start, and i2c_sched_submit() may be called from
+  * either.
+  *
+  * i2c_sched_read()/i2c_sched_write()/i2c_sched_read_async() are the
+  * bme680_dev hooks and queue as I2C_CLASS_SENSOR. The time from submit to
+  * start is kept per class in i2c_sched_stats.
+  ******************************************************************************/
+
+#ifndef I2C_SCHED_H_
+#define I2C_SCHED_H_
+
+#include <stdint.h>
+#include "bme680_defs.h"
+#include "i2c_transport.h"
+
+/* Traffic classes, most urgent first */
+enum i2c_class {
+	I2C_CLASS_SENSOR,			/* BME680 register access */
+	I2C_CLASS_ALARM,			/* display frames while the state machine warns */
+	I2C_CLASS_DISPLAY,			/* routine display frames */
+	I2C_CLASSES
+};
+
+/* Queued transactions per bus and class */
+#define I2C_SCHED_DEPTH		8
+
+/* One queued transaction; data must stay valid until cplt has run */
+struct i2c_txn {
+	uint8_t dev_id;
+	uint8_t reg_addr;
+	uint8_t write;
+	uint16_t len;
+	uint8_t *data;
+	bme680_com_cplt_fptr_t cplt;
+	void *ctx;
+	uint32_t t_queued;			/* cycles */
+};
+
+/* Queueing latency per class, bins as in i2c_dev_stats */
+struct i2c_class_stats {
+	uint32_t started;
+	uint32_t rejected;			/* queue full */
+	uint32_t depth_max;
+	uint32_t lat_hist[I2C_LAT_BINS];
+	uint32_t lat_sum;			/* us */
+	uint32_t lat_max;			/* us */
+};
+
+extern struct i2c_class_stats i2c_sched_stats[I2C_CLASSES];
+
+int8_t i2c_sched_submit(uint8_t cls, uint8_t dev_id, uint8_t reg_addr, uint8_t *data, uint16_t len, uint8_t write,
+		bme680_com_cplt_fptr_t cplt, void *ctx);
+void i2c_sched_service(void);
+uint8_t i2c_sched_busy(uint8_t dev_id);
+int8_t i2c_sched_read(uint8_t dev_id, uint8_t reg_addr, uint8_t *reg_data, uint16_t len);
+int8_t i2c_sched_write(uint8_t dev_id, uint8_t reg_addr, uint8_t *reg_data, uint16_t len);
+int8_t i2c_sched_read_async(uint8_t dev_id, uint8_t reg_addr, uint8_t *reg_data, uint16_t len,
+		bme680_com_cplt_fptr_t cplt, void *ctx);
+
+#endif /* I2C_SCHED_H_ */
@@ -0,0 +1,94 @@
+/**
+  ******************************************************************************
+  * @file           : i2c_transport.h
+  * @brief          : DMA backed register transport for BME680s on hi2c1/hi2c2
+  ******************************************************************************
+  * Register transfers go through HAL_I2C_Mem_Read_DMA/HAL_I2C_Mem_Write_DMA,
+  * or through the interrupt-driven i2c_ll engine when they are short or the
+  * bus has no TX DMA stream, and report completion from the I2C/DMA
+  * interrupts. user_i2c_read()/user_i2c_write() are the synchronous
+  * bme680_dev hooks and sleep in WFI while the transfer runs;
+  * user_i2c_read_async() is the asynchronous hook and returns as soon as the
+  * transfer has been queued. Bit 7 of dev_id (I2C_BUS2_FLAG) routes a sensor
+  * to hi2c2; each bus has its own in-flight transfer.
+  *
+  * Every transaction has a deadline of I2C_TIMEOUT_BASE_MS plus its wire
+  * time. A transfer still running at its deadline is abandoned and the bus
+  * recovered: the peripheral is de-initialised, SCL is pulsed until the slave
+  * releases SDA, a STOP is sent and the peripheral is initialised again. Bus
+  * and arbitration errors, and a BUSY flag found set on an idle bus, trigger
+  * the same recovery before the next transaction. A synchronous call on a bus
+  * with a transfer in flight waits for it, up to that transfer's deadline.
+  * i2c_transport_service() expires asynchronous transfers and must be called
+  * from the main loop.
+  ******************************************************************************/
+
+#ifndef I2C_TRANSPORT_H_
+#define I2C_TRANSPORT_H_
+
+#include <stdint.h>
+#include "bme680_defs.h"
+
+/* Transfers shorter than this run on i2c_ll: a few interrupts of a few
+ * dozen cycles each cost less than setting up a HAL DMA transfer */
+#define I2C_DMA_MIN_LEN		8
+
+/* dev_id bit 7 selects hi2c2; the low 7 bits are the I2C address */
+#define I2C_BUS2_FLAG			0x80
+#define I2C_DEV_ADDR(dev_id)	((uint16_t)((dev_id) & 0x7F))
+#define I2C_TRANSPORT_BUSES		2
+
+/* Transaction deadline: the base plus len bytes at about 44 bytes per ms
+ * (9 clocks each at 400 kHz) */
+#define I2C_TIMEOUT_BASE_MS		5
+#define I2C_BYTES_PER_MS		44
+#define I2C_TIMEOUT_MS(len)		(I2C_TIMEOUT_BASE_MS + ((len) + I2C_BYTES_PER_MS - 1) / I2C_BYTES_PER_MS)
+
+/* SCL pulses clocked out by a bus recovery at most, one byte and the ACK */
+#define I2C_RECOVERY_PULSES		9
+#define I2C_RECOVERY_HALF_US	5
+
+/* Devices with their own statistics; any further ones share the last slot */
+#define I2C_TRANSPORT_DEVS		6
+/* Latency histogram: bin n holds transactions under I2C_LAT_BIN0_US << n us,
+ * the last bin everything longer */
+#define I2C_LAT_BINS			8
+#define I2C_LAT_BIN0_US			250
+
+/* Transfer statistics, used to estimate the CPU time handed back per sample */
+struct i2c_xfer_stats {
+	uint32_t dma_xfers;			/* transfers moved by DMA */
+	uint32_t dma_bytes;			/* payload bytes moved by DMA */
+	uint32_t ll_xfers;			/* short transfers run on i2c_ll */
+	uint32_t errors;			/* NACK, bus and DMA errors */
+	uint32_t timeouts;			/* transactions abandoned at their deadline */
+	uint32_t recoveries;		/* bus recoveries run */
+};
+
+/* Per-device outcome and latency of every transaction, recovery included */
+struct i2c_dev_stats {
+	uint8_t used;
+	uint8_t dev_id;
+	uint32_t xfers;
+	uint32_t nacks;				/* address or data not acknowledged */
+	uint32_t errors;			/* bus, arbitration and DMA errors */
+	uint32_t timeouts;
+	uint32_t lat_hist[I2C_LAT_BINS];
+	uint32_t lat_sum;			/* us */
+	uint32_t lat_max;			/* us */
+};
+
+extern struct i2c_xfer_stats i2c_stats;
+extern struct i2c_dev_stats i2c_dev_stats[I2C_TRANSPORT_DEVS];
+
+void i2c_transport_init(void);
+void i2c_transport_service(void);
+int8_t user_i2c_read(uint8_t dev_id, uint8_t reg_addr, uint8_t *reg_data, uint16_t len);
+int8_t user_i2c_write(uint8_t dev_id, uint8_t reg_addr, uint8_t *reg_data, uint16_t len);
+int8_t user_i2c_read_async(uint8_t dev_id, uint8_t reg_addr, uint8_t *reg_data, uint16_t len,
+		bme680_com_cplt_fptr_t cplt, void *ctx);
+int8_t i2c_transport_start(uint8_t dev_id, uint8_t reg_addr, uint8_t *reg_data, uint16_t len, uint8_t write,
+		bme680_com_cplt_fptr_t cplt, void *ctx);
+uint8_t i2c_transport_busy(uint8_t dev_id);
+
+#endif /* I2C_TRANSPORT_H_ */
@@ -0,0 +1,76 @@
+/**
+  ******************************************************************************
+  * @file           : log_ring.h
+  * @brief          : Lock-free console ring drained by a DMA transmitter
+  ******************************************************************************
+  * One producer and one consumer share a byte ring of LOG_RING_SIZE. The
+  * producer is the main loop (myprintf). The consumer is the transmitter's
+  * completion interrupt. The producer alone writes head. The consumer
+  * advances tail by copying up to LOG_RING_CHUNK bytes into the
+  * transmitter's own buffer and hands that to the tx hook (a UART DMA
+  * transfer on target). Because the chunk is a copy, nothing in the ring
+  * is pinned by a transfer in flight.
+  *
+  * When a write does not fit, the policy decides:
+  *   - LOG_RING_DROP_NEWEST: the whole write is dropped. Lines already
+  *     queued go out intact.
+  *   - LOG_RING_DROP_OLDEST: the oldest unsent bytes make room, so the
+  *     latest lines survive a burst. The producer moves tail with a
+  *     compare-and-swap. A completion interrupt that also moves tail makes
+  *     the swap fail, and it is retried against the new tail.
+  * Either way writing never waits on the transmitter, and the drops are
+  * counted in log_ring_stats.
+  *
+  * The start decision is race-free without a lock. The producer publishes
+  * head before it reads busy. The completion interrupt clears busy before
+  * it reads head. So whichever runs second sees the other's data and
+  * starts the next chunk. This holds on one core where the interrupt runs
+  * to completion, as on the STM32F411.
+  ******************************************************************************/
+
+#ifndef LOG_RING_H_
+#define LOG_RING_H_
+
+#include <stdint.h>
+
+#define LOG_RING_SIZE		4096	/* power of two; a telemetry report fits whole */
+#define LOG_RING_CHUNK		64		/* bytes per transmitter start */
+
+enum log_ring_policy {
+	LOG_RING_DROP_NEWEST,
+	LOG_RING_DROP_OLDEST
+};
+
+/* Starts sending len bytes of buf; log_ring_tx_done() must follow once
+ * they are out. Returns 0 if the transfer started. */
+typedef int8_t (*log_ring_tx_fptr_t)(const uint8_t *buf, uint16_t len, void *ctx);
+
+struct log_ring_stats {
+	uint32_t written;			/* bytes accepted */
+	uint32_t sent;				/* bytes handed to the transmitter */
+	uint32_t dropped;			/* writes refused, DROP_NEWEST */
+	uint32_t dropped_bytes;		/* their bytes */
+	uint32_t overwritten;		/* unsent bytes discarded, DROP_OLDEST */
+	uint32_t chunks;
+	uint32_t tx_errors;			/* starts the tx hook refused; their bytes are lost */
+	uint16_t fill_max;			/* most bytes queued at once */
+};
+
+struct log_ring {
+	uint8_t buf[LOG_RING_SIZE];
+	uint8_t chunk[LOG_RING_CHUNK];
+	volatile uint32_t head;		/* free-running, producer only */
+	volatile uint32_t tail;		/* free-running, consumer or the DROP_OLDEST swap */
+	volatile uint8_t busy;		/* chunk in flight */
+	enum log_ring_policy policy;
+	log_ring_tx_fptr_t tx;
+	void *ctx;
+	struct log_ring_stats stats;
+};
+
+void log_ring_init(struct log_ring *ring, enum log_ring_policy policy, log_ring_tx_fptr_t tx, void *ctx);
+uint16_t log_ring_write(struct log_ring *ring, const void *data, uint16_t len);
+void log_ring_tx_done(struct log_ring *ring);
+uint16_t log_ring_fill(const struct log_ring *ring);
+
+#endif /* LOG_RING_H_ */
@@ -0,0 +1,86 @@
+/**
+  ******************************************************************************
+  * @file           : meas_engine.h
+  * @brief          : Non-blocking forced mode measurement engine for the BME680
+  ******************************************************************************
+  * The engine triggers a forced conversion, returns straight away and hands the
+  * compensated sample to a callback once the profile duration has elapsed and
+  * the data-ready poll succeeds. Time comes from a tick function pointer so the
+  * same code runs against HAL_GetTick() on target and a virtual clock on host.
+  * When the sensor provides a read_async hook the field burst is fetched in
+  * the background and compensated on the next service call. With a heater
+  * profile loaded, consecutive conversions step through it and each full pass
+  * is reported as a per-step gas resistance vector.
+  ******************************************************************************/
+
+#ifndef MEAS_ENGINE_H_
+#define MEAS_ENGINE_H_
+
+#include <stdint.h>
+#include "bme680.h"
+
+/* Number of data-ready polls after the profile duration before giving up */
+#define MEAS_ENGINE_MAX_POLLS		UINT8_C(10)
+
+/* Millisecond time source */
+typedef uint32_t (*meas_tick_fptr_t)(void);
+
+/* Completion callback; data is only valid when rslt == BME680_OK */
+typedef void (*meas_ready_fptr_t)(int8_t rslt, const struct bme680_field_data *data, void *ctx);
+
+/* One pass over the heater profile: gas resistance per step */
+struct meas_gas_scan {
+#ifndef BME680_FLOAT_POINT_COMPENSATION
+	uint32_t gas_resistance[BME680_HEATR_STEPS];	/* Ohms, as bme680_field_data */
+#else
+	float gas_resistance[BME680_HEATR_STEPS];
+#endif
+	uint16_t valid;				/* bit n set if step n had a valid, stable reading */
+	uint8_t len;				/* steps in the profile */
+	uint32_t seq;				/* completed scans */
+};
+
+/* Scan callback, called once the last profile step has been sampled */
+typedef void (*meas_scan_fptr_t)(const struct meas_gas_scan *scan, void *ctx);
+
+enum meas_state {
+	MEAS_IDLE,			/* no conversion in flight */
+	MEAS_CONVERTING,	/* waiting for the profile duration to elapse */
+	MEAS_POLLING,		/* profile elapsed, polling for new_data */
+	MEAS_READING		/* asynchronous field read in flight */
+};
+
+struct meas_engine {
+	struct bme680_dev *dev;
+	meas_tick_fptr_t get_tick;
+	meas_ready_fptr_t on_ready;
+	void *ctx;
+
+	enum meas_state state;
+	uint32_t t_trigger;			/* tick at which the conversion was started */
+	uint32_t deadline;			/* tick of the next poll */
+	uint8_t polls_left;
+	struct bme680_field_data data;
+
+	/* Asynchronous read state, used when dev->read_async is set */
+	uint8_t field_buff[BME680_FIELD_LENGTH];
+	volatile uint8_t xfer_done;
+	volatile int8_t xfer_rslt;
+
+	/* Heater profile scan, used when dev->heatr_prof is set */
+	meas_scan_fptr_t on_scan;
+	uint8_t scan_step;			/* profile step of the next conversion */
+	struct meas_gas_scan scan;
+
+	uint32_t samples;			/* completed conversions */
+	uint32_t errors;			/* bus errors and poll timeouts */
+};
+
+void meas_engine_init(struct meas_engine *eng, struct bme680_dev *dev, meas_tick_fptr_t get_tick,
+		meas_ready_fptr_t on_ready, void *ctx);
+int8_t meas_engine_start(struct meas_engine *eng);
+int8_t meas_engine_service(struct meas_engine *eng);
+void meas_engine_set_scan(struct meas_engine *eng, meas_scan_fptr_t on_scan);
+uint8_t meas_engine_busy(const struct meas_engine *eng);
+
+#endif /* MEAS_ENGINE_H_ */
@@ -0,0 +1,88 @@
+/**
+  ******************************************************************************
+  * @file           : os_ctrl.h
+  * @brief          : Adaptive oversampling and IIR filter controller for the BME680
+  ******************************************************************************
+  * The controller keeps a sliding window of the last OS_CTRL_WINDOW samples of
+  * temperature, pressure and humidity. From the sample-to-sample differences it
+  * estimates a noise floor (their standard deviation / sqrt(2)) and a trend
+  * (their mean). Noise above noise_hi or a trend raises the oversampling level
+  * at once. Noise below noise_lo on every channel for OS_CTRL_HOLD samples
+  * lowers it by one step, which shortens the conversion. While a trend is
+  * present the IIR filter is capped so the output follows the change.
+  ******************************************************************************/
+
+#ifndef OS_CTRL_H_
+#define OS_CTRL_H_
+
+#include <stdint.h>
+#include "bme680.h"
+
+#define OS_CTRL_WINDOW		8		/* samples per noise estimate */
+#define OS_CTRL_HOLD		16		/* stable samples before stepping down */
+#define OS_CTRL_LEVELS		4		/* level 0 = fastest, OS_CTRL_LEVELS - 1 = main() defaults */
+#define OS_CTRL_TREND_FILTER	BME680_FILTER_SIZE_3
+
+/* Channels, in bme680_field_data units (see BME680_TEMP_SCALE and friends) */
+enum os_ctrl_chan {
+	OS_CTRL_TEMP,
+	OS_CTRL_PRES,
+	OS_CTRL_HUM,
+	OS_CTRL_CHANS
+};
+
+/* Oversampling and filter settings of one level */
+struct os_ctrl_level {
+	uint8_t os_temp;
+	uint8_t os_pres;
+	uint8_t os_hum;
+	uint8_t filter;
+};
+
+/* Per channel thresholds, in the units of bme680_field_data */
+struct os_ctrl_limits {
+	float noise_lo;				/* below: channel counts as stable */
+	float noise_hi;				/* above: raise the level */
+	float trend;				/* |mean change per sample| above: raise the level */
+};
+
+struct os_ctrl {
+	struct os_ctrl_limits limits[OS_CTRL_CHANS];
+	float hist[OS_CTRL_CHANS][OS_CTRL_WINDOW];
+	uint8_t head;
+	uint8_t fill;
+
+	uint8_t level;
+	uint8_t trend;				/* a trend was seen in the current window */
+	uint8_t stable;				/* consecutive stable samples */
+	float noise[OS_CTRL_CHANS];	/* latest noise floor estimate */
+
+	/* Achieved rate and duty cycle since os_ctrl_init() */
+	uint32_t samples;
+	uint32_t t_first;
+	uint32_t t_last;
+	uint32_t busy_ms;			/* sum of measurement durations */
+	uint32_t changes;			/* settings updates written to the sensor */
+};
+
+/* Result of os_ctrl_replay() */
+struct os_ctrl_replay_result {
+	uint32_t samples;
+	uint32_t busy_ms_fixed;		/* measurement time at the top level */
+	uint32_t busy_ms_adaptive;	/* measurement time with the controller */
+	uint32_t changes;
+	uint8_t level_hist[OS_CTRL_LEVELS];	/* percentage of samples at each level */
+};
+
+extern const struct os_ctrl_level os_ctrl_levels[OS_CTRL_LEVELS];
+
+void os_ctrl_init(struct os_ctrl *ctrl, uint8_t level);
+uint8_t os_ctrl_update(struct os_ctrl *ctrl, const struct bme680_field_data *data, uint32_t now, uint16_t meas_dur);
+void os_ctrl_settings(const struct os_ctrl *ctrl, struct bme680_tph_sett *tph);
+int8_t os_ctrl_apply(struct os_ctrl *ctrl, struct bme680_dev *dev);
+float os_ctrl_rate(const struct os_ctrl *ctrl);
+float os_ctrl_duty(const struct os_ctrl *ctrl);
+void os_ctrl_replay(const struct bme680_field_data *trace, uint32_t count, const struct bme680_dev *dev,
+		struct os_ctrl_replay_result *res);
+
+#endif /* OS_CTRL_H_ */
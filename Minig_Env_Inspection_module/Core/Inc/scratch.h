@@ -0,0 +1,54 @@
+/**
+  ******************************************************************************
+  * @file           : scratch.h
+  * @brief          : Statically sized scratch arenas in place of the heap
+  ******************************************************************************
+  * An arena is a fixed block of .bss handed out from the bottom up. A user
+  * takes a mark, takes buffers and releases back to the mark when done, so
+  * buffers nest like stack frames. Nothing is freed on its own. Taking more
+  * than is left fails and returns NULL instead of growing anything. Every
+  * arena tracks its peak use and its failed takes, so the sizes below can
+  * be trimmed from a running system.
+  *
+  * The firmware is single threaded apart from interrupts, and no interrupt
+  * takes from an arena. That is what makes the release-to-mark rule
+  * enough.
+  *
+  * With BME680_ZERO_HEAP defined, sysmem.c's _sbrk() no longer links. Any
+  * call that reaches newlib's malloc then fails the link (see sysmem.c).
+  * The arenas are filled through fixfmt.h, never newlib's printf family,
+  * which can allocate.
+  ******************************************************************************/
+
+#ifndef SCRATCH_H_
+#define SCRATCH_H_
+
+#include <stdint.h>
+
+/* Format arena: a console line of myprintf() or a display row. The
+ * console line is taken for one call and released. The row is taken for
+ * one display refresh. Longer console lines are truncated. */
+#define SCRATCH_LINE_LEN	128
+#define SCRATCH_ROW_LEN		24
+#define SCRATCH_FMT_SIZE	(SCRATCH_LINE_LEN + SCRATCH_ROW_LEN)
+
+struct scratch {
+	uint8_t *base;
+	uint16_t size;
+	uint16_t used;
+	uint16_t peak;				/* largest used seen */
+	uint16_t fails;				/* takes that did not fit */
+};
+
+/* Defines an arena over its own static block */
+#define SCRATCH_ARENA(name, bytes) \
+	static uint32_t name##_block[((bytes) + 3) / 4]; \
+	struct scratch name = { (uint8_t *)name##_block, sizeof(name##_block), 0, 0, 0 }
+
+extern struct scratch scratch_fmt;
+
+void *scratch_take(struct scratch *arena, uint16_t len);
+uint16_t scratch_mark(const struct scratch *arena);
+void scratch_release(struct scratch *arena, uint16_t mark);
+
+#endif /* SCRATCH_H_ */
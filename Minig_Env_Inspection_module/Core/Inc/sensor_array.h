@@ -0,0 +1,74 @@
+/**
+  ******************************************************************************
+  * @file           : sensor_array.h
+  * @brief          : Scheduler for several BME680s across I2C buses and addresses
+  ******************************************************************************
+  * Each node owns a bme680_dev and a measurement engine. Forced mode triggers
+  * are staggered across the sample period, so one sensor converts (heater on,
+  * bus idle) while another is triggered or read out. At most one field read
+  * is in flight per bus. Consecutive failures take a node offline and it is
+  * retried at a slower rate. Buses are identified by a caller-supplied
+  * bus_busy hook, so the scheduler also runs on host against simulated devices.
+  ******************************************************************************/
+
+#ifndef SENSOR_ARRAY_H_
+#define SENSOR_ARRAY_H_
+
+#include <stdint.h>
+#include "meas_engine.h"
+
+/* Two addresses on each of two buses */
+#define SENSOR_ARRAY_MAX			4
+
+/* Consecutive failures before a node is marked offline */
+#define SENSOR_ARRAY_MAX_FAILS		5
+
+/* An offline node is retried every SENSOR_ARRAY_BACKOFF sample periods */
+#define SENSOR_ARRAY_BACKOFF		8
+
+/* Per-sensor sample callback; data is only valid when rslt == BME680_OK */
+typedef void (*sensor_sample_fptr_t)(uint8_t idx, int8_t rslt, const struct bme680_field_data *data, void *ctx);
+
+/* Reports whether the bus that dev_id lives on has a transfer in flight */
+typedef uint8_t (*sensor_bus_busy_fptr_t)(uint8_t dev_id);
+
+struct sensor_health {
+	uint32_t samples;			/* delivered samples */
+	uint32_t errors;			/* bus errors and data-ready timeouts */
+	uint32_t deferred;			/* service passes skipped on a busy bus */
+	uint32_t refused;			/* triggers refused while the sensor still converted */
+	uint8_t fails;				/* consecutive failures */
+	uint8_t offline;			/* set after SENSOR_ARRAY_MAX_FAILS failures */
+	int8_t last_rslt;
+};
+
+struct sensor_array;
+
+struct sensor_node {
+	struct bme680_dev dev;
+	struct meas_engine eng;
+	struct sensor_health health;
+	uint32_t next_trigger;
+	uint32_t retry_at;			/* a refused trigger is retried from here */
+	uint8_t idx;
+	struct sensor_array *arr;
+};
+
+struct sensor_array {
+	struct sensor_node node[SENSOR_ARRAY_MAX];
+	uint8_t count;
+	uint32_t period;			/* per-sensor sample period in ms */
+	meas_tick_fptr_t get_tick;
+	sensor_bus_busy_fptr_t bus_busy;
+	sensor_sample_fptr_t on_sample;
+	void *ctx;
+};
+
+void sensor_array_init(struct sensor_array *arr, meas_tick_fptr_t get_tick, sensor_bus_busy_fptr_t bus_busy,
+		uint32_t period, sensor_sample_fptr_t on_sample, void *ctx);
+int8_t sensor_array_add(struct sensor_array *arr, const struct bme680_dev *dev);
+void sensor_array_start(struct sensor_array *arr);
+void sensor_array_service(struct sensor_array *arr);
+uint32_t sensor_array_min_period(const struct sensor_array *arr);
+
+#endif /* SENSOR_ARRAY_H_ */
@@ -91,10 +91,37 @@ uint8_t SSD1306_Init(void);
 /** 
  * @brief  Updates buffer from internal RAM to LCD
  * @note   This function must be called each time you do some changes to LCD, to update buffer from RAM to LCD
+ * @note   The update stops at the first failed write; the next one resends the whole frame
+ * @param  None
+ * @retval Update status:
+ *           - 0: a write failed, the LCD shows a partial frame
+ *           - > 0: LCD updated
+ */
+uint8_t SSD1306_UpdateScreen(void);
+
+/**
+ * @brief  Queues the buffer for the LCD through the I2C scheduler and returns
+ * @note   The buffer is copied first and may be drawn into straight away. Each page goes out as
+ *         one command write and SSD1306_WIDTH / 32 data writes, so more urgent classes get the
+ *         bus between them. A call while a frame is on its way leaves the buffer pending until
+ *         it has finished; i2c_sched_service() and @ref SSD1306_Service() must run from the
+ *         main loop.
+ * @note   Not to be mixed with @ref SSD1306_UpdateScreen() while a frame is on its way
+ * @param  cls: i2c_sched traffic class of the frame
+ * @retval Queue status:
+ *           - 0: the first write could not be queued
+ *           - > 0: frame queued
+ */
+uint8_t SSD1306_UpdateScreenAsync(uint8_t cls);
+
+/**
+ * @brief  Starts the frame @ref SSD1306_UpdateScreenAsync() left pending, once the one before
+ *         it has finished
+ * @note   Copies the buffer, so it must be called from thread context, not from a completion
  * @param  None
  * @retval None
  */
-void SSD1306_UpdateScreen(void);
+void SSD1306_Service(void);
 
 /**
  * @brief  Toggles pixels invertion inside internal RAM
@@ -238,25 +265,23 @@ void SSD1306_DrawFilledCircle(int16_t x0, int16_t y0, int16_t r, SSD1306_COLOR_t
 void ssd1306_I2C_Init();
 
 /**
- * @brief  Writes single byte to slave
- * @param  *I2Cx: I2C used
+ * @brief  Writes single byte to slave through i2c_transport
  * @param  address: 7 bit slave address, left aligned, bits 7:1 are used, LSB bit is not used
  * @param  reg: register to write to
  * @param  data: data to be written
- * @retval None
+ * @retval 0 on success, -1 on NACK, bus error or timeout
  */
-void ssd1306_I2C_Write(uint8_t address, uint8_t reg, uint8_t data);
+int8_t ssd1306_I2C_Write(uint8_t address, uint8_t reg, uint8_t data);
 
 /**
- * @brief  Writes multi bytes to slave
- * @param  *I2Cx: I2C used
+ * @brief  Writes multi bytes to slave through i2c_transport
  * @param  address: 7 bit slave address, left aligned, bits 7:1 are used, LSB bit is not used
  * @param  reg: register to write to
  * @param  *data: pointer to data array to write it to slave
  * @param  count: how many bytes will be written
- * @retval None
+ * @retval 0 on success, -1 on NACK, bus error or timeout
  */
-void ssd1306_I2C_WriteMulti(uint8_t address, uint8_t reg, uint8_t *data, uint16_t count);
+int8_t ssd1306_I2C_WriteMulti(uint8_t address, uint8_t reg, uint8_t *data, uint16_t count);
 
 /**
  * @brief  Draws the Bitmap
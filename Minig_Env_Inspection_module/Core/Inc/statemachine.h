@@ -9,4 +9,26 @@
   * @Assignment     : Final Project
   ******************************************************************************/
 
-void sensor_statemachine(float t1, float h1, float p1, float g1);
+#ifndef STATEMACHINE_H_
+#define STATEMACHINE_H_
+
+#include "bme680.h"
+#include "air_quality.h"
+#include "derived.h"
+
+/* Readings are compared in bme680_field_data units: scaled integers in the
+ * integer build, floats when BME680_FLOAT_POINT_COMPENSATION is defined */
+#ifndef BME680_FLOAT_POINT_COMPENSATION
+typedef int32_t sm_value_t;
+#else
+typedef float sm_value_t;
+#endif
+
+/* Confirmed state from which the red LED is lit */
+#define SM_STATE_DANGER		2
+
+extern struct aq_engine air_quality;
+
+uint8_t sensor_statemachine(const struct bme680_field_data *data, const struct derived_data *derived);
+
+#endif /* STATEMACHINE_H_ */
@@ -0,0 +1,73 @@
+/**
+  ******************************************************************************
+  * @file           : task_sched.h
+  * @brief          : Cooperative scheduler of periodic tasks
+  ******************************************************************************
+  * Tasks are plain functions that run to completion. Each has a period
+  * and a deadline in ms. A task is released every period. When several
+  * are due, the one added first runs first. A task that finishes more than
+  * deadline ms after its release counts as an overrun. Releases missed
+  * while other tasks ran are dropped, not run in a burst, and counted as
+  * skipped.
+  *
+  * Time comes from two caller hooks, as in sensor_array: a ms tick and a
+  * cycle counter. When nothing is due, the idle hook runs; on target that
+  * is WFI until the next SysTick. A host build can instead advance virtual
+  * time there. Per task the scheduler keeps run, overrun and skip counts,
+  * the worst-case execution time and the total execution time. The CPU
+  * share is the total over the elapsed ticks, so the host shows the share
+  * a CPU of cycles_per_ms would need.
+  ******************************************************************************/
+
+#ifndef TASK_SCHED_H_
+#define TASK_SCHED_H_
+
+#include <stdint.h>
+#include "meas_engine.h"
+
+#define TASK_SCHED_MAX		8
+
+typedef void (*task_fptr_t)(void *ctx);
+
+/* Cycle counter, e.g. the DWT CYCCNT */
+typedef uint32_t (*task_cycles_fptr_t)(void);
+
+/* Called when no task is due */
+typedef void (*task_idle_fptr_t)(void);
+
+struct task {
+	const char *name;
+	task_fptr_t fn;
+	void *ctx;
+	uint32_t period;			/* ms */
+	uint32_t deadline;			/* ms after release */
+	uint32_t release;			/* tick of the next release */
+
+	uint32_t runs;
+	uint32_t overruns;			/* finished past the deadline */
+	uint32_t skipped;			/* releases dropped while late */
+	uint32_t wcet;				/* cycles */
+	uint64_t busy;				/* cycles */
+};
+
+struct task_sched {
+	struct task task[TASK_SCHED_MAX];
+	uint8_t count;
+	meas_tick_fptr_t get_tick;
+	task_cycles_fptr_t get_cycles;
+	task_idle_fptr_t idle;
+	uint32_t cycles_per_ms;
+	uint32_t t_start;			/* tick of task_sched_start() or the last reset */
+	uint32_t idles;				/* idle hook calls */
+};
+
+void task_sched_init(struct task_sched *sched, meas_tick_fptr_t get_tick, task_cycles_fptr_t get_cycles,
+		uint32_t cycles_per_ms, task_idle_fptr_t idle);
+int8_t task_sched_add(struct task_sched *sched, const char *name, task_fptr_t fn, void *ctx, uint32_t period,
+		uint32_t deadline, uint32_t offset);
+void task_sched_start(struct task_sched *sched);
+void task_sched_run(struct task_sched *sched);
+uint32_t task_sched_share(const struct task_sched *sched, uint8_t idx);
+void task_sched_reset_stats(struct task_sched *sched);
+
+#endif /* TASK_SCHED_H_ */
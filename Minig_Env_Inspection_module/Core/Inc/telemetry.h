@@ -0,0 +1,93 @@
+/**
+  ******************************************************************************
+  * @file           : telemetry.h
+  * @brief          : Binary telemetry frames: COBS framing, CRC16, scaled fields
+  ******************************************************************************
+  * Each sample goes out as one frame of at most TELEM_FRAME_MAX bytes, in
+  * place of the lines of the text report. The payload is TELEM_SAMPLE_LEN
+  * bytes, little-endian, at fixed offsets:
+  *
+  *    0  u8   type, TELEM_TYPE_SAMPLE; a new layout gets a new type
+  *    1  u8   node, the sensor array index
+  *    2  u16  seq, +1 per frame sent; a gap is frames lost on the way
+  *    4  u32  t_ms, tick the sample was latched at
+  *    8  i16  temperature, centi degC
+  *   10  u32  pressure, Pa
+  *   14  u32  humidity, milli %rH
+  *   18  u32  gas resistance, ohm
+  *   22  i16  dew point, centi degC
+  *   24  u16  absolute humidity, centi g/m3
+  *   26  i32  height above the reference level, cm
+  *   30  u16  gas index, 0 to AQ_INDEX_MAX
+  *   32  u8   state of the state machine, TELEM_STATE_NONE off node 0
+  *   33  u8   sensor status: new data, gas valid, heater stable bits
+  *
+  * A CRC-16/CCITT-FALSE (poly 0x1021, init 0xFFFF) of the payload follows
+  * it, low byte first. The payload and CRC are COBS encoded and closed by
+  * a 0x00 delimiter. So a zero byte always ends a frame, and a reader
+  * joining mid-stream or losing bytes resynchronises on the next one.
+  * Any frame that fails to decode, or has the wrong length or CRC, is
+  * dropped whole.
+  *
+  * tools/telem_decode is the host decoder.
+  ******************************************************************************/
+
+#ifndef TELEMETRY_H_
+#define TELEMETRY_H_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define TELEM_TYPE_SAMPLE	0x01
+#define TELEM_SAMPLE_LEN	34
+#define TELEM_CRC_LEN		2
+/* COBS adds one byte per 254 and the delimiter one more */
+#define TELEM_FRAME_MAX		(TELEM_SAMPLE_LEN + TELEM_CRC_LEN + 2)
+
+#define TELEM_STATE_NONE	0xFF	/* node without a state machine */
+
+struct bme680_field_data;
+struct derived_data;
+
+/* One sample in the wire units */
+struct telem_sample {
+	uint8_t node;
+	uint8_t state;
+	uint8_t status;
+	uint16_t gas_index;
+	uint32_t t_ms;
+	int16_t temperature;		/* centi degC */
+	uint32_t pressure;			/* Pa */
+	uint32_t humidity;			/* milli %rH */
+	uint32_t gas_resistance;	/* ohm */
+	int16_t dew_point;			/* centi degC */
+	uint16_t abs_humidity;		/* centi g/m3 */
+	int32_t height;				/* cm */
+};
+
+/* Output function; len bytes of buf are one whole frame */
+typedef void (*telem_write_fptr_t)(const void *buf, uint16_t len, void *ctx);
+
+struct telem {
+	telem_write_fptr_t write;
+	void *ctx;
+	uint16_t seq;
+	uint32_t frames;
+};
+
+uint16_t telem_crc16(const uint8_t *buf, uint16_t len);
+uint16_t telem_cobs_encode(const uint8_t *in, uint16_t len, uint8_t *out);
+void telem_sample_set(struct telem_sample *sample, const struct bme680_field_data *data,
+		const struct derived_data *derived);
+uint16_t telem_encode(const struct telem_sample *sample, uint16_t seq, uint8_t *frame);
+void telem_init(struct telem *tm, telem_write_fptr_t write, void *ctx);
+void telem_send(struct telem *tm, const struct telem_sample *sample);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TELEMETRY_H_ */
@@ -0,0 +1,71 @@
+/**
+  ******************************************************************************
+  * @file           : air_quality.c
+  * @brief          : Streaming gas baseline and air-quality index
+  ******************************************************************************
+**/
+
+#include "air_quality.h"
+
+/***********************************************************************
+ * @name aq_init()
+ * @brief Starts an engine over, warm-up included
+ * @return void
+ ***********************************************************************/
+void aq_init(struct aq_engine *aq, int32_t hum_slope)
+{
+	aq->hum_slope = hum_slope;
+	aq->baseline = 0;
+	aq->index = 0;
+	aq->warmup = 0;
+	aq->samples = 0;
+	aq->skipped = 0;
+}
+
+/***********************************************************************
+ * @name aq_update()
+ * @brief Adds a compensated sample. The index is taken against the
+ *        baseline before the sample moves it. Samples without a valid,
+ *        heat-stable gas reading leave everything as it was.
+ * @return index, 0 (baseline air) to AQ_INDEX_MAX
+ ***********************************************************************/
+uint16_t aq_update(struct aq_engine *aq, const struct bme680_field_data *data)
+{
+	uint32_t ohm = (uint32_t)(data->gas_resistance / BME680_GAS_SCALE);
+	int32_t hum = (int32_t)(data->humidity * (1000 / BME680_HUM_SCALE));
+	int32_t lr, deficit;
+
+	if (!(data->status & BME680_GASM_VALID_MSK) || !(data->status & BME680_HEAT_STAB_MSK) || (ohm == 0))
+	{
+		aq->skipped++;
+		return aq->index;
+	}
+	aq->samples++;
+
+	/* Humid air has pulled the reading down; add that back */
+	lr = fx_log2(ohm) + aq->hum_slope * (hum - AQ_HUM_REF) / 1000;
+
+	if (aq->warmup < AQ_WARMUP_SAMPLES)
+	{
+		aq->baseline = (aq->warmup == 0) ? lr : aq->baseline + (lr - aq->baseline) / 2;
+		aq->warmup++;
+		aq->index = 0;
+		return 0;
+	}
+
+	deficit = aq->baseline - lr;
+	if (deficit <= 0)
+		aq->index = 0;
+	else if (deficit >= (AQ_INDEX_MAX << 16) / AQ_INDEX_PER_HALVING)
+		aq->index = AQ_INDEX_MAX;
+	else
+		aq->index = (uint16_t)((deficit * AQ_INDEX_PER_HALVING) >> 16);
+
+	/* Rounded up so the decay never stalls on small differences */
+	if (lr > aq->baseline)
+		aq->baseline += (lr - aq->baseline) >> AQ_RISE_SHIFT;
+	else
+		aq->baseline -= (aq->baseline - lr + (1 << AQ_DECAY_SHIFT) - 1) >> AQ_DECAY_SHIFT;
+
+	return aq->index;
+}
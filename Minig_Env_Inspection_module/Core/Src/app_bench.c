@@ -0,0 +1,319 @@
+/**
+  ******************************************************************************
+  * @file           : app_bench.c
+  * @brief          : Benchmarks, replay, capture and gas scan of the firmware
+  ******************************************************************************
+**/
+
+#include <stdio.h>
+#include "main.h"
+#include "app_tasks.h"
+#include "app_bench.h"
+#include "cyccnt.h"
+#include "scratch.h"
+#include "i2c_transport.h"
+#include "i2c_ll.h"
+#include "ssd1306.h"
+
+/* Define BME680_OS_REPLAY to record node 0 and print the duty cycle the
+ * oversampling controller would save on that trace once it is full */
+#ifdef BME680_OS_REPLAY
+#define OS_REPLAY_SAMPLES	256
+#endif
+
+#ifdef BME680_I2C_BENCH
+extern I2C_HandleTypeDef hi2c1;
+extern I2C_HandleTypeDef hi2c2;
+#endif
+#ifdef BME680_FRAME_LOG
+extern UART_HandleTypeDef huart2;
+
+struct frame_log frame_log;
+#endif
+
+#ifdef BME680_COMP_BENCH
+#define COMP_BENCH_FRAMES	64
+
+/* The rows as one format string each, as before fixfmt.h. newlib's
+ * snprintf can reach malloc, so the zero-heap build times fmt_printf() */
+#ifdef BME680_ZERO_HEAP
+#define ROW_PRINTF(row, ...)	fmt_printf(row, row + SCRATCH_ROW_LEN, __VA_ARGS__)
+#define ROW_PRINTF_NAME			"fmt_printf"
+#else
+#define ROW_PRINTF(row, ...)	snprintf(row, SCRATCH_ROW_LEN, __VA_ARGS__)
+#define ROW_PRINTF_NAME			"snprintf"
+#endif
+
+/***********************************************************************
+ * @name BME680_CompBench()
+ * @brief Times bme680_compensate_field() and bme680_compensate_batch()
+ *        on the last raw field burst with the DWT cycle counter and
+ *        prints cycles per sample and batch throughput over UART, the
+ *        gas pass next to the 64-bit division it replaced, then the
+ *        cost and accuracy of derived_compute() against libm
+ * @return void
+ ***********************************************************************/
+void BME680_CompBench(void)
+{
+	static uint32_t temp_adc[COMP_BENCH_FRAMES], pres_adc[COMP_BENCH_FRAMES];
+	static uint16_t hum_adc[COMP_BENCH_FRAMES], gas_adc[COMP_BENCH_FRAMES];
+	static uint8_t gas_range[COMP_BENCH_FRAMES];
+#ifndef BME680_FLOAT_POINT_COMPENSATION
+	static int16_t temperature[COMP_BENCH_FRAMES];
+	static uint32_t pressure[COMP_BENCH_FRAMES], humidity[COMP_BENCH_FRAMES], gas_res[COMP_BENCH_FRAMES];
+#else
+	static float temperature[COMP_BENCH_FRAMES];
+	static float pressure[COMP_BENCH_FRAMES], humidity[COMP_BENCH_FRAMES], gas_res[COMP_BENCH_FRAMES];
+#endif
+#ifndef BME680_FLOAT_POINT_COMPENSATION
+	const struct bme680_comp_plan *plan;
+	uint32_t ref_cycles;
+	int32_t var2;
+#endif
+	const uint8_t *buff = sensors.node[0].eng.field_buff;
+	struct bme680_raw_batch raw = { temp_adc, pres_adc, hum_adc, gas_adc, gas_range };
+	struct bme680_comp_batch comp = { temperature, pressure, humidity, gas_res };
+	struct bme680_field_data bench, point;
+	struct derived_data fixed, libm;
+	uint32_t start, cycles, libm_cycles, err[3] = { 0, 0, 0 };
+	uint16_t i, mark;
+	uint8_t line;
+	char *row;
+
+	cyccnt_init();
+	start = cyccnt_read();
+	for (i = 0; i < 1000; i++)
+		bme680_compensate_field(buff, &bench, &sensors.node[0].dev);
+	cycles = cyccnt_read() - start;
+	myprintf("\r\n Compensation: %lu cycles/sample ", cycles / 1000);
+
+	/* Same field layout as the driver's parse_field_data() */
+	for (i = 0; i < COMP_BENCH_FRAMES; i++)
+	{
+		pres_adc[i] = ((uint32_t)buff[2] << 12) | ((uint32_t)buff[3] << 4) | (buff[4] >> 4);
+		temp_adc[i] = ((uint32_t)buff[5] << 12) | ((uint32_t)buff[6] << 4) | (buff[7] >> 4);
+		hum_adc[i] = ((uint16_t)buff[8] << 8) | buff[9];
+		gas_adc[i] = ((uint16_t)buff[13] << 2) | (buff[14] >> 6);
+		gas_range[i] = buff[14] & BME680_GAS_RANGE_MSK;
+	}
+
+	start = cyccnt_read();
+	bme680_compensate_batch(&raw, &comp, COMP_BENCH_FRAMES, &sensors.node[0].dev);
+	cycles = cyccnt_read() - start;
+	myprintf("\r\n Batch: %lu cycles/sample, %lu samples/s ", cycles / COMP_BENCH_FRAMES,
+			(uint32_t)(((uint64_t)HAL_RCC_GetSysClockFreq() * COMP_BENCH_FRAMES) / cycles));
+
+	/* Gas share of the batch: the same frames without the gas pass */
+	raw.gas_adc = NULL;
+	start = cyccnt_read();
+	bme680_compensate_batch(&raw, &comp, COMP_BENCH_FRAMES, &sensors.node[0].dev);
+	cycles -= cyccnt_read() - start;
+#ifndef BME680_FLOAT_POINT_COMPENSATION
+	/* The same frames through the reference formula's 64-bit division */
+	plan = &sensors.node[0].dev.plan;
+	start = cyccnt_read();
+	for (i = 0; i < COMP_BENCH_FRAMES; i++)
+	{
+		var2 = ((int32_t)gas_adc[i] << 15) + plan->gas_ofs[gas_range[i]];
+		gas_res[i] = (uint32_t)((plan->gas_var3[gas_range[i]] + (var2 >> 1)) / var2);
+	}
+	ref_cycles = cyccnt_read() - start;
+	myprintf("\r\n Gas: %lu cycles/sample, 64-bit division %lu ", cycles / COMP_BENCH_FRAMES,
+			ref_cycles / COMP_BENCH_FRAMES);
+#else
+	myprintf("\r\n Gas: %lu cycles/sample ", cycles / COMP_BENCH_FRAMES);
+#endif
+
+	/* Display formatting of one sample, as BME680_TaskDisplay() does it,
+	 * then the same rows through one format string each */
+	mark = scratch_mark(&scratch_fmt);
+	row = scratch_take(&scratch_fmt, SCRATCH_ROW_LEN);
+	if (row == NULL)
+		return;
+	start = cyccnt_read();
+	for (i = 0; i < 100; i++)
+		for (line = 1; line < DISPLAY_ROWS; line++)
+			BME680_FormatRow(row, line, &bench, &derived);
+	cycles = cyccnt_read() - start;
+	start = cyccnt_read();
+	for (i = 0; i < 100; i++)
+	{
+		ROW_PRINTF(row, "Dew:" CENTI_FMT "C %ldm ", CENTI_ARG(derived.dew_point), (long)(derived.height / 100));
+		ROW_PRINTF(row, "Temp:" CENTI_FMT "degC", CENTI_ARG(FIELD_TEMP(bench.temperature)));
+		ROW_PRINTF(row, "Humi:" CENTI_FMT " %%rH ", CENTI_ARG(FIELD_HUM(bench.humidity) / 10));
+		ROW_PRINTF(row, "Press:" CENTI_FMT "hPa", CENTI_ARG(FIELD_PRES(bench.pressure)));
+		ROW_PRINTF(row, "AIRQUAL:" CENTI_FMT "Kohms ", CENTI_ARG(FIELD_GAS(bench.gas_resistance) / 10));
+	}
+	libm_cycles = cyccnt_read() - start;
+	scratch_release(&scratch_fmt, mark);
+	myprintf("\r\n Format: %lu cycles/sample, " ROW_PRINTF_NAME " %lu ", cycles / 100, libm_cycles / 100);
+
+	/* Derived metrics at the current temperature, from 1 %rH and 540 hPa
+	 * to 100 %rH and 1100 hPa: fixed point against libm */
+	point = bench;
+	cycles = 0;
+	libm_cycles = 0;
+	for (i = 0; i < COMP_BENCH_FRAMES; i++)
+	{
+		point.humidity = (1 + i * 99 / (COMP_BENCH_FRAMES - 1)) * BME680_HUM_SCALE;
+		point.pressure = (54000 + i * 56000 / (COMP_BENCH_FRAMES - 1)) * BME680_PRES_SCALE;
+		start = cyccnt_read();
+		derived_compute(&point, BME680_REF_PA, &fixed);
+		cycles += cyccnt_read() - start;
+		start = cyccnt_read();
+		derived_reference(&point, BME680_REF_PA, &libm);
+		libm_cycles += cyccnt_read() - start;
+
+		if (CENTI_ABS(fixed.dew_point - libm.dew_point) > err[0])
+			err[0] = CENTI_ABS(fixed.dew_point - libm.dew_point);
+		if (CENTI_ABS(fixed.abs_humidity - libm.abs_humidity) > err[1])
+			err[1] = CENTI_ABS(fixed.abs_humidity - libm.abs_humidity);
+		if (CENTI_ABS(fixed.height - libm.height) > err[2])
+			err[2] = CENTI_ABS(fixed.height - libm.height);
+	}
+	myprintf("\r\n Derived: %lu cycles/sample, libm %lu; apart by %lu cdegC, %lu cg/m3, %lu cm ",
+			cycles / COMP_BENCH_FRAMES, libm_cycles / COMP_BENCH_FRAMES, err[0], err[1], err[2]);
+}
+#endif
+
+#ifdef BME680_I2C_BENCH
+#define I2C_BENCH_XFERS		64
+
+/***********************************************************************
+ * @name BME680_I2CBenchRun()
+ * @brief Runs I2C_BENCH_XFERS transfers through the HAL polling path
+ *        and through i2c_ll, and prints the CPU cycles each one costs.
+ *        The HAL keeps the CPU for the whole transfer; i2c_ll only for
+ *        i2c_ll_start() and its interrupts, the core sleeps meanwhile.
+ * @return void
+ ***********************************************************************/
+void BME680_I2CBenchRun(const char *name, uint8_t dev_id, uint8_t reg_addr, uint8_t *data, uint16_t len,
+		uint8_t write)
+{
+	I2C_HandleTypeDef *hi2c = (dev_id & I2C_BUS2_FLAG) ? &hi2c2 : &hi2c1;
+	uint32_t start, cycles, ll_cycles, ll_irqs;
+	uint16_t i;
+	uint8_t failed = 0;
+
+	start = cyccnt_read();
+	for (i = 0; i < I2C_BENCH_XFERS; i++)
+	{
+		if (write)
+			failed |= HAL_I2C_Mem_Write(hi2c, I2C_DEV_ADDR(dev_id) << 1, reg_addr, I2C_MEMADD_SIZE_8BIT, data,
+					len, I2C_TIMEOUT_MS(len)) != HAL_OK;
+		else
+			failed |= HAL_I2C_Mem_Read(hi2c, I2C_DEV_ADDR(dev_id) << 1, reg_addr, I2C_MEMADD_SIZE_8BIT, data,
+					len, I2C_TIMEOUT_MS(len)) != HAL_OK;
+	}
+	cycles = cyccnt_read() - start;
+	myprintf("\r\n %s HAL: %lu cycles, %lu us%s ", name, cycles / I2C_BENCH_XFERS,
+			cycles / I2C_BENCH_XFERS / (SystemCoreClock / 1000000U), failed ? " (errors)" : "");
+
+	failed = 0;
+	ll_cycles = i2c_ll_stats.cycles;
+	ll_irqs = i2c_ll_stats.irqs;
+	start = cyccnt_read();
+	for (i = 0; i < I2C_BENCH_XFERS; i++)
+	{
+		if (write)
+			failed |= user_i2c_write(dev_id, reg_addr, data, len) != 0;
+		else
+			failed |= user_i2c_read(dev_id, reg_addr, data, len) != 0;
+	}
+	cycles = cyccnt_read() - start;
+	myprintf("\r\n %s LL : %lu cycles in %lu irqs, %lu us%s ", name,
+			(i2c_ll_stats.cycles - ll_cycles) / I2C_BENCH_XFERS, (i2c_ll_stats.irqs - ll_irqs) / I2C_BENCH_XFERS,
+			cycles / I2C_BENCH_XFERS / (SystemCoreClock / 1000000U), failed ? " (errors)" : "");
+}
+
+/***********************************************************************
+ * @name BME680_I2CBench()
+ * @brief Compares the HAL and i2c_ll per-transaction cost on the hot
+ *        transfers: a one-byte status read of node 0 and a one-byte
+ *        SSD1306 command write
+ * @return void
+ ***********************************************************************/
+void BME680_I2CBench(void)
+{
+	uint8_t status;
+	uint8_t command = 0xA6;		/* normal display, as set by SSD1306_Init() */
+
+	if (sensors.node[0].dev.intf == BME680_I2C_INTF)
+		BME680_I2CBenchRun("BME680 status read", sensors.node[0].dev.dev_id, BME680_FIELD0_ADDR, &status, 1, 0);
+	BME680_I2CBenchRun("SSD1306 command  ", SSD1306_I2C_ADDR >> 1, 0x00, &command, 1, 1);
+}
+#endif
+
+#ifdef BME680_OS_REPLAY
+/***********************************************************************
+ * @name BME680_OsReplay()
+ * @brief Records node 0 samples and, once OS_REPLAY_SAMPLES are in,
+ *        replays them through os_ctrl_replay() and prints the
+ *        measurement time against the fixed top level settings
+ * @return void
+ ***********************************************************************/
+void BME680_OsReplay(const struct bme680_field_data *sample)
+{
+	static struct bme680_field_data trace[OS_REPLAY_SAMPLES];
+	static uint16_t count;
+	struct os_ctrl_replay_result res;
+	uint8_t i;
+
+	if (count >= OS_REPLAY_SAMPLES)
+		return;
+
+	trace[count++] = *sample;
+	if (count < OS_REPLAY_SAMPLES)
+		return;
+
+	os_ctrl_replay(trace, OS_REPLAY_SAMPLES, &sensors.node[0].dev, &res);
+	myprintf("\r\n OS replay: %lu samples, %lu ms fixed, %lu ms adaptive (" CENTI_FMT "%% saved), %lu changes ",
+			res.samples, res.busy_ms_fixed, res.busy_ms_adaptive,
+			CENTI_ARG(10000 - ((uint64_t)res.busy_ms_adaptive * 10000) / res.busy_ms_fixed), res.changes);
+	for (i = 0; i < OS_CTRL_LEVELS; i++)
+		myprintf("\r\n  level %u: %u%% ", i, res.level_hist[i]);
+}
+#endif
+
+#ifdef BME680_FRAME_LOG
+/***********************************************************************
+ * @name BME680_Capture()
+ * @brief Driver field hook of node 0, appends the raw burst to the capture
+ * @return void
+ ***********************************************************************/
+void BME680_Capture(const uint8_t *buff, const struct bme680_dev *dev)
+{
+	frame_log_add(&frame_log, HAL_GetTick(), buff);
+}
+
+/***********************************************************************
+ * @name BME680_LogWrite()
+ * @brief Capture output, a blocking write to USART2
+ * @return void
+ ***********************************************************************/
+void BME680_LogWrite(const void *buf, uint16_t len, void *ctx)
+{
+	HAL_UART_Transmit(&huart2, (uint8_t *)buf, len, HAL_MAX_DELAY);
+}
+#endif
+
+#ifdef BME680_GAS_SCAN
+/***********************************************************************
+ * @name BME680_Scan()
+ * @brief Measurement engine scan callback, prints the gas fingerprint
+ * @return void
+ ***********************************************************************/
+void BME680_Scan(const struct meas_gas_scan *scan, void *ctx)
+{
+	char kohm[FMT_VALUE_LEN];
+	uint8_t i;
+
+	myprintf("\r\n Gas scan %lu:", scan->seq);
+	for (i = 0; i < scan->len; i++)
+	{
+		fmt_udec(kohm, kohm + sizeof(kohm), FIELD_GAS(scan->gas_resistance[i]), 3, 2, 0, 0);
+		myprintf(" %u:%s%s", gas_profile.heatr_temp[i], kohm, (scan->valid & (1U << i)) ? "" : "?");
+	}
+	myprintf(" KOhms ");
+}
+#endif
@@ -0,0 +1,411 @@
+/**
+  ******************************************************************************
+  * @file           : app_tasks.c
+  * @brief          : Task bodies of the firmware, the OLED rows and the
+  *                   text console report
+  ******************************************************************************
+**/
+
+#include "main.h"
+#include "app_tasks.h"
+#include "app_bench.h"
+#include "fonts.h"
+#include "ssd1306.h"
+#include "statemachine.h"
+#include "i2c_transport.h"
+#include "i2c_sched.h"
+#include "i2c_ll.h"
+#include "scratch.h"
+#ifdef BME680_SPI
+#include "spi_transport.h"
+#endif
+
+struct sensor_array sensors;
+struct bme680_field_data data;
+volatile uint8_t sample_ready;
+struct bme680_field_data latest;
+uint32_t latest_ms, data_ms;
+uint32_t sample_seq;
+uint8_t state;
+uint32_t state_seq;
+struct derived_data derived;
+struct os_ctrl os_ctrl;
+struct telem telem;
+
+/***********************************************************************
+ * @name BME680_TaskSample()
+ * @brief Sampling task: the array triggers each sensor every
+ *        BME680_SAMPLE_PERIOD_MS, staggered across the period, and hands
+ *        finished samples to BME680_Ready(); also starts any OLED frame
+ *        left pending by BME680_TaskDisplay()
+ * @return void
+ ***********************************************************************/
+void BME680_TaskSample(void *ctx)
+{
+	i2c_sched_service();
+	SSD1306_Service();
+	sensor_array_service(&sensors);
+}
+
+/***********************************************************************
+ * @name BME680_TaskCompensate()
+ * @brief Compensation task: takes node 0's latest sample as the one
+ *        every other task shows and adds the derived metrics to it
+ * @return void
+ ***********************************************************************/
+void BME680_TaskCompensate(void *ctx)
+{
+	if (!sample_ready)
+		return;
+	sample_ready = 0;
+
+	data = latest;
+	data_ms = latest_ms;
+	derived_compute(&data, BME680_REF_PA, &derived);
+	sample_seq++;
+}
+
+/***********************************************************************
+ * @name BME680_TaskState()
+ * @brief State task: runs the state machine once per compensated sample
+ * @return void
+ ***********************************************************************/
+void BME680_TaskState(void *ctx)
+{
+	static uint32_t seq;
+
+	if (seq == sample_seq)
+		return;
+	seq = sample_seq;
+
+	state = sensor_statemachine(&data, &derived);
+	state_seq = seq;
+}
+
+/***********************************************************************
+ * @name BME680_Idle()
+ * @brief Scheduler idle hook; sleeps until the next interrupt, at the
+ *        latest the next SysTick
+ * @return void
+ ***********************************************************************/
+void BME680_Idle(void)
+{
+	__WFI();
+}
+
+/***********************************************************************
+ * @name BME680_Ready()
+ * @brief Sensor array callback; latches node 0 for the compensation
+ *        task and logs the other sensors over UART
+ * @return void
+ ***********************************************************************/
+void BME680_Ready(uint8_t idx, int8_t result, const struct bme680_field_data *sample, void *ctx)
+{
+	if (idx != 0)
+	{
+#ifndef BME680_TEXT_TELEMETRY
+		struct derived_data metrics;
+
+		if (result == BME680_OK)
+		{
+			derived_compute(sample, BME680_REF_PA, &metrics);
+			BME680_TelemSend(idx, sample, &metrics, HAL_GetTick(), TELEM_STATE_NONE, 0);
+		}
+#else
+		char field[FIELDS][FMT_VALUE_LEN];
+
+		if (result == BME680_OK)
+		{
+			BME680_Fields(sample, field);
+			myprintf("\r\n BME680 %u: %s C %s %%rH %s hPa %s KOhms ", idx, field[0], field[1], field[2], field[3]);
+		}
+#endif
+		return;
+	}
+
+	rslt = result;
+	if (result == BME680_OK)
+	{
+		uint16_t meas_dur;
+
+		latest = *sample;
+		latest_ms = HAL_GetTick();
+		sample_ready = 1;
+
+		/* The engine is idle here, so new settings cannot race a conversion */
+		bme680_get_profile_dur(&meas_dur, &sensors.node[0].dev);
+		if (os_ctrl_update(&os_ctrl, sample, HAL_GetTick(), meas_dur))
+			rslt = os_ctrl_apply(&os_ctrl, &sensors.node[0].dev);
+#ifdef BME680_OS_REPLAY
+		BME680_OsReplay(sample);
+#endif
+	}
+}
+
+/***********************************************************************
+ * @name BME680_FormatRow()
+ * @brief Formats OLED row line, 1 to DISPLAY_ROWS - 1 below the title,
+ *        of a sample into row, SCRATCH_ROW_LEN bytes
+ * @return void
+ ***********************************************************************/
+void BME680_FormatRow(char *row, uint8_t line, const struct bme680_field_data *sample,
+		const struct derived_data *metrics)
+{
+	char *end = row + SCRATCH_ROW_LEN;
+	char *p;
+
+	switch (line)
+	{
+	case 1:
+		p = fmt_str(row, end, "Dew:");
+		p = fmt_dec(p, end, metrics->dew_point, 2, 2, 0, 0);
+		p = fmt_str(p, end, "C ");
+		p = fmt_dec(p, end, metrics->height, 2, 0, 0, 0);
+		fmt_str(p, end, "m ");
+		break;
+	case 2:
+		p = fmt_str(row, end, "Temp:");
+		p = fmt_dec(p, end, FIELD_TEMP(sample->temperature), 2, 2, 0, 0);
+		fmt_str(p, end, "degC");
+		break;
+	case 3:
+		p = fmt_str(row, end, "Humi:");
+		p = fmt_udec(p, end, FIELD_HUM(sample->humidity), 3, 2, 0, 0);
+		fmt_str(p, end, " %rH ");
+		break;
+	case 4:
+		p = fmt_str(row, end, "Press:");
+		p = fmt_udec(p, end, FIELD_PRES(sample->pressure), 2, 2, 0, 0);
+		fmt_str(p, end, "hPa");
+		break;
+	case 5:
+		p = fmt_str(row, end, "AIRQUAL:");
+		p = fmt_udec(p, end, FIELD_GAS(sample->gas_resistance), 3, 2, 0, 0);
+		fmt_str(p, end, "Kohms ");
+		break;
+	default:
+		row[0] = '\0';
+		break;
+	}
+}
+
+/***********************************************************************
+ * @name BME680_Fields()
+ * @brief Formats a sample's temperature, humidity, pressure and gas
+ *        resistance for the console: degC, %rH, hPa and kOhm with two
+ *        decimals
+ * @return void
+ ***********************************************************************/
+void BME680_Fields(const struct bme680_field_data *sample, char field[FIELDS][FMT_VALUE_LEN])
+{
+	fmt_dec(field[0], field[0] + FMT_VALUE_LEN, FIELD_TEMP(sample->temperature), 2, 2, 0, 0);
+	fmt_udec(field[1], field[1] + FMT_VALUE_LEN, FIELD_HUM(sample->humidity), 3, 2, 0, 0);
+	fmt_udec(field[2], field[2] + FMT_VALUE_LEN, FIELD_PRES(sample->pressure), 2, 2, 0, 0);
+	fmt_udec(field[3], field[3] + FMT_VALUE_LEN, FIELD_GAS(sample->gas_resistance), 3, 2, 0, 0);
+}
+
+/***********************************************************************
+ * @name BME680_TaskDisplay()
+ * @brief Display task: draws the latest sample and queues the frame
+ *        behind sensor traffic, ahead of routine frames while the state
+ *        machine reports danger
+ * @return void
+ ***********************************************************************/
+void BME680_TaskDisplay(void *ctx)
+{
+	uint16_t mark = scratch_mark(&scratch_fmt);
+	char *row = scratch_take(&scratch_fmt, SCRATCH_ROW_LEN);
+	uint8_t line;
+
+	if ((sample_seq == 0) || (row == NULL))
+	{
+		scratch_release(&scratch_fmt, mark);
+		return;
+	}
+
+	SSD1306_GotoXY(0, 0);
+	SSD1306_Puts("ESD PROJECT 2023", &Font_7x10, 1);
+
+	for (line = 1; line < DISPLAY_ROWS; line++)
+	{
+		BME680_FormatRow(row, line, &data, &derived);
+		SSD1306_GotoXY(0, 10 * line);
+		SSD1306_Puts(row, &Font_7x10, 1);
+	}
+
+	scratch_release(&scratch_fmt, mark);
+
+	SSD1306_UpdateScreenAsync((state >= SM_STATE_DANGER) ? I2C_CLASS_ALARM : I2C_CLASS_DISPLAY);
+}
+
+/***********************************************************************
+ * @name BME680_TelemWrite()
+ * @brief Telemetry output; a frame is queued on uart_log whole or not at
+ *        all under LOG_RING_DROP_NEWEST
+ * @return void
+ ***********************************************************************/
+void BME680_TelemWrite(const void *buf, uint16_t len, void *ctx)
+{
+	log_ring_write(&uart_log, buf, len);
+}
+
+/***********************************************************************
+ * @name BME680_TelemSend()
+ * @brief Sends one sample of a node as a binary telemetry frame
+ * @return void
+ ***********************************************************************/
+void BME680_TelemSend(uint8_t node, const struct bme680_field_data *sample, const struct derived_data *metrics,
+		uint32_t t_ms, uint8_t sm_state, uint16_t gas_index)
+{
+	struct telem_sample frame;
+
+	telem_sample_set(&frame, sample, metrics);
+	frame.node = node;
+	frame.t_ms = t_ms;
+	frame.state = sm_state;
+	frame.gas_index = gas_index;
+	telem_send(&telem, &frame);
+}
+
+/***********************************************************************
+ * @name BME680_TaskTelemetry()
+ * @brief Telemetry task: sends node 0's sample once the state machine
+ *        has run on it. The text console prints the latest sample, the
+ *        controller, readout and task statistics and the state
+ *        machine's gas index over UART instead.
+ * @return void
+ ***********************************************************************/
+void BME680_TaskTelemetry(void *ctx)
+{
+#ifndef BME680_TEXT_TELEMETRY
+	static uint32_t seq;
+
+	if (seq == state_seq)
+		return;
+	seq = state_seq;
+
+	BME680_TelemSend(0, &data, &derived, data_ms, state, air_quality.index);
+#else
+	char field[FIELDS][FMT_VALUE_LEN];
+
+	if (sample_seq == 0)
+		return;
+
+	BME680_Fields(&data, field);
+	myprintf("\r\n\n Temperature: %s C ", field[0]);
+	myprintf("\r\n Humidity   : %s %%rH ", field[1]);
+	myprintf("\r\n Pressure   : %s hPa ", field[2]);
+	myprintf("\r\n Air Quality: %s Kohms ", field[3]);
+	myprintf("\r\n Dew point  : " CENTI_FMT " C, " CENTI_FMT " C below, abs. humidity " CENTI_FMT " g/m3 ",
+			CENTI_ARG(derived.dew_point), CENTI_ARG(derived.dew_spread), CENTI_ARG(derived.abs_humidity));
+	myprintf("\r\n Height     : " CENTI_FMT " m above the %lu Pa level ", CENTI_ARG(derived.height),
+			(unsigned long)BME680_REF_PA);
+	myprintf("\r\n Sampling   : " MILLI_FMT " Hz, " CENTI_FMT "%% busy, OS level %u%s ",
+			MILLI_ARG(os_ctrl_rate(&os_ctrl) * 1000), CENTI_ARG(os_ctrl_duty(&os_ctrl) * 100), os_ctrl.level,
+			os_ctrl.trend ? " (trend)" : "");
+	myprintf("\r\n Noise floor: " MILLI_FMT " C " CENTI_FMT " Pa " MILLI_FMT " %%rH ",
+			MILLI_ARG(os_ctrl.noise[OS_CTRL_TEMP] * (1000 / BME680_TEMP_SCALE)),
+			CENTI_ARG(os_ctrl.noise[OS_CTRL_PRES] * (100 / BME680_PRES_SCALE)),
+			MILLI_ARG(os_ctrl.noise[OS_CTRL_HUM] * (1000 / BME680_HUM_SCALE)));
+	myprintf("\r\n Scratch    : %u of %u bytes at peak, %u failed ", scratch_fmt.peak, scratch_fmt.size,
+			scratch_fmt.fails);
+	myprintf("\r\n UART log   : %lu bytes, %lu lines dropped, %lu bytes overwritten, fill max %u of %u ",
+			uart_log.stats.written, uart_log.stats.dropped, uart_log.stats.overwritten, uart_log.stats.fill_max,
+			LOG_RING_SIZE);
+	BME680_Stats();
+	BME680_Tasks();
+
+	myprintf("\r\n Gas index  : %u, baseline %lu ohms at %u %%rH%s, state %u ", air_quality.index,
+			(unsigned long)fx_exp2(air_quality.baseline), AQ_HUM_REF / 1000,
+			(air_quality.warmup < AQ_WARMUP_SAMPLES) ? " (warming up)" : "", state);
+#ifdef BME680_COMP_BENCH
+	BME680_CompBench();
+#endif
+#endif
+}
+
+/***********************************************************************
+ * @name BME680_Tasks()
+ * @brief Prints every task's runs, overruns, skipped releases, worst-case
+ *        execution time and CPU share, then the share left idle
+ * @return void
+ ***********************************************************************/
+void BME680_Tasks(void)
+{
+	const struct task *task;
+	uint32_t share, idle = 1000;
+	uint8_t idx;
+
+	for (idx = 0; idx < tasks.count; idx++)
+	{
+		task = &tasks.task[idx];
+		share = task_sched_share(&tasks, idx);
+		idle = (share < idle) ? idle - share : 0;
+		myprintf("\r\n Task %-10s: %lu runs, %lu overruns, %lu skipped, wcet %lu us, %lu.%lu%% CPU ", task->name,
+				task->runs, task->overruns, task->skipped, task->wcet / (SystemCoreClock / 1000000),
+				share / 10, share % 10);
+	}
+	myprintf("\r\n Task idle      : %lu.%lu%% CPU, %lu wake-ups ", idle / 10, idle % 10, tasks.idles);
+}
+
+/***********************************************************************
+ * @name BME680_Stats()
+ * @brief Prints the readout statistics of every sensor: meas_index gaps,
+ *        polls without new data and the trigger-to-readout latency
+ *        histogram (bin n holds readouts under 16 << n ms), then the
+ *        I2C transaction outcomes and latency of every bus device and
+ *        the queueing latency of every scheduler class (bin n under
+ *        250 << n us)
+ * @return void
+ ***********************************************************************/
+void BME680_Stats(void)
+{
+	const struct bme680_meas_stats *stats;
+	const struct i2c_dev_stats *istats;
+	const struct i2c_class_stats *cstats;
+	static const char *const class_name[I2C_CLASSES] = { "sensor", "alarm", "display" };
+	uint32_t timed;
+	uint8_t idx, bin;
+
+	for (idx = 0; idx < sensors.count; idx++)
+	{
+		stats = &sensors.node[idx].dev.stats;
+		myprintf("\r\n Readouts %u : %lu, %lu gaps (%lu missed), %lu repeats, %lu stale, %lu unread ", idx,
+				stats->samples, stats->gaps, stats->missed, stats->repeats, stats->stale, stats->unread);
+		for (bin = 0, timed = 0; bin < BME680_LAT_BINS; bin++)
+			timed += stats->lat_hist[bin];
+		myprintf("\r\n  Latency  : avg %lu max %lu ms |", timed ? stats->lat_sum / timed : 0, stats->lat_max);
+		for (bin = 0; bin < BME680_LAT_BINS; bin++)
+			myprintf(" %lu", stats->lat_hist[bin]);
+		myprintf("\r\n  Polls    :");
+		for (bin = 0; bin < BME680_POLL_BINS; bin++)
+			myprintf(" %lu", stats->poll_hist[bin]);
+	}
+	for (idx = 0; idx < I2C_TRANSPORT_DEVS; idx++)
+	{
+		istats = &i2c_dev_stats[idx];
+		if (!istats->used)
+			continue;
+		myprintf("\r\n I2C%u 0x%02X : %lu xfers, %lu nacks, %lu errors, %lu timeouts, avg %lu max %lu us |",
+				(istats->dev_id & I2C_BUS2_FLAG) ? 2 : 1, I2C_DEV_ADDR(istats->dev_id), istats->xfers,
+				istats->nacks, istats->errors, istats->timeouts, istats->xfers ? istats->lat_sum / istats->xfers : 0,
+				istats->lat_max);
+		for (bin = 0; bin < I2C_LAT_BINS; bin++)
+			myprintf(" %lu", istats->lat_hist[bin]);
+	}
+	myprintf("\r\n I2C      : %lu recoveries, %lu LL jobs, %lu cycles/job ", i2c_stats.recoveries,
+			i2c_ll_stats.jobs, i2c_ll_stats.jobs ? i2c_ll_stats.cycles / i2c_ll_stats.jobs : 0);
+	for (idx = 0; idx < I2C_CLASSES; idx++)
+	{
+		cstats = &i2c_sched_stats[idx];
+		myprintf("\r\n  Queue %-7s: %lu started, %lu rejected, depth %lu, avg %lu max %lu us |", class_name[idx],
+				cstats->started, cstats->rejected, cstats->depth_max,
+				cstats->started ? cstats->lat_sum / cstats->started : 0, cstats->lat_max);
+		for (bin = 0; bin < I2C_LAT_BINS; bin++)
+			myprintf(" %lu", cstats->lat_hist[bin]);
+	}
+#ifdef BME680_SPI
+	myprintf("\r\n SPI      : %lu frames, %lu bytes, %lu errors ", spi_stats.xfers, spi_stats.bytes,
+			spi_stats.errors);
+#endif
+}
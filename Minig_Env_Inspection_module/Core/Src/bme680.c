@@ -141,6 +141,30 @@ static uint32_t calc_gas_resistance(uint16_t gas_res_adc, uint8_t gas_range, con
  */
 static uint8_t calc_heater_res(uint16_t temp, const struct bme680_dev *dev);
 
+/*!
+ * @brief Compensation kernels behind calc_temperature, calc_pressure,
+ * calc_humidity and calc_gas_resistance. They take t_fine and the plan
+ * explicitly so bme680_compensate_batch() can run them over arrays.
+ *
+ * @param[in] t_fine	: Fine temperature returned by comp_t_fine().
+ * @param[in] plan	: Compensation plan built by bme680_build_comp_plan().
+ */
+static inline int32_t comp_t_fine(uint32_t temp_adc, const struct bme680_comp_plan *plan);
+static inline uint32_t comp_pressure(uint32_t pres_adc, int32_t t_fine, const struct bme680_comp_plan *plan);
+static inline uint32_t comp_humidity(uint16_t hum_adc, int32_t t_fine, const struct bme680_comp_plan *plan);
+static inline uint32_t comp_gas_resistance(uint16_t gas_res_adc, uint8_t gas_range, const struct bme680_comp_plan *plan);
+
+/*!
+ * @brief This internal API precomputes the per gas range terms of
+ * comp_gas_resistance() from range_sw_err.
+ *
+ * @param[out] plan	: Compensation plan to fill.
+ * @param[in] range_sw_err	: Range switching error from the calibration.
+ *
+ * @return Nothing
+ */
+static void build_gas_plan(struct bme680_comp_plan *plan, int8_t range_sw_err);
+
 #else
 /*!
  * @brief This internal API is used to calculate the
@@ -210,9 +234,47 @@ static float calc_heater_res(uint16_t temp, const struct bme680_dev *dev);
  */
 static int8_t read_field_data(struct bme680_field_data *data, struct bme680_dev *dev);
 
+/*!
+ * @brief This internal API is used to decode one burst of the field
+ * registers and compensate it when it carries new data.
+ *
+ * @param[in] buff	:Raw field registers starting at BME680_FIELD0_ADDR.
+ * @param[out] data :Structure instance to hold the data
+ * @param[in] dev	:Structure instance of bme680_dev.
+ *
+ * @return Nothing
+ */
+static void parse_field_data(const uint8_t *buff, struct bme680_field_data *data, struct bme680_dev *dev);
+
+/*!
+ * @brief This internal API returns the SPI memory page holding a register.
+ *
+ * @param[in] reg_addr	:Register address.
+ *
+ * @return BME680_MEM_PAGE0 or BME680_MEM_PAGE1
+ */
+static uint8_t mem_page_of(uint8_t reg_addr);
+
+/*!
+ * @brief This internal API writes the registers of one SPI memory page
+ * from a batch, selecting the page first, as one write transaction.
+ *
+ * @param[in] reg_addr	:Register addresses of the whole batch.
+ * @param[in] reg_data	:Register values of the whole batch.
+ * @param[in] len	:Number of registers in the batch.
+ * @param[in] mem_page	:Page whose registers are written.
+ * @param[in] dev	:Structure instance of bme680_dev.
+ *
+ * @return Result of API execution status
+ * @retval zero -> Success / +ve value -> Warning / -ve value -> Error
+ */
+static int8_t set_page_regs(const uint8_t *reg_addr, const uint8_t *reg_data, uint8_t len, uint8_t mem_page,
+	struct bme680_dev *dev);
+
 /*!
  * @brief This internal API is used to set the memory page
- * based on register address.
+ * based on register address. The page is cached in dev->mem_page, so
+ * only a change of page costs a bus write.
  *
  * The value of memory page
  *  value  | Description
@@ -270,6 +332,68 @@ static int8_t null_ptr_check(const struct bme680_dev *dev);
  */
 static int8_t boundary_check(uint8_t *value, uint8_t min, uint8_t max, struct bme680_dev *dev);
 
+/*!
+ * @brief This internal API copies register values that fall inside the
+ * shadow window into dev->shadow and marks them valid.
+ *
+ * @param[in] reg_addr	:Address of the first register.
+ * @param[in] reg_data	:Register values.
+ * @param[in] len	:Number of consecutive registers.
+ * @param[in] dev	:Structure instance of bme680_dev.
+ *
+ * @return Nothing
+ */
+static void shadow_store(uint8_t reg_addr, const uint8_t *reg_data, uint16_t len, struct bme680_dev *dev);
+
+/*!
+ * @brief This internal API returns the value of a shadowed register. When
+ * the shadow is not valid the control registers are fetched in one burst.
+ *
+ * @param[in] reg_addr	:Register address. Addresses outside the shadow
+ * window are read from the device.
+ * @param[out] reg_data	:Register value.
+ * @param[in] dev	:Structure instance of bme680_dev.
+ *
+ * @return Result of API execution status
+ * @retval zero -> Success / +ve value -> Warning / -ve value -> Error
+ */
+static int8_t shadow_read(uint8_t reg_addr, uint8_t *reg_data, struct bme680_dev *dev);
+
+/*!
+ * @brief This internal API writes the registers whose value differs from
+ * the shadow, as a single bme680_set_regs() transaction. Registers outside
+ * the shadow window are always written.
+ *
+ * @param[in] reg_addr	:Register addresses.
+ * @param[in] reg_data	:Register values.
+ * @param[in] len	:Number of registers, at most 19.
+ * @param[in] dev	:Structure instance of bme680_dev.
+ *
+ * @return Result of API execution status
+ * @retval zero -> Success / +ve value -> Warning / -ve value -> Error
+ */
+static int8_t shadow_write(const uint8_t *reg_addr, const uint8_t *reg_data, uint8_t len, struct bme680_dev *dev);
+
+/*!
+ * @brief This internal API notes a forced mode trigger in dev->stats.
+ *
+ * @param[in] dev	:Structure instance of bme680_dev.
+ *
+ * @return Nothing
+ */
+static void stats_trigger(struct bme680_dev *dev);
+
+/*!
+ * @brief This internal API accounts one decoded field burst in dev->stats:
+ * meas_index gaps, polls without new data and trigger-to-readout latency.
+ *
+ * @param[in] data	:Decoded field data.
+ * @param[in] dev	:Structure instance of bme680_dev.
+ *
+ * @return Nothing
+ */
+static void stats_readout(const struct bme680_field_data *data, struct bme680_dev *dev);
+
 /****************** Global Function Definitions *******************************/
 /*!
  *@brief This API is the entry point.
@@ -279,6 +403,22 @@ int8_t bme680_init(struct bme680_dev *dev)
 {
 	int8_t rslt;
 
+	rslt = bme680_probe(dev);
+	if (rslt == BME680_OK) {
+		/* Get the Calibration data */
+		rslt = get_calib_data(dev);
+	}
+
+	return rslt;
+}
+
+/*!
+ * @brief This API soft resets the sensor and verifies its chip-id.
+ */
+int8_t bme680_probe(struct bme680_dev *dev)
+{
+	int8_t rslt;
+
 	/* Check for null pointer in the device structure*/
 	rslt = null_ptr_check(dev);
 	if (rslt == BME680_OK) {
@@ -286,26 +426,74 @@ int8_t bme680_init(struct bme680_dev *dev)
 		rslt = bme680_soft_reset(dev);
 		if (rslt == BME680_OK) {
 			rslt = bme680_get_regs(BME680_CHIP_ID_ADDR, &dev->chip_id, 1, dev);
-			if (rslt == BME680_OK) {
-				if (dev->chip_id == BME680_CHIP_ID) {
-					/* Get the Calibration data */
-					rslt = get_calib_data(dev);
-				} else {
-					rslt = BME680_E_DEV_NOT_FOUND;
-				}
-			}
+			if ((rslt == BME680_OK) && (dev->chip_id != BME680_CHIP_ID))
+				rslt = BME680_E_DEV_NOT_FOUND;
 		}
 	}
 
 	return rslt;
 }
 
+/*!
+ * @brief This API reads the calibration data from the sensor.
+ */
+int8_t bme680_read_calib(struct bme680_dev *dev)
+{
+	return get_calib_data(dev);
+}
+
+/*!
+ * @brief This API precomputes the calibration-only compensation terms.
+ */
+void bme680_build_comp_plan(struct bme680_dev *dev)
+{
+#ifndef BME680_FLOAT_POINT_COMPENSATION
+	const struct bme680_calib_data *calib = &dev->calib;
+	struct bme680_comp_plan *plan = &dev->plan;
+
+	plan->t1_x2 = (int32_t) calib->par_t1 << 1;
+	plan->t2 = (int32_t) calib->par_t2;
+	plan->t3_x16 = (int32_t) calib->par_t3 << 4;
+
+	plan->p1 = (int32_t) calib->par_p1;
+	plan->p2 = (int32_t) calib->par_p2;
+	plan->p3_x32 = (int32_t) calib->par_p3 << 5;
+	plan->p4_x65536 = (int32_t) calib->par_p4 << 16;
+	plan->p5_x2 = (int32_t) calib->par_p5 << 1;
+	plan->p6 = (int32_t) calib->par_p6;
+	plan->p7_x128 = (int32_t) calib->par_p7 << 7;
+	plan->p8 = (int32_t) calib->par_p8;
+	plan->p9 = (int32_t) calib->par_p9;
+	plan->p10 = (int32_t) calib->par_p10;
+
+	plan->h1_x16 = (int32_t) calib->par_h1 * 16;
+	plan->h2 = (int32_t) calib->par_h2;
+	plan->h3 = (int32_t) calib->par_h3;
+	plan->h4 = (int32_t) calib->par_h4;
+	plan->h5 = (int32_t) calib->par_h5;
+	plan->h6_x128 = (int32_t) calib->par_h6 << 7;
+	plan->h7 = (int32_t) calib->par_h7;
+
+	plan->gh1_784 = calib->par_gh1 + 784;
+	plan->gh2_x5 = (calib->par_gh2 + 154009) * 5;
+	plan->heat_amb = (((int32_t) dev->amb_temp * calib->par_gh3) / 1000) * 256;
+	plan->heat_range_div = calib->res_heat_range + 4;
+	plan->heat_val = (131 * calib->res_heat_val) + 65536;
+	plan->amb_temp = dev->amb_temp;
+
+	build_gas_plan(plan, calib->range_sw_err);
+#else
+	(void) dev;
+#endif
+}
+
 /*!
  * @brief This API reads the data from the given register address of the sensor.
  */
 int8_t bme680_get_regs(uint8_t reg_addr, uint8_t *reg_data, uint16_t len, struct bme680_dev *dev)
 {
 	int8_t rslt;
+	uint8_t bus_addr = reg_addr;
 
 	/* Check for null pointer in the device structure*/
 	rslt = null_ptr_check(dev);
@@ -314,11 +502,20 @@ int8_t bme680_get_regs(uint8_t reg_addr, uint8_t *reg_data, uint16_t len, struct
 			/* Set the memory page */
 			rslt = set_mem_page(reg_addr, dev);
 			if (rslt == BME680_OK)
-				reg_addr = reg_addr | BME680_SPI_RD_MSK;
+				bus_addr = (reg_addr & BME680_SPI_WR_MSK) | BME680_SPI_RD_MSK;
 		}
-		dev->com_rslt = dev->read(dev->dev_id, reg_addr, reg_data, len);
-		if (dev->com_rslt != 0)
-			rslt = BME680_E_COM_FAIL;
+		if (rslt == BME680_OK) {
+			dev->com_rslt = dev->read(dev->dev_id, bus_addr, reg_data, len);
+			if (dev->com_rslt != 0)
+				rslt = BME680_E_COM_FAIL;
+		}
+
+		/* The shadow is kept by I2C address; on SPI the masked address of
+		 * page 1 would alias the coefficient registers onto the window */
+		if (rslt == BME680_OK)
+			shadow_store(reg_addr, reg_data, len, dev);
+		else
+			dev->shadow.valid = 0;
 	}
 
 	return rslt;
@@ -331,30 +528,27 @@ int8_t bme680_get_regs(uint8_t reg_addr, uint8_t *reg_data, uint16_t len, struct
 int8_t bme680_set_regs(const uint8_t *reg_addr, const uint8_t *reg_data, uint8_t len, struct bme680_dev *dev)
 {
 	int8_t rslt;
-	/* Length of the temporary buffer is 2*(length of register)*/
-	uint8_t tmp_buff[BME680_TMP_BUFFER_LENGTH] = { 0 };
+	uint8_t first_page;
 	uint16_t index;
 
 	/* Check for null pointer in the device structure*/
 	rslt = null_ptr_check(dev);
 	if (rslt == BME680_OK) {
 		if ((len > 0) && (len < BME680_TMP_BUFFER_LENGTH / 2)) {
-			/* Interleave the 2 arrays */
-			for (index = 0; index < len; index++) {
-				if (dev->intf == BME680_SPI_INTF) {
-					/* Set the memory page */
-					rslt = set_mem_page(reg_addr[index], dev);
-					tmp_buff[(2 * index)] = reg_addr[index] & BME680_SPI_WR_MSK;
-				} else {
-					tmp_buff[(2 * index)] = reg_addr[index];
-				}
-				tmp_buff[(2 * index) + 1] = reg_data[index];
+			if (dev->intf == BME680_SPI_INTF) {
+				/* The page already selected goes first, so each page is selected at most once */
+				first_page = (dev->mem_page == BME680_MEM_PAGE0) ? BME680_MEM_PAGE0 : BME680_MEM_PAGE1;
+				rslt = set_page_regs(reg_addr, reg_data, len, first_page, dev);
+				if (rslt == BME680_OK)
+					rslt = set_page_regs(reg_addr, reg_data, len, first_page ^ BME680_MEM_PAGE_MSK, dev);
+			} else {
+				rslt = set_page_regs(reg_addr, reg_data, len, BME680_MEM_PAGE_UNKNOWN, dev);
 			}
-			/* Write the interleaved array */
 			if (rslt == BME680_OK) {
-				dev->com_rslt = dev->write(dev->dev_id, tmp_buff[0], &tmp_buff[1], (2 * len) - 1);
-				if (dev->com_rslt != 0)
-					rslt = BME680_E_COM_FAIL;
+				for (index = 0; index < len; index++)
+					shadow_store(reg_addr[index], &reg_data[index], 1, dev);
+			} else {
+				dev->shadow.valid = 0;
 			}
 		} else {
 			rslt = BME680_E_INVALID_LENGTH;
@@ -385,12 +579,11 @@ int8_t bme680_soft_reset(struct bme680_dev *dev)
 			rslt = bme680_set_regs(&reg_addr, &soft_rst_cmd, 1, dev);
 			/* Wait for 5ms */
 			dev->delay_ms(BME680_RESET_PERIOD);
+			dev->shadow.valid = 0;
 
-			if (rslt == BME680_OK) {
-				/* After reset get the memory page */
-				if (dev->intf == BME680_SPI_INTF)
-					rslt = get_mem_page(dev);
-			}
+			/* The reset selects the default page, no need to read it back */
+			if ((rslt == BME680_OK) && (dev->intf == BME680_SPI_INTF))
+				dev->mem_page = BME680_MEM_PAGE_RESET;
 		}
 	}
 
@@ -427,7 +620,7 @@ int8_t bme680_set_sensor_settings(uint16_t desired_settings, struct bme680_dev *
 			reg_addr = BME680_CONF_ODR_FILT_ADDR;
 
 			if (rslt == BME680_OK)
-				rslt = bme680_get_regs(reg_addr, &data, 1, dev);
+				rslt = shadow_read(reg_addr, &data, dev);
 
 			if (desired_settings & BME680_FILTER_SEL)
 				data = BME680_SET_BITS(data, BME680_FILTER, dev->tph_sett.filter);
@@ -444,7 +637,7 @@ int8_t bme680_set_sensor_settings(uint16_t desired_settings, struct bme680_dev *
 			reg_addr = BME680_CONF_HEAT_CTRL_ADDR;
 
 			if (rslt == BME680_OK)
-				rslt = bme680_get_regs(reg_addr, &data, 1, dev);
+				rslt = shadow_read(reg_addr, &data, dev);
 			data = BME680_SET_BITS_POS_0(data, BME680_HCTRL, dev->gas_sett.heatr_ctrl);
 
 			reg_array[count] = reg_addr; /* Append configuration */
@@ -458,7 +651,7 @@ int8_t bme680_set_sensor_settings(uint16_t desired_settings, struct bme680_dev *
 			reg_addr = BME680_CONF_T_P_MODE_ADDR;
 
 			if (rslt == BME680_OK)
-				rslt = bme680_get_regs(reg_addr, &data, 1, dev);
+				rslt = shadow_read(reg_addr, &data, dev);
 
 			if (desired_settings & BME680_OST_SEL)
 				data = BME680_SET_BITS(data, BME680_OST, dev->tph_sett.os_temp);
@@ -477,7 +670,7 @@ int8_t bme680_set_sensor_settings(uint16_t desired_settings, struct bme680_dev *
 			reg_addr = BME680_CONF_OS_H_ADDR;
 
 			if (rslt == BME680_OK)
-				rslt = bme680_get_regs(reg_addr, &data, 1, dev);
+				rslt = shadow_read(reg_addr, &data, dev);
 			data = BME680_SET_BITS_POS_0(data, BME680_OSH, dev->tph_sett.os_hum);
 
 			reg_array[count] = reg_addr; /* Append configuration */
@@ -498,7 +691,7 @@ int8_t bme680_set_sensor_settings(uint16_t desired_settings, struct bme680_dev *
 			reg_addr = BME680_CONF_ODR_RUN_GAS_NBC_ADDR;
 
 			if (rslt == BME680_OK)
-				rslt = bme680_get_regs(reg_addr, &data, 1, dev);
+				rslt = shadow_read(reg_addr, &data, dev);
 
 			if (desired_settings & BME680_RUN_GAS_SEL)
 				data = BME680_SET_BITS(data, BME680_RUN_GAS, dev->gas_sett.run_gas);
@@ -512,7 +705,7 @@ int8_t bme680_set_sensor_settings(uint16_t desired_settings, struct bme680_dev *
 		}
 
 		if (rslt == BME680_OK)
-			rslt = bme680_set_regs(reg_array, data_array, count, dev);
+			rslt = shadow_write(reg_array, data_array, count, dev);
 
 		/* Restore previous intended power mode */
 		dev->power_mode = intended_power_mode;
@@ -587,9 +780,9 @@ int8_t bme680_set_sensor_mode(struct bme680_dev *dev)
 	/* Check for null pointer in the device structure*/
 	rslt = null_ptr_check(dev);
 	if (rslt == BME680_OK) {
-		/* Call repeatedly until in sleep */
+		/* Call repeatedly until in sleep; a shadow already in sleep needs no bus access */
 		do {
-			rslt = bme680_get_regs(BME680_CONF_T_P_MODE_ADDR, &tmp_pow_mode, 1, dev);
+			rslt = shadow_read(BME680_CONF_T_P_MODE_ADDR, &tmp_pow_mode, dev);
 			if (rslt == BME680_OK) {
 				/* Put to sleep before changing mode */
 				pow_mode = (tmp_pow_mode & BME680_MODE_MSK);
@@ -598,6 +791,8 @@ int8_t bme680_set_sensor_mode(struct bme680_dev *dev)
 					tmp_pow_mode = tmp_pow_mode & (~BME680_MODE_MSK); /* Set to sleep */
 					rslt = bme680_set_regs(&reg_addr, &tmp_pow_mode, 1, dev);
 					dev->delay_ms(BME680_POLL_PERIOD_MS);
+					/* Confirm from the sensor, not from the value just written */
+					dev->shadow.valid &= ~(UINT32_C(1) << (reg_addr - BME680_SHADOW_START));
 				}
 			}
 		} while (pow_mode != BME680_SLEEP_MODE);
@@ -607,6 +802,8 @@ int8_t bme680_set_sensor_mode(struct bme680_dev *dev)
 			tmp_pow_mode = (tmp_pow_mode & ~BME680_MODE_MSK) | (dev->power_mode & BME680_MODE_MSK);
 			if (rslt == BME680_OK)
 				rslt = bme680_set_regs(&reg_addr, &tmp_pow_mode, 1, dev);
+			if ((rslt == BME680_OK) && (dev->power_mode == BME680_FORCED_MODE))
+				stats_trigger(dev);
 		}
 	}
 
@@ -688,6 +885,62 @@ void bme680_get_profile_dur(uint16_t *duration, const struct bme680_dev *dev)
 	}
 }
 
+/*!
+ * @brief This API loads a multi-step heater profile.
+ */
+int8_t bme680_set_heatr_profile(const struct bme680_heatr_profile *profile, struct bme680_dev *dev)
+{
+	int8_t rslt;
+
+	/* Check for null pointer in the device structure*/
+	rslt = null_ptr_check(dev);
+	if (rslt == BME680_OK) {
+		if ((profile != NULL) && ((profile->len == 0) || (profile->len > BME680_HEATR_STEPS)))
+			rslt = BME680_E_INVALID_LENGTH;
+
+		if (rslt == BME680_OK) {
+			dev->heatr_prof = profile;
+			dev->gas_sett.nb_conv = 0;
+			rslt = set_gas_config(dev);
+			if ((rslt == BME680_OK) && (profile != NULL))
+				rslt = bme680_set_heatr_step(0, dev);
+		}
+	}
+
+	return rslt;
+}
+
+/*!
+ * @brief This API selects the heater profile step of the next measurement.
+ */
+int8_t bme680_set_heatr_step(uint8_t step, struct bme680_dev *dev)
+{
+	int8_t rslt;
+	uint8_t reg_addr = BME680_CONF_ODR_RUN_GAS_NBC_ADDR;
+	uint8_t data;
+
+	/* Check for null pointer in the device structure*/
+	rslt = null_ptr_check(dev);
+	if (rslt == BME680_OK) {
+		if ((dev->heatr_prof == NULL) || (step >= dev->heatr_prof->len))
+			rslt = BME680_E_INVALID_LENGTH;
+
+		if (rslt == BME680_OK) {
+			/* ctrl_gas_1 only holds run_gas and nb_conv, no read-modify-write needed */
+			data = BME680_SET_BITS(0, BME680_RUN_GAS, dev->gas_sett.run_gas);
+			data = BME680_SET_BITS_POS_0(data, BME680_NBCONV, step);
+			rslt = shadow_write(&reg_addr, &data, 1, dev);
+		}
+		if (rslt == BME680_OK) {
+			dev->gas_sett.nb_conv = step;
+			dev->gas_sett.heatr_temp = dev->heatr_prof->heatr_temp[step];
+			dev->gas_sett.heatr_dur = dev->heatr_prof->heatr_dur[step];
+		}
+	}
+
+	return rslt;
+}
+
 /*!
  * @brief This API reads the pressure, temperature and humidity and gas data
  * from the sensor, compensates the data and store it in the bme680_data
@@ -713,6 +966,203 @@ int8_t bme680_get_sensor_data(struct bme680_field_data *data, struct bme680_dev
 	return rslt;
 }
 
+/*!
+ * @brief This API triggers a single forced mode conversion and returns
+ * without waiting for the sensor to finish.
+ */
+int8_t bme680_start_meas(struct bme680_dev *dev)
+{
+	int8_t rslt;
+	uint8_t tmp_pow_mode;
+	uint8_t reg_addr = BME680_CONF_T_P_MODE_ADDR;
+
+	/* Check for null pointer in the device structure*/
+	rslt = null_ptr_check(dev);
+	if (rslt == BME680_OK) {
+		/* The shadow only knows a forced conversion ended once its data was read */
+		if ((dev->shadow.reg[reg_addr - BME680_SHADOW_START] & BME680_MODE_MSK) != BME680_SLEEP_MODE)
+			dev->shadow.valid &= ~(UINT32_C(1) << (reg_addr - BME680_SHADOW_START));
+
+		rslt = shadow_read(reg_addr, &tmp_pow_mode, dev);
+		if (rslt == BME680_OK) {
+			/* The sensor drops back to sleep by itself once a forced conversion ends */
+			if ((tmp_pow_mode & BME680_MODE_MSK) != BME680_SLEEP_MODE) {
+				rslt = BME680_W_MEAS_BUSY;
+			} else {
+				tmp_pow_mode = (tmp_pow_mode & ~BME680_MODE_MSK) | BME680_FORCED_MODE;
+				rslt = bme680_set_regs(&reg_addr, &tmp_pow_mode, 1, dev);
+				if (rslt == BME680_OK)
+					stats_trigger(dev);
+			}
+		}
+	}
+
+	return rslt;
+}
+
+/*!
+ * @brief This API reads the field registers exactly once and compensates
+ * them if a new conversion is available.
+ */
+int8_t bme680_poll_sensor_data(struct bme680_field_data *data, struct bme680_dev *dev)
+{
+	int8_t rslt;
+	uint8_t buff[BME680_FIELD_LENGTH] = { 0 };
+
+	/* Check for null pointer in the device structure*/
+	rslt = null_ptr_check(dev);
+	if ((rslt == BME680_OK) && (data == NULL))
+		rslt = BME680_E_NULL_PTR;
+
+	if (rslt == BME680_OK) {
+		rslt = bme680_get_regs(BME680_FIELD0_ADDR, buff, BME680_FIELD_LENGTH, dev);
+		if (rslt == BME680_OK)
+			rslt = bme680_compensate_field(buff, data, dev);
+	}
+
+	return rslt;
+}
+
+/*!
+ * @brief This API starts an asynchronous burst read of the field registers.
+ */
+int8_t bme680_start_field_read(uint8_t *buff, bme680_com_cplt_fptr_t cplt, void *ctx, struct bme680_dev *dev)
+{
+	int8_t rslt;
+	uint8_t reg_addr = BME680_FIELD0_ADDR;
+
+	/* Check for null pointer in the device structure*/
+	rslt = null_ptr_check(dev);
+	if ((rslt == BME680_OK) && ((buff == NULL) || (cplt == NULL) || (dev->read_async == NULL)))
+		rslt = BME680_E_NULL_PTR;
+
+	if (rslt == BME680_OK) {
+		if (dev->intf == BME680_SPI_INTF) {
+			/* The page switch itself stays synchronous */
+			rslt = set_mem_page(reg_addr, dev);
+			if (rslt == BME680_OK)
+				reg_addr = reg_addr | BME680_SPI_RD_MSK;
+		}
+		if (rslt == BME680_OK) {
+			dev->com_rslt = dev->read_async(dev->dev_id, reg_addr, buff, BME680_FIELD_LENGTH, cplt, ctx);
+			if (dev->com_rslt != 0)
+				rslt = BME680_E_COM_FAIL;
+		}
+	}
+
+	return rslt;
+}
+
+/*!
+ * @brief This API decodes a burst of the field registers and compensates it
+ * when it carries new data.
+ */
+int8_t bme680_compensate_field(const uint8_t *buff, struct bme680_field_data *data, struct bme680_dev *dev)
+{
+	int8_t rslt;
+
+	/* Check for null pointer in the device structure*/
+	rslt = null_ptr_check(dev);
+	if ((rslt == BME680_OK) && ((buff == NULL) || (data == NULL)))
+		rslt = BME680_E_NULL_PTR;
+
+	if (rslt == BME680_OK) {
+		parse_field_data(buff, data, dev);
+		if (data->status & BME680_NEW_DATA_MSK) {
+			dev->new_fields = 1;
+		} else {
+			dev->new_fields = 0;
+			rslt = BME680_W_NO_NEW_DATA;
+		}
+	}
+
+	return rslt;
+}
+
+/*!
+ * @brief This API clears the readout statistics.
+ */
+int8_t bme680_clear_meas_stats(struct bme680_dev *dev)
+{
+	int8_t rslt;
+	struct bme680_meas_stats cleared = { 0 };
+
+	/* Check for null pointer in the device structure*/
+	rslt = null_ptr_check(dev);
+	if (rslt == BME680_OK) {
+		cleared.t_trigger = dev->stats.t_trigger;
+		cleared.retries = dev->stats.retries;
+		cleared.pending = dev->stats.pending;
+		dev->stats = cleared;
+	}
+
+	return rslt;
+}
+
+/*!
+ * @brief This API compensates a structure-of-arrays batch of raw frames.
+ */
+int8_t bme680_compensate_batch(const struct bme680_raw_batch *raw, struct bme680_comp_batch *comp,
+	uint32_t count, struct bme680_dev *dev)
+{
+	uint32_t i;
+
+	if ((raw == NULL) || (comp == NULL) || (dev == NULL))
+		return BME680_E_NULL_PTR;
+	if ((raw->temp_adc == NULL) || (raw->pres_adc == NULL) || (raw->hum_adc == NULL)
+		|| (comp->temperature == NULL) || (comp->pressure == NULL) || (comp->humidity == NULL))
+		return BME680_E_NULL_PTR;
+	if (count == 0)
+		return BME680_OK;
+
+#ifndef BME680_FLOAT_POINT_COMPENSATION
+	{
+		/* Private copies and restrict pointers let the compiler keep the
+		 * plan in registers and unroll/vectorise the loops */
+		const struct bme680_comp_plan plan = dev->plan;
+		const uint32_t *__restrict temp_adc = raw->temp_adc;
+		const uint32_t *__restrict pres_adc = raw->pres_adc;
+		const uint16_t *__restrict hum_adc = raw->hum_adc;
+		int16_t *__restrict temperature = comp->temperature;
+		uint32_t *__restrict pressure = comp->pressure;
+		uint32_t *__restrict humidity = comp->humidity;
+		int32_t t_fine = 0;
+
+		for (i = 0; i < count; i++) {
+			t_fine = comp_t_fine(temp_adc[i], &plan);
+			temperature[i] = (int16_t) (((t_fine * 5) + 128) >> 8);
+			pressure[i] = comp_pressure(pres_adc[i], t_fine, &plan);
+			humidity[i] = comp_humidity(hum_adc[i], t_fine, &plan);
+		}
+		dev->calib.t_fine = t_fine;
+
+		/* Gas does not depend on t_fine, run it as a separate pass */
+		if ((raw->gas_adc != NULL) && (raw->gas_range != NULL) && (comp->gas_resistance != NULL)) {
+			const uint16_t *__restrict gas_adc = raw->gas_adc;
+			const uint8_t *__restrict gas_range = raw->gas_range;
+			uint32_t *__restrict gas_resistance = comp->gas_resistance;
+
+			for (i = 0; i < count; i++)
+				gas_resistance[i] = comp_gas_resistance(gas_adc[i], gas_range[i] & BME680_GAS_RANGE_MSK,
+					&plan);
+		}
+	}
+#else
+	for (i = 0; i < count; i++) {
+		comp->temperature[i] = calc_temperature(raw->temp_adc[i], dev);
+		comp->pressure[i] = calc_pressure(raw->pres_adc[i], dev);
+		comp->humidity[i] = calc_humidity(raw->hum_adc[i], dev);
+	}
+	if ((raw->gas_adc != NULL) && (raw->gas_range != NULL) && (comp->gas_resistance != NULL)) {
+		for (i = 0; i < count; i++)
+			comp->gas_resistance[i] = calc_gas_resistance(raw->gas_adc[i],
+				raw->gas_range[i] & BME680_GAS_RANGE_MSK, dev);
+	}
+#endif
+
+	return BME680_OK;
+}
+
 /*!
  * @brief This internal API is used to read the calibrated data from the sensor.
  */
@@ -787,6 +1237,9 @@ static int8_t get_calib_data(struct bme680_dev *dev)
 			}
 		}
 		dev->calib.range_sw_err = ((int8_t) temp_var & (int8_t) BME680_RSERROR_MSK) / 16;
+
+		if (rslt == BME680_OK)
+			bme680_build_comp_plan(dev);
 	}
 
 	return rslt;
@@ -803,20 +1256,39 @@ static int8_t set_gas_config(struct bme680_dev *dev)
 	rslt = null_ptr_check(dev);
 	if (rslt == BME680_OK) {
 
-		uint8_t reg_addr[2] = {0};
-		uint8_t reg_data[2] = {0};
+		uint8_t reg_addr[BME680_HEATR_STEPS] = {0};
+		uint8_t reg_data[BME680_HEATR_STEPS] = {0};
+		const struct bme680_heatr_profile *prof = dev->heatr_prof;
+		uint8_t i;
 
-		if (dev->power_mode == BME680_FORCED_MODE) {
+		if (dev->power_mode != BME680_FORCED_MODE) {
+			rslt = BME680_W_DEFINE_PWR_MODE;
+		} else if (prof == NULL) {
 			reg_addr[0] = BME680_RES_HEAT0_ADDR;
 			reg_data[0] = calc_heater_res(dev->gas_sett.heatr_temp, dev);
 			reg_addr[1] = BME680_GAS_WAIT0_ADDR;
 			reg_data[1] = calc_heater_dur(dev->gas_sett.heatr_dur);
 			dev->gas_sett.nb_conv = 0;
+			rslt = shadow_write(reg_addr, reg_data, 2, dev);
 		} else {
-			rslt = BME680_W_DEFINE_PWR_MODE;
+			/* Two bursts: all res_heat_x, then all gas_wait_x */
+			for (i = 0; i < prof->len; i++) {
+				reg_addr[i] = BME680_RES_HEAT0_ADDR + i;
+				reg_data[i] = calc_heater_res(prof->heatr_temp[i], dev);
+			}
+			rslt = shadow_write(reg_addr, reg_data, prof->len, dev);
+			if (rslt == BME680_OK) {
+				for (i = 0; i < prof->len; i++) {
+					reg_addr[i] = BME680_GAS_WAIT0_ADDR + i;
+					reg_data[i] = calc_heater_dur(prof->heatr_dur[i]);
+				}
+				rslt = shadow_write(reg_addr, reg_data, prof->len, dev);
+			}
+			if (dev->gas_sett.nb_conv >= prof->len)
+				dev->gas_sett.nb_conv = 0;
+			dev->gas_sett.heatr_temp = prof->heatr_temp[dev->gas_sett.nb_conv];
+			dev->gas_sett.heatr_dur = prof->heatr_dur[dev->gas_sett.nb_conv];
 		}
-		if (rslt == BME680_OK)
-			rslt = bme680_set_regs(reg_addr, reg_data, 2, dev);
 	}
 
 	return rslt;
@@ -861,71 +1333,74 @@ static int8_t get_gas_config(struct bme680_dev *dev)
 
 #ifndef BME680_FLOAT_POINT_COMPENSATION
 
+/**Look up table 1 for the possible gas range values */
+static const uint32_t lookupTable1[16] = { UINT32_C(2147483647), UINT32_C(2147483647), UINT32_C(2147483647),
+	UINT32_C(2147483647), UINT32_C(2147483647), UINT32_C(2126008810), UINT32_C(2147483647), UINT32_C(2130303777),
+	UINT32_C(2147483647), UINT32_C(2147483647), UINT32_C(2143188679), UINT32_C(2136746228),
+	UINT32_C(2147483647), UINT32_C(2126008810), UINT32_C(2147483647), UINT32_C(2147483647) };
+/**Look up table 2 for the possible gas range values */
+static const uint32_t lookupTable2[16] = { UINT32_C(4096000000), UINT32_C(2048000000), UINT32_C(1024000000),
+	UINT32_C(512000000), UINT32_C(255744255), UINT32_C(127110228), UINT32_C(64000000), UINT32_C(32258064),
+	UINT32_C(16016016), UINT32_C(8000000), UINT32_C(4000000), UINT32_C(2000000), UINT32_C(1000000),
+	UINT32_C(500000), UINT32_C(250000), UINT32_C(125000) };
+
 /*!
- * @brief This internal API is used to calculate the temperature value.
+ * @brief Temperature kernel shared by the single sample and batch paths.
  */
-static int16_t calc_temperature(uint32_t temp_adc, struct bme680_dev *dev)
+static inline int32_t comp_t_fine(uint32_t temp_adc, const struct bme680_comp_plan *plan)
 {
 	int64_t var1;
 	int64_t var2;
 	int64_t var3;
-	int16_t calc_temp;
 
-	var1 = ((int32_t) temp_adc >> 3) - ((int32_t) dev->calib.par_t1 << 1);
-	var2 = (var1 * (int32_t) dev->calib.par_t2) >> 11;
+	var1 = ((int32_t) temp_adc >> 3) - plan->t1_x2;
+	var2 = (var1 * plan->t2) >> 11;
 	var3 = ((var1 >> 1) * (var1 >> 1)) >> 12;
-	var3 = ((var3) * ((int32_t) dev->calib.par_t3 << 4)) >> 14;
-	dev->calib.t_fine = (int32_t) (var2 + var3);
-	calc_temp = (int16_t) (((dev->calib.t_fine * 5) + 128) >> 8);
+	var3 = ((var3) * plan->t3_x16) >> 14;
 
-	return calc_temp;
+	return (int32_t) (var2 + var3);
 }
 
 /*!
- * @brief This internal API is used to calculate the pressure value.
+ * @brief Pressure kernel shared by the single sample and batch paths.
  */
-static uint32_t calc_pressure(uint32_t pres_adc, const struct bme680_dev *dev)
+static inline uint32_t comp_pressure(uint32_t pres_adc, int32_t t_fine, const struct bme680_comp_plan *plan)
 {
 	int32_t var1;
 	int32_t var2;
 	int32_t var3;
 	int32_t pressure_comp;
 
-	var1 = (((int32_t)dev->calib.t_fine) >> 1) - 64000;
-	var2 = ((((var1 >> 2) * (var1 >> 2)) >> 11) *
-		(int32_t)dev->calib.par_p6) >> 2;
-	var2 = var2 + ((var1 * (int32_t)dev->calib.par_p5) << 1);
-	var2 = (var2 >> 2) + ((int32_t)dev->calib.par_p4 << 16);
-	var1 = (((((var1 >> 2) * (var1 >> 2)) >> 13) *
-		((int32_t)dev->calib.par_p3 << 5)) >> 3) +
-		(((int32_t)dev->calib.par_p2 * var1) >> 1);
+	var1 = (t_fine >> 1) - 64000;
+	var2 = ((((var1 >> 2) * (var1 >> 2)) >> 11) * plan->p6) >> 2;
+	var2 = var2 + (var1 * plan->p5_x2);
+	var2 = (var2 >> 2) + plan->p4_x65536;
+	var1 = (((((var1 >> 2) * (var1 >> 2)) >> 13) * plan->p3_x32) >> 3) +
+		((plan->p2 * var1) >> 1);
 	var1 = var1 >> 18;
-	var1 = ((32768 + var1) * (int32_t)dev->calib.par_p1) >> 15;
+	var1 = ((32768 + var1) * plan->p1) >> 15;
 	pressure_comp = 1048576 - pres_adc;
 	pressure_comp = (int32_t)((pressure_comp - (var2 >> 12)) * ((uint32_t)3125));
 	if (pressure_comp >= BME680_MAX_OVERFLOW_VAL)
 		pressure_comp = ((pressure_comp / var1) << 1);
 	else
 		pressure_comp = ((pressure_comp << 1) / var1);
-	var1 = ((int32_t)dev->calib.par_p9 * (int32_t)(((pressure_comp >> 3) *
+	var1 = (plan->p9 * (int32_t)(((pressure_comp >> 3) *
 		(pressure_comp >> 3)) >> 13)) >> 12;
-	var2 = ((int32_t)(pressure_comp >> 2) *
-		(int32_t)dev->calib.par_p8) >> 13;
+	var2 = ((int32_t)(pressure_comp >> 2) * plan->p8) >> 13;
 	var3 = ((int32_t)(pressure_comp >> 8) * (int32_t)(pressure_comp >> 8) *
-		(int32_t)(pressure_comp >> 8) *
-		(int32_t)dev->calib.par_p10) >> 17;
+		(int32_t)(pressure_comp >> 8) * plan->p10) >> 17;
 
 	pressure_comp = (int32_t)(pressure_comp) + ((var1 + var2 + var3 +
-		((int32_t)dev->calib.par_p7 << 7)) >> 4);
+		plan->p7_x128) >> 4);
 
 	return (uint32_t)pressure_comp;
-
 }
 
 /*!
- * @brief This internal API is used to calculate the humidity value.
+ * @brief Humidity kernel shared by the single sample and batch paths.
  */
-static uint32_t calc_humidity(uint16_t hum_adc, const struct bme680_dev *dev)
+static inline uint32_t comp_humidity(uint16_t hum_adc, int32_t t_fine, const struct bme680_comp_plan *plan)
 {
 	int32_t var1;
 	int32_t var2;
@@ -936,16 +1411,15 @@ static uint32_t calc_humidity(uint16_t hum_adc, const struct bme680_dev *dev)
 	int32_t temp_scaled;
 	int32_t calc_hum;
 
-	temp_scaled = (((int32_t) dev->calib.t_fine * 5) + 128) >> 8;
-	var1 = (int32_t) (hum_adc - ((int32_t) ((int32_t) dev->calib.par_h1 * 16)))
-		- (((temp_scaled * (int32_t) dev->calib.par_h3) / ((int32_t) 100)) >> 1);
-	var2 = ((int32_t) dev->calib.par_h2
-		* (((temp_scaled * (int32_t) dev->calib.par_h4) / ((int32_t) 100))
-			+ (((temp_scaled * ((temp_scaled * (int32_t) dev->calib.par_h5) / ((int32_t) 100))) >> 6)
+	temp_scaled = ((t_fine * 5) + 128) >> 8;
+	var1 = (int32_t) (hum_adc - plan->h1_x16)
+		- (((temp_scaled * plan->h3) / ((int32_t) 100)) >> 1);
+	var2 = (plan->h2
+		* (((temp_scaled * plan->h4) / ((int32_t) 100))
+			+ (((temp_scaled * ((temp_scaled * plan->h5) / ((int32_t) 100))) >> 6)
 				/ ((int32_t) 100)) + (int32_t) (1 << 14))) >> 10;
 	var3 = var1 * var2;
-	var4 = (int32_t) dev->calib.par_h6 << 7;
-	var4 = ((var4) + ((temp_scaled * (int32_t) dev->calib.par_h7) / ((int32_t) 100))) >> 4;
+	var4 = (plan->h6_x128 + ((temp_scaled * plan->h7) / ((int32_t) 100))) >> 4;
 	var5 = ((var3 >> 14) * (var3 >> 14)) >> 10;
 	var6 = (var4 * var5) >> 1;
 	calc_hum = (((var3 + var6) >> 10) * ((int32_t) 1000)) >> 12;
@@ -959,32 +1433,89 @@ static uint32_t calc_humidity(uint16_t hum_adc, const struct bme680_dev *dev)
 }
 
 /*!
- * @brief This internal API is used to calculate the Gas Resistance value.
+ * @brief This internal API precomputes the per gas range terms.
  */
-static uint32_t calc_gas_resistance(uint16_t gas_res_adc, uint8_t gas_range, const struct bme680_dev *dev)
+static void build_gas_plan(struct bme680_comp_plan *plan, int8_t range_sw_err)
 {
 	int64_t var1;
-	uint64_t var2;
+	uint8_t range;
+
+	for (range = 0; range < 16; range++) {
+		var1 = (int64_t) ((1340 + (5 * (int64_t) range_sw_err)) *
+			((int64_t) lookupTable1[range])) >> 16;
+		plan->gas_ofs[range] = (int32_t) (var1 - (int64_t) (16777216));
+		plan->gas_var3[range] = (((int64_t) lookupTable2[range] * (int64_t) var1) >> 9);
+		plan->gas_var3f[range] = (float) plan->gas_var3[range];
+	}
+}
+
+/*!
+ * @brief Gas resistance kernel shared by the single sample and batch paths.
+ * The 64-bit division of the reference formula is a library call on the
+ * Cortex-M4; here a single precision quotient estimate is corrected to the
+ * exact result with one 32x32 multiply and the remainder.
+ */
+static inline uint32_t comp_gas_resistance(uint16_t gas_res_adc, uint8_t gas_range, const struct bme680_comp_plan *plan)
+{
+	int32_t var2;
 	int64_t var3;
-	uint32_t calc_gas_res;
-	/**Look up table 1 for the possible gas range values */
-	uint32_t lookupTable1[16] = { UINT32_C(2147483647), UINT32_C(2147483647), UINT32_C(2147483647), UINT32_C(2147483647),
-		UINT32_C(2147483647), UINT32_C(2126008810), UINT32_C(2147483647), UINT32_C(2130303777),
-		UINT32_C(2147483647), UINT32_C(2147483647), UINT32_C(2143188679), UINT32_C(2136746228),
-		UINT32_C(2147483647), UINT32_C(2126008810), UINT32_C(2147483647), UINT32_C(2147483647) };
-	/**Look up table 2 for the possible gas range values */
-	uint32_t lookupTable2[16] = { UINT32_C(4096000000), UINT32_C(2048000000), UINT32_C(1024000000), UINT32_C(512000000),
-		UINT32_C(255744255), UINT32_C(127110228), UINT32_C(64000000), UINT32_C(32258064), UINT32_C(16016016),
-		UINT32_C(8000000), UINT32_C(4000000), UINT32_C(2000000), UINT32_C(1000000), UINT32_C(500000),
-		UINT32_C(250000), UINT32_C(125000) };
-
-	var1 = (int64_t) ((1340 + (5 * (int64_t) dev->calib.range_sw_err)) *
-		((int64_t) lookupTable1[gas_range])) >> 16;
-	var2 = (((int64_t) ((int64_t) gas_res_adc << 15) - (int64_t) (16777216)) + var1);
-	var3 = (((int64_t) lookupTable2[gas_range] * (int64_t) var1) >> 9);
-	calc_gas_res = (uint32_t) ((var3 + ((int64_t) var2 >> 1)) / (int64_t) var2);
+	int64_t rem;
+	uint32_t res;
+
+	/* range_sw_err is -8..7, which keeps var2 between 2^24 and 2^27 */
+	var2 = ((int32_t) gas_res_adc << 15) + plan->gas_ofs[gas_range];
+	var3 = plan->gas_var3[gas_range] + (var2 >> 1);
+	if (var2 <= 0)
+		return (uint32_t) (var3 / var2);
+
+	/* The quotient stays below 2^24; over every code, range and range_sw_err
+	 * the estimate is at most one count off, the loops are only a backstop */
+	res = (uint32_t) ((plan->gas_var3f[gas_range] / (float) var2) + 0.5f);
+	rem = var3 - ((int64_t) res * var2);
+	while (rem < 0) {
+		res--;
+		rem += var2;
+	}
+	while (rem >= var2) {
+		res++;
+		rem -= var2;
+	}
 
-	return calc_gas_res;
+	return res;
+}
+
+/*!
+ * @brief This internal API is used to calculate the temperature value.
+ */
+static int16_t calc_temperature(uint32_t temp_adc, struct bme680_dev *dev)
+{
+	dev->calib.t_fine = comp_t_fine(temp_adc, &dev->plan);
+
+	return (int16_t) (((dev->calib.t_fine * 5) + 128) >> 8);
+}
+
+/*!
+ * @brief This internal API is used to calculate the pressure value.
+ */
+static uint32_t calc_pressure(uint32_t pres_adc, const struct bme680_dev *dev)
+{
+	return comp_pressure(pres_adc, dev->calib.t_fine, &dev->plan);
+}
+
+/*!
+ * @brief This internal API is used to calculate the humidity value.
+ */
+static uint32_t calc_humidity(uint16_t hum_adc, const struct bme680_dev *dev)
+{
+	return comp_humidity(hum_adc, dev->calib.t_fine, &dev->plan);
+}
+
+/*!
+ * @brief This internal API is used to calculate the Gas Resistance value.
+ */
+static uint32_t calc_gas_resistance(uint16_t gas_res_adc, uint8_t gas_range, const struct bme680_dev *dev)
+{
+	return comp_gas_resistance(gas_res_adc, gas_range, &dev->plan);
 }
 
 /*!
@@ -992,6 +1523,7 @@ static uint32_t calc_gas_resistance(uint16_t gas_res_adc, uint8_t gas_range, con
  */
 static uint8_t calc_heater_res(uint16_t temp, const struct bme680_dev *dev)
 {
+	const struct bme680_comp_plan *plan = &dev->plan;
 	uint8_t heatr_res;
 	int32_t var1;
 	int32_t var2;
@@ -1003,11 +1535,15 @@ static uint8_t calc_heater_res(uint16_t temp, const struct bme680_dev *dev)
 	if (temp > 400) /* Cap temperature */
 		temp = 400;
 
-	var1 = (((int32_t) dev->amb_temp * dev->calib.par_gh3) / 1000) * 256;
-	var2 = (dev->calib.par_gh1 + 784) * (((((dev->calib.par_gh2 + 154009) * temp * 5) / 100) + 3276800) / 10);
+	/* amb_temp may be updated after the plan was built */
+	if (dev->amb_temp == plan->amb_temp)
+		var1 = plan->heat_amb;
+	else
+		var1 = (((int32_t) dev->amb_temp * dev->calib.par_gh3) / 1000) * 256;
+	var2 = plan->gh1_784 * ((((plan->gh2_x5 * temp) / 100) + 3276800) / 10);
 	var3 = var1 + (var2 / 2);
-	var4 = (var3 / (dev->calib.res_heat_range + 4));
-	var5 = (131 * dev->calib.res_heat_val) + 65536;
+	var4 = (var3 / plan->heat_range_div);
+	var5 = plan->heat_val;
 	heatr_res_x100 = (int32_t) (((var4 / var5) - 250) * 34);
 	heatr_res = (uint8_t) ((heatr_res_x100 + 50) / 100);
 
@@ -1195,17 +1731,57 @@ static uint8_t calc_heater_dur(uint16_t dur)
 }
 
 /*!
- * @brief This internal API is used to calculate the field data of sensor.
+ * @brief This internal API is used to decode one burst of the field
+ * registers and compensate it when it carries new data.
  */
-static int8_t read_field_data(struct bme680_field_data *data, struct bme680_dev *dev)
+static void parse_field_data(const uint8_t *buff, struct bme680_field_data *data, struct bme680_dev *dev)
 {
-	int8_t rslt;
-	uint8_t buff[BME680_FIELD_LENGTH] = { 0 };
 	uint8_t gas_range;
 	uint32_t adc_temp;
 	uint32_t adc_pres;
 	uint16_t adc_hum;
 	uint16_t adc_gas_res;
+
+	if (dev->field_hook != NULL)
+		dev->field_hook(buff, dev);
+
+	data->status = buff[0] & BME680_NEW_DATA_MSK;
+	data->gas_index = buff[0] & BME680_GAS_INDEX_MSK;
+	data->meas_index = buff[1];
+
+	/* New data means the forced conversion is over and the sensor is asleep */
+	if (data->status)
+		dev->shadow.reg[BME680_CONF_T_P_MODE_ADDR - BME680_SHADOW_START] &= ~BME680_MODE_MSK;
+
+	/* read the raw data from the sensor */
+	adc_pres = (uint32_t) (((uint32_t) buff[2] * 4096) | ((uint32_t) buff[3] * 16)
+		| ((uint32_t) buff[4] / 16));
+	adc_temp = (uint32_t) (((uint32_t) buff[5] * 4096) | ((uint32_t) buff[6] * 16)
+		| ((uint32_t) buff[7] / 16));
+	adc_hum = (uint16_t) (((uint32_t) buff[8] * 256) | (uint32_t) buff[9]);
+	adc_gas_res = (uint16_t) ((uint32_t) buff[13] * 4 | (((uint32_t) buff[14]) / 64));
+	gas_range = buff[14] & BME680_GAS_RANGE_MSK;
+
+	data->status |= buff[14] & BME680_GASM_VALID_MSK;
+	data->status |= buff[14] & BME680_HEAT_STAB_MSK;
+
+	if (data->status & BME680_NEW_DATA_MSK) {
+		data->temperature = calc_temperature(adc_temp, dev);
+		data->pressure = calc_pressure(adc_pres, dev);
+		data->humidity = calc_humidity(adc_hum, dev);
+		data->gas_resistance = calc_gas_resistance(adc_gas_res, gas_range, dev);
+	}
+
+	stats_readout(data, dev);
+}
+
+/*!
+ * @brief This internal API is used to calculate the field data of sensor.
+ */
+static int8_t read_field_data(struct bme680_field_data *data, struct bme680_dev *dev)
+{
+	int8_t rslt;
+	uint8_t buff[BME680_FIELD_LENGTH] = { 0 };
 	uint8_t tries = 10;
 
 	/* Check for null pointer in the device structure*/
@@ -1215,29 +1791,10 @@ static int8_t read_field_data(struct bme680_field_data *data, struct bme680_dev
 			rslt = bme680_get_regs(((uint8_t) (BME680_FIELD0_ADDR)), buff, (uint16_t) BME680_FIELD_LENGTH,
 				dev);
 
-			data->status = buff[0] & BME680_NEW_DATA_MSK;
-			data->gas_index = buff[0] & BME680_GAS_INDEX_MSK;
-			data->meas_index = buff[1];
-
-			/* read the raw data from the sensor */
-			adc_pres = (uint32_t) (((uint32_t) buff[2] * 4096) | ((uint32_t) buff[3] * 16)
-				| ((uint32_t) buff[4] / 16));
-			adc_temp = (uint32_t) (((uint32_t) buff[5] * 4096) | ((uint32_t) buff[6] * 16)
-				| ((uint32_t) buff[7] / 16));
-			adc_hum = (uint16_t) (((uint32_t) buff[8] * 256) | (uint32_t) buff[9]);
-			adc_gas_res = (uint16_t) ((uint32_t) buff[13] * 4 | (((uint32_t) buff[14]) / 64));
-			gas_range = buff[14] & BME680_GAS_RANGE_MSK;
-
-			data->status |= buff[14] & BME680_GASM_VALID_MSK;
-			data->status |= buff[14] & BME680_HEAT_STAB_MSK;
-
-			if (data->status & BME680_NEW_DATA_MSK) {
-				data->temperature = calc_temperature(adc_temp, dev);
-				data->pressure = calc_pressure(adc_pres, dev);
-				data->humidity = calc_humidity(adc_hum, dev);
-				data->gas_resistance = calc_gas_resistance(adc_gas_res, gas_range, dev);
+			parse_field_data(buff, data, dev);
+			if (data->status & BME680_NEW_DATA_MSK)
 				break;
-			}
+
 			/* Delay to poll the data */
 			dev->delay_ms(BME680_POLL_PERIOD_MS);
 		}
@@ -1262,27 +1819,69 @@ static int8_t set_mem_page(uint8_t reg_addr, struct bme680_dev *dev)
 	/* Check for null pointers in the device structure*/
 	rslt = null_ptr_check(dev);
 	if (rslt == BME680_OK) {
-		if (reg_addr > 0x7f)
-			mem_page = BME680_MEM_PAGE1;
-		else
-			mem_page = BME680_MEM_PAGE0;
+		mem_page = mem_page_of(reg_addr);
 
 		if (mem_page != dev->mem_page) {
-			dev->mem_page = mem_page;
-
-			dev->com_rslt = dev->read(dev->dev_id, BME680_MEM_PAGE_ADDR | BME680_SPI_RD_MSK, &reg, 1);
-			if (dev->com_rslt != 0)
+			/* spi_mem_page is the only writable bit of the status register,
+			 * so the page is written without reading the register first */
+			reg = mem_page & BME680_MEM_PAGE_MSK;
+			dev->com_rslt = dev->write(dev->dev_id, BME680_MEM_PAGE_ADDR & BME680_SPI_WR_MSK, &reg, 1);
+			if (dev->com_rslt != 0) {
 				rslt = BME680_E_COM_FAIL;
+				dev->mem_page = BME680_MEM_PAGE_UNKNOWN;
+			} else {
+				dev->mem_page = mem_page;
+			}
+		}
+	}
 
-			if (rslt == BME680_OK) {
-				reg = reg & (~BME680_MEM_PAGE_MSK);
-				reg = reg | (dev->mem_page & BME680_MEM_PAGE_MSK);
+	return rslt;
+}
 
-				dev->com_rslt = dev->write(dev->dev_id, BME680_MEM_PAGE_ADDR & BME680_SPI_WR_MSK,
-					&reg, 1);
-				if (dev->com_rslt != 0)
-					rslt = BME680_E_COM_FAIL;
-			}
+/*!
+ * @brief This internal API returns the SPI memory page holding a register.
+ */
+static uint8_t mem_page_of(uint8_t reg_addr)
+{
+	return (reg_addr > 0x7f) ? BME680_MEM_PAGE1 : BME680_MEM_PAGE0;
+}
+
+/*!
+ * @brief This internal API writes the registers of one memory page.
+ */
+static int8_t set_page_regs(const uint8_t *reg_addr, const uint8_t *reg_data, uint8_t len, uint8_t mem_page,
+	struct bme680_dev *dev)
+{
+	int8_t rslt = BME680_OK;
+	/* Length of the temporary buffer is 2*(length of register)*/
+	uint8_t tmp_buff[BME680_TMP_BUFFER_LENGTH] = { 0 };
+	uint16_t count = 0;
+	uint16_t index;
+	uint8_t page_addr = 0;
+
+	/* Interleave the 2 arrays; BME680_MEM_PAGE_UNKNOWN takes every register (I2C) */
+	for (index = 0; index < len; index++) {
+		if (mem_page == BME680_MEM_PAGE_UNKNOWN) {
+			tmp_buff[(2 * count)] = reg_addr[index];
+		} else if (mem_page_of(reg_addr[index]) == mem_page) {
+			tmp_buff[(2 * count)] = reg_addr[index] & BME680_SPI_WR_MSK;
+		} else {
+			continue;
+		}
+		tmp_buff[(2 * count) + 1] = reg_data[index];
+		if (count == 0)
+			page_addr = reg_addr[index];
+		count++;
+	}
+
+	if (count > 0) {
+		if (mem_page != BME680_MEM_PAGE_UNKNOWN)
+			rslt = set_mem_page(page_addr, dev);
+		/* Write the interleaved array */
+		if (rslt == BME680_OK) {
+			dev->com_rslt = dev->write(dev->dev_id, tmp_buff[0], &tmp_buff[1], (2 * count) - 1);
+			if (dev->com_rslt != 0)
+				rslt = BME680_E_COM_FAIL;
 		}
 	}
 
@@ -1356,3 +1955,151 @@ static int8_t null_ptr_check(const struct bme680_dev *dev)
 
 	return rslt;
 }
+
+/*!
+ * @brief This internal API copies register values into the shadow.
+ */
+static void shadow_store(uint8_t reg_addr, const uint8_t *reg_data, uint16_t len, struct bme680_dev *dev)
+{
+	uint16_t index;
+	uint16_t pos;
+
+	for (index = 0; index < len; index++) {
+		pos = (uint16_t) reg_addr + index;
+		if ((pos >= BME680_SHADOW_START) && (pos < BME680_SHADOW_START + BME680_SHADOW_LEN)) {
+			pos -= BME680_SHADOW_START;
+			dev->shadow.reg[pos] = reg_data[index];
+			dev->shadow.valid |= (UINT32_C(1) << pos) & BME680_SHADOW_VALID_MSK;
+		}
+	}
+}
+
+/*!
+ * @brief This internal API returns the value of a shadowed register.
+ */
+static int8_t shadow_read(uint8_t reg_addr, uint8_t *reg_data, struct bme680_dev *dev)
+{
+	int8_t rslt = BME680_OK;
+	uint8_t pos;
+	uint8_t buff[BME680_REG_BUFFER_LENGTH];
+
+	/* Registers outside the window are not shadowed */
+	if ((reg_addr < BME680_SHADOW_START) || (reg_addr >= BME680_SHADOW_START + BME680_SHADOW_LEN))
+		return bme680_get_regs(reg_addr, reg_data, 1, dev);
+
+	pos = reg_addr - BME680_SHADOW_START;
+	if (!(dev->shadow.valid & (UINT32_C(1) << pos))) {
+		/* One burst refreshes every control register, 0x70 to 0x75 */
+		if (reg_addr >= BME680_CONF_HEAT_CTRL_ADDR)
+			rslt = bme680_get_regs(BME680_CONF_HEAT_CTRL_ADDR, buff, BME680_REG_BUFFER_LENGTH, dev);
+		else
+			rslt = bme680_get_regs(reg_addr, buff, 1, dev);
+	}
+
+	if (rslt == BME680_OK)
+		*reg_data = dev->shadow.reg[pos];
+
+	return rslt;
+}
+
+/*!
+ * @brief This internal API writes the registers that differ from the shadow.
+ */
+static int8_t shadow_write(const uint8_t *reg_addr, const uint8_t *reg_data, uint8_t len, struct bme680_dev *dev)
+{
+	int8_t rslt = BME680_OK;
+	uint8_t addr[BME680_TMP_BUFFER_LENGTH / 2];
+	uint8_t data[BME680_TMP_BUFFER_LENGTH / 2];
+	uint8_t count = 0;
+	uint8_t index;
+	uint8_t pos;
+
+	/* bme680_set_regs() takes at most this many registers per transaction */
+	if (len >= BME680_TMP_BUFFER_LENGTH / 2)
+		return BME680_E_INVALID_LENGTH;
+
+	for (index = 0; index < len; index++) {
+		/* Registers outside the window are always written */
+		if ((reg_addr[index] >= BME680_SHADOW_START)
+			&& (reg_addr[index] < BME680_SHADOW_START + BME680_SHADOW_LEN)) {
+			pos = reg_addr[index] - BME680_SHADOW_START;
+			if ((dev->shadow.valid & (UINT32_C(1) << pos)) && (dev->shadow.reg[pos] == reg_data[index]))
+				continue;
+		}
+		addr[count] = reg_addr[index];
+		data[count] = reg_data[index];
+		count++;
+	}
+
+	if (count > 0)
+		rslt = bme680_set_regs(addr, data, count, dev);
+
+	return rslt;
+}
+
+/*!
+ * @brief This internal API notes a forced mode trigger.
+ */
+static void stats_trigger(struct bme680_dev *dev)
+{
+	struct bme680_meas_stats *stats = &dev->stats;
+
+	if (stats->pending)
+		stats->unread++;
+
+	stats->pending = 1;
+	stats->retries = 0;
+	stats->t_trigger = (dev->get_tick != NULL) ? dev->get_tick() : 0;
+}
+
+/*!
+ * @brief This internal API accounts one decoded field burst.
+ */
+static void stats_readout(const struct bme680_field_data *data, struct bme680_dev *dev)
+{
+	struct bme680_meas_stats *stats = &dev->stats;
+	uint32_t age;
+	uint8_t step;
+	uint8_t bin;
+
+	if (!(data->status & BME680_NEW_DATA_MSK)) {
+		stats->stale++;
+		if (stats->pending && (stats->retries < UINT8_MAX))
+			stats->retries++;
+		return;
+	}
+
+	/* meas_index counts conversions modulo 256 */
+	if (stats->samples > 0) {
+		step = (uint8_t) (data->meas_index - stats->last_index);
+		if (step == 0) {
+			stats->repeats++;
+		} else if (step != 1) {
+			stats->gaps++;
+			stats->missed += step - 1;
+		}
+	}
+	stats->samples++;
+	stats->last_index = data->meas_index;
+
+	if (!stats->pending) {
+		stats->untriggered++;
+		return;
+	}
+
+	bin = (stats->retries < BME680_POLL_BINS - 1) ? stats->retries : BME680_POLL_BINS - 1;
+	stats->poll_hist[bin]++;
+
+	if (dev->get_tick != NULL) {
+		age = dev->get_tick() - stats->t_trigger;
+		for (bin = 0; (bin < BME680_LAT_BINS - 1) && (age >= (BME680_LAT_BIN0_MS << bin)); bin++)
+			;
+		stats->lat_hist[bin]++;
+		stats->lat_sum += age;
+		if (age > stats->lat_max)
+			stats->lat_max = age;
+	}
+
+	stats->pending = 0;
+	stats->retries = 0;
+}
@@ -0,0 +1,171 @@
+/**
+  ******************************************************************************
+  * @file           : calib_cache.c
+  * @brief          : Flash backed cache of the decoded BME680 calibration block
+  ******************************************************************************
+**/
+
+#include <stddef.h>
+#include <string.h>
+#include "main.h"
+#include "calib_cache.h"
+
+/* Record rounded up to whole flash words */
+#define CALIB_RECORD_WORDS	((sizeof(struct calib_record) + 3) / 4)
+
+/***********************************************************************
+ * @name calib_cache_crc32()
+ * @brief Bitwise CRC32 (IEEE 802.3, reflected); only runs once per boot
+ * @return CRC of buf
+ ***********************************************************************/
+uint32_t calib_cache_crc32(const uint8_t *buf, uint32_t len)
+{
+	uint32_t crc = 0xFFFFFFFFUL;
+	uint8_t bit;
+
+	while (len--)
+	{
+		crc ^= *buf++;
+		for (bit = 0; bit < 8; bit++)
+			crc = (crc >> 1) ^ (0xEDB88320UL & (0UL - (crc & 1UL)));
+	}
+
+	return ~crc;
+}
+
+/***********************************************************************
+ * @name calib_cache_fill()
+ * @brief Builds the flash image of the calibration held in dev. The
+ *        runtime t_fine and any padding are zeroed so the CRC is stable.
+ * @return void
+ ***********************************************************************/
+static void calib_cache_fill(struct calib_record *rec, const struct bme680_dev *dev, const uint8_t *ident)
+{
+	memset(rec, 0, sizeof(*rec));
+	rec->magic = CALIB_CACHE_MAGIC;
+	rec->version = CALIB_CACHE_VERSION;
+	rec->chip_id = dev->chip_id;
+	rec->dev_id = dev->dev_id;
+	memcpy(rec->ident, ident, sizeof(rec->ident));
+	rec->calib = dev->calib;
+	rec->calib.t_fine = 0;
+	rec->crc = calib_cache_crc32((const uint8_t *)rec, offsetof(struct calib_record, crc));
+}
+
+/***********************************************************************
+ * @name calib_cache_valid()
+ * @brief Checks magic, version, key, part identity and CRC of a stored
+ *        record; ident is coefficient block 2 as read from the sensor
+ * @return 1 if the record can be used for this sensor, 0 otherwise
+ ***********************************************************************/
+uint8_t calib_cache_valid(const struct calib_record *rec, uint8_t chip_id, uint8_t dev_id, const uint8_t *ident)
+{
+	if (rec->magic != CALIB_CACHE_MAGIC || rec->version != CALIB_CACHE_VERSION)
+		return 0;
+
+	if (rec->chip_id != chip_id || rec->dev_id != dev_id)
+		return 0;
+
+	if (memcmp(rec->ident, ident, sizeof(rec->ident)) != 0)
+		return 0;
+
+	return rec->crc == calib_cache_crc32((const uint8_t *)rec, offsetof(struct calib_record, crc));
+}
+
+/***********************************************************************
+ * @name calib_cache_save()
+ * @brief Erases sector 7 and programs the calibration held in dev,
+ *        under the identity block ident. The erase stalls the CPU, so
+ *        this only runs after a cache miss.
+ * @return 0 on success, -1 on flash error
+ ***********************************************************************/
+int8_t calib_cache_save(const struct bme680_dev *dev, const uint8_t *ident)
+{
+	uint32_t words[CALIB_RECORD_WORDS];
+	FLASH_EraseInitTypeDef erase = { 0 };
+	uint32_t sector_error = 0;
+	uint32_t i;
+	int8_t result = 0;
+
+	memset(words, 0, sizeof(words));
+	calib_cache_fill((struct calib_record *)words, dev, ident);
+
+	erase.TypeErase = FLASH_TYPEERASE_SECTORS;
+	erase.VoltageRange = FLASH_VOLTAGE_RANGE_3;
+	erase.Sector = FLASH_SECTOR_7;
+	erase.NbSectors = 1;
+
+	HAL_FLASH_Unlock();
+
+	if (HAL_FLASHEx_Erase(&erase, &sector_error) != HAL_OK)
+		result = -1;
+
+	for (i = 0; (result == 0) && (i < CALIB_RECORD_WORDS); i++)
+	{
+		if (HAL_FLASH_Program(FLASH_TYPEPROGRAM_WORD, CALIB_CACHE_ADDR + (4 * i), words[i]) != HAL_OK)
+			result = -1;
+	}
+
+	HAL_FLASH_Lock();
+
+	return result;
+}
+
+/***********************************************************************
+ * @name calib_cache_invalidate()
+ * @brief Clears the magic of the stored record so the next
+ *        calib_cache_init() reads the sensor. Programming only turns
+ *        bits to 0, so no erase is needed.
+ * @return 0 on success, -1 on flash error
+ ***********************************************************************/
+int8_t calib_cache_invalidate(void)
+{
+	int8_t result = 0;
+
+	HAL_FLASH_Unlock();
+	if (HAL_FLASH_Program(FLASH_TYPEPROGRAM_WORD, CALIB_CACHE_ADDR, 0) != HAL_OK)
+		result = -1;
+	HAL_FLASH_Lock();
+
+	return result;
+}
+
+/***********************************************************************
+ * @name calib_cache_init()
+ * @brief Probes the sensor and loads its calibration, from flash when a
+ *        valid record matches the part and from the sensor otherwise
+ * @return BME680_OK or the driver error code
+ ***********************************************************************/
+int8_t calib_cache_init(struct bme680_dev *dev, enum calib_cache_src *src)
+{
+	const struct calib_record *rec = CALIB_CACHE_RECORD;
+	uint8_t ident[BME680_COEFF_ADDR2_LEN];
+	int8_t rslt;
+
+	rslt = bme680_probe(dev);
+	if (rslt != BME680_OK)
+		return rslt;
+
+	/* One burst tells this part from the one the record was taken from */
+	rslt = bme680_get_regs(BME680_COEFF_ADDR2, ident, sizeof(ident), dev);
+	if (rslt != BME680_OK)
+		return rslt;
+
+	if (calib_cache_valid(rec, dev->chip_id, dev->dev_id, ident))
+	{
+		dev->calib = rec->calib;
+		bme680_build_comp_plan(dev);
+		if (src != NULL)
+			*src = CALIB_FROM_CACHE;
+		return BME680_OK;
+	}
+
+	rslt = bme680_read_calib(dev);
+	if (rslt == BME680_OK)
+	{
+		if (src != NULL)
+			*src = (calib_cache_save(dev, ident) == 0) ? CALIB_FROM_SENSOR : CALIB_FROM_SENSOR_NOSAVE;
+	}
+
+	return rslt;
+}
@@ -0,0 +1,112 @@
+/**
+  ******************************************************************************
+  * @file           : derived.c
+  * @brief          : Dew point, absolute humidity and barometric height
+  ******************************************************************************
+**/
+
+#include <math.h>
+#include "fixmath.h"
+#include "derived.h"
+
+/* Magnus coefficients: b = 17.62 in Q16, c = 243.12 degC in centi degC */
+#define MAGNUS_B_Q16		1154744
+#define MAGNUS_B_CENTI		1762
+#define MAGNUS_C			24312
+
+/* 0 degC in centi kelvin */
+#define ZERO_C_CENTI_K		27315
+
+/* 216.673 g K/m3 per hPa of vapour (1 / R_w) times Magnus' 6.112 hPa,
+ * scaled so that (es_q16 * rh_milli * AH_K) >> 32 is centi g/m3 times
+ * centi kelvin */
+#define AH_K				8678873
+
+/* Scale height per centi kelvin: R_d / g = 29.2712 m/K, in cm, Q12 */
+#define SCALE_HEIGHT_Q12	119895
+
+/***********************************************************************
+ * @name derived_magnus()
+ * @brief b t / (c + t) of the Magnus formula, t in centi degC
+ * @return Q16
+ ***********************************************************************/
+static int32_t derived_magnus(int32_t t)
+{
+	return ((t * FX_ONE) / (MAGNUS_C + t)) * MAGNUS_B_CENTI / 100;
+}
+
+/***********************************************************************
+ * @name derived_compute()
+ * @brief Derived metrics of a compensated sample in fixed point. p_ref
+ *        is the pressure, in Pa, of the level height is taken from.
+ * @return void
+ ***********************************************************************/
+void derived_compute(const struct bme680_field_data *data, uint32_t p_ref, struct derived_data *out)
+{
+	int32_t t = (int32_t)(data->temperature * (100 / BME680_TEMP_SCALE));
+	int32_t rh = (int32_t)(data->humidity * (1000 / BME680_HUM_SCALE));
+	uint32_t p = (uint32_t)(data->pressure / BME680_PRES_SCALE);
+	uint32_t tk = (uint32_t)(t + ZERO_C_CENTI_K);
+	uint32_t es, d, s, u, u2, f;
+	int32_t q, gamma, h;
+	uint64_t ln;
+
+	if (rh < 1)
+		rh = 1;
+	else if (rh > 100000)
+		rh = 100000;
+
+	/* Dew point: gamma = ln(rh) + q, td = c gamma / (b - gamma). gamma is
+	 * taken down to Q12 so the product fits 32 bits. */
+	q = derived_magnus(t);
+	gamma = (int32_t)(((int64_t)(fx_log2(rh) - fx_log2(100000)) * FX_LN2) >> 16) + q;
+	out->dew_point = MAGNUS_C * (gamma / 16) / ((MAGNUS_B_Q16 - gamma) / 16);
+	out->dew_spread = t - out->dew_point;
+
+	/* Saturation pressure over 6.112 hPa is exp(q), taken as 2^(q log2 e) */
+	es = fx_exp2((int32_t)(((int64_t)q * FX_LOG2E) >> 16) + (16 << 16));
+	out->abs_humidity = (uint32_t)((((uint64_t)es * (uint32_t)rh) * AH_K) >> 32) / tk;
+
+	/* ln(p_ref / p) = 2 u (1 + u^2/3 + u^4/5 + u^6/7 + u^8/9), Horner in
+	 * Q26. u is found by long division in two 13-bit steps so that every
+	 * dividend fits 32 bits. */
+	d = (p_ref > p) ? (p_ref - p) : (p - p_ref);
+	s = p_ref + p;
+	u = ((d << 13) / s) << 13;
+	u += (((d << 13) % s) << 13) / s;
+	u2 = (uint32_t)(((uint64_t)u * u) >> 26);
+	f = (1UL << 26) / 9;
+	f = (1UL << 26) / 7 + (uint32_t)(((uint64_t)u2 * f) >> 26);
+	f = (1UL << 26) / 5 + (uint32_t)(((uint64_t)u2 * f) >> 26);
+	f = (1UL << 26) / 3 + (uint32_t)(((uint64_t)u2 * f) >> 26);
+	f = (1UL << 26) + (uint32_t)(((uint64_t)u2 * f) >> 26);
+	ln = ((uint64_t)u * f) >> 25;
+	h = (int32_t)(((uint64_t)tk * SCALE_HEIGHT_Q12 * ln) >> 38);
+	out->height = (p < p_ref) ? h : -h;
+}
+
+/***********************************************************************
+ * @name derived_reference()
+ * @brief derived_compute() in float with libm, for the benchmarks
+ * @return void
+ ***********************************************************************/
+void derived_reference(const struct bme680_field_data *data, uint32_t p_ref, struct derived_data *out)
+{
+	float t = (float)data->temperature / BME680_TEMP_SCALE;
+	float rh = (float)data->humidity / BME680_HUM_SCALE;
+	float p = (float)data->pressure / BME680_PRES_SCALE;
+	float q, gamma, td;
+
+	if (rh < 0.001f)
+		rh = 0.001f;
+	else if (rh > 100.0f)
+		rh = 100.0f;
+
+	q = 17.62f * t / (243.12f + t);
+	gamma = logf(rh / 100.0f) + q;
+	td = 243.12f * gamma / (17.62f - gamma);
+	out->dew_point = lroundf(td * 100.0f);
+	out->dew_spread = lroundf((t - td) * 100.0f);
+	out->abs_humidity = lroundf(216.673f * 6.112f * (rh / 100.0f) * expf(q) / (t + 273.15f) * 100.0f);
+	out->height = lroundf(29.2712f * (t + 273.15f) * logf((float)p_ref / p) * 100.0f);
+}
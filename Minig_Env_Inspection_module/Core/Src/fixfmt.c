@@ -0,0 +1,270 @@
+/**
+  ******************************************************************************
+  * @file           : fixfmt.c
+  * @brief          : Integer-only formatting of scaled fixed-point values
+  ******************************************************************************
+**/
+
+#include "fixfmt.h"
+
+#define FMT_DECIMALS_MAX	9
+
+static const uint32_t pow10[FMT_DECIMALS_MAX + 1] = {
+	1UL, 10UL, 100UL, 1000UL, 10000UL, 100000UL, 1000000UL, 10000000UL, 100000000UL, 1000000000UL
+};
+
+/* Appends c while one byte is left for the terminator */
+static char *fmt_put(char *p, char *end, char c)
+{
+	if (end - p > 1)
+		*p++ = c;
+	return p;
+}
+
+static char *fmt_fill(char *p, char *end, char c, uint8_t count)
+{
+	while (count--)
+		p = fmt_put(p, end, c);
+	return p;
+}
+
+/***********************************************************************
+ * @name fmt_fixed()
+ * @brief Formats mag, negated when neg, as described in fixfmt.h
+ * @return new end of the output
+ ***********************************************************************/
+static char *fmt_fixed(char *p, char *end, uint32_t mag, uint8_t neg, uint8_t decimals, uint8_t prec,
+		uint8_t width, uint8_t flags)
+{
+	char digits[10];			/* least significant first */
+	uint8_t n = 0, frac, zeros = 0, int_len, len, pad, i;
+
+	if (decimals > FMT_DECIMALS_MAX)
+		decimals = FMT_DECIMALS_MAX;
+	if (prec > FMT_DECIMALS_MAX)
+		prec = FMT_DECIMALS_MAX;
+
+	if (prec < decimals)
+	{
+		uint32_t div = pow10[decimals - prec];
+		uint32_t rem = mag % div;
+
+		mag /= div;
+		if (rem >= div - rem)
+			mag++;
+		frac = prec;
+	}
+	else
+	{
+		zeros = prec - decimals;
+		frac = decimals;
+	}
+	if (mag == 0)
+		neg = 0;
+
+	do
+	{
+		digits[n++] = (char)('0' + mag % 10);
+		mag /= 10;
+	} while (mag != 0);
+
+	int_len = (n > frac) ? n - frac : 1;
+	len = neg + int_len + (prec ? 1 + prec : 0);
+	pad = (width > len) ? width - len : 0;
+
+	if (!(flags & (FMT_LEFT | FMT_ZERO)))
+		p = fmt_fill(p, end, ' ', pad);
+	if (neg)
+		p = fmt_put(p, end, '-');
+	if ((flags & FMT_ZERO) && !(flags & FMT_LEFT))
+		p = fmt_fill(p, end, '0', pad);
+
+	for (i = frac + int_len; i > frac; i--)
+		p = fmt_put(p, end, (i - 1 < n) ? digits[i - 1] : '0');
+	if (prec)
+	{
+		p = fmt_put(p, end, '.');
+		for (i = frac; i > 0; i--)
+			p = fmt_put(p, end, (i - 1 < n) ? digits[i - 1] : '0');
+		p = fmt_fill(p, end, '0', zeros);
+	}
+
+	if (flags & FMT_LEFT)
+		p = fmt_fill(p, end, ' ', pad);
+	if (p < end)
+		*p = '\0';
+
+	return p;
+}
+
+/***********************************************************************
+ * @name fmt_str()
+ * @brief Appends the string s
+ * @return new end of the output
+ ***********************************************************************/
+char *fmt_str(char *p, char *end, const char *s)
+{
+	while (*s != '\0')
+		p = fmt_put(p, end, *s++);
+	if (p < end)
+		*p = '\0';
+
+	return p;
+}
+
+/***********************************************************************
+ * @name fmt_udec()
+ * @brief Appends value, holding decimals decimals, with prec of them
+ *        in a field of width
+ * @return new end of the output
+ ***********************************************************************/
+char *fmt_udec(char *p, char *end, uint32_t value, uint8_t decimals, uint8_t prec, uint8_t width, uint8_t flags)
+{
+	return fmt_fixed(p, end, value, 0, decimals, prec, width, flags);
+}
+
+/***********************************************************************
+ * @name fmt_dec()
+ * @brief Signed fmt_udec()
+ * @return new end of the output
+ ***********************************************************************/
+char *fmt_dec(char *p, char *end, int32_t value, uint8_t decimals, uint8_t prec, uint8_t width, uint8_t flags)
+{
+	uint32_t mag = (value < 0) ? 0U - (uint32_t)value : (uint32_t)value;
+
+	return fmt_fixed(p, end, mag, value < 0, decimals, prec, width, flags);
+}
+
+/***********************************************************************
+ * @name fmt_hex()
+ * @brief Appends value in hex, upper case when upper, padded as
+ *        fmt_fixed() pads
+ * @return new end of the output
+ ***********************************************************************/
+static char *fmt_hex(char *p, char *end, uint32_t value, uint8_t upper, uint8_t width, uint8_t flags)
+{
+	const char *xdigits = upper ? "0123456789ABCDEF" : "0123456789abcdef";
+	char digits[8];				/* least significant first */
+	uint8_t n = 0, pad;
+
+	do
+	{
+		digits[n++] = xdigits[value & 0xf];
+		value >>= 4;
+	} while (value != 0);
+
+	pad = (width > n) ? width - n : 0;
+	if (!(flags & FMT_LEFT))
+		p = fmt_fill(p, end, (flags & FMT_ZERO) ? '0' : ' ', pad);
+	while (n > 0)
+		p = fmt_put(p, end, digits[--n]);
+	if (flags & FMT_LEFT)
+		p = fmt_fill(p, end, ' ', pad);
+	if (p < end)
+		*p = '\0';
+
+	return p;
+}
+
+/***********************************************************************
+ * @name fmt_vprintf()
+ * @brief Appends fmt with its arguments, as described in fixfmt.h
+ * @return new end of the output
+ ***********************************************************************/
+char *fmt_vprintf(char *p, char *end, const char *fmt, va_list args)
+{
+	const char *s;
+	uint8_t flags, width, is_long, pad;
+	char c;
+
+	if (p < end)
+		*p = '\0';
+	while ((c = *fmt++) != '\0')
+	{
+		if (c != '%')
+		{
+			p = fmt_put(p, end, c);
+			continue;
+		}
+
+		flags = 0;
+		for (;; fmt++)
+		{
+			if (*fmt == '-')
+				flags |= FMT_LEFT;
+			else if (*fmt == '0')
+				flags |= FMT_ZERO;
+			else
+				break;
+		}
+		width = 0;
+		while (*fmt >= '0' && *fmt <= '9')
+			width = (uint8_t)(width * 10 + (*fmt++ - '0'));
+		is_long = 0;
+		while (*fmt == 'l' || *fmt == 'h')
+			is_long |= (*fmt++ == 'l');
+
+		switch (c = *fmt++)
+		{
+		case 'd':
+		case 'i':
+			p = fmt_dec(p, end, is_long ? (int32_t)va_arg(args, long) : va_arg(args, int), 0, 0, width, flags);
+			break;
+		case 'u':
+			p = fmt_udec(p, end, is_long ? (uint32_t)va_arg(args, unsigned long) : va_arg(args, unsigned int),
+					0, 0, width, flags);
+			break;
+		case 'x':
+		case 'X':
+			p = fmt_hex(p, end, is_long ? (uint32_t)va_arg(args, unsigned long) : va_arg(args, unsigned int),
+					c == 'X', width, flags);
+			break;
+		case 'c':
+			p = fmt_put(p, end, (char)va_arg(args, int));
+			break;
+		case 's':
+			s = va_arg(args, const char *);
+			pad = 0;
+			while (s[pad] != '\0' && pad < width)
+				pad++;
+			pad = width - pad;
+			if (!(flags & FMT_LEFT))
+				p = fmt_fill(p, end, ' ', pad);
+			p = fmt_str(p, end, s);
+			if (flags & FMT_LEFT)
+				p = fmt_fill(p, end, ' ', pad);
+			break;
+		case '%':
+			p = fmt_put(p, end, '%');
+			break;
+		default:
+			/* Not handled: print the conversion as written */
+			p = fmt_put(p, end, '%');
+			if (c == '\0')
+				fmt--;
+			else
+				p = fmt_put(p, end, c);
+			break;
+		}
+	}
+	if (p < end)
+		*p = '\0';
+
+	return p;
+}
+
+/***********************************************************************
+ * @name fmt_printf()
+ * @brief fmt_vprintf() with its arguments inline
+ * @return new end of the output
+ ***********************************************************************/
+char *fmt_printf(char *p, char *end, const char *fmt, ...)
+{
+	va_list args;
+
+	va_start(args, fmt);
+	p = fmt_vprintf(p, end, fmt, args);
+	va_end(args);
+
+	return p;
+}
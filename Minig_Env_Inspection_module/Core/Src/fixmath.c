@@ -0,0 +1,61 @@
+/**
+  ******************************************************************************
+  * @file           : fixmath.c
+  * @brief          : Table-driven Q16 log2 and exp2
+  ******************************************************************************
+**/
+
+#include "fixmath.h"
+
+/* log2(1 + i/16) and 2^(i/16), Q16, for linear interpolation */
+static const uint32_t fx_log2_tab[17] = {
+	0, 5732, 11136, 16248, 21098, 25711, 30109, 34312, 38336,
+	42196, 45904, 49472, 52911, 56229, 59434, 62534, 65536
+};
+
+static const uint32_t fx_exp2_tab[17] = {
+	65536, 68438, 71468, 74632, 77936, 81386, 84990, 88752, 92682,
+	96785, 101070, 105545, 110218, 115098, 120194, 125515, 131072
+};
+
+/***********************************************************************
+ * @name fx_log2()
+ * @brief log2 of x in Q16. The leading one gives the integer part, the
+ *        next 4 bits pick a table interval and the 16 bits after them
+ *        interpolate inside it.
+ * @return log2(x) in Q16, 0 for x of 0 or 1
+ ***********************************************************************/
+int32_t fx_log2(uint32_t x)
+{
+	uint32_t n, m, i, f;
+
+	if (x == 0)
+		return 0;
+
+	n = 31 - __builtin_clz(x);
+	m = x << (31 - n);
+	i = (m >> 27) & 0xF;
+	f = (m >> 11) & 0xFFFF;
+
+	return (int32_t)((n << 16) + fx_log2_tab[i] + (((fx_log2_tab[i + 1] - fx_log2_tab[i]) * f) >> 16));
+}
+
+/***********************************************************************
+ * @name fx_exp2()
+ * @brief 2^y for y in Q16. For a Q16 result, pass y + (16 << 16).
+ * @return 2^y rounded down, 0 for y below 0, UINT32_MAX from 32 on
+ ***********************************************************************/
+uint32_t fx_exp2(int32_t y)
+{
+	uint32_t n, i, f, m;
+
+	if (y < 0)
+		return 0;
+
+	n = (uint32_t)y >> 16;
+	i = ((uint32_t)y >> 12) & 0xF;
+	f = ((uint32_t)y & 0xFFF) << 4;
+	m = fx_exp2_tab[i] + (((fx_exp2_tab[i + 1] - fx_exp2_tab[i]) * f) >> 16);
+
+	return (n > 31) ? UINT32_MAX : (uint32_t)(((uint64_t)m << n) >> 16);
+}
@@ -0,0 +1,96 @@
+/**
+  ******************************************************************************
+  * @file           : frame_log.c
+  * @brief          : Raw BME680 field-frame capture format and recorder
+  ******************************************************************************
+**/
+
+#include <string.h>
+#include "frame_log.h"
+
+/***********************************************************************
+ * @name frame_log_begin()
+ * @brief Starts a capture of dev and writes its header
+ * @return void
+ ***********************************************************************/
+void frame_log_begin(struct frame_log *log, const struct bme680_dev *dev, frame_log_write_fptr_t write, void *ctx)
+{
+	struct frame_log_header hdr;
+
+	log->write = write;
+	log->ctx = ctx;
+	log->seq = 0;
+	log->frames = 0;
+
+	memset(&hdr, 0, sizeof(hdr));
+	hdr.magic = FRAME_LOG_MAGIC;
+	hdr.version = FRAME_LOG_VERSION;
+	hdr.frame_size = sizeof(struct frame_log_frame);
+	hdr.calib_size = sizeof(struct bme680_calib_data);
+	hdr.chip_id = dev->chip_id;
+	hdr.dev_id = dev->dev_id;
+	hdr.calib = dev->calib;
+	hdr.calib.t_fine = 0;
+
+	log->write(&hdr, sizeof(hdr), log->ctx);
+}
+
+/***********************************************************************
+ * @name frame_log_add()
+ * @brief Appends one raw field burst
+ * @return void
+ ***********************************************************************/
+void frame_log_add(struct frame_log *log, uint32_t t_ms, const uint8_t *field)
+{
+	struct frame_log_frame frame;
+
+	if (log->write == NULL)
+		return;
+
+	frame.t_ms = t_ms;
+	frame.seq = log->seq++;
+	memcpy(frame.field, field, BME680_FIELD_LENGTH);
+	log->frames++;
+
+	log->write(&frame, sizeof(frame), log->ctx);
+}
+
+/***********************************************************************
+ * @name frame_log_open()
+ * @brief Validates a capture held in memory and sets up a view on it.
+ *        buf must be 4-byte aligned; a trailing partial frame is ignored.
+ * @return BME680_OK, BME680_E_NULL_PTR or BME680_E_INVALID_LENGTH when
+ *         the header does not match this build
+ ***********************************************************************/
+int8_t frame_log_open(struct frame_log_view *view, const void *buf, uint32_t len)
+{
+	const struct frame_log_header *hdr = buf;
+
+	if (view == NULL || buf == NULL)
+		return BME680_E_NULL_PTR;
+
+	if (len < sizeof(*hdr) || hdr->magic != FRAME_LOG_MAGIC || hdr->version != FRAME_LOG_VERSION
+			|| hdr->frame_size != sizeof(struct frame_log_frame)
+			|| hdr->calib_size != sizeof(struct bme680_calib_data))
+		return BME680_E_INVALID_LENGTH;
+
+	view->hdr = hdr;
+	view->frame = (const struct frame_log_frame *)(hdr + 1);
+	view->count = (len - sizeof(*hdr)) / sizeof(struct frame_log_frame);
+
+	return BME680_OK;
+}
+
+/***********************************************************************
+ * @name frame_log_load()
+ * @brief Loads the recorded calibration into dev and rebuilds its
+ *        compensation plan, ready for bme680_compensate_field()
+ * @return void
+ ***********************************************************************/
+void frame_log_load(const struct frame_log_view *view, struct bme680_dev *dev)
+{
+	dev->chip_id = view->hdr->chip_id;
+	dev->dev_id = view->hdr->dev_id;
+	dev->calib = view->hdr->calib;
+	bme680_build_comp_plan(dev);
+}
@@ -0,0 +1,293 @@
+/**
+  ******************************************************************************
+  * @file           : i2c_ll.c
+  * @brief          : Interrupt-driven register-level I2C master for short transfers
+  ******************************************************************************
+**/
+
+#include "main.h"
+#include "stm32f4xx_ll_i2c.h"
+#include "cyccnt.h"
+#include "i2c_ll.h"
+
+/* Where a job is; each event interrupt moves it on by at most one phase */
+enum i2c_ll_phase {
+	I2C_LL_IDLE,
+	I2C_LL_START,				/* START requested, write address goes out on SB */
+	I2C_LL_ADDR_W,				/* write address sent, waiting for ADDR */
+	I2C_LL_TX,					/* write: register address and data */
+	I2C_LL_REG,					/* read: register address on the wire, waiting for BTF */
+	I2C_LL_RESTART,				/* read: repeated START requested, read address goes out on SB */
+	I2C_LL_ADDR_R,				/* read address sent, waiting for ADDR */
+	I2C_LL_RX					/* read: data */
+};
+
+/* One job per bus */
+struct i2c_ll_job {
+	volatile uint8_t phase;
+	uint8_t addr;				/* 7-bit slave address */
+	uint8_t reg_addr;
+	uint8_t read;
+	uint16_t len;
+	uint16_t idx;				/* data bytes sent or received */
+	uint8_t *data;
+};
+
+struct i2c_ll_stats i2c_ll_stats;
+
+/* Same bus order as i2c_transport */
+static I2C_TypeDef *const i2c_ll_inst[] = { I2C1, I2C2 };
+
+static struct i2c_ll_job jobs[sizeof(i2c_ll_inst) / sizeof(i2c_ll_inst[0])];
+
+/***********************************************************************
+ * @name i2c_ll_finish()
+ * @brief Masks the bus interrupts, frees the job and reports status
+ * @return void
+ ***********************************************************************/
+static void i2c_ll_finish(uint8_t bus, uint8_t status, uint32_t t0)
+{
+	I2C_TypeDef *I2Cx = i2c_ll_inst[bus];
+
+	LL_I2C_DisableIT_EVT(I2Cx);
+	LL_I2C_DisableIT_BUF(I2Cx);
+	LL_I2C_DisableIT_ERR(I2Cx);
+	LL_I2C_DisableBitPOS(I2Cx);
+	jobs[bus].phase = I2C_LL_IDLE;
+	i2c_ll_stats.cycles += cyccnt_read() - t0;
+
+	i2c_ll_done_callback(bus, status);
+}
+
+/***********************************************************************
+ * @name i2c_ll_start()
+ * @brief Starts a register write of len bytes, or a register read of
+ *        len bytes, on an idle bus. The job runs from the interrupts
+ *        and ends with i2c_ll_done_callback().
+ * @return 0 if started, -1 for a read of nothing
+ ***********************************************************************/
+int8_t i2c_ll_start(uint8_t bus, uint8_t addr, uint8_t reg_addr, uint8_t *data, uint16_t len, uint8_t read)
+{
+	I2C_TypeDef *I2Cx = i2c_ll_inst[bus];
+	struct i2c_ll_job *job = &jobs[bus];
+	uint32_t t0 = cyccnt_read();
+
+	if (read && (len == 0))
+		return -1;
+
+	job->addr = addr;
+	job->reg_addr = reg_addr;
+	job->read = read;
+	job->len = len;
+	job->idx = 0;
+	job->data = data;
+	job->phase = I2C_LL_START;
+
+	if (!LL_I2C_IsEnabled(I2Cx))
+		LL_I2C_Enable(I2Cx);
+	LL_I2C_DisableBitPOS(I2Cx);
+	LL_I2C_AcknowledgeNextData(I2Cx, LL_I2C_ACK);
+	LL_I2C_EnableIT_EVT(I2Cx);
+	LL_I2C_EnableIT_ERR(I2Cx);
+
+	/* Booked before the START, the interrupts book their own cycles */
+	i2c_ll_stats.jobs++;
+	i2c_ll_stats.cycles += cyccnt_read() - t0;
+	LL_I2C_GenerateStartCondition(I2Cx);
+
+	return 0;
+}
+
+/***********************************************************************
+ * @name i2c_ll_abort()
+ * @brief Drops the job of a bus about to be recovered, without a report
+ * @return void
+ ***********************************************************************/
+void i2c_ll_abort(uint8_t bus)
+{
+	I2C_TypeDef *I2Cx = i2c_ll_inst[bus];
+
+	LL_I2C_DisableIT_EVT(I2Cx);
+	LL_I2C_DisableIT_BUF(I2Cx);
+	LL_I2C_DisableIT_ERR(I2Cx);
+	LL_I2C_DisableBitPOS(I2Cx);
+	jobs[bus].phase = I2C_LL_IDLE;
+}
+
+/***********************************************************************
+ * @name i2c_ll_ev_irq()
+ * @brief Event interrupt of a bus. Flags are tested in SR1 before
+ *        the DR access or SR2 read that clears them, as the clearing
+ *        sequences require.
+ * @return 1 if a job owned the interrupt, 0 to hand it to the HAL
+ ***********************************************************************/
+uint8_t i2c_ll_ev_irq(uint8_t bus)
+{
+	struct i2c_ll_job *job = &jobs[bus];
+	I2C_TypeDef *I2Cx = i2c_ll_inst[bus];
+	uint32_t t0;
+	uint16_t remaining;
+
+	if (job->phase == I2C_LL_IDLE)
+		return 0;
+
+	t0 = cyccnt_read();
+	i2c_ll_stats.irqs++;
+
+	switch (job->phase)
+	{
+	case I2C_LL_START:
+	case I2C_LL_RESTART:
+		/* Until the repeated START is out, the BTF of the register byte
+		 * keeps raising the interrupt; only SB moves on */
+		if (!LL_I2C_IsActiveFlag_SB(I2Cx))
+			break;
+		if (job->phase == I2C_LL_START)
+		{
+			LL_I2C_TransmitData8(I2Cx, job->addr << 1);
+			job->phase = I2C_LL_ADDR_W;
+		}
+		else
+		{
+			LL_I2C_TransmitData8(I2Cx, (job->addr << 1) | 1);
+			job->phase = I2C_LL_ADDR_R;
+		}
+		break;
+
+	case I2C_LL_ADDR_W:
+		if (!LL_I2C_IsActiveFlag_ADDR(I2Cx))
+			break;
+		LL_I2C_ClearFlag_ADDR(I2Cx);
+		LL_I2C_TransmitData8(I2Cx, job->reg_addr);
+		if (job->read)
+		{
+			job->phase = I2C_LL_REG;
+		}
+		else
+		{
+			job->phase = I2C_LL_TX;
+			if (job->len != 0)
+				LL_I2C_EnableIT_BUF(I2Cx);
+		}
+		break;
+
+	case I2C_LL_TX:
+		if (job->idx < job->len)
+		{
+			/* TXE: next byte, then only BTF is wanted */
+			if (!LL_I2C_IsActiveFlag_TXE(I2Cx))
+				break;
+			LL_I2C_TransmitData8(I2Cx, job->data[job->idx++]);
+			if (job->idx == job->len)
+				LL_I2C_DisableIT_BUF(I2Cx);
+			break;
+		}
+		if (!LL_I2C_IsActiveFlag_BTF(I2Cx))
+			break;
+		LL_I2C_GenerateStopCondition(I2Cx);
+		i2c_ll_finish(bus, I2C_LL_OK, t0);
+		return 1;
+
+	case I2C_LL_REG:
+		if (!LL_I2C_IsActiveFlag_BTF(I2Cx))
+			break;
+		LL_I2C_GenerateStartCondition(I2Cx);
+		job->phase = I2C_LL_RESTART;
+		break;
+
+	case I2C_LL_ADDR_R:
+		if (!LL_I2C_IsActiveFlag_ADDR(I2Cx))
+			break;
+		if (job->len == 1)
+		{
+			/* NACK and STOP go with the only byte */
+			LL_I2C_AcknowledgeNextData(I2Cx, LL_I2C_NACK);
+			LL_I2C_ClearFlag_ADDR(I2Cx);
+			LL_I2C_GenerateStopCondition(I2Cx);
+			LL_I2C_EnableIT_BUF(I2Cx);
+		}
+		else if (job->len == 2)
+		{
+			/* POS: the NACK applies to the second byte */
+			LL_I2C_AcknowledgeNextData(I2Cx, LL_I2C_NACK);
+			LL_I2C_EnableBitPOS(I2Cx);
+			LL_I2C_ClearFlag_ADDR(I2Cx);
+		}
+		else
+		{
+			LL_I2C_ClearFlag_ADDR(I2Cx);
+		}
+		job->phase = I2C_LL_RX;
+		break;
+
+	case I2C_LL_RX:
+		if (job->len == 1)
+		{
+			if (!LL_I2C_IsActiveFlag_RXNE(I2Cx))
+				break;
+			job->data[0] = LL_I2C_ReceiveData8(I2Cx);
+			i2c_ll_finish(bus, I2C_LL_OK, t0);
+			return 1;
+		}
+
+		/* BTF: one byte in DR, the next in the shift register, SCL held */
+		if (!LL_I2C_IsActiveFlag_BTF(I2Cx))
+			break;
+		remaining = job->len - job->idx;
+		if (remaining == 2)
+		{
+			LL_I2C_GenerateStopCondition(I2Cx);
+			job->data[job->idx++] = LL_I2C_ReceiveData8(I2Cx);
+			job->data[job->idx++] = LL_I2C_ReceiveData8(I2Cx);
+			i2c_ll_finish(bus, I2C_LL_OK, t0);
+			return 1;
+		}
+		/* NACK the last byte before reading the third last */
+		if (remaining == 3)
+			LL_I2C_AcknowledgeNextData(I2Cx, LL_I2C_NACK);
+		job->data[job->idx++] = LL_I2C_ReceiveData8(I2Cx);
+		break;
+
+	default:
+		break;
+	}
+
+	i2c_ll_stats.cycles += cyccnt_read() - t0;
+	return 1;
+}
+
+/***********************************************************************
+ * @name i2c_ll_er_irq()
+ * @brief Error interrupt of a bus: a NACK ends the job with a STOP,
+ *        anything else leaves the bus to i2c_transport's recovery
+ * @return 1 if a job owned the interrupt, 0 to hand it to the HAL
+ ***********************************************************************/
+uint8_t i2c_ll_er_irq(uint8_t bus)
+{
+	I2C_TypeDef *I2Cx = i2c_ll_inst[bus];
+	uint32_t t0;
+	uint8_t status;
+
+	if (jobs[bus].phase == I2C_LL_IDLE)
+		return 0;
+
+	t0 = cyccnt_read();
+	i2c_ll_stats.irqs++;
+
+	if (LL_I2C_IsActiveFlag_AF(I2Cx))
+	{
+		LL_I2C_ClearFlag_AF(I2Cx);
+		LL_I2C_GenerateStopCondition(I2Cx);
+		status = I2C_LL_NACK;
+	}
+	else
+	{
+		LL_I2C_ClearFlag_BERR(I2Cx);
+		LL_I2C_ClearFlag_ARLO(I2Cx);
+		LL_I2C_ClearFlag_OVR(I2Cx);
+		status = I2C_LL_ERROR;
+	}
+
+	i2c_ll_finish(bus, status, t0);
+	return 1;
+}
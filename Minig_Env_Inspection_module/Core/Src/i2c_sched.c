@@ -0,0 +1,296 @@
+/**
+  ******************************************************************************
+  * @file           : i2c_sched.c
+  * @brief          : Prioritised transaction queues in front of i2c_transport
+  ******************************************************************************
+**/
+
+#include "main.h"
+#include "cyccnt.h"
+#include "i2c_sched.h"
+
+#define I2C_CYCLES_PER_US	(SystemCoreClock / 1000000U)
+
+/* FIFO of one class on one bus */
+struct i2c_queue {
+	struct i2c_txn txn[I2C_SCHED_DEPTH];
+	uint8_t head;
+	volatile uint8_t count;
+};
+
+struct i2c_sched_bus {
+	struct i2c_queue queue[I2C_CLASSES];
+	struct i2c_txn active;		/* transaction on the wire */
+	volatile uint8_t running;
+	uint8_t active_cls;
+	uint8_t dispatching;
+};
+
+/* Completion of a synchronous call */
+struct i2c_sync {
+	volatile uint8_t done;
+	volatile int8_t rslt;
+};
+
+struct i2c_class_stats i2c_sched_stats[I2C_CLASSES];
+
+static struct i2c_sched_bus sched[I2C_TRANSPORT_BUSES];
+
+/***********************************************************************
+ * @name i2c_sched_of()
+ * @brief Maps a dev_id to its bus queues; I2C_BUS2_FLAG selects hi2c2
+ * @return bus queues
+ ***********************************************************************/
+static struct i2c_sched_bus *i2c_sched_of(uint8_t dev_id)
+{
+	return &sched[(dev_id & I2C_BUS2_FLAG) ? 1 : 0];
+}
+
+/***********************************************************************
+ * @name i2c_sched_account()
+ * @brief Books the queueing latency of a transaction being started
+ * @return void
+ ***********************************************************************/
+static void i2c_sched_account(uint8_t cls, uint32_t t_queued)
+{
+	struct i2c_class_stats *st = &i2c_sched_stats[cls];
+	uint32_t us = (cyccnt_read() - t_queued) / I2C_CYCLES_PER_US;
+	uint8_t bin = 0;
+
+	st->started++;
+	while ((bin < I2C_LAT_BINS - 1) && (us >= ((uint32_t)I2C_LAT_BIN0_US << bin)))
+		bin++;
+	st->lat_hist[bin]++;
+	st->lat_sum += us;
+	if (us > st->lat_max)
+		st->lat_max = us;
+}
+
+/***********************************************************************
+ * @name i2c_sched_pop()
+ * @brief Takes the oldest transaction of the most urgent non-empty
+ *        class; call with interrupts masked
+ * @return 1 if txn and cls were filled, 0 if every queue is empty
+ ***********************************************************************/
+static uint8_t i2c_sched_pop(struct i2c_sched_bus *sb, struct i2c_txn *txn, uint8_t *cls)
+{
+	struct i2c_queue *q;
+	uint8_t c;
+
+	for (c = 0; c < I2C_CLASSES; c++)
+	{
+		q = &sb->queue[c];
+		if (q->count == 0)
+			continue;
+
+		*txn = q->txn[q->head];
+		q->head = (q->head + 1) % I2C_SCHED_DEPTH;
+		q->count--;
+		*cls = c;
+		return 1;
+	}
+
+	return 0;
+}
+
+/***********************************************************************
+ * @name i2c_sched_done()
+ * @brief Transport completion of the active transaction; runs in
+ *        interrupt context for DMA transfers
+ * @return void
+ ***********************************************************************/
+static void i2c_sched_done(int8_t rslt, void *ctx)
+{
+	struct i2c_sched_bus *sb = ctx;
+	bme680_com_cplt_fptr_t cplt = sb->active.cplt;
+	void *user = sb->active.ctx;
+
+	sb->running = 0;
+	if (cplt != NULL)
+		cplt(rslt, user);
+}
+
+/***********************************************************************
+ * @name i2c_sched_dispatch()
+ * @brief Starts queued transactions while the bus is idle. One that
+ *        fails to start completes in place, so this loops until a
+ *        transfer is in flight or the queues are empty. Thread context
+ *        only.
+ * @return void
+ ***********************************************************************/
+static void i2c_sched_dispatch(struct i2c_sched_bus *sb)
+{
+	uint8_t bus_flag = (sb == &sched[1]) ? I2C_BUS2_FLAG : 0;
+	uint8_t found;
+
+	if (sb->dispatching)
+		return;
+	sb->dispatching = 1;
+
+	while (!sb->running && !i2c_transport_busy(bus_flag))
+	{
+		__disable_irq();
+		found = i2c_sched_pop(sb, &sb->active, &sb->active_cls);
+		if (found)
+			sb->running = 1;
+		__enable_irq();
+		if (!found)
+			break;
+
+		i2c_sched_account(sb->active_cls, sb->active.t_queued);
+		if (i2c_transport_start(sb->active.dev_id, sb->active.reg_addr, sb->active.data, sb->active.len,
+				sb->active.write, i2c_sched_done, sb) != 0)
+			i2c_sched_done(-1, sb);
+	}
+
+	sb->dispatching = 0;
+}
+
+/***********************************************************************
+ * @name i2c_sched_submit()
+ * @brief Queues a transaction in class cls; from thread context an idle
+ *        bus starts it at once. Safe from interrupt context, where it is
+ *        left for i2c_sched_service().
+ * @return 0 if queued, -1 if the class queue is full
+ ***********************************************************************/
+int8_t i2c_sched_submit(uint8_t cls, uint8_t dev_id, uint8_t reg_addr, uint8_t *data, uint16_t len, uint8_t write,
+		bme680_com_cplt_fptr_t cplt, void *ctx)
+{
+	struct i2c_sched_bus *sb = i2c_sched_of(dev_id);
+	struct i2c_queue *q;
+	struct i2c_txn *txn;
+	uint32_t primask;
+
+	if (cls >= I2C_CLASSES)
+		return -1;
+
+	primask = __get_PRIMASK();
+	__disable_irq();
+	q = &sb->queue[cls];
+	if (q->count == I2C_SCHED_DEPTH)
+	{
+		i2c_sched_stats[cls].rejected++;
+		__set_PRIMASK(primask);
+		return -1;
+	}
+
+	txn = &q->txn[(q->head + q->count) % I2C_SCHED_DEPTH];
+	txn->dev_id = dev_id;
+	txn->reg_addr = reg_addr;
+	txn->write = write;
+	txn->len = len;
+	txn->data = data;
+	txn->cplt = cplt;
+	txn->ctx = ctx;
+	txn->t_queued = cyccnt_read();
+	q->count++;
+	if (q->count > i2c_sched_stats[cls].depth_max)
+		i2c_sched_stats[cls].depth_max = q->count;
+	__set_PRIMASK(primask);
+
+	if (__get_IPSR() == 0)
+		i2c_sched_dispatch(sb);
+
+	return 0;
+}
+
+/***********************************************************************
+ * @name i2c_sched_service()
+ * @brief Runs the transport deadlines and starts whatever is queued on
+ *        idle buses. Call from the main loop.
+ * @return void
+ ***********************************************************************/
+void i2c_sched_service(void)
+{
+	uint8_t i;
+
+	i2c_transport_service();
+	for (i = 0; i < I2C_TRANSPORT_BUSES; i++)
+		i2c_sched_dispatch(&sched[i]);
+}
+
+/***********************************************************************
+ * @name i2c_sched_busy()
+ * @brief sensor_array bus_busy hook: reports sensor traffic queued or on
+ *        the wire on dev_id's bus. Display traffic never defers a sensor.
+ * @return 1 if busy, 0 if not
+ ***********************************************************************/
+uint8_t i2c_sched_busy(uint8_t dev_id)
+{
+	struct i2c_sched_bus *sb = i2c_sched_of(dev_id);
+
+	return (sb->running && (sb->active_cls == I2C_CLASS_SENSOR)) || (sb->queue[I2C_CLASS_SENSOR].count != 0);
+}
+
+/***********************************************************************
+ * @name i2c_sched_sync_cplt()
+ * @brief Completion of a synchronous call
+ * @return void
+ ***********************************************************************/
+static void i2c_sched_sync_cplt(int8_t rslt, void *ctx)
+{
+	struct i2c_sync *sync = ctx;
+
+	sync->rslt = rslt;
+	sync->done = 1;
+}
+
+/***********************************************************************
+ * @name i2c_sched_sync()
+ * @brief Queues a sensor transaction and sleeps until it completes,
+ *        servicing the buses meanwhile. Interrupts are masked around the
+ *        flag test so a completion that lands just before WFI still
+ *        wakes the core.
+ * @return 0 on success, -1 on error
+ ***********************************************************************/
+static int8_t i2c_sched_sync(uint8_t dev_id, uint8_t reg_addr, uint8_t *reg_data, uint16_t len, uint8_t write)
+{
+	struct i2c_sync sync = { 0, -1 };
+
+	if (i2c_sched_submit(I2C_CLASS_SENSOR, dev_id, reg_addr, reg_data, len, write, i2c_sched_sync_cplt,
+			&sync) != 0)
+		return -1;
+
+	while (!sync.done)
+	{
+		i2c_sched_service();
+		__disable_irq();
+		if (!sync.done)
+			__WFI();
+		__enable_irq();
+	}
+
+	return sync.rslt;
+}
+
+/***********************************************************************
+ * @name i2c_sched_read()
+ * @brief Synchronous bme680_dev read hook, queued as I2C_CLASS_SENSOR
+ * @return 0 on success, -1 on error
+ ***********************************************************************/
+int8_t i2c_sched_read(uint8_t dev_id, uint8_t reg_addr, uint8_t *reg_data, uint16_t len)
+{
+	return i2c_sched_sync(dev_id, reg_addr, reg_data, len, 0);
+}
+
+/***********************************************************************
+ * @name i2c_sched_write()
+ * @brief Synchronous bme680_dev write hook, queued as I2C_CLASS_SENSOR
+ * @return 0 on success, -1 on error
+ ***********************************************************************/
+int8_t i2c_sched_write(uint8_t dev_id, uint8_t reg_addr, uint8_t *reg_data, uint16_t len)
+{
+	return i2c_sched_sync(dev_id, reg_addr, reg_data, len, 1);
+}
+
+/***********************************************************************
+ * @name i2c_sched_read_async()
+ * @brief Asynchronous bme680_dev read hook, queued as I2C_CLASS_SENSOR;
+ *        cplt runs once the read has been through the queue
+ * @return 0 if queued, -1 if the queue is full
+ ***********************************************************************/
+int8_t i2c_sched_read_async(uint8_t dev_id, uint8_t reg_addr, uint8_t *reg_data, uint16_t len,
+		bme680_com_cplt_fptr_t cplt, void *ctx)
+{
+	return i2c_sched_submit(I2C_CLASS_SENSOR, dev_id, reg_addr, reg_data, len, 0, cplt, ctx);
+}
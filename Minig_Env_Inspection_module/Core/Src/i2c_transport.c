@@ -0,0 +1,591 @@
+/**
+  ******************************************************************************
+  * @file           : i2c_transport.c
+  * @brief          : DMA backed register transport for BME680s on hi2c1/hi2c2
+  ******************************************************************************
+**/
+
+#include "main.h"
+#include "cyccnt.h"
+#include "i2c_transport.h"
+#include "i2c_ll.h"
+
+/* Longest a STOP may take to clear BUSY before the bus counts as stuck */
+#define I2C_BUSY_WAIT_US	100
+
+#define I2C_CYCLES_PER_US	(SystemCoreClock / 1000000U)
+
+/* How a transaction ended */
+enum i2c_outcome {
+	I2C_XFER_OK,
+	I2C_XFER_NACK,
+	I2C_XFER_ERROR,
+	I2C_XFER_TIMEOUT
+};
+
+extern I2C_HandleTypeDef hi2c1;
+extern I2C_HandleTypeDef hi2c2;
+
+struct i2c_xfer_stats i2c_stats;
+struct i2c_dev_stats i2c_dev_stats[I2C_TRANSPORT_DEVS];
+
+/* State of the single transfer that may be in flight on each bus */
+struct i2c_bus {
+	I2C_HandleTypeDef *hi2c;
+	GPIO_TypeDef *scl_port;		/* pins driven by hand during a recovery */
+	uint16_t scl_pin;
+	GPIO_TypeDef *sda_port;
+	uint16_t sda_pin;
+	volatile uint8_t busy;
+	volatile int8_t rslt;
+	volatile uint8_t recover;	/* bus error seen, recover before the next transfer */
+	uint8_t dev_id;				/* owner of the transfer in flight */
+	uint32_t t_start;			/* its start, in cycles */
+	uint32_t deadline;			/* tick by which it must have completed */
+	bme680_com_cplt_fptr_t cplt;
+	void *ctx;
+};
+
+/* Pins as in HAL_I2C_MspInit() */
+static struct i2c_bus buses[I2C_TRANSPORT_BUSES] = {
+	{ .hi2c = &hi2c1, .scl_port = GPIOB, .scl_pin = GPIO_PIN_6, .sda_port = GPIOB, .sda_pin = GPIO_PIN_7 },
+	{ .hi2c = &hi2c2, .scl_port = GPIOB, .scl_pin = GPIO_PIN_10, .sda_port = GPIOB, .sda_pin = GPIO_PIN_3 }
+};
+
+/***********************************************************************
+ * @name i2c_bus_of()
+ * @brief Maps a dev_id to its bus; I2C_BUS2_FLAG selects hi2c2
+ * @return bus state
+ ***********************************************************************/
+static struct i2c_bus *i2c_bus_of(uint8_t dev_id)
+{
+	return &buses[(dev_id & I2C_BUS2_FLAG) ? 1 : 0];
+}
+
+/***********************************************************************
+ * @name i2c_bus_from_handle()
+ * @brief Maps a HAL handle back to its bus
+ * @return bus state, or NULL for a handle this module does not own
+ ***********************************************************************/
+static struct i2c_bus *i2c_bus_from_handle(I2C_HandleTypeDef *hi2c)
+{
+	uint8_t i;
+
+	for (i = 0; i < I2C_TRANSPORT_BUSES; i++)
+	{
+		if (buses[i].hi2c->Instance == hi2c->Instance)
+			return &buses[i];
+	}
+
+	return NULL;
+}
+
+/***********************************************************************
+ * @name i2c_dev_of()
+ * @brief Finds or allocates the statistics slot of dev_id; once the
+ *        table is full, further devices share the last slot
+ * @return statistics slot
+ ***********************************************************************/
+static struct i2c_dev_stats *i2c_dev_of(uint8_t dev_id)
+{
+	uint8_t i;
+
+	for (i = 0; i < I2C_TRANSPORT_DEVS - 1; i++)
+	{
+		if (!i2c_dev_stats[i].used)
+		{
+			i2c_dev_stats[i].used = 1;
+			i2c_dev_stats[i].dev_id = dev_id;
+		}
+		if (i2c_dev_stats[i].dev_id == dev_id)
+			return &i2c_dev_stats[i];
+	}
+
+	i2c_dev_stats[i].used = 1;
+	i2c_dev_stats[i].dev_id = dev_id;
+	return &i2c_dev_stats[i];
+}
+
+/***********************************************************************
+ * @name i2c_account()
+ * @brief Books a finished transaction: outcome counters and the latency
+ *        from t_start to now into dev_id's histogram
+ * @return void
+ ***********************************************************************/
+static void i2c_account(uint8_t dev_id, uint32_t t_start, uint8_t outcome)
+{
+	struct i2c_dev_stats *dev = i2c_dev_of(dev_id);
+	uint32_t us = (cyccnt_read() - t_start) / I2C_CYCLES_PER_US;
+	uint8_t bin = 0;
+
+	dev->xfers++;
+	switch (outcome)
+	{
+	case I2C_XFER_NACK:
+		dev->nacks++;
+		i2c_stats.errors++;
+		break;
+	case I2C_XFER_ERROR:
+		dev->errors++;
+		i2c_stats.errors++;
+		break;
+	case I2C_XFER_TIMEOUT:
+		dev->timeouts++;
+		i2c_stats.timeouts++;
+		break;
+	default:
+		break;
+	}
+
+	while ((bin < I2C_LAT_BINS - 1) && (us >= ((uint32_t)I2C_LAT_BIN0_US << bin)))
+		bin++;
+	dev->lat_hist[bin]++;
+	dev->lat_sum += us;
+	if (us > dev->lat_max)
+		dev->lat_max = us;
+}
+
+/***********************************************************************
+ * @name i2c_outcome_of()
+ * @brief Classifies a HAL result, using the handle's error code
+ * @return enum i2c_outcome
+ ***********************************************************************/
+static uint8_t i2c_outcome_of(struct i2c_bus *bus, HAL_StatusTypeDef status)
+{
+	uint32_t error;
+
+	if (status == HAL_OK)
+		return I2C_XFER_OK;
+	if (status == HAL_BUSY)
+		return I2C_XFER_ERROR;
+
+	error = HAL_I2C_GetError(bus->hi2c);
+	if (error & HAL_I2C_ERROR_TIMEOUT)
+		return I2C_XFER_TIMEOUT;
+	if (error == HAL_I2C_ERROR_AF)
+		return I2C_XFER_NACK;
+
+	return I2C_XFER_ERROR;
+}
+
+/***********************************************************************
+ * @name i2c_tick_passed()
+ * @brief Wrap-safe test of a HAL_GetTick() deadline, with the same
+ *        strictly-after rule as the HAL's own timeouts
+ * @return 1 once the deadline has passed
+ ***********************************************************************/
+static uint8_t i2c_tick_passed(uint32_t deadline)
+{
+	return (int32_t)(HAL_GetTick() - deadline) > 0;
+}
+
+/***********************************************************************
+ * @name i2c_delay_us()
+ * @brief Busy-waits on the cycle counter
+ * @return void
+ ***********************************************************************/
+static void i2c_delay_us(uint32_t us)
+{
+	uint32_t t0 = cyccnt_read();
+
+	while ((cyccnt_read() - t0) < us * I2C_CYCLES_PER_US)
+		;
+}
+
+/***********************************************************************
+ * @name i2c_bus_recover()
+ * @brief Frees a hung bus. An i2c_ll job is dropped; de-initialising
+ *        the peripheral also stops its DMA streams and masks its
+ *        interrupts. SCL is then pulsed by
+ *        hand until the slave that holds SDA low has shifted out its byte,
+ *        a START and a STOP reset every slave, and the peripheral is set
+ *        up again with the pins handed back to it.
+ * @return void
+ ***********************************************************************/
+static void i2c_bus_recover(struct i2c_bus *bus)
+{
+	GPIO_InitTypeDef GPIO_InitStruct = { 0 };
+	uint8_t pulse;
+
+	i2c_stats.recoveries++;
+	bus->recover = 0;
+	i2c_ll_abort(bus - buses);
+	HAL_I2C_DeInit(bus->hi2c);
+
+	HAL_GPIO_WritePin(bus->scl_port, bus->scl_pin, GPIO_PIN_SET);
+	HAL_GPIO_WritePin(bus->sda_port, bus->sda_pin, GPIO_PIN_SET);
+	GPIO_InitStruct.Mode = GPIO_MODE_OUTPUT_OD;
+	GPIO_InitStruct.Pull = GPIO_PULLUP;
+	GPIO_InitStruct.Speed = GPIO_SPEED_FREQ_HIGH;
+	GPIO_InitStruct.Pin = bus->scl_pin;
+	HAL_GPIO_Init(bus->scl_port, &GPIO_InitStruct);
+	GPIO_InitStruct.Pin = bus->sda_pin;
+	HAL_GPIO_Init(bus->sda_port, &GPIO_InitStruct);
+	i2c_delay_us(I2C_RECOVERY_HALF_US);
+
+	for (pulse = 0; (pulse < I2C_RECOVERY_PULSES)
+			&& (HAL_GPIO_ReadPin(bus->sda_port, bus->sda_pin) == GPIO_PIN_RESET); pulse++)
+	{
+		HAL_GPIO_WritePin(bus->scl_port, bus->scl_pin, GPIO_PIN_RESET);
+		i2c_delay_us(I2C_RECOVERY_HALF_US);
+		HAL_GPIO_WritePin(bus->scl_port, bus->scl_pin, GPIO_PIN_SET);
+		i2c_delay_us(I2C_RECOVERY_HALF_US);
+	}
+
+	/* SCL is high: SDA falling is a START, SDA rising a STOP */
+	HAL_GPIO_WritePin(bus->sda_port, bus->sda_pin, GPIO_PIN_RESET);
+	i2c_delay_us(I2C_RECOVERY_HALF_US);
+	HAL_GPIO_WritePin(bus->sda_port, bus->sda_pin, GPIO_PIN_SET);
+	i2c_delay_us(I2C_RECOVERY_HALF_US);
+
+	HAL_I2C_Init(bus->hi2c);
+}
+
+/***********************************************************************
+ * @name i2c_bus_ready()
+ * @brief Runs a pending recovery, or one for a BUSY flag that a STOP
+ *        does not clear within I2C_BUSY_WAIT_US, before a transfer
+ * @return void
+ ***********************************************************************/
+static void i2c_bus_ready(struct i2c_bus *bus)
+{
+	uint32_t t0 = cyccnt_read();
+
+	while (!bus->recover && __HAL_I2C_GET_FLAG(bus->hi2c, I2C_FLAG_BUSY))
+	{
+		if ((cyccnt_read() - t0) >= I2C_BUSY_WAIT_US * I2C_CYCLES_PER_US)
+			bus->recover = 1;
+	}
+
+	if (bus->recover)
+		i2c_bus_recover(bus);
+}
+
+/***********************************************************************
+ * @name i2c_xfer_begin()
+ * @brief Stamps the start and deadline of a transfer of len bytes
+ * @return void
+ ***********************************************************************/
+static void i2c_xfer_begin(struct i2c_bus *bus, uint8_t dev_id, uint16_t len)
+{
+	bus->dev_id = dev_id;
+	bus->t_start = cyccnt_read();
+	bus->deadline = HAL_GetTick() + I2C_TIMEOUT_MS(len);
+}
+
+/***********************************************************************
+ * @name i2c_xfer_done()
+ * @brief Closes the in-flight transfer and notifies its owner; runs in
+ *        interrupt context. Bus errors leave a recovery for the next
+ *        transfer.
+ * @return void
+ ***********************************************************************/
+static void i2c_xfer_done(struct i2c_bus *bus, uint8_t outcome)
+{
+	bme680_com_cplt_fptr_t cplt = bus->cplt;
+	void *ctx = bus->ctx;
+	int8_t result = (outcome == I2C_XFER_OK) ? 0 : -1;
+
+	if (!bus->busy)
+		return;
+
+	if (outcome == I2C_XFER_ERROR)
+		bus->recover = 1;
+	i2c_account(bus->dev_id, bus->t_start, outcome);
+
+	bus->cplt = NULL;
+	bus->rslt = result;
+	bus->busy = 0;
+
+	if (cplt != NULL)
+		cplt(result, ctx);
+}
+
+/***********************************************************************
+ * @name i2c_xfer_expire()
+ * @brief Abandons the in-flight transfer once its deadline has passed:
+ *        the bus is recovered and the owner told of the failure. The
+ *        transfer is closed with interrupts masked, so a completion that
+ *        races the deadline is either reported or dropped, never both.
+ * @return void
+ ***********************************************************************/
+static void i2c_xfer_expire(struct i2c_bus *bus)
+{
+	bme680_com_cplt_fptr_t cplt;
+	void *ctx;
+
+	__disable_irq();
+	if (!bus->busy || !i2c_tick_passed(bus->deadline))
+	{
+		__enable_irq();
+		return;
+	}
+	cplt = bus->cplt;
+	ctx = bus->ctx;
+	bus->cplt = NULL;
+	bus->rslt = -1;
+	bus->busy = 0;
+	__enable_irq();
+
+	i2c_bus_recover(bus);
+	i2c_account(bus->dev_id, bus->t_start, I2C_XFER_TIMEOUT);
+
+	if (cplt != NULL)
+		cplt(-1, ctx);
+}
+
+/***********************************************************************
+ * @name i2c_xfer_wait()
+ * @brief Sleeps until the in-flight transfer completes or its deadline
+ *        passes. Interrupts are masked around the flag test so a
+ *        completion that lands just before WFI still wakes the core;
+ *        SysTick wakes it every millisecond to check the deadline.
+ * @return 0 on success, -1 on bus error or timeout
+ ***********************************************************************/
+static int8_t i2c_xfer_wait(struct i2c_bus *bus)
+{
+	__disable_irq();
+	while (bus->busy && !i2c_tick_passed(bus->deadline))
+	{
+		__WFI();
+		__enable_irq();
+		__disable_irq();
+	}
+	__enable_irq();
+
+	i2c_xfer_expire(bus);
+
+	return bus->rslt;
+}
+
+/***********************************************************************
+ * @name i2c_xfer_failed()
+ * @brief Books a transfer that could not be started
+ * @return -1
+ ***********************************************************************/
+static int8_t i2c_xfer_failed(struct i2c_bus *bus, uint8_t outcome)
+{
+	bus->cplt = NULL;
+	bus->busy = 0;
+	if (outcome != I2C_XFER_NACK)
+		bus->recover = 1;
+	i2c_account(bus->dev_id, bus->t_start, outcome);
+
+	return -1;
+}
+
+/***********************************************************************
+ * @name i2c_xfer_start()
+ * @brief Starts a transfer on an idle bus. Short ones, and writes on
+ *        buses without a TX DMA stream, run on the i2c_ll engine, the
+ *        rest on HAL DMA. cplt runs from the I2C/DMA interrupt, or from
+ *        i2c_transport_service() on timeout.
+ * @return 0 if started, -1 if it was refused
+ ***********************************************************************/
+static int8_t i2c_xfer_start(struct i2c_bus *bus, uint8_t dev_id, uint8_t reg_addr, uint8_t *reg_data,
+		uint16_t len, uint8_t write, bme680_com_cplt_fptr_t cplt, void *ctx)
+{
+	HAL_StatusTypeDef status;
+
+	i2c_bus_ready(bus);
+	bus->cplt = cplt;
+	bus->ctx = ctx;
+	i2c_xfer_begin(bus, dev_id, len);
+	bus->busy = 1;
+
+	if ((len < I2C_DMA_MIN_LEN) || (write && (bus->hi2c->hdmatx == NULL)))
+	{
+		if (i2c_ll_start(bus - buses, I2C_DEV_ADDR(dev_id), reg_addr, reg_data, len, !write) != 0)
+			return i2c_xfer_failed(bus, I2C_XFER_ERROR);
+		i2c_stats.ll_xfers++;
+		return 0;
+	}
+
+	if (write)
+		status = HAL_I2C_Mem_Write_DMA(bus->hi2c, I2C_DEV_ADDR(dev_id) << 1, reg_addr, I2C_MEMADD_SIZE_8BIT,
+				reg_data, len);
+	else
+		status = HAL_I2C_Mem_Read_DMA(bus->hi2c, I2C_DEV_ADDR(dev_id) << 1, reg_addr, I2C_MEMADD_SIZE_8BIT,
+				reg_data, len);
+	if (status != HAL_OK)
+		return i2c_xfer_failed(bus, i2c_outcome_of(bus, status));
+
+	i2c_stats.dma_xfers++;
+	i2c_stats.dma_bytes += len;
+
+	return 0;
+}
+
+/***********************************************************************
+ * @name i2c_transport_init()
+ * @brief Starts the cycle counter the latency histograms are taken with;
+ *        call once the I2C peripherals are initialised
+ * @return void
+ ***********************************************************************/
+void i2c_transport_init(void)
+{
+	cyccnt_init();
+}
+
+/***********************************************************************
+ * @name i2c_transport_service()
+ * @brief Expires asynchronous transfers past their deadline and runs
+ *        recoveries left by interrupt context. Call from the main loop.
+ * @return void
+ ***********************************************************************/
+void i2c_transport_service(void)
+{
+	uint8_t i;
+
+	for (i = 0; i < I2C_TRANSPORT_BUSES; i++)
+	{
+		if (buses[i].busy)
+			i2c_xfer_expire(&buses[i]);
+		else if (buses[i].recover)
+			i2c_bus_recover(&buses[i]);
+	}
+}
+
+/***********************************************************************
+ * @name user_i2c_read_async()
+ * @brief Starts a register read and returns immediately; cplt is called
+ *        from the I2C/DMA interrupt once reg_data is filled, or from
+ *        i2c_transport_service() with -1 once the deadline passes
+ * @return 0 if the transfer was started, -1 if the bus is busy or failed
+ ***********************************************************************/
+int8_t user_i2c_read_async(uint8_t dev_id, uint8_t reg_addr, uint8_t *reg_data, uint16_t len,
+		bme680_com_cplt_fptr_t cplt, void *ctx)
+{
+	struct i2c_bus *bus = i2c_bus_of(dev_id);
+
+	if (bus->busy)
+		return -1;
+
+	return i2c_xfer_start(bus, dev_id, reg_addr, reg_data, len, 0, cplt, ctx);
+}
+
+/***********************************************************************
+ * @name i2c_transport_start()
+ * @brief Starts a read or write on an idle bus for the scheduler. cplt
+ *        is called from the I2C/DMA interrupt or i2c_transport_service(),
+ *        or before returning with -1 if the transfer could not start.
+ *        Thread context only, the start may run a bus recovery.
+ * @return 0 if cplt has been or will be called, -1 if the bus is busy
+ ***********************************************************************/
+int8_t i2c_transport_start(uint8_t dev_id, uint8_t reg_addr, uint8_t *reg_data, uint16_t len, uint8_t write,
+		bme680_com_cplt_fptr_t cplt, void *ctx)
+{
+	struct i2c_bus *bus = i2c_bus_of(dev_id);
+
+	if (bus->busy)
+		return -1;
+
+	if ((i2c_xfer_start(bus, dev_id, reg_addr, reg_data, len, write, cplt, ctx) != 0) && (cplt != NULL))
+		cplt(-1, ctx);
+
+	return 0;
+}
+
+/***********************************************************************
+ * @name user_i2c_read()
+ * @brief Synchronous bme680_dev read hook; the core sleeps while the
+ *        transfer runs. A transfer already in flight on the bus is
+ *        waited for first.
+ * @return 0 on success, -1 on bus error or timeout
+ ***********************************************************************/
+int8_t user_i2c_read(uint8_t dev_id, uint8_t reg_addr, uint8_t *reg_data, uint16_t len)
+{
+	struct i2c_bus *bus = i2c_bus_of(dev_id);
+
+	if (bus->busy)
+		i2c_xfer_wait(bus);
+
+	if (i2c_xfer_start(bus, dev_id, reg_addr, reg_data, len, 0, NULL, NULL) != 0)
+		return -1;
+
+	return i2c_xfer_wait(bus);
+}
+
+/***********************************************************************
+ * @name user_i2c_write()
+ * @brief Synchronous bme680_dev write hook. The register address goes
+ *        out as the memory address, so no bounce buffer is needed. A
+ *        transfer already in flight on the bus is waited for first.
+ * @return 0 on success, -1 on bus error or timeout
+ ***********************************************************************/
+int8_t user_i2c_write(uint8_t dev_id, uint8_t reg_addr, uint8_t *reg_data, uint16_t len)
+{
+	struct i2c_bus *bus = i2c_bus_of(dev_id);
+
+	if (bus->busy)
+		i2c_xfer_wait(bus);
+
+	if (i2c_xfer_start(bus, dev_id, reg_addr, reg_data, len, 1, NULL, NULL) != 0)
+		return -1;
+
+	return i2c_xfer_wait(bus);
+}
+
+/***********************************************************************
+ * @name i2c_transport_busy()
+ * @brief Reports whether a transfer is in flight on dev_id's bus
+ * @return 1 if busy, 0 if idle
+ ***********************************************************************/
+uint8_t i2c_transport_busy(uint8_t dev_id)
+{
+	return i2c_bus_of(dev_id)->busy;
+}
+
+/***********************************************************************
+ * @name HAL_I2C_MemRxCpltCallback()
+ * @brief HAL completion callback for DMA register reads
+ * @return void
+ ***********************************************************************/
+void HAL_I2C_MemRxCpltCallback(I2C_HandleTypeDef *hi2c)
+{
+	struct i2c_bus *bus = i2c_bus_from_handle(hi2c);
+
+	if (bus != NULL)
+		i2c_xfer_done(bus, I2C_XFER_OK);
+}
+
+/***********************************************************************
+ * @name HAL_I2C_MemTxCpltCallback()
+ * @brief HAL completion callback for DMA register writes
+ * @return void
+ ***********************************************************************/
+void HAL_I2C_MemTxCpltCallback(I2C_HandleTypeDef *hi2c)
+{
+	struct i2c_bus *bus = i2c_bus_from_handle(hi2c);
+
+	if (bus != NULL)
+		i2c_xfer_done(bus, I2C_XFER_OK);
+}
+
+/***********************************************************************
+ * @name HAL_I2C_ErrorCallback()
+ * @brief HAL error callback (NACK, bus error, DMA error)
+ * @return void
+ ***********************************************************************/
+void HAL_I2C_ErrorCallback(I2C_HandleTypeDef *hi2c)
+{
+	struct i2c_bus *bus = i2c_bus_from_handle(hi2c);
+
+	if (bus != NULL)
+		i2c_xfer_done(bus, i2c_outcome_of(bus, HAL_ERROR));
+}
+
+/***********************************************************************
+ * @name i2c_ll_done_callback()
+ * @brief i2c_ll completion of a short transfer
+ * @return void
+ ***********************************************************************/
+void i2c_ll_done_callback(uint8_t bus, uint8_t status)
+{
+	if (status == I2C_LL_OK)
+		i2c_xfer_done(&buses[bus], I2C_XFER_OK);
+	else if (status == I2C_LL_NACK)
+		i2c_xfer_done(&buses[bus], I2C_XFER_NACK);
+	else
+		i2c_xfer_done(&buses[bus], I2C_XFER_ERROR);
+}
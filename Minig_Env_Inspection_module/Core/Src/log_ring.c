@@ -0,0 +1,152 @@
+/**
+  ******************************************************************************
+  * @file           : log_ring.c
+  * @brief          : Lock-free console ring drained by a DMA transmitter
+  ******************************************************************************
+**/
+
+#include <string.h>
+#include "log_ring.h"
+
+#define LOG_RING_MASK		(LOG_RING_SIZE - 1)
+
+/***********************************************************************
+ * @name log_ring_copy_in()
+ * @brief Copies len bytes to ring position pos, across the wrap
+ * @return void
+ ***********************************************************************/
+static void log_ring_copy_in(struct log_ring *ring, uint32_t pos, const uint8_t *data, uint16_t len)
+{
+	uint32_t off = pos & LOG_RING_MASK;
+	uint32_t first = LOG_RING_SIZE - off;
+
+	if (first > len)
+		first = len;
+	memcpy(&ring->buf[off], data, first);
+	memcpy(ring->buf, data + first, len - first);
+}
+
+/***********************************************************************
+ * @name log_ring_start()
+ * @brief Moves the next chunk out of the ring and starts it, or marks
+ *        the transmitter idle when there is nothing to send. Runs in
+ *        the producer only while idle, otherwise in the completion.
+ * @return void
+ ***********************************************************************/
+static void log_ring_start(struct log_ring *ring)
+{
+	uint32_t tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+	uint32_t len = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE) - tail;
+	uint32_t off = tail & LOG_RING_MASK;
+	uint32_t first;
+
+	if (len == 0)
+	{
+		ring->busy = 0;
+		return;
+	}
+	if (len > LOG_RING_CHUNK)
+		len = LOG_RING_CHUNK;
+
+	first = LOG_RING_SIZE - off;
+	if (first > len)
+		first = len;
+	memcpy(ring->chunk, &ring->buf[off], first);
+	memcpy(ring->chunk + first, ring->buf, len - first);
+	__atomic_store_n(&ring->tail, tail + len, __ATOMIC_RELEASE);
+
+	ring->busy = 1;
+	ring->stats.chunks++;
+	if (ring->tx(ring->chunk, (uint16_t)len, ring->ctx) != 0)
+	{
+		ring->stats.tx_errors++;
+		ring->busy = 0;
+		return;
+	}
+	ring->stats.sent += len;
+}
+
+/***********************************************************************
+ * @name log_ring_init()
+ * @brief Sets up an empty ring that sends through tx
+ * @return void
+ ***********************************************************************/
+void log_ring_init(struct log_ring *ring, enum log_ring_policy policy, log_ring_tx_fptr_t tx, void *ctx)
+{
+	memset(ring, 0, sizeof(*ring));
+	ring->policy = policy;
+	ring->tx = tx;
+	ring->ctx = ctx;
+}
+
+/***********************************************************************
+ * @name log_ring_write()
+ * @brief Queues len bytes and starts the transmitter if it is idle.
+ *        Never waits; what does not fit is dropped by the ring's policy.
+ * @return bytes queued, len or 0
+ ***********************************************************************/
+uint16_t log_ring_write(struct log_ring *ring, const void *data, uint16_t len)
+{
+	uint32_t head = ring->head;
+	uint32_t room = LOG_RING_SIZE - (uint32_t)len;
+	uint32_t tail, fill;
+
+	if (len == 0)
+		return 0;
+
+	if (len > LOG_RING_SIZE || (ring->policy == LOG_RING_DROP_NEWEST
+			&& head - __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE) > room))
+	{
+		ring->stats.dropped++;
+		ring->stats.dropped_bytes += len;
+		return 0;
+	}
+
+	/* DROP_OLDEST: push tail past what does not fit; a completion moving
+	 * tail meanwhile fails the swap, and the shortfall is taken again */
+	tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+	while (head - tail > room)
+	{
+		uint32_t need = (head - tail) - room;
+
+		if (__atomic_compare_exchange_n(&ring->tail, &tail, tail + need, 0, __ATOMIC_ACQ_REL,
+				__ATOMIC_ACQUIRE))
+		{
+			ring->stats.overwritten += need;
+			tail += need;
+		}
+	}
+
+	log_ring_copy_in(ring, head, data, len);
+	__atomic_store_n(&ring->head, head + len, __ATOMIC_RELEASE);
+	ring->stats.written += len;
+	fill = head + len - tail;
+	if (fill > ring->stats.fill_max)
+		ring->stats.fill_max = (uint16_t)fill;
+
+	if (!ring->busy)
+		log_ring_start(ring);
+
+	return len;
+}
+
+/***********************************************************************
+ * @name log_ring_tx_done()
+ * @brief Transmitter completion; call from its interrupt
+ * @return void
+ ***********************************************************************/
+void log_ring_tx_done(struct log_ring *ring)
+{
+	ring->busy = 0;
+	log_ring_start(ring);
+}
+
+/***********************************************************************
+ * @name log_ring_fill()
+ * @brief Bytes queued and not yet handed to the transmitter
+ * @return bytes
+ ***********************************************************************/
+uint16_t log_ring_fill(const struct log_ring *ring)
+{
+	return (uint16_t)(ring->head - ring->tail);
+}
@@ -25,43 +25,158 @@
 
 #include <stdbool.h>
 #include "statemachine.h"
+#include "meas_engine.h"
+#include "sensor_array.h"
+#include "i2c_transport.h"
+#include "i2c_sched.h"
+#include "i2c_ll.h"
+#include "calib_cache.h"
+#include "os_ctrl.h"
+#include "derived.h"
+#include "task_sched.h"
+#include "scratch.h"
+#include "log_ring.h"
+#include "telemetry.h"
+#include "fixfmt.h"
+#include "cyccnt.h"
+#include "app_tasks.h"
+#include "app_bench.h"
+#ifdef BME680_FRAME_LOG
+#include "frame_log.h"
+#endif
+#ifdef BME680_SPI
+#include "spi_transport.h"
+#endif
+
+/* Interval between forced mode conversions of each sensor */
+#define BME680_SAMPLE_PERIOD_MS	5000
+
+/* Define BME680_TEXT_TELEMETRY for the text console: the readable report
+ * with the controller, bus and task statistics, and everything else
+ * myprintf() prints. The benchmarks and the scan print there too. Without
+ * it USART2 carries only binary frames, one per sample of every sensor
+ * (see telemetry.h), and tools/telem_decode reads them. */
+
+/* Intervals of the OLED refresh and the UART report, independent of the
+ * sample period; both show the latest compensated sample. Binary
+ * telemetry polls for the next sample instead. */
+#define BME680_DISPLAY_PERIOD_MS	1000
+#ifdef BME680_TEXT_TELEMETRY
+#define BME680_TELEMETRY_PERIOD_MS	5000
+#define BME680_TELEMETRY_DEADLINE_MS	500
+#else
+#define BME680_TELEMETRY_PERIOD_MS	100
+#define BME680_TELEMETRY_DEADLINE_MS	50
+#endif
+
+/* Further sensor positions probed at start-up, next to gas_sensor */
+static const uint8_t extra_sensor_ids[] = {
+	BME680_I2C_ADDR_PRIMARY,
+	I2C_BUS2_FLAG | BME680_I2C_ADDR_SECONDARY,
+	I2C_BUS2_FLAG | BME680_I2C_ADDR_PRIMARY
+};
+
+/* Define BME680_GAS_SCAN to step the heater through gas_profile, one step per
+ * sample, and print the per-step gas resistance vector after every pass */
+#ifdef BME680_GAS_SCAN
+const struct bme680_heatr_profile gas_profile = {
+	.heatr_temp = { 200, 220, 240, 260, 280, 300, 320, 340, 360, 380 },	/* degree Celsius */
+	.heatr_dur = { 100, 100, 100, 100, 100, 100, 100, 100, 100, 100 },	/* milliseconds */
+	.len = BME680_HEATR_STEPS
+};
+#endif
+
+/* Define BME680_SPI to run gas_sensor on SPI2 (see spi_transport.h) instead
+ * of I2C1; the positions in extra_sensor_ids are still probed on I2C */
+
+/* Define BME680_FRAME_LOG to stream a raw field capture of node 0 over
+ * USART2 (see frame_log.h); the text console is silenced so the port
+ * carries nothing else and can be saved straight to a file */
+
+/* What myprintf() gives up when the console ring is full: the new line
+ * (LOG_RING_DROP_NEWEST) or the oldest unsent bytes (LOG_RING_DROP_OLDEST) */
+#define UART_LOG_POLICY		LOG_RING_DROP_NEWEST
+
+/* Define BME680_ZERO_HEAP to build with no heap: sysmem.c's _sbrk() is
+ * then left undefined, so anything that reaches newlib's malloc breaks the
+ * link. The Debug configuration already links without -u _printf_float
+ * and -u _scanf_float, which a zero-heap build needs.
+ * Formatting buffers come from scratch.h's arenas, and myprintf(), the
+ * OLED rows and BME680_CompBench() format through fixfmt.h instead of
+ * newlib's printf family, whose nano vsnprintf references _malloc_r.
+ * Both compensation builds print their fields as integers. */
 
 I2C_HandleTypeDef hi2c1;
+DMA_HandleTypeDef hdma_i2c1_rx;
+DMA_HandleTypeDef hdma_i2c1_tx;
+I2C_HandleTypeDef hi2c2;
+DMA_HandleTypeDef hdma_i2c2_rx;
 UART_HandleTypeDef huart2;
+DMA_HandleTypeDef hdma_usart2_tx;
 
 void SystemClock_Config(void);
 static void MX_GPIO_Init(void);
+static void MX_DMA_Init(void);
 static void MX_I2C1_Init(void);
+static void MX_I2C2_Init(void);
 static void MX_USART2_UART_Init(void);
 
-void BME680_Read(void);
+void BME680_AddSensors(void);
 void user_delay_ms(uint32_t period);
-
-int8_t user_i2c_read(uint8_t dev_id, uint8_t reg_addr, uint8_t *reg_data, uint16_t len);
-int8_t user_i2c_write(uint8_t dev_id, uint8_t reg_addr, uint8_t *reg_data,uint16_t len);
+int8_t BME680_UartTx(const uint8_t *buf, uint16_t len, void *ctx);
 
 volatile uint8_t set_required_settings;
 volatile int8_t rslt = 0;
 struct bme680_dev gas_sensor;
-struct bme680_field_data data;
-char bufbme1[50];
 uint16_t min_sampling_period;
+struct task_sched tasks;
+struct log_ring uart_log;
+enum calib_cache_src calib_src;
 
 /***********************************************************************
  * @name myprintf()
- * @brief to print over a UART
+ * @brief to print over a UART; the line is queued on uart_log and goes
+ *        out by DMA, so the caller never waits on the baud rate. Only
+ *        the text console build prints.
  * @return void
  ***********************************************************************/
 void myprintf(const char *fmt, ...) {
-  static char buffer[256];
+#if defined(BME680_TEXT_TELEMETRY) && !defined(BME680_FRAME_LOG)
+  uint16_t mark = scratch_mark(&scratch_fmt);
+  char *buffer = scratch_take(&scratch_fmt, SCRATCH_LINE_LEN);
+  char *end;
   va_list args;
+
+  if (buffer == NULL)
+    return;
   va_start(args, fmt);
-  vsnprintf(buffer, sizeof(buffer), fmt, args);
+  end = fmt_vprintf(buffer, buffer + SCRATCH_LINE_LEN, fmt, args);
   va_end(args);
 
-  int len = strlen(buffer);
-  HAL_UART_Transmit(&huart2, (uint8_t*)buffer, len, -1);
+  log_ring_write(&uart_log, buffer, end - buffer);
+  scratch_release(&scratch_fmt, mark);
+#endif
+}
+
+/***********************************************************************
+ * @name BME680_UartTx()
+ * @brief uart_log transmitter: one chunk by DMA on USART2
+ * @return 0 if the transfer started
+ ***********************************************************************/
+int8_t BME680_UartTx(const uint8_t *buf, uint16_t len, void *ctx)
+{
+	return (HAL_UART_Transmit_DMA(&huart2, (uint8_t *)buf, len) == HAL_OK) ? 0 : -1;
+}
 
+/***********************************************************************
+ * @name HAL_UART_TxCpltCallback()
+ * @brief HAL completion callback of USART2 DMA transfers
+ * @return void
+ ***********************************************************************/
+void HAL_UART_TxCpltCallback(UART_HandleTypeDef *huart)
+{
+	if (huart == &huart2)
+		log_ring_tx_done(&uart_log);
 }
 
 
@@ -75,31 +190,47 @@ int main(void)
 	HAL_Init();
 	SystemClock_Config();
 	MX_GPIO_Init();
+	MX_DMA_Init();
 	MX_I2C1_Init();
+	MX_I2C2_Init();
+	i2c_transport_init();
 	SSD1306_Init();
 	SSD1306_Clear();
 	MX_USART2_UART_Init();
-
+	log_ring_init(&uart_log, UART_LOG_POLICY, BME680_UartTx, NULL);
+#if !defined(BME680_TEXT_TELEMETRY) && !defined(BME680_FRAME_LOG)
+	telem_init(&telem, BME680_TelemWrite, NULL);
+#endif
+
+#ifdef BME680_SPI
+	spi_transport_init();
+	gas_sensor.dev_id = 0;
+	gas_sensor.intf = BME680_SPI_INTF;
+	gas_sensor.read = user_spi_read;
+	gas_sensor.write = user_spi_write;
+	gas_sensor.read_async = user_spi_read_async;
+#else
 	gas_sensor.dev_id = BME680_I2C_ADDR_SECONDARY;
 	gas_sensor.intf = BME680_I2C_INTF;
-	gas_sensor.read = user_i2c_read;
-	gas_sensor.write = user_i2c_write;
+	gas_sensor.read = i2c_sched_read;
+	gas_sensor.write = i2c_sched_write;
+	gas_sensor.read_async = i2c_sched_read_async;
+#endif
 	gas_sensor.delay_ms = user_delay_ms;
+	gas_sensor.get_tick = HAL_GetTick;
 	gas_sensor.amb_temp = 25;
 
-	rslt = bme680_init(&gas_sensor);
-
-	if (bme680_init(&gas_sensor) != BME680_OK)
-	{
-	}
-	else
-	{
-
-	}
-	gas_sensor.tph_sett.os_hum = BME680_OS_2X;
-	gas_sensor.tph_sett.os_pres = BME680_OS_4X;
-	gas_sensor.tph_sett.os_temp = BME680_OS_8X;
-	gas_sensor.tph_sett.filter = BME680_FILTER_SIZE_127;
+	/* One probe per boot; the coefficients come from flash after the first.
+	 * Define BME680_CALIB_REFRESH to drop the cached record and read them
+	 * from the sensor again. */
+#ifdef BME680_CALIB_REFRESH
+	calib_cache_invalidate();
+#endif
+	rslt = calib_cache_init(&gas_sensor, &calib_src);
+
+	/* Start at the top oversampling level; os_ctrl steps down once readings settle */
+	os_ctrl_init(&os_ctrl, OS_CTRL_LEVELS - 1);
+	os_ctrl_settings(&os_ctrl, &gas_sensor.tph_sett);
 	gas_sensor.gas_sett.run_gas = BME680_ENABLE_GAS_MEAS;
 	gas_sensor.gas_sett.heatr_temp = 320; /* degree Celsius */
 	gas_sensor.gas_sett.heatr_dur = 150; /* milliseconds */
@@ -107,15 +238,42 @@ int main(void)
 
 	set_required_settings = BME680_OST_SEL | BME680_OSP_SEL | BME680_OSH_SEL| BME680_FILTER_SEL | BME680_GAS_SENSOR_SEL;
 
-	rslt = bme680_init(&gas_sensor);
-
 	bme680_get_profile_dur(&min_sampling_period, &gas_sensor);
-	struct bme680_field_data data;
 	rslt = bme680_set_sensor_settings(set_required_settings, &gas_sensor);
-	rslt = bme680_set_sensor_mode(&gas_sensor);
+
+	/* gas_sensor becomes node 0, the one shown on the OLED and fed to the state machine */
+	sensor_array_init(&sensors, HAL_GetTick, i2c_sched_busy, BME680_SAMPLE_PERIOD_MS, BME680_Ready, NULL);
+	sensor_array_add(&sensors, &gas_sensor);
+#ifdef BME680_FRAME_LOG
+	frame_log_begin(&frame_log, &sensors.node[0].dev, BME680_LogWrite, NULL);
+	sensors.node[0].dev.field_hook = BME680_Capture;
+#endif
+	BME680_AddSensors();
+#ifdef BME680_I2C_BENCH
+	BME680_I2CBench();
+#endif
+#ifdef BME680_GAS_SCAN
+	rslt = bme680_set_heatr_profile(&gas_profile, &sensors.node[0].dev);
+	if (rslt == BME680_OK)
+		meas_engine_set_scan(&sensors.node[0].eng, BME680_Scan);
+	else
+		myprintf("\r\n Gas scan off: heater profile not loaded (%d) ", rslt);
+#endif
+	sensor_array_start(&sensors);
+
+	/* In priority order; the offsets keep the slow tasks off the same tick */
+	task_sched_init(&tasks, HAL_GetTick, cyccnt_read, SystemCoreClock / 1000, BME680_Idle);
+	task_sched_add(&tasks, "sample", BME680_TaskSample, NULL, 1, 5, 0);
+	task_sched_add(&tasks, "compensate", BME680_TaskCompensate, NULL, 50, 50, 0);
+	task_sched_add(&tasks, "state", BME680_TaskState, NULL, 100, 100, 10);
+	task_sched_add(&tasks, "display", BME680_TaskDisplay, NULL, BME680_DISPLAY_PERIOD_MS, 100, 20);
+	task_sched_add(&tasks, "telemetry", BME680_TaskTelemetry, NULL, BME680_TELEMETRY_PERIOD_MS,
+			BME680_TELEMETRY_DEADLINE_MS, 30);
+	task_sched_start(&tasks);
+
 	while (1)
 	{
-		BME680_Read();
+		task_sched_run(&tasks);
 	}
 }
 
@@ -163,6 +321,34 @@ void SystemClock_Config(void) {
 	}
 }
 
+/**
+ * @brief Enable DMA controller clock and the I2C and USART2_TX stream interrupts
+ * @param None
+ * @retval None
+ */
+static void MX_DMA_Init(void)
+{
+	/* DMA controller clock enable */
+	__HAL_RCC_DMA1_CLK_ENABLE();
+
+	/* DMA interrupt init */
+	/* DMA1_Stream0_IRQn interrupt configuration (I2C1_RX) */
+	HAL_NVIC_SetPriority(DMA1_Stream0_IRQn, 0, 0);
+	HAL_NVIC_EnableIRQ(DMA1_Stream0_IRQn);
+	/* DMA1_Stream2_IRQn interrupt configuration (I2C2_RX) */
+	HAL_NVIC_SetPriority(DMA1_Stream2_IRQn, 0, 0);
+	HAL_NVIC_EnableIRQ(DMA1_Stream2_IRQn);
+	/* DMA1_Stream6_IRQn interrupt configuration (USART2_TX). HAL_Init()
+	 * leaves all four priority bits to preemption (NVIC_PRIORITYGROUP_4),
+	 * so the I2C event, error and DMA interrupts at 0 preempt the console
+	 * at 1 */
+	HAL_NVIC_SetPriority(DMA1_Stream6_IRQn, 1, 0);
+	HAL_NVIC_EnableIRQ(DMA1_Stream6_IRQn);
+	/* DMA1_Stream7_IRQn interrupt configuration (I2C1_TX) */
+	HAL_NVIC_SetPriority(DMA1_Stream7_IRQn, 0, 0);
+	HAL_NVIC_EnableIRQ(DMA1_Stream7_IRQn);
+}
+
 /**
  * @brief I2C1 Initialization Function
  * @param None
@@ -187,6 +373,30 @@ static void MX_I2C1_Init(void) {
 
 }
 
+/**
+ * @brief I2C2 Initialization Function
+ * @param None
+ * @retval None
+ */
+static void MX_I2C2_Init(void) {
+	hi2c2.Instance = I2C2;
+	hi2c2.Init.ClockSpeed = 400000;
+	hi2c2.Init.DutyCycle = I2C_DUTYCYCLE_2;
+	hi2c2.Init.OwnAddress1 = 0;
+	hi2c2.Init.AddressingMode = I2C_ADDRESSINGMODE_7BIT;
+	hi2c2.Init.DualAddressMode = I2C_DUALADDRESS_DISABLE;
+	hi2c2.Init.OwnAddress2 = 0;
+	hi2c2.Init.GeneralCallMode = I2C_GENERALCALL_DISABLE;
+	hi2c2.Init.NoStretchMode = I2C_NOSTRETCH_DISABLE;
+	if (HAL_I2C_Init(&hi2c2) != HAL_OK) {
+		Error_Handler();
+	}
+	/* USER CODE BEGIN I2C2_Init 2 */
+
+	/* USER CODE END I2C2_Init 2 */
+
+}
+
 static void MX_USART2_UART_Init(void)
 {
 
@@ -244,51 +454,32 @@ static void MX_GPIO_Init(void) {
 }
 
 /***********************************************************************
- * @name BME680_Read()
- * @brief Reads sensor values for every 1s and passes to the state machine
+ * @name BME680_AddSensors()
+ * @brief Probes the remaining bus/address positions and adds every
+ *        sensor that answers, configured like gas_sensor
  * @return void
  ***********************************************************************/
-void BME680_Read(void)
+void BME680_AddSensors(void)
 {
-	user_delay_ms(min_sampling_period);
-	rslt = bme680_get_sensor_data(&data, &gas_sensor);
-
-	SSD1306_GotoXY(0, 0);
-	SSD1306_Puts("ESD PROJECT 2023", &Font_7x10, 1);
-
-	SSD1306_GotoXY(0, 20);
-	sprintf(bufbme1, "Temp:%.2fdegC", data.temperature / 100.0f);
-	SSD1306_Puts(bufbme1, &Font_7x10, 1);
-	myprintf("\r\n\n Temperature: %.2f C ", data.temperature/ 100.0f);
-
-	SSD1306_GotoXY(0, 30);
-	sprintf(bufbme1, "Humi:%.2f %%rH ", data.humidity / 1000.0f);
-	SSD1306_Puts(bufbme1, &Font_7x10, 1);
-	myprintf("\r\n Humidity   : %.2f %%rH ", data.humidity / 1000.0f);
-
-	SSD1306_GotoXY(0, 40);
-	sprintf(bufbme1, "Press:%.2fhPa", data.pressure / 100.0f);
-	SSD1306_Puts(bufbme1, &Font_7x10, 1);
-	myprintf("\r\n Pressure   : %.2f hPa ", data.pressure / 100.0f);
-
-	SSD1306_GotoXY(0, 50);
-	sprintf(bufbme1, "AIRQUAL:%.2fKohms ", data.gas_resistance / 1000.0f);
-	SSD1306_Puts(bufbme1, &Font_7x10, 1);
-	myprintf("\r\n Air Quality: %.2f Kohms ", data.gas_resistance / 1000.0f);
-
-
-	sensor_statemachine(data.temperature / 100.0f, data.humidity / 1000.0f, data.pressure / 100.0f, data.gas_resistance / 1000.0f );
-
-	SSD1306_UpdateScreen();
-
-	user_delay_ms(5*1000);
+	struct bme680_dev dev;
+	uint8_t i;
 
-	/*  Trigger the next measurement if you would like to read data out continuously*/
-	if (gas_sensor.power_mode == BME680_FORCED_MODE)
+	for (i = 0; i < sizeof(extra_sensor_ids); i++)
 	{
-		rslt = bme680_set_sensor_mode(&gas_sensor);
+		dev = gas_sensor;
+		dev.dev_id = extra_sensor_ids[i];
+		dev.intf = BME680_I2C_INTF;
+		dev.read = i2c_sched_read;
+		dev.write = i2c_sched_write;
+		dev.read_async = i2c_sched_read_async;
+		if (bme680_init(&dev) != BME680_OK)
+			continue;
+		if (bme680_set_sensor_settings(set_required_settings, &dev) != BME680_OK)
+			continue;
+		if (sensor_array_add(&sensors, &dev) >= 0)
+			myprintf("\r\n BME680 %u on I2C%u addr 0x%02X ", sensors.count - 1,
+					(dev.dev_id & I2C_BUS2_FLAG) ? 2 : 1, I2C_DEV_ADDR(dev.dev_id));
 	}
-
 }
 
 /***********************************************************************
@@ -302,59 +493,6 @@ void user_delay_ms(uint32_t period)
 }
 
 
-/***********************************************************************
- * @name user_i2c_read()
- * @brief reads data from i2c
- * @return void
- ***********************************************************************/
-int8_t user_i2c_read(uint8_t dev_id, uint8_t reg_addr, uint8_t *reg_data, uint16_t len)
-{
-	int8_t result;
-
-	if (HAL_I2C_Master_Transmit(&hi2c1, (dev_id << 1), &reg_addr, 1, HAL_MAX_DELAY) != HAL_OK)
-	{
-		result = -1;
-	}
-	else if (HAL_I2C_Master_Receive(&hi2c1, (dev_id << 1) | 0x01, reg_data, len, HAL_MAX_DELAY) != HAL_OK)
-	{
-		result = -1;
-	}
-	else
-	{
-		result = 0;
-	}
-	return result;
-}
-
-
-/***********************************************************************
- * @name user_i2c_write()
- * @brief reads data from i2c
- * @return void
- ***********************************************************************/
-int8_t user_i2c_write(uint8_t dev_id, uint8_t reg_addr, uint8_t *reg_data, uint16_t len)
-{
-	int8_t result;
-	int8_t *buf;
-
-	// Allocate and load I2C transmit buffer
-	buf = malloc(len + 1);
-	buf[0] = reg_addr;
-	memcpy(buf + 1, reg_data, len);
-
-	if (HAL_I2C_Master_Transmit(&hi2c1, (dev_id << 1), (uint8_t*) buf, len + 1, HAL_MAX_DELAY) != HAL_OK)
-	{
-		result = -1;
-	}
-	else
-	{
-		result = 0;
-	}
-
-	free(buf);
-	return result;
-}
-
 /***********************************************************************
  * @name Error_Handler()
  * @brief
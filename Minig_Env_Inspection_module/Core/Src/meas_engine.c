@@ -0,0 +1,235 @@
+/**
+  ******************************************************************************
+  * @file           : meas_engine.c
+  * @brief          : Non-blocking forced mode measurement engine for the BME680
+  ******************************************************************************
+**/
+
+#include <string.h>
+#include "meas_engine.h"
+
+/***********************************************************************
+ * @name tick_reached()
+ * @brief Wrap-safe comparison of the current tick against a deadline
+ * @return true once now is at or past the deadline
+ ***********************************************************************/
+static uint8_t tick_reached(uint32_t now, uint32_t deadline)
+{
+	return (int32_t)(now - deadline) >= 0;
+}
+
+/***********************************************************************
+ * @name meas_engine_scan_record()
+ * @brief Files a sample under the heater step it was taken at and reports
+ *        the scan once the last step is in
+ * @return void
+ ***********************************************************************/
+static void meas_engine_scan_record(struct meas_engine *eng)
+{
+	const struct bme680_heatr_profile *prof = eng->dev->heatr_prof;
+	uint8_t step = eng->data.gas_index;
+
+	if (step >= prof->len)
+		return;
+
+	eng->scan.gas_resistance[step] = eng->data.gas_resistance;
+	if ((eng->data.status & BME680_GASM_VALID_MSK) && (eng->data.status & BME680_HEAT_STAB_MSK))
+		eng->scan.valid |= (uint16_t)(1U << step);
+
+	eng->scan_step = step + 1;
+	if (eng->scan_step >= prof->len) {
+		eng->scan.len = prof->len;
+		eng->scan.seq++;
+		eng->on_scan(&eng->scan, eng->ctx);
+		eng->scan.valid = 0;
+		eng->scan_step = 0;
+	}
+}
+
+/***********************************************************************
+ * @name meas_engine_finish()
+ * @brief Returns the engine to idle and reports the outcome
+ * @return void
+ ***********************************************************************/
+static void meas_engine_finish(struct meas_engine *eng, int8_t rslt)
+{
+	eng->state = MEAS_IDLE;
+
+	if (rslt == BME680_OK) {
+		eng->samples++;
+		if ((eng->on_scan != NULL) && (eng->dev->heatr_prof != NULL))
+			meas_engine_scan_record(eng);
+	} else {
+		eng->errors++;
+	}
+
+	if (eng->on_ready != NULL)
+		eng->on_ready(rslt, (rslt == BME680_OK) ? &eng->data : NULL, eng->ctx);
+}
+
+/***********************************************************************
+ * @name meas_engine_init()
+ * @brief Binds the engine to a configured sensor, time source and callback
+ * @return void
+ ***********************************************************************/
+void meas_engine_init(struct meas_engine *eng, struct bme680_dev *dev, meas_tick_fptr_t get_tick,
+		meas_ready_fptr_t on_ready, void *ctx)
+{
+	memset(eng, 0, sizeof(*eng));
+	eng->dev = dev;
+	eng->get_tick = get_tick;
+	eng->on_ready = on_ready;
+	eng->ctx = ctx;
+	eng->state = MEAS_IDLE;
+}
+
+/***********************************************************************
+ * @name meas_engine_start()
+ * @brief Triggers a forced conversion and arms the completion deadline
+ * @return BME680_OK, BME680_W_MEAS_BUSY if a conversion is in flight,
+ *         or the driver error code
+ ***********************************************************************/
+int8_t meas_engine_start(struct meas_engine *eng)
+{
+	int8_t rslt;
+	uint16_t meas_dur;
+
+	if (eng->state != MEAS_IDLE)
+		return BME680_W_MEAS_BUSY;
+
+	/* Move the heater to the next profile step; only nb_conv is written */
+	if ((eng->on_scan != NULL) && (eng->dev->heatr_prof != NULL)) {
+		if (eng->scan_step >= eng->dev->heatr_prof->len)
+			eng->scan_step = 0;
+		if (eng->dev->gas_sett.nb_conv != eng->scan_step) {
+			rslt = bme680_set_heatr_step(eng->scan_step, eng->dev);
+			if (rslt != BME680_OK) {
+				eng->errors++;
+				return rslt;
+			}
+		}
+	}
+
+	rslt = bme680_start_meas(eng->dev);
+	if (rslt == BME680_OK) {
+		/* Settings may change between samples, so size every conversion afresh */
+		bme680_get_profile_dur(&meas_dur, eng->dev);
+		eng->t_trigger = eng->get_tick();
+		eng->deadline = eng->t_trigger + meas_dur;
+		eng->polls_left = MEAS_ENGINE_MAX_POLLS;
+		eng->state = MEAS_CONVERTING;
+	} else if (rslt < 0) {
+		eng->errors++;
+	}
+
+	return rslt;
+}
+
+/***********************************************************************
+ * @name meas_engine_xfer_cplt()
+ * @brief Completion callback of the asynchronous field read; may run in
+ *        interrupt context so it only latches the outcome
+ * @return void
+ ***********************************************************************/
+static void meas_engine_xfer_cplt(int8_t rslt, void *ctx)
+{
+	struct meas_engine *eng = ctx;
+
+	eng->xfer_rslt = rslt;
+	eng->xfer_done = 1;
+}
+
+/***********************************************************************
+ * @name meas_engine_result()
+ * @brief Handles the outcome of one data-ready poll
+ * @return BME680_OK when a sample was delivered, BME680_W_MEAS_BUSY if
+ *         another poll is scheduled, otherwise the error reported
+ ***********************************************************************/
+static int8_t meas_engine_result(struct meas_engine *eng, int8_t rslt)
+{
+	if (rslt == BME680_W_NO_NEW_DATA) {
+		if (--eng->polls_left == 0) {
+			meas_engine_finish(eng, BME680_W_NO_NEW_DATA);
+			return BME680_W_NO_NEW_DATA;
+		}
+		eng->state = MEAS_POLLING;
+		eng->deadline = eng->get_tick() + BME680_POLL_PERIOD_MS;
+		return BME680_W_MEAS_BUSY;
+	}
+
+	meas_engine_finish(eng, rslt);
+
+	return rslt;
+}
+
+/***********************************************************************
+ * @name meas_engine_service()
+ * @brief Advances the engine; call from the main loop or a timer tick.
+ *        Performs at most one bus read per call and never delays.
+ * @return BME680_OK when a sample was delivered, BME680_W_MEAS_BUSY while
+ *         a conversion is pending, BME680_W_NO_NEW_DATA when idle
+ ***********************************************************************/
+int8_t meas_engine_service(struct meas_engine *eng)
+{
+	int8_t rslt;
+
+	switch (eng->state) {
+	case MEAS_IDLE:
+		return BME680_W_NO_NEW_DATA;
+
+	case MEAS_READING:
+		if (!eng->xfer_done)
+			return BME680_W_MEAS_BUSY;
+		eng->xfer_done = 0;
+		if (eng->xfer_rslt != 0)
+			rslt = BME680_E_COM_FAIL;
+		else
+			rslt = bme680_compensate_field(eng->field_buff, &eng->data, eng->dev);
+		return meas_engine_result(eng, rslt);
+
+	default:
+		break;
+	}
+
+	if (!tick_reached(eng->get_tick(), eng->deadline))
+		return BME680_W_MEAS_BUSY;
+
+	if (eng->dev->read_async != NULL) {
+		eng->state = MEAS_READING;
+		eng->xfer_done = 0;
+		rslt = bme680_start_field_read(eng->field_buff, meas_engine_xfer_cplt, eng, eng->dev);
+		if (rslt != BME680_OK) {
+			meas_engine_finish(eng, rslt);
+			return rslt;
+		}
+		return BME680_W_MEAS_BUSY;
+	}
+
+	eng->state = MEAS_POLLING;
+	rslt = bme680_poll_sensor_data(&eng->data, eng->dev);
+
+	return meas_engine_result(eng, rslt);
+}
+
+/***********************************************************************
+ * @name meas_engine_set_scan()
+ * @brief Enables heater profile scanning; each conversion then uses the
+ *        next step of dev->heatr_prof and on_scan receives every full pass
+ * @return void
+ ***********************************************************************/
+void meas_engine_set_scan(struct meas_engine *eng, meas_scan_fptr_t on_scan)
+{
+	eng->on_scan = on_scan;
+	eng->scan_step = 0;
+	memset(&eng->scan, 0, sizeof(eng->scan));
+}
+
+/***********************************************************************
+ * @name meas_engine_busy()
+ * @brief Reports whether a conversion is in flight
+ * @return 1 if busy, 0 if idle
+ ***********************************************************************/
+uint8_t meas_engine_busy(const struct meas_engine *eng)
+{
+	return eng->state != MEAS_IDLE;
+}
@@ -0,0 +1,240 @@
+/**
+  ******************************************************************************
+  * @file           : os_ctrl.c
+  * @brief          : Adaptive oversampling and IIR filter controller for the BME680
+  ******************************************************************************
+**/
+
+#include <math.h>
+#include <string.h>
+#include "os_ctrl.h"
+
+/* Level OS_CTRL_LEVELS - 1 matches the fixed settings main() used to apply */
+const struct os_ctrl_level os_ctrl_levels[OS_CTRL_LEVELS] = {
+	{ BME680_OS_1X, BME680_OS_1X, BME680_OS_1X, BME680_FILTER_SIZE_3 },
+	{ BME680_OS_2X, BME680_OS_1X, BME680_OS_1X, BME680_FILTER_SIZE_15 },
+	{ BME680_OS_4X, BME680_OS_2X, BME680_OS_1X, BME680_FILTER_SIZE_63 },
+	{ BME680_OS_8X, BME680_OS_4X, BME680_OS_2X, BME680_FILTER_SIZE_127 },
+};
+
+/* Defaults, roughly the datasheet RMS noise at 1X oversampling without filter */
+static const struct os_ctrl_limits os_ctrl_default_limits[OS_CTRL_CHANS] = {
+	{ 0.005f * BME680_TEMP_SCALE, 0.02f * BME680_TEMP_SCALE, 0.03f * BME680_TEMP_SCALE },	/* degC */
+	{ 1.5f * BME680_PRES_SCALE, 6.0f * BME680_PRES_SCALE, 8.0f * BME680_PRES_SCALE },		/* Pa */
+	{ 0.015f * BME680_HUM_SCALE, 0.06f * BME680_HUM_SCALE, 0.08f * BME680_HUM_SCALE },		/* %rH */
+};
+
+/***********************************************************************
+ * @name os_ctrl_init()
+ * @brief Resets the statistics and starts at the given level
+ * @return void
+ ***********************************************************************/
+void os_ctrl_init(struct os_ctrl *ctrl, uint8_t level)
+{
+	memset(ctrl, 0, sizeof(*ctrl));
+	memcpy(ctrl->limits, os_ctrl_default_limits, sizeof(ctrl->limits));
+	ctrl->level = (level < OS_CTRL_LEVELS) ? level : (OS_CTRL_LEVELS - 1);
+}
+
+/***********************************************************************
+ * @name os_ctrl_restart()
+ * @brief Drops the window after a settings change; samples taken with
+ *        different oversampling do not share a noise floor
+ * @return void
+ ***********************************************************************/
+static void os_ctrl_restart(struct os_ctrl *ctrl)
+{
+	ctrl->head = 0;
+	ctrl->fill = 0;
+	ctrl->stable = 0;
+}
+
+/***********************************************************************
+ * @name os_ctrl_update()
+ * @brief Adds a compensated sample and re-evaluates the level.
+ *        meas_dur is the bme680_get_profile_dur() of the sample.
+ * @return 1 when the settings changed and os_ctrl_apply() is due
+ ***********************************************************************/
+uint8_t os_ctrl_update(struct os_ctrl *ctrl, const struct bme680_field_data *data, uint32_t now, uint16_t meas_dur)
+{
+	float sample[OS_CTRL_CHANS];
+	uint8_t noisy = 0, quiet = 1, trend = 0;
+	uint8_t old_level = ctrl->level, old_trend = ctrl->trend;
+	uint8_t ch, i, idx, prev;
+
+	if (ctrl->samples++ == 0)
+		ctrl->t_first = now;
+	ctrl->t_last = now;
+	ctrl->busy_ms += meas_dur;
+
+	sample[OS_CTRL_TEMP] = data->temperature;
+	sample[OS_CTRL_PRES] = data->pressure;
+	sample[OS_CTRL_HUM] = data->humidity;
+
+	for (ch = 0; ch < OS_CTRL_CHANS; ch++)
+		ctrl->hist[ch][ctrl->head] = sample[ch];
+	ctrl->head = (ctrl->head + 1) % OS_CTRL_WINDOW;
+	if (ctrl->fill < OS_CTRL_WINDOW)
+		ctrl->fill++;
+
+	if (ctrl->fill < OS_CTRL_WINDOW)
+		return 0;
+
+	for (ch = 0; ch < OS_CTRL_CHANS; ch++)
+	{
+		float sum = 0.0f, sum2 = 0.0f, mean, var, d;
+
+		/* Oldest sample sits at head once the window is full */
+		prev = ctrl->head;
+		for (i = 1; i < OS_CTRL_WINDOW; i++)
+		{
+			idx = (ctrl->head + i) % OS_CTRL_WINDOW;
+			d = ctrl->hist[ch][idx] - ctrl->hist[ch][prev];
+			sum += d;
+			sum2 += d * d;
+			prev = idx;
+		}
+
+		mean = sum / (OS_CTRL_WINDOW - 1);
+		var = sum2 / (OS_CTRL_WINDOW - 1) - mean * mean;
+		if (var < 0.0f)
+			var = 0.0f;
+
+		/* Differences of independent samples carry twice the variance */
+		ctrl->noise[ch] = sqrtf(var * 0.5f);
+
+		if (fabsf(mean) > ctrl->limits[ch].trend)
+			trend = 1;
+		if (ctrl->noise[ch] > ctrl->limits[ch].noise_hi)
+			noisy = 1;
+		if (ctrl->noise[ch] >= ctrl->limits[ch].noise_lo)
+			quiet = 0;
+	}
+
+	ctrl->trend = trend;
+
+	if ((noisy || trend) && (ctrl->level < OS_CTRL_LEVELS - 1))
+	{
+		ctrl->level++;
+	}
+	else if (quiet && !trend)
+	{
+		if (++ctrl->stable >= OS_CTRL_HOLD && ctrl->level > 0)
+			ctrl->level--;
+	}
+	else
+	{
+		ctrl->stable = 0;
+	}
+
+	if (ctrl->level != old_level)
+		os_ctrl_restart(ctrl);
+
+	return (ctrl->level != old_level) || (ctrl->trend != old_trend);
+}
+
+/***********************************************************************
+ * @name os_ctrl_settings()
+ * @brief Fills tph with the oversampling and filter of the current level
+ * @return void
+ ***********************************************************************/
+void os_ctrl_settings(const struct os_ctrl *ctrl, struct bme680_tph_sett *tph)
+{
+	const struct os_ctrl_level *lvl = &os_ctrl_levels[ctrl->level];
+
+	tph->os_temp = lvl->os_temp;
+	tph->os_pres = lvl->os_pres;
+	tph->os_hum = lvl->os_hum;
+	tph->filter = lvl->filter;
+
+	/* A long IIR filter would hide the step the trend is reporting */
+	if (ctrl->trend && tph->filter > OS_CTRL_TREND_FILTER)
+		tph->filter = OS_CTRL_TREND_FILTER;
+}
+
+/***********************************************************************
+ * @name os_ctrl_apply()
+ * @brief Writes the current level through bme680_set_sensor_settings().
+ *        Only call it while no measurement is in flight.
+ * @return BME680_OK or the driver error code
+ ***********************************************************************/
+int8_t os_ctrl_apply(struct os_ctrl *ctrl, struct bme680_dev *dev)
+{
+	os_ctrl_settings(ctrl, &dev->tph_sett);
+	ctrl->changes++;
+
+	return bme680_set_sensor_settings(BME680_OST_SEL | BME680_OSP_SEL | BME680_OSH_SEL | BME680_FILTER_SEL, dev);
+}
+
+/***********************************************************************
+ * @name os_ctrl_rate()
+ * @brief Achieved sample rate since os_ctrl_init()
+ * @return samples per second, 0 before the second sample
+ ***********************************************************************/
+float os_ctrl_rate(const struct os_ctrl *ctrl)
+{
+	if (ctrl->samples < 2 || ctrl->t_last == ctrl->t_first)
+		return 0.0f;
+
+	return (ctrl->samples - 1) * 1000.0f / (ctrl->t_last - ctrl->t_first);
+}
+
+/***********************************************************************
+ * @name os_ctrl_duty()
+ * @brief Share of the elapsed time the sensor spent converting
+ * @return duty cycle in percent, 0 before the second sample
+ ***********************************************************************/
+float os_ctrl_duty(const struct os_ctrl *ctrl)
+{
+	if (ctrl->samples < 2 || ctrl->t_last == ctrl->t_first)
+		return 0.0f;
+
+	/* The last measurement finished at t_last, so it is not part of the span */
+	return (ctrl->busy_ms - ctrl->busy_ms / ctrl->samples) * 100.0f / (ctrl->t_last - ctrl->t_first);
+}
+
+/***********************************************************************
+ * @name os_ctrl_replay()
+ * @brief Runs a recorded trace through a fresh controller and compares
+ *        the measurement time against the top level. Uses the gas and
+ *        heater settings of dev; nothing is written to the sensor.
+ * @return void
+ ***********************************************************************/
+void os_ctrl_replay(const struct bme680_field_data *trace, uint32_t count, const struct bme680_dev *dev,
+		struct os_ctrl_replay_result *res)
+{
+	struct os_ctrl ctrl;
+	struct bme680_dev scratch = *dev;
+	uint16_t dur[OS_CTRL_LEVELS];
+	uint32_t at_level[OS_CTRL_LEVELS] = { 0 };
+	uint32_t i;
+	uint8_t lvl;
+
+	memset(res, 0, sizeof(*res));
+
+	for (lvl = 0; lvl < OS_CTRL_LEVELS; lvl++)
+	{
+		scratch.tph_sett.os_temp = os_ctrl_levels[lvl].os_temp;
+		scratch.tph_sett.os_pres = os_ctrl_levels[lvl].os_pres;
+		scratch.tph_sett.os_hum = os_ctrl_levels[lvl].os_hum;
+		bme680_get_profile_dur(&dur[lvl], &scratch);
+	}
+
+	os_ctrl_init(&ctrl, OS_CTRL_LEVELS - 1);
+
+	for (i = 0; i < count; i++)
+	{
+		lvl = ctrl.level;
+		at_level[lvl]++;
+		res->busy_ms_fixed += dur[OS_CTRL_LEVELS - 1];
+		res->busy_ms_adaptive += dur[lvl];
+
+		if (os_ctrl_update(&ctrl, &trace[i], i, dur[lvl]))
+			ctrl.changes++;
+	}
+
+	res->samples = count;
+	res->changes = ctrl.changes;
+	for (lvl = 0; count && lvl < OS_CTRL_LEVELS; lvl++)
+		res->level_hist[lvl] = (uint8_t)((at_level[lvl] * 100U) / count);
+}
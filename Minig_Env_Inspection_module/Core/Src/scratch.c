@@ -0,0 +1,57 @@
+/**
+  ******************************************************************************
+  * @file           : scratch.c
+  * @brief          : Statically sized scratch arenas in place of the heap
+  ******************************************************************************
+**/
+
+#include <stddef.h>
+#include "scratch.h"
+
+SCRATCH_ARENA(scratch_fmt, SCRATCH_FMT_SIZE);
+
+/***********************************************************************
+ * @name scratch_take()
+ * @brief Hands out len bytes, word aligned, until the next release to a
+ *        mark taken before this call
+ * @return the buffer, or NULL if the arena cannot hold len more bytes
+ ***********************************************************************/
+void *scratch_take(struct scratch *arena, uint16_t len)
+{
+	uint16_t size = (len + 3) & ~3U;
+	uint8_t *buf;
+
+	if (size > arena->size - arena->used)
+	{
+		arena->fails++;
+		return NULL;
+	}
+
+	buf = arena->base + arena->used;
+	arena->used += size;
+	if (arena->used > arena->peak)
+		arena->peak = arena->used;
+
+	return buf;
+}
+
+/***********************************************************************
+ * @name scratch_mark()
+ * @brief Current fill of the arena, for scratch_release()
+ * @return mark
+ ***********************************************************************/
+uint16_t scratch_mark(const struct scratch *arena)
+{
+	return arena->used;
+}
+
+/***********************************************************************
+ * @name scratch_release()
+ * @brief Gives back everything taken since mark
+ * @return void
+ ***********************************************************************/
+void scratch_release(struct scratch *arena, uint16_t mark)
+{
+	if (mark < arena->used)
+		arena->used = mark;
+}
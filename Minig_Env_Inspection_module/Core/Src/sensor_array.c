@@ -0,0 +1,188 @@
+/**
+  ******************************************************************************
+  * @file           : sensor_array.c
+  * @brief          : Scheduler for several BME680s across I2C buses and addresses
+  ******************************************************************************
+**/
+
+#include <string.h>
+#include "sensor_array.h"
+
+/***********************************************************************
+ * @name tick_reached()
+ * @brief Wrap-safe comparison of the current tick against a deadline
+ * @return true once now is at or past the deadline
+ ***********************************************************************/
+static uint8_t tick_reached(uint32_t now, uint32_t deadline)
+{
+	return (int32_t)(now - deadline) >= 0;
+}
+
+/***********************************************************************
+ * @name sensor_array_fail()
+ * @brief Books a failed trigger or sample against the node's health
+ * @return void
+ ***********************************************************************/
+static void sensor_array_fail(struct sensor_node *node, int8_t rslt)
+{
+	node->health.errors++;
+	node->health.last_rslt = rslt;
+	if (node->health.fails < UINT8_MAX)
+		node->health.fails++;
+	if (node->health.fails >= SENSOR_ARRAY_MAX_FAILS)
+		node->health.offline = 1;
+}
+
+/***********************************************************************
+ * @name sensor_array_ready()
+ * @brief Measurement engine callback of every node
+ * @return void
+ ***********************************************************************/
+static void sensor_array_ready(int8_t rslt, const struct bme680_field_data *data, void *ctx)
+{
+	struct sensor_node *node = ctx;
+	struct sensor_array *arr = node->arr;
+
+	if (rslt == BME680_OK) {
+		node->health.samples++;
+		node->health.last_rslt = rslt;
+		node->health.fails = 0;
+		node->health.offline = 0;
+	} else {
+		sensor_array_fail(node, rslt);
+	}
+
+	if (arr->on_sample != NULL)
+		arr->on_sample(node->idx, rslt, data, arr->ctx);
+}
+
+/***********************************************************************
+ * @name sensor_array_init()
+ * @brief Sets up an empty array. period is the per-sensor sample period
+ *        in ms; 0 runs every sensor back-to-back at its profile duration.
+ * @return void
+ ***********************************************************************/
+void sensor_array_init(struct sensor_array *arr, meas_tick_fptr_t get_tick, sensor_bus_busy_fptr_t bus_busy,
+		uint32_t period, sensor_sample_fptr_t on_sample, void *ctx)
+{
+	memset(arr, 0, sizeof(*arr));
+	arr->get_tick = get_tick;
+	arr->bus_busy = bus_busy;
+	arr->period = period;
+	arr->on_sample = on_sample;
+	arr->ctx = ctx;
+}
+
+/***********************************************************************
+ * @name sensor_array_add()
+ * @brief Copies an initialised and configured sensor into the array
+ * @return node index, or -1 if the array is full
+ ***********************************************************************/
+int8_t sensor_array_add(struct sensor_array *arr, const struct bme680_dev *dev)
+{
+	struct sensor_node *node;
+
+	if (arr->count >= SENSOR_ARRAY_MAX)
+		return -1;
+
+	node = &arr->node[arr->count];
+	memset(node, 0, sizeof(*node));
+	node->dev = *dev;
+	node->idx = arr->count;
+	node->arr = arr;
+	meas_engine_init(&node->eng, &node->dev, arr->get_tick, sensor_array_ready, node);
+
+	return (int8_t)arr->count++;
+}
+
+/***********************************************************************
+ * @name sensor_array_min_period()
+ * @brief Shortest sample period every node can sustain: the longest
+ *        profile duration plus one data-ready poll
+ * @return period in ms
+ ***********************************************************************/
+uint32_t sensor_array_min_period(const struct sensor_array *arr)
+{
+	uint32_t longest = 0;
+	uint16_t dur;
+	uint8_t i;
+
+	for (i = 0; i < arr->count; i++) {
+		bme680_get_profile_dur(&dur, &arr->node[i].dev);
+		if (dur > longest)
+			longest = dur;
+	}
+
+	return longest + BME680_POLL_PERIOD_MS;
+}
+
+/***********************************************************************
+ * @name sensor_array_start()
+ * @brief Spreads the first triggers evenly over one sample period
+ * @return void
+ ***********************************************************************/
+void sensor_array_start(struct sensor_array *arr)
+{
+	uint32_t now = arr->get_tick();
+	uint32_t min_period = sensor_array_min_period(arr);
+	uint8_t i;
+
+	if (arr->period < min_period)
+		arr->period = min_period;
+
+	for (i = 0; i < arr->count; i++) {
+		arr->node[i].next_trigger = now + (arr->period * i) / arr->count;
+		arr->node[i].retry_at = arr->node[i].next_trigger;
+	}
+}
+
+/***********************************************************************
+ * @name sensor_array_service()
+ * @brief Triggers due nodes and advances every engine. A node is skipped
+ *        while another transfer owns its bus, so field reads on one bus
+ *        never collide. Call from the main loop; never blocks.
+ * @return void
+ ***********************************************************************/
+void sensor_array_service(struct sensor_array *arr)
+{
+	struct sensor_node *node;
+	uint32_t now;
+	int8_t rslt;
+	uint8_t i;
+
+	for (i = 0; i < arr->count; i++) {
+		node = &arr->node[i];
+		now = arr->get_tick();
+
+		if ((node->eng.state != MEAS_READING) && (arr->bus_busy != NULL) && arr->bus_busy(node->dev.dev_id)) {
+			if (tick_reached(now, meas_engine_busy(&node->eng) ? node->eng.deadline : node->next_trigger))
+				node->health.deferred++;
+			continue;
+		}
+
+		if (!meas_engine_busy(&node->eng)) {
+			if (!tick_reached(now, node->next_trigger) || !tick_reached(now, node->retry_at))
+				continue;
+
+			/* A sensor still converting after a data-ready timeout refuses the
+			 * trigger; keep the slot and try again after one poll period */
+			rslt = meas_engine_start(&node->eng);
+			if (rslt == BME680_W_MEAS_BUSY) {
+				node->health.refused++;
+				node->retry_at = now + BME680_POLL_PERIOD_MS;
+				continue;
+			}
+			if (rslt < 0)
+				sensor_array_fail(node, rslt);
+
+			node->next_trigger += arr->period * (node->health.offline ? SENSOR_ARRAY_BACKOFF : 1);
+			/* Fell more than a period behind: restart the slot from now */
+			if (tick_reached(now, node->next_trigger))
+				node->next_trigger = now + arr->period;
+			node->retry_at = node->next_trigger;
+			continue;
+		}
+
+		meas_engine_service(&node->eng);
+	}
+}
@@ -0,0 +1,181 @@
+/**
+  ******************************************************************************
+  * @file           : spi_transport.c
+  * @brief          : Register transport for a BME680 on SPI2
+  ******************************************************************************
+**/
+
+#include "main.h"
+#include "spi_transport.h"
+
+/* SPI2 clock: PCLK1 / 4 */
+#define SPI_TRANSPORT_BR	SPI_CR1_BR_0
+
+struct spi_xfer_stats spi_stats;
+
+/* Chip-select line per dev_id */
+static const struct {
+	GPIO_TypeDef *port;
+	uint16_t pin;
+} spi_cs[SPI_TRANSPORT_CS_MAX] = {
+	{ GPIOB, GPIO_PIN_12 }
+};
+
+/***********************************************************************
+ * @name spi_transport_init()
+ * @brief Clocks SPI2 and its pins and enables it as mode 0, 8 bit, MSB
+ *        first master with software slave management. CSB idles high.
+ * @return void
+ ***********************************************************************/
+void spi_transport_init(void)
+{
+	GPIO_InitTypeDef GPIO_InitStruct = { 0 };
+	uint8_t i;
+
+	__HAL_RCC_GPIOB_CLK_ENABLE();
+	__HAL_RCC_SPI2_CLK_ENABLE();
+
+	for (i = 0; i < SPI_TRANSPORT_CS_MAX; i++)
+	{
+		HAL_GPIO_WritePin(spi_cs[i].port, spi_cs[i].pin, GPIO_PIN_SET);
+		GPIO_InitStruct.Pin = spi_cs[i].pin;
+		GPIO_InitStruct.Mode = GPIO_MODE_OUTPUT_PP;
+		GPIO_InitStruct.Pull = GPIO_NOPULL;
+		GPIO_InitStruct.Speed = GPIO_SPEED_FREQ_HIGH;
+		HAL_GPIO_Init(spi_cs[i].port, &GPIO_InitStruct);
+	}
+
+	GPIO_InitStruct.Pin = GPIO_PIN_13 | GPIO_PIN_14 | GPIO_PIN_15;
+	GPIO_InitStruct.Mode = GPIO_MODE_AF_PP;
+	GPIO_InitStruct.Pull = GPIO_NOPULL;
+	GPIO_InitStruct.Speed = GPIO_SPEED_FREQ_VERY_HIGH;
+	GPIO_InitStruct.Alternate = GPIO_AF5_SPI2;
+	HAL_GPIO_Init(GPIOB, &GPIO_InitStruct);
+
+	SPI2->CR1 = SPI_CR1_MSTR | SPI_CR1_SSM | SPI_CR1_SSI | SPI_TRANSPORT_BR;
+	SPI2->CR1 |= SPI_CR1_SPE;
+}
+
+/***********************************************************************
+ * @name spi_wait()
+ * @brief Spins until the SR bits in mask reach the wanted state
+ * @return 0, or -1 after SPI_SPIN_LIMIT polls
+ ***********************************************************************/
+static int8_t spi_wait(uint32_t mask, uint32_t state)
+{
+	uint32_t spin;
+
+	for (spin = 0; (SPI2->SR & mask) != state; spin++)
+	{
+		if (spin >= SPI_SPIN_LIMIT)
+			return -1;
+	}
+
+	return 0;
+}
+
+/***********************************************************************
+ * @name spi_xfer()
+ * @brief Clocks len bytes full duplex; tx NULL sends 0xFF, rx NULL drops
+ *        what comes back. The next byte is queued while the current one
+ *        shifts, so the clock runs without gaps.
+ * @return 0 on success, -1 on timeout
+ ***********************************************************************/
+static int8_t spi_xfer(const uint8_t *tx, uint8_t *rx, uint16_t len)
+{
+	uint16_t i;
+	uint8_t byte;
+
+	if (len == 0)
+		return 0;
+
+	if (spi_wait(SPI_SR_TXE, SPI_SR_TXE) != 0)
+		return -1;
+	*(volatile uint8_t *)&SPI2->DR = (tx != NULL) ? tx[0] : 0xFF;
+
+	for (i = 0; i < len; i++)
+	{
+		if (i + 1 < len)
+		{
+			if (spi_wait(SPI_SR_TXE, SPI_SR_TXE) != 0)
+				return -1;
+			*(volatile uint8_t *)&SPI2->DR = (tx != NULL) ? tx[i + 1] : 0xFF;
+		}
+		if (spi_wait(SPI_SR_RXNE, SPI_SR_RXNE) != 0)
+			return -1;
+		byte = *(volatile uint8_t *)&SPI2->DR;
+		if (rx != NULL)
+			rx[i] = byte;
+	}
+
+	/* CSB may only rise once the last bit is out */
+	return spi_wait(SPI_SR_BSY, 0);
+}
+
+/***********************************************************************
+ * @name spi_frame()
+ * @brief One chip-select frame: the address byte, then len bytes of
+ *        reg_data written (write) or read into reg_data (read)
+ * @return 0 on success, -1 on error
+ ***********************************************************************/
+static int8_t spi_frame(uint8_t dev_id, uint8_t reg_addr, uint8_t *reg_data, uint16_t len, uint8_t write)
+{
+	int8_t result;
+
+	if (dev_id >= SPI_TRANSPORT_CS_MAX)
+	{
+		spi_stats.errors++;
+		return -1;
+	}
+
+	HAL_GPIO_WritePin(spi_cs[dev_id].port, spi_cs[dev_id].pin, GPIO_PIN_RESET);
+	result = spi_xfer(&reg_addr, NULL, 1);
+	if (result == 0)
+		result = write ? spi_xfer(reg_data, NULL, len) : spi_xfer(NULL, reg_data, len);
+	HAL_GPIO_WritePin(spi_cs[dev_id].port, spi_cs[dev_id].pin, GPIO_PIN_SET);
+
+	spi_stats.xfers++;
+	spi_stats.bytes += len + 1;
+	if (result != 0)
+		spi_stats.errors++;
+
+	return result;
+}
+
+/***********************************************************************
+ * @name user_spi_read()
+ * @brief bme680_com_fptr_t read; reg_addr already carries the read bit
+ * @return 0 on success, -1 on error
+ ***********************************************************************/
+int8_t user_spi_read(uint8_t dev_id, uint8_t reg_addr, uint8_t *reg_data, uint16_t len)
+{
+	return spi_frame(dev_id, reg_addr, reg_data, len, 0);
+}
+
+/***********************************************************************
+ * @name user_spi_write()
+ * @brief bme680_com_fptr_t write; the address/value pairs of a
+ *        bme680_set_regs() batch go out in the same frame
+ * @return 0 on success, -1 on error
+ ***********************************************************************/
+int8_t user_spi_write(uint8_t dev_id, uint8_t reg_addr, uint8_t *reg_data, uint16_t len)
+{
+	return spi_frame(dev_id, reg_addr, reg_data, len, 1);
+}
+
+/***********************************************************************
+ * @name user_spi_read_async()
+ * @brief bme680_com_async_fptr_t read; the transfer is short enough to
+ *        finish in place, so cplt runs before this returns
+ * @return 0 once cplt has been called, -1 on error
+ ***********************************************************************/
+int8_t user_spi_read_async(uint8_t dev_id, uint8_t reg_addr, uint8_t *reg_data, uint16_t len,
+		bme680_com_cplt_fptr_t cplt, void *ctx)
+{
+	int8_t result = spi_frame(dev_id, reg_addr, reg_data, len, 0);
+
+	if (result == 0)
+		cplt(0, ctx);
+
+	return result;
+}
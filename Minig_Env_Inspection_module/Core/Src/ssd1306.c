@@ -21,6 +21,8 @@
  ----------------------------------------------------------------------
  */
 #include "ssd1306.h"
+#include "i2c_transport.h"
+#include "i2c_sched.h"
 
 extern I2C_HandleTypeDef hi2c1;
 /* Write command */
@@ -44,6 +46,27 @@ typedef struct {
 /* Private variable */
 static SSD1306_t SSD1306;
 
+/* Data bytes per queued write of SSD1306_UpdateScreenAsync(); one page
+ * command write and SSD1306_WIDTH / SSD1306_CHUNK data writes per page */
+#define SSD1306_CHUNK            32
+#define SSD1306_PAGE_STEPS       (1 + SSD1306_WIDTH / SSD1306_CHUNK)
+#define SSD1306_FRAME_STEPS      (SSD1306_PAGE_STEPS * SSD1306_HEIGHT / 8)
+
+/* Copy of the buffer being pushed, so drawing can go on meanwhile */
+static uint8_t SSD1306_Frame[sizeof(SSD1306_Buffer)];
+
+/* Frame push state; the completions run in interrupt context and only
+ * clear Busy, the buffer is copied from thread context */
+typedef struct {
+	volatile uint8_t Busy;
+	volatile uint8_t Dirty;
+	uint8_t Class;
+	uint8_t Step;
+	uint8_t Command[3];
+} SSD1306_Push_t;
+
+static SSD1306_Push_t SSD1306_Push;
+
 #define SSD1306_RIGHT_HORIZONTAL_SCROLL              0x26
 #define SSD1306_LEFT_HORIZONTAL_SCROLL               0x27
 #define SSD1306_VERTICAL_AND_RIGHT_HORIZONTAL_SCROLL 0x29
@@ -55,6 +78,39 @@ static SSD1306_t SSD1306;
 #define SSD1306_NORMALDISPLAY       0xA6
 #define SSD1306_INVERTDISPLAY       0xA7
 
+/* Power-up command sequence */
+static const uint8_t SSD1306_InitCommands[] = {
+	0xAE, //display off
+	0x20, //Set Memory Addressing Mode
+	0x10, //00,Horizontal Addressing Mode;01,Vertical Addressing Mode;10,Page Addressing Mode (RESET);11,Invalid
+	0xB0, //Set Page Start Address for Page Addressing Mode,0-7
+	0xC8, //Set COM Output Scan Direction
+	0x00, //---set low column address
+	0x10, //---set high column address
+	0x40, //--set start line address
+	0x81, //--set contrast control register
+	0xFF,
+	0xA1, //--set segment re-map 0 to 127
+	0xA6, //--set normal display
+	0xA8, //--set multiplex ratio(1 to 64)
+	0x3F, //
+	0xA4, //0xa4,Output follows RAM content;0xa5,Output ignores RAM content
+	0xD3, //-set display offset
+	0x00, //-not offset
+	0xD5, //--set display clock divide ratio/oscillator frequency
+	0xF0, //--set divide ratio
+	0xD9, //--set pre-charge period
+	0x22, //
+	0xDA, //--set com pins hardware configuration
+	0x12,
+	0xDB, //--set vcomh
+	0x20, //0x20,0.77xVcc
+	0x8D, //--set DC-DC enable
+	0x14, //
+	0xAF, //--turn on SSD1306 panel
+	SSD1306_DEACTIVATE_SCROLL
+};
+
 void SSD1306_ScrollRight(uint8_t start_row, uint8_t end_row) {
 	SSD1306_WRITECOMMAND(SSD1306_RIGHT_HORIZONTAL_SCROLL);  // send 0x26
 	SSD1306_WRITECOMMAND(0x00);  // send dummy
@@ -139,12 +195,13 @@ void SSD1306_DrawBitmap(int16_t x, int16_t y, const unsigned char *bitmap,
 }
 
 uint8_t SSD1306_Init(void) {
+	uint8_t i;
 
 	/* Init I2C */
 	ssd1306_I2C_Init();
 
 	/* Check if LCD connected to I2C */
-	if (HAL_I2C_IsDeviceReady(&hi2c1, SSD1306_I2C_ADDR, 1, 20000) != HAL_OK) {
+	if (HAL_I2C_IsDeviceReady(&hi2c1, SSD1306_I2C_ADDR, 1, I2C_TIMEOUT_BASE_MS) != HAL_OK) {
 		/* Return false */
 		return 0;
 	}
@@ -154,43 +211,18 @@ uint8_t SSD1306_Init(void) {
 	while (p > 0)
 		p--;
 
-	/* Init LCD */
-	SSD1306_WRITECOMMAND(0xAE); //display off
-	SSD1306_WRITECOMMAND(0x20); //Set Memory Addressing Mode   
-	SSD1306_WRITECOMMAND(0x10); //00,Horizontal Addressing Mode;01,Vertical Addressing Mode;10,Page Addressing Mode (RESET);11,Invalid
-	SSD1306_WRITECOMMAND(0xB0); //Set Page Start Address for Page Addressing Mode,0-7
-	SSD1306_WRITECOMMAND(0xC8); //Set COM Output Scan Direction
-	SSD1306_WRITECOMMAND(0x00); //---set low column address
-	SSD1306_WRITECOMMAND(0x10); //---set high column address
-	SSD1306_WRITECOMMAND(0x40); //--set start line address
-	SSD1306_WRITECOMMAND(0x81); //--set contrast control register
-	SSD1306_WRITECOMMAND(0xFF);
-	SSD1306_WRITECOMMAND(0xA1); //--set segment re-map 0 to 127
-	SSD1306_WRITECOMMAND(0xA6); //--set normal display
-	SSD1306_WRITECOMMAND(0xA8); //--set multiplex ratio(1 to 64)
-	SSD1306_WRITECOMMAND(0x3F); //
-	SSD1306_WRITECOMMAND(0xA4); //0xa4,Output follows RAM content;0xa5,Output ignores RAM content
-	SSD1306_WRITECOMMAND(0xD3); //-set display offset
-	SSD1306_WRITECOMMAND(0x00); //-not offset
-	SSD1306_WRITECOMMAND(0xD5); //--set display clock divide ratio/oscillator frequency
-	SSD1306_WRITECOMMAND(0xF0); //--set divide ratio
-	SSD1306_WRITECOMMAND(0xD9); //--set pre-charge period
-	SSD1306_WRITECOMMAND(0x22); //
-	SSD1306_WRITECOMMAND(0xDA); //--set com pins hardware configuration
-	SSD1306_WRITECOMMAND(0x12);
-	SSD1306_WRITECOMMAND(0xDB); //--set vcomh
-	SSD1306_WRITECOMMAND(0x20); //0x20,0.77xVcc
-	SSD1306_WRITECOMMAND(0x8D); //--set DC-DC enable
-	SSD1306_WRITECOMMAND(0x14); //
-	SSD1306_WRITECOMMAND(0xAF); //--turn on SSD1306 panel
-
-	SSD1306_WRITECOMMAND(SSD1306_DEACTIVATE_SCROLL);
+	/* Init LCD, giving up on the first write that fails */
+	for (i = 0; i < sizeof(SSD1306_InitCommands); i++) {
+		if (SSD1306_WRITECOMMAND(SSD1306_InitCommands[i]) != 0)
+			return 0;
+	}
 
 	/* Clear screen */
 	SSD1306_Fill(SSD1306_COLOR_BLACK);
 
 	/* Update screen */
-	SSD1306_UpdateScreen();
+	if (!SSD1306_UpdateScreen())
+		return 0;
 
 	/* Set default values */
 	SSD1306.CurrentX = 0;
@@ -203,18 +235,100 @@ uint8_t SSD1306_Init(void) {
 	return 1;
 }
 
-void SSD1306_UpdateScreen(void) {
+uint8_t SSD1306_UpdateScreen(void) {
 	uint8_t m;
 
 	for (m = 0; m < 8; m++) {
-		SSD1306_WRITECOMMAND(0xB0 + m);
-		SSD1306_WRITECOMMAND(0x00);
-		SSD1306_WRITECOMMAND(0x10);
+		/* Each write is bounded by the transport; a failing LCD costs one timeout per frame */
+		if (SSD1306_WRITECOMMAND(0xB0 + m) != 0 || SSD1306_WRITECOMMAND(0x00) != 0
+				|| SSD1306_WRITECOMMAND(0x10) != 0)
+			return 0;
 
 		/* Write multi data */
-		ssd1306_I2C_WriteMulti(SSD1306_I2C_ADDR, 0x40,
-				&SSD1306_Buffer[SSD1306_WIDTH * m], SSD1306_WIDTH);
+		if (ssd1306_I2C_WriteMulti(SSD1306_I2C_ADDR, 0x40,
+				&SSD1306_Buffer[SSD1306_WIDTH * m], SSD1306_WIDTH) != 0)
+			return 0;
+	}
+
+	return 1;
+}
+
+static void SSD1306_PushCplt(int8_t rslt, void *ctx);
+
+/* Queues the write for the current step of the frame push */
+static int8_t SSD1306_PushStep(void) {
+	uint8_t page = SSD1306_Push.Step / SSD1306_PAGE_STEPS;
+	uint8_t chunk = SSD1306_Push.Step % SSD1306_PAGE_STEPS;
+
+	if (chunk == 0) {
+		/* Page address and column 0 in one command write */
+		SSD1306_Push.Command[0] = 0xB0 + page;
+		SSD1306_Push.Command[1] = 0x00;
+		SSD1306_Push.Command[2] = 0x10;
+		return i2c_sched_submit(SSD1306_Push.Class, SSD1306_I2C_ADDR >> 1, 0x00,
+				SSD1306_Push.Command, sizeof(SSD1306_Push.Command), 1, SSD1306_PushCplt, NULL);
+	}
+
+	return i2c_sched_submit(SSD1306_Push.Class, SSD1306_I2C_ADDR >> 1, 0x40,
+			&SSD1306_Frame[SSD1306_WIDTH * page + SSD1306_CHUNK * (chunk - 1)], SSD1306_CHUNK, 1,
+			SSD1306_PushCplt, NULL);
+}
+
+/* Snapshots the buffer and queues the first write of a frame; thread
+ * context only, with Busy already set */
+static void SSD1306_PushStart(void) {
+	memcpy(SSD1306_Frame, SSD1306_Buffer, sizeof(SSD1306_Frame));
+	SSD1306_Push.Dirty = 0;
+	SSD1306_Push.Step = 0;
+	if (SSD1306_PushStep() != 0)
+		SSD1306_Push.Busy = 0;
+}
+
+/* Completion of one write: queues the next one, or the next frame */
+static void SSD1306_PushCplt(int8_t rslt, void *ctx) {
+	(void)ctx;
+
+	/* A failed write abandons the frame; the next one resends it whole */
+	if (rslt == 0 && ++SSD1306_Push.Step < SSD1306_FRAME_STEPS) {
+		if (SSD1306_PushStep() != 0)
+			SSD1306_Push.Busy = 0;
+		return;
+	}
+
+	/* A frame left pending is started by SSD1306_Service() */
+	SSD1306_Push.Busy = 0;
+}
+
+uint8_t SSD1306_UpdateScreenAsync(uint8_t cls) {
+	uint32_t primask = __get_PRIMASK();
+
+	__disable_irq();
+	SSD1306_Push.Class = cls;
+	if (SSD1306_Push.Busy) {
+		/* Picked up once the frame on its way finishes */
+		SSD1306_Push.Dirty = 1;
+		__set_PRIMASK(primask);
+		return 1;
+	}
+	SSD1306_Push.Busy = 1;
+	__set_PRIMASK(primask);
+
+	SSD1306_PushStart();
+	return SSD1306_Push.Busy;
+}
+
+void SSD1306_Service(void) {
+	uint32_t primask = __get_PRIMASK();
+
+	__disable_irq();
+	if (!SSD1306_Push.Dirty || SSD1306_Push.Busy) {
+		__set_PRIMASK(primask);
+		return;
 	}
+	SSD1306_Push.Busy = 1;
+	__set_PRIMASK(primask);
+
+	SSD1306_PushStart();
 }
 
 void SSD1306_ToggleInvert(void) {
@@ -611,19 +725,12 @@ void ssd1306_I2C_Init() {
 	//MX_I2C1_Init();
 }
 
-void ssd1306_I2C_WriteMulti(uint8_t address, uint8_t reg, uint8_t *data,
+/* The control byte goes out as the memory address, so data needs no bounce buffer */
+int8_t ssd1306_I2C_WriteMulti(uint8_t address, uint8_t reg, uint8_t *data,
 		uint16_t count) {
-	uint8_t dt[256];
-	dt[0] = reg;
-	uint8_t i;
-	for (i = 0; i < count; i++)
-		dt[i + 1] = data[i];
-	HAL_I2C_Master_Transmit(&hi2c1, address, dt, count + 1, 10);
+	return user_i2c_write(address >> 1, reg, data, count);
 }
 
-void ssd1306_I2C_Write(uint8_t address, uint8_t reg, uint8_t data) {
-	uint8_t dt[2];
-	dt[0] = reg;
-	dt[1] = data;
-	HAL_I2C_Master_Transmit(&hi2c1, address, dt, 2, 10);
+int8_t ssd1306_I2C_Write(uint8_t address, uint8_t reg, uint8_t data) {
+	return user_i2c_write(address >> 1, reg, &data, 1);
 }
@@ -27,37 +27,53 @@
 //          MACRO DEFINITIONS
 /* -------------------------------------------------- */
 
+/* Thresholds are written in the finest integer unit and converted to
+ * bme680_field_data units, so the integer build never touches float */
+#define SM_TEMP(centi_degc)	((centi_degc) * BME680_TEMP_SCALE / 100)
+#define SM_PRES(pa)			((pa) * BME680_PRES_SCALE)
+#define SM_HUM(milli_rh)	((milli_rh) * BME680_HUM_SCALE / 1000)
+#define SM_GAS(ohm)			((ohm) * BME680_GAS_SCALE)
+
 /* Macros for Temperature Calibration Threshold */
 
-#define TempHiModerate 25.00 		//High Temperature threshold value for moderate state
-#define TempHiDanger 26.00			//High Temperature threshold value for danger state
-#define TempLoModerate 23.00		//For hysteresis, delta change from high temperature i.e. (hightemp - delta)
-#define TempLoDanger 23.00			//For hysteresis, delta change from high temperature i.e. (hightemp - delta)
+#define TempHiModerate SM_TEMP(2500) 	//High Temperature threshold value for moderate state, 25.00 degC
+#define TempHiDanger SM_TEMP(2600)		//High Temperature threshold value for danger state, 26.00 degC
+#define TempLoModerate SM_TEMP(2300)	//For hysteresis, delta change from high temperature i.e. (hightemp - delta)
+#define TempLoDanger SM_TEMP(2300)		//For hysteresis, delta change from high temperature i.e. (hightemp - delta)
 #define TempCtrThd 2				//Accuracy, confirming the state for the counter time to avoid sudden spikes and glitches
 
 /* Macros for Pressure Calibration Threshold */
 
-#define PresHiModerate 834.0		//High Pressure threshold value for moderate state
-#define PresHiDanger 835.0			//High Pressure threshold value for danger state
-#define PresLoModerate 830.00		//For hysteresis, delta change from high pressure i.e. (hightPress - delta)
-#define PresLoDanger 833.60			//For hysteresis, delta change from high pressure i.e. (highPress - delta)
+#define PresHiModerate SM_PRES(83400)	//High Pressure threshold value for moderate state, 834.00 hPa
+#define PresHiDanger SM_PRES(83500)		//High Pressure threshold value for danger state, 835.00 hPa
+#define PresLoModerate SM_PRES(83000)	//For hysteresis, delta change from high pressure i.e. (hightPress - delta)
+#define PresLoDanger SM_PRES(83360)		//For hysteresis, delta change from high pressure i.e. (highPress - delta)
 #define PresCtrThd 2				//Accuracy, confirming the state for the counter time to avoid sudden spikes and glitches
 
 /* Macros for Humidity Calibration Threshold */
 
-#define HumHiModerate 28.0
-#define HumHiDanger 30.0
-#define HumLoModerate 27.0
-#define HumLoDanger 26.0
+#define HumHiModerate SM_HUM(28000)
+#define HumHiDanger SM_HUM(30000)
+#define HumLoModerate SM_HUM(27000)
+#define HumLoDanger SM_HUM(26000)
 #define HumCtrThd 1
 
-/* Macros for Gas Calibration Threshold */
-#define GasHiModerate 14.0
-#define GasHiDanger 15.0
-#define GasLoModerate 13.5
-#define GasLoDanger 14.5
+/* Macros for Gas Calibration Threshold, on the air_quality.c index: 100 is
+ * about 71 % of the baseline resistance, 200 half of it */
+#define GasHiModerate 100
+#define GasHiDanger 200
+#define GasLoModerate 80
+#define GasLoDanger 180
 #define GasCtrThd 2
 
+/* Macros for Condensation Threshold, on the dew point minus the temperature
+ * (derived.c): 0 means condensation */
+#define DewHiModerate SM_TEMP(-300)	//Within 3 degC of the dew point
+#define DewHiDanger SM_TEMP(-100)		//Within 1 degC of the dew point
+#define DewLoModerate SM_TEMP(-400)
+#define DewLoDanger SM_TEMP(-200)
+#define DewCtrThd 2
+
 #define FinalCounterCtrThd 1
 
 /* -------------------------------------------------- */
@@ -66,46 +82,56 @@
 
 
 /* Variables to store the actual sensor values */
-float Temperature_Actual;
-float Pressure_Actual;
-float Humidity_Actual;
-float Gas_Actual;
+sm_value_t Temperature_Actual;
+sm_value_t Pressure_Actual;
+sm_value_t Humidity_Actual;
+sm_value_t Gas_Actual;
+sm_value_t Dew_Actual;
+
+/* Gas baseline and index of the sensor fed to the state machine */
+struct aq_engine air_quality = AQ_ENGINE_INIT;
 
 /* Variables to store the state: Safe(0), moderate(1), dangerous(2) based on the threshold */
 uint8_t TempState=0;
 uint8_t PresState=0;
 uint8_t GasState=0;
 uint8_t HumState=0;
+uint8_t DewState=0;
 
 /* Variables to store the previous values of the hysteresis o/p in the moderate state */
 bool TempModerate_Old=0;
 bool PresModerate_Old=0;
 bool HumModerate_Old=0;
 bool GasModerate_Old=0;
+bool DewModerate_Old=0;
 
 /* Variables to store the previous values of the hysteresis o/p in the danger state */
 bool TempDanger_Old=0;
 bool PresDanger_Old=0;
 bool HumDanger_Old=0;
 bool GasDanger_Old=0;
+bool DewDanger_Old=0;
 
 /* Variables to store final state */
 uint8_t TempState_Confirmed=0;
 uint8_t PresState_Confirmed=0;
 uint8_t HumState_Confirmed=0;
 uint8_t GasState_Confirmed=0;
+uint8_t DewState_Confirmed=0;
 
 /* Variables to store counter to check state stability in order to decide confirmed_state*/
 uint8_t TempCounter=0;
 uint8_t PresCounter=0;
 uint8_t HumCounter=0;
 uint8_t GasCounter=0;
+uint8_t DewCounter=0;
 
 /* Variables to store the old values of the state */
 uint8_t TempState_Old=0;
 uint8_t PresState_Old=0;
 uint8_t HumState_Old=0;
 uint8_t GasState_Old=0;
+uint8_t DewState_Old=0;
 
 /* Final state variables considering all the sensor values */
 uint8_t FinalCounter=0;
@@ -122,7 +148,7 @@ uint8_t FinalState=0;
  * @brief Calculates the hysteresis based on threshold values to avoid the fluctuations around the threshold values
  * @return boolean value 0 or 1 based on a high or low temp.
  ***********************************************************************/
-bool Hyst(float Hy,float Hy_L,float Hy_H,bool Hy_Out_Old)
+bool Hyst(sm_value_t Hy,sm_value_t Hy_L,sm_value_t Hy_H,bool Hy_Out_Old)
 {
 	bool Hy_Out=0;
 	if(Hy_L>Hy)
@@ -269,24 +295,58 @@ void Gas()
 }
 
 
+/***********************************************************************
+ * @name Dew()
+ * @brief Finalizes the condensation state
+ * @return void
+ ***********************************************************************/
+void Dew()
+{
+	bool DewModerate,DewDanger;
+	DewModerate=Hyst(Dew_Actual,DewLoModerate,DewHiModerate,DewModerate_Old);
+	DewModerate_Old=DewModerate;
+
+	DewDanger=Hyst(Dew_Actual,DewLoDanger,DewHiDanger,DewDanger_Old);
+	DewDanger_Old=DewDanger;
+	if(DewDanger)
+		DewState=2;
+	else if(DewModerate)
+		DewState=1;
+	else
+		DewState=0;
+
+	if(DewState_Old==DewState)
+		DewCounter=DewCounter+1;
+
+	if(DewCounter>DewCtrThd)
+	{
+		DewState_Confirmed=DewState;
+		DewCounter=0;
+	}
+
+	DewState_Old=DewState;
+}
+
 
 /***********************************************************************
  * @name sensor_statemachine()
  * @brief State Transition logic
- * @return void
+ * @return confirmed state, 0 (safe) to 4 (highly dangerous)
  ***********************************************************************/
-void sensor_statemachine(float t1, float h1, float p1, float g1)
+uint8_t sensor_statemachine(const struct bme680_field_data *data, const struct derived_data *derived)
 {
 
-	Temperature_Actual = t1;
-	Pressure_Actual= p1;
-	Humidity_Actual = h1;
-	Gas_Actual= g1;
+	Temperature_Actual = data->temperature;
+	Pressure_Actual= data->pressure;
+	Humidity_Actual = data->humidity;
+	Gas_Actual= aq_update(&air_quality, data);
+	Dew_Actual= -derived->dew_spread * (BME680_TEMP_SCALE / 100);
 
 	Temperature();
 	Pressure();
 	Humidity();
 	Gas();
+	Dew();
 
 	if(GasState_Confirmed == 2 && TempState_Confirmed == 2 && PresState_Confirmed == 2)
 	{
@@ -297,12 +357,14 @@ void sensor_statemachine(float t1, float h1, float p1, float g1)
 	{
 		FinalState=3;
 	}
-	else if(GasState_Confirmed==2 || HumState_Confirmed==2 || PresState_Confirmed==2 || TempState_Confirmed==2)
+	else if(GasState_Confirmed==2 || HumState_Confirmed==2 || PresState_Confirmed==2 || TempState_Confirmed==2
+			|| DewState_Confirmed==2)
 	{
 		FinalState=2;
 
 	}
-	else if(GasState_Confirmed==1 || HumState_Confirmed==1 || PresState_Confirmed==1 || TempState_Confirmed==1)
+	else if(GasState_Confirmed==1 || HumState_Confirmed==1 || PresState_Confirmed==1 || TempState_Confirmed==1
+			|| DewState_Confirmed==1)
 	{
 		FinalState=1;
 
@@ -363,4 +425,5 @@ void sensor_statemachine(float t1, float h1, float p1, float g1)
 
 	}
 
+	return FinalState_Confirmed;
 }
@@ -23,7 +23,23 @@
 /* Includes */
 #include <errno.h>
 #include <stdint.h>
+#include <stddef.h>
 
+#ifdef BME680_ZERO_HEAP
+/**
+ * Defined nowhere on purpose. In a zero-heap build, anything that pulls in
+ * newlib's malloc also keeps _sbrk(). The link then fails on this symbol,
+ * and the map file's archive list names the object that made the call.
+ * With nothing calling malloc, --gc-sections drops _sbrk() and the
+ * reference goes with it.
+ */
+extern void *zero_heap_build_calls_malloc(ptrdiff_t incr);
+
+void *_sbrk(ptrdiff_t incr)
+{
+  return zero_heap_build_calls_malloc(incr);
+}
+#else
 /**
  * Pointer to the current high watermark of the heap usage
  */
@@ -77,3 +93,4 @@ void *_sbrk(ptrdiff_t incr)
 
   return (void *)prev_heap_end;
 }
+#endif /* BME680_ZERO_HEAP */
@@ -0,0 +1,162 @@
+/**
+  ******************************************************************************
+  * @file           : task_sched.c
+  * @brief          : Cooperative scheduler of periodic tasks
+  ******************************************************************************
+**/
+
+#include <string.h>
+#include "task_sched.h"
+
+/***********************************************************************
+ * @name tick_reached()
+ * @brief Wrap-safe comparison of the current tick against a deadline
+ * @return true once now is at or past the deadline
+ ***********************************************************************/
+static uint8_t tick_reached(uint32_t now, uint32_t deadline)
+{
+	return (int32_t)(now - deadline) >= 0;
+}
+
+/***********************************************************************
+ * @name task_sched_init()
+ * @brief Sets up an empty scheduler. get_cycles counts cycles_per_ms
+ *        per tick of get_tick; idle may be NULL to spin.
+ * @return void
+ ***********************************************************************/
+void task_sched_init(struct task_sched *sched, meas_tick_fptr_t get_tick, task_cycles_fptr_t get_cycles,
+		uint32_t cycles_per_ms, task_idle_fptr_t idle)
+{
+	memset(sched, 0, sizeof(*sched));
+	sched->get_tick = get_tick;
+	sched->get_cycles = get_cycles;
+	sched->cycles_per_ms = cycles_per_ms;
+	sched->idle = idle;
+}
+
+/***********************************************************************
+ * @name task_sched_add()
+ * @brief Adds a task below those already added in priority. It is first
+ *        released offset ms after task_sched_start(), then every period
+ *        ms (at least 1).
+ * @return task index, or -1 if the scheduler is full
+ ***********************************************************************/
+int8_t task_sched_add(struct task_sched *sched, const char *name, task_fptr_t fn, void *ctx, uint32_t period,
+		uint32_t deadline, uint32_t offset)
+{
+	struct task *task;
+
+	if (sched->count >= TASK_SCHED_MAX)
+		return -1;
+
+	task = &sched->task[sched->count];
+	memset(task, 0, sizeof(*task));
+	task->name = name;
+	task->fn = fn;
+	task->ctx = ctx;
+	task->period = period ? period : 1;
+	task->deadline = deadline;
+	task->release = offset;
+
+	return (int8_t)sched->count++;
+}
+
+/***********************************************************************
+ * @name task_sched_start()
+ * @brief Turns every task's offset into its first release tick
+ * @return void
+ ***********************************************************************/
+void task_sched_start(struct task_sched *sched)
+{
+	uint8_t i;
+
+	sched->t_start = sched->get_tick();
+	for (i = 0; i < sched->count; i++)
+		sched->task[i].release += sched->t_start;
+}
+
+/***********************************************************************
+ * @name task_sched_run()
+ * @brief One scheduler step: runs the first due task, or calls the idle
+ *        hook when none is. Call it forever from the main loop.
+ * @return void
+ ***********************************************************************/
+void task_sched_run(struct task_sched *sched)
+{
+	struct task *task;
+	uint32_t now = sched->get_tick();
+	uint32_t c0, cycles, finish, missed;
+	uint8_t i;
+
+	for (i = 0; i < sched->count; i++)
+	{
+		task = &sched->task[i];
+		if (!tick_reached(now, task->release))
+			continue;
+
+		c0 = sched->get_cycles();
+		task->fn(task->ctx);
+		cycles = sched->get_cycles() - c0;
+		finish = sched->get_tick();
+
+		task->runs++;
+		task->busy += cycles;
+		if (cycles > task->wcet)
+			task->wcet = cycles;
+		if (!tick_reached(task->release + task->deadline, finish))
+			task->overruns++;
+
+		/* Releases already gone by are dropped, so a late task runs once
+		 * and falls back into its period instead of running in a burst */
+		task->release += task->period;
+		if (tick_reached(finish, task->release))
+		{
+			missed = (finish - task->release) / task->period + 1;
+			task->skipped += missed;
+			task->release += missed * task->period;
+		}
+		return;
+	}
+
+	sched->idles++;
+	if (sched->idle != NULL)
+		sched->idle();
+}
+
+/***********************************************************************
+ * @name task_sched_share()
+ * @brief CPU share of a task since start or the last reset
+ * @return tenths of a percent
+ ***********************************************************************/
+uint32_t task_sched_share(const struct task_sched *sched, uint8_t idx)
+{
+	uint64_t avail = (uint64_t)(sched->get_tick() - sched->t_start) * sched->cycles_per_ms;
+
+	if (avail == 0)
+		return 0;
+	return (uint32_t)(sched->task[idx].busy * 1000 / avail);
+}
+
+/***********************************************************************
+ * @name task_sched_reset_stats()
+ * @brief Clears every task's counters and restarts the share window;
+ *        the release times are kept
+ * @return void
+ ***********************************************************************/
+void task_sched_reset_stats(struct task_sched *sched)
+{
+	struct task *task;
+	uint8_t i;
+
+	for (i = 0; i < sched->count; i++)
+	{
+		task = &sched->task[i];
+		task->runs = 0;
+		task->overruns = 0;
+		task->skipped = 0;
+		task->wcet = 0;
+		task->busy = 0;
+	}
+	sched->idles = 0;
+	sched->t_start = sched->get_tick();
+}
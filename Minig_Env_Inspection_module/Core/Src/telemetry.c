@@ -0,0 +1,162 @@
+/**
+  ******************************************************************************
+  * @file           : telemetry.c
+  * @brief          : Binary telemetry frames: COBS framing, CRC16, scaled fields
+  ******************************************************************************
+**/
+
+#include "telemetry.h"
+#include "bme680.h"
+#include "derived.h"
+
+/***********************************************************************
+ * @name telem_crc16()
+ * @brief Bitwise CRC-16/CCITT-FALSE; one frame per sample is too little
+ *        work to pay flash for a table
+ * @return CRC of buf
+ ***********************************************************************/
+uint16_t telem_crc16(const uint8_t *buf, uint16_t len)
+{
+	uint16_t crc = 0xFFFF;
+	uint8_t bit;
+
+	while (len--)
+	{
+		crc ^= (uint16_t)(*buf++ << 8);
+		for (bit = 0; bit < 8; bit++)
+			crc = (uint16_t)((crc << 1) ^ (0x1021 & (0U - (crc >> 15))));
+	}
+
+	return crc;
+}
+
+/***********************************************************************
+ * @name telem_cobs_encode()
+ * @brief COBS-encodes len bytes of in and appends the 0x00 delimiter.
+ *        out needs len + len / 254 + 2 bytes.
+ * @return bytes written to out
+ ***********************************************************************/
+uint16_t telem_cobs_encode(const uint8_t *in, uint16_t len, uint8_t *out)
+{
+	uint16_t code_pos = 0, pos = 1, i;
+	uint8_t code = 1;
+
+	for (i = 0; i < len; i++)
+	{
+		if (in[i] != 0)
+		{
+			out[pos++] = in[i];
+			code++;
+		}
+		if (in[i] == 0 || code == 0xFF)
+		{
+			out[code_pos] = code;
+			code_pos = pos++;
+			code = 1;
+		}
+	}
+	out[code_pos] = code;
+	out[pos++] = 0;
+
+	return pos;
+}
+
+/***********************************************************************
+ * @name telem_sample_set()
+ * @brief Converts a compensated sample and its derived metrics to the
+ *        wire units; node, state, gas index and time are the caller's
+ * @return void
+ ***********************************************************************/
+void telem_sample_set(struct telem_sample *sample, const struct bme680_field_data *data,
+		const struct derived_data *derived)
+{
+	sample->status = data->status;
+	sample->temperature = (int16_t)(data->temperature * (100 / BME680_TEMP_SCALE));
+	sample->pressure = (uint32_t)(data->pressure / BME680_PRES_SCALE);
+	sample->humidity = (uint32_t)(data->humidity * (1000 / BME680_HUM_SCALE));
+	sample->gas_resistance = (uint32_t)(data->gas_resistance / BME680_GAS_SCALE);
+	sample->dew_point = (int16_t)derived->dew_point;
+	sample->abs_humidity = (uint16_t)derived->abs_humidity;
+	sample->height = derived->height;
+}
+
+static uint8_t *put16(uint8_t *p, uint16_t v)
+{
+	p[0] = (uint8_t)v;
+	p[1] = (uint8_t)(v >> 8);
+	return p + 2;
+}
+
+static uint8_t *put32(uint8_t *p, uint32_t v)
+{
+	p[0] = (uint8_t)v;
+	p[1] = (uint8_t)(v >> 8);
+	p[2] = (uint8_t)(v >> 16);
+	p[3] = (uint8_t)(v >> 24);
+	return p + 4;
+}
+
+/***********************************************************************
+ * @name telem_encode()
+ * @brief Lays out sample as payload number seq (see telemetry.h), adds
+ *        the CRC and frames it into frame, TELEM_FRAME_MAX bytes
+ * @return frame length, delimiter included
+ ***********************************************************************/
+uint16_t telem_encode(const struct telem_sample *sample, uint16_t seq, uint8_t *frame)
+{
+	uint8_t payload[TELEM_SAMPLE_LEN + TELEM_CRC_LEN];
+	uint8_t *p = payload;
+	uint16_t crc;
+
+	*p++ = TELEM_TYPE_SAMPLE;
+	*p++ = sample->node;
+	p = put16(p, seq);
+	p = put32(p, sample->t_ms);
+	p = put16(p, (uint16_t)sample->temperature);
+	p = put32(p, sample->pressure);
+	p = put32(p, sample->humidity);
+	p = put32(p, sample->gas_resistance);
+	p = put16(p, (uint16_t)sample->dew_point);
+	p = put16(p, sample->abs_humidity);
+	p = put32(p, (uint32_t)sample->height);
+	p = put16(p, sample->gas_index);
+	*p++ = sample->state;
+	*p++ = sample->status;
+
+	crc = telem_crc16(payload, TELEM_SAMPLE_LEN);
+	put16(p, crc);
+
+	return telem_cobs_encode(payload, sizeof(payload), frame);
+}
+
+/***********************************************************************
+ * @name telem_init()
+ * @brief Sets up a frame stream to write, numbered from 0
+ * @return void
+ ***********************************************************************/
+void telem_init(struct telem *tm, telem_write_fptr_t write, void *ctx)
+{
+	tm->write = write;
+	tm->ctx = ctx;
+	tm->seq = 0;
+	tm->frames = 0;
+}
+
+/***********************************************************************
+ * @name telem_send()
+ * @brief Frames one sample and writes it
+ * @return void
+ ***********************************************************************/
+void telem_send(struct telem *tm, const struct telem_sample *sample)
+{
+	uint8_t frame[TELEM_FRAME_MAX];
+	uint16_t len;
+
+	if (tm->write == NULL)
+		return;
+
+	len = telem_encode(sample, tm->seq++, frame);
+	tm->frames++;
+
+	tm->write(frame, len, tm->ctx);
+}
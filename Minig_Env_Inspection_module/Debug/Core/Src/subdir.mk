@@ -5,40 +5,97 @@
 
 # Add inputs and outputs from these tool invocations to the build variables 
 C_SRCS += \
+../Core/Src/air_quality.c \
+../Core/Src/app_bench.c \
+../Core/Src/app_tasks.c \
 ../Core/Src/bme680.c \
+../Core/Src/calib_cache.c \
+../Core/Src/derived.c \
+../Core/Src/fixfmt.c \
+../Core/Src/fixmath.c \
 ../Core/Src/fonts.c \
+../Core/Src/frame_log.c \
+../Core/Src/i2c_ll.c \
+../Core/Src/i2c_sched.c \
+../Core/Src/i2c_transport.c \
+../Core/Src/log_ring.c \
 ../Core/Src/main.c \
+../Core/Src/meas_engine.c \
+../Core/Src/os_ctrl.c \
+../Core/Src/scratch.c \
+../Core/Src/sensor_array.c \
+../Core/Src/spi_transport.c \
 ../Core/Src/ssd1306.c \
 ../Core/Src/statemachine.c \
 ../Core/Src/stm32f4xx_hal_msp.c \
 ../Core/Src/stm32f4xx_it.c \
 ../Core/Src/syscalls.c \
 ../Core/Src/sysmem.c \
-../Core/Src/system_stm32f4xx.c 
+../Core/Src/system_stm32f4xx.c \
+../Core/Src/task_sched.c \
+../Core/Src/telemetry.c 
 
 OBJS += \
+./Core/Src/air_quality.o \
+./Core/Src/app_bench.o \
+./Core/Src/app_tasks.o \
 ./Core/Src/bme680.o \
+./Core/Src/calib_cache.o \
+./Core/Src/derived.o \
+./Core/Src/fixfmt.o \
+./Core/Src/fixmath.o \
 ./Core/Src/fonts.o \
+./Core/Src/frame_log.o \
+./Core/Src/i2c_ll.o \
+./Core/Src/i2c_sched.o \
+./Core/Src/i2c_transport.o \
+./Core/Src/log_ring.o \
 ./Core/Src/main.o \
+./Core/Src/meas_engine.o \
+./Core/Src/os_ctrl.o \
+./Core/Src/scratch.o \
+./Core/Src/sensor_array.o \
+./Core/Src/spi_transport.o \
 ./Core/Src/ssd1306.o \
 ./Core/Src/statemachine.o \
 ./Core/Src/stm32f4xx_hal_msp.o \
 ./Core/Src/stm32f4xx_it.o \
 ./Core/Src/syscalls.o \
 ./Core/Src/sysmem.o \
-./Core/Src/system_stm32f4xx.o 
+./Core/Src/system_stm32f4xx.o \
+./Core/Src/task_sched.o \
+./Core/Src/telemetry.o 
 
 C_DEPS += \
+./Core/Src/air_quality.d \
+./Core/Src/app_bench.d \
+./Core/Src/app_tasks.d \
 ./Core/Src/bme680.d \
+./Core/Src/calib_cache.d \
+./Core/Src/derived.d \
+./Core/Src/fixfmt.d \
+./Core/Src/fixmath.d \
 ./Core/Src/fonts.d \
+./Core/Src/frame_log.d \
+./Core/Src/i2c_ll.d \
+./Core/Src/i2c_sched.d \
+./Core/Src/i2c_transport.d \
+./Core/Src/log_ring.d \
 ./Core/Src/main.d \
+./Core/Src/meas_engine.d \
+./Core/Src/os_ctrl.d \
+./Core/Src/scratch.d \
+./Core/Src/sensor_array.d \
+./Core/Src/spi_transport.d \
 ./Core/Src/ssd1306.d \
 ./Core/Src/statemachine.d \
 ./Core/Src/stm32f4xx_hal_msp.d \
 ./Core/Src/stm32f4xx_it.d \
 ./Core/Src/syscalls.d \
 ./Core/Src/sysmem.d \
-./Core/Src/system_stm32f4xx.d 
+./Core/Src/system_stm32f4xx.d \
+./Core/Src/task_sched.d \
+./Core/Src/telemetry.d 
 
 
 # Each subdirectory must supply rules for building sources it contributes
@@ -48,7 +105,7 @@ Core/Src/%.o Core/Src/%.su: ../Core/Src/%.c Core/Src/subdir.mk
 clean: clean-Core-2f-Src
 
 clean-Core-2f-Src:
-	-$(RM) ./Core/Src/bme680.d ./Core/Src/bme680.o ./Core/Src/bme680.su ./Core/Src/fonts.d ./Core/Src/fonts.o ./Core/Src/fonts.su ./Core/Src/main.d ./Core/Src/main.o ./Core/Src/main.su ./Core/Src/ssd1306.d ./Core/Src/ssd1306.o ./Core/Src/ssd1306.su ./Core/Src/statemachine.d ./Core/Src/statemachine.o ./Core/Src/statemachine.su ./Core/Src/stm32f4xx_hal_msp.d ./Core/Src/stm32f4xx_hal_msp.o ./Core/Src/stm32f4xx_hal_msp.su ./Core/Src/stm32f4xx_it.d ./Core/Src/stm32f4xx_it.o ./Core/Src/stm32f4xx_it.su ./Core/Src/syscalls.d ./Core/Src/syscalls.o ./Core/Src/syscalls.su ./Core/Src/sysmem.d ./Core/Src/sysmem.o ./Core/Src/sysmem.su ./Core/Src/system_stm32f4xx.d ./Core/Src/system_stm32f4xx.o ./Core/Src/system_stm32f4xx.su
+	-$(RM) ./Core/Src/air_quality.d ./Core/Src/air_quality.o ./Core/Src/air_quality.su ./Core/Src/app_bench.d ./Core/Src/app_bench.o ./Core/Src/app_bench.su ./Core/Src/app_tasks.d ./Core/Src/app_tasks.o ./Core/Src/app_tasks.su ./Core/Src/bme680.d ./Core/Src/bme680.o ./Core/Src/bme680.su ./Core/Src/calib_cache.d ./Core/Src/calib_cache.o ./Core/Src/calib_cache.su ./Core/Src/derived.d ./Core/Src/derived.o ./Core/Src/derived.su ./Core/Src/fixfmt.d ./Core/Src/fixfmt.o ./Core/Src/fixfmt.su ./Core/Src/fixmath.d ./Core/Src/fixmath.o ./Core/Src/fixmath.su ./Core/Src/fonts.d ./Core/Src/fonts.o ./Core/Src/fonts.su ./Core/Src/frame_log.d ./Core/Src/frame_log.o ./Core/Src/frame_log.su ./Core/Src/i2c_ll.d ./Core/Src/i2c_ll.o ./Core/Src/i2c_ll.su ./Core/Src/i2c_sched.d ./Core/Src/i2c_sched.o ./Core/Src/i2c_sched.su ./Core/Src/i2c_transport.d ./Core/Src/i2c_transport.o ./Core/Src/i2c_transport.su ./Core/Src/log_ring.d ./Core/Src/log_ring.o ./Core/Src/log_ring.su ./Core/Src/main.d ./Core/Src/main.o ./Core/Src/main.su ./Core/Src/meas_engine.d ./Core/Src/meas_engine.o ./Core/Src/meas_engine.su ./Core/Src/os_ctrl.d ./Core/Src/os_ctrl.o ./Core/Src/os_ctrl.su ./Core/Src/scratch.d ./Core/Src/scratch.o ./Core/Src/scratch.su ./Core/Src/sensor_array.d ./Core/Src/sensor_array.o ./Core/Src/sensor_array.su ./Core/Src/spi_transport.d ./Core/Src/spi_transport.o ./Core/Src/spi_transport.su ./Core/Src/ssd1306.d ./Core/Src/ssd1306.o ./Core/Src/ssd1306.su ./Core/Src/statemachine.d ./Core/Src/statemachine.o ./Core/Src/statemachine.su ./Core/Src/stm32f4xx_hal_msp.d ./Core/Src/stm32f4xx_hal_msp.o ./Core/Src/stm32f4xx_hal_msp.su ./Core/Src/stm32f4xx_it.d ./Core/Src/stm32f4xx_it.o ./Core/Src/stm32f4xx_it.su ./Core/Src/syscalls.d ./Core/Src/syscalls.o ./Core/Src/syscalls.su ./Core/Src/sysmem.d ./Core/Src/sysmem.o ./Core/Src/sysmem.su ./Core/Src/system_stm32f4xx.d ./Core/Src/system_stm32f4xx.o ./Core/Src/system_stm32f4xx.su ./Core/Src/task_sched.d ./Core/Src/task_sched.o ./Core/Src/task_sched.su ./Core/Src/telemetry.d ./Core/Src/telemetry.o ./Core/Src/telemetry.su
 
 .PHONY: clean-Core-2f-Src
 
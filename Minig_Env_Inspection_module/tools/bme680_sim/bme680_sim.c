@@ -0,0 +1,724 @@
+/**
+  ******************************************************************************
+  * @file           : bme680_sim.c
+  * @brief          : Register-level BME680 I2C/SPI simulator for host builds
+  ******************************************************************************
+**/
+
+#include <math.h>
+#include <string.h>
+#include "bme680_sim.h"
+
+/* Register layout of the coefficient image, BME680_COEFF_ADDR1 then 2 */
+#define SIM_COEFF2_OFS		BME680_COEFF_ADDR1_LEN
+
+/* Status bits of the field registers not named in bme680_defs.h */
+#define SIM_GAS_MEASURING	UINT8_C(0x40)
+#define SIM_MEASURING		UINT8_C(0x20)
+
+/* SPI view of the status register, present in both memory pages */
+#define SIM_SPI_STATUS		(BME680_MEM_PAGE_ADDR & BME680_SPI_WR_MSK)
+
+/* Shortest heater on-time that still reports a stable heater */
+#define SIM_HEAT_STAB_MS	20
+
+/* Humidity cross-sensitivity of the gas plate: the scenarios give the
+ * resistance at SIM_GAS_HUM_REF, every %rH above it takes about 3 % off */
+#define SIM_GAS_HUM_REF		25.0
+#define SIM_GAS_HUM_K		0.03
+
+static uint32_t sim_now;
+static struct bme680_sim *sim_table[BME680_SIM_MAX];
+
+/* A typical factory calibration */
+static const struct bme680_calib_data sim_calib = {
+	.par_h1 = 774, .par_h2 = 1018, .par_h3 = 0, .par_h4 = 45, .par_h5 = 20, .par_h6 = 120, .par_h7 = -100,
+	.par_gh1 = -30, .par_gh2 = -5969, .par_gh3 = 18,
+	.par_t1 = 26184, .par_t2 = 26280, .par_t3 = 3,
+	.par_p1 = 37142, .par_p2 = -10439, .par_p3 = 88, .par_p4 = 7000, .par_p5 = -154,
+	.par_p6 = 30, .par_p7 = 50, .par_p8 = -2386, .par_p9 = -2728, .par_p10 = 30,
+	.res_heat_range = 1, .res_heat_val = 50, .range_sw_err = 0,
+};
+
+static const double sim_k1_range[16] = {
+	0.0, 0.0, 0.0, 0.0, 0.0, -1.0, 0.0, -0.8, 0.0, 0.0, -0.2, -0.5, 0.0, -1.0, 0.0, 0.0 };
+static const double sim_k2_range[16] = {
+	0.0, 0.0, 0.0, 0.0, 0.1, 0.7, 0.0, -0.8, -0.1, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0, 0.0 };
+
+/***********************************************************************
+ * @name put16()
+ * @brief Stores a 16 bit coefficient little endian in the image
+ * @return void
+ ***********************************************************************/
+static void put16(uint8_t *coeff, uint8_t lsb, uint8_t msb, uint16_t value)
+{
+	coeff[lsb] = (uint8_t)value;
+	coeff[msb] = (uint8_t)(value >> 8);
+}
+
+/***********************************************************************
+ * @name sim_load_calib()
+ * @brief Writes sim->calib into the coefficient and heater registers,
+ *        laid out as get_calib_data() decodes them
+ * @return void
+ ***********************************************************************/
+static void sim_load_calib(struct bme680_sim *sim)
+{
+	const struct bme680_calib_data *c = &sim->calib;
+	uint8_t coeff[BME680_COEFF_SIZE];
+
+	memset(coeff, 0, sizeof(coeff));
+	put16(coeff, BME680_T1_LSB_REG, BME680_T1_MSB_REG, c->par_t1);
+	put16(coeff, BME680_T2_LSB_REG, BME680_T2_MSB_REG, (uint16_t)c->par_t2);
+	coeff[BME680_T3_REG] = (uint8_t)c->par_t3;
+	put16(coeff, BME680_P1_LSB_REG, BME680_P1_MSB_REG, c->par_p1);
+	put16(coeff, BME680_P2_LSB_REG, BME680_P2_MSB_REG, (uint16_t)c->par_p2);
+	coeff[BME680_P3_REG] = (uint8_t)c->par_p3;
+	put16(coeff, BME680_P4_LSB_REG, BME680_P4_MSB_REG, (uint16_t)c->par_p4);
+	put16(coeff, BME680_P5_LSB_REG, BME680_P5_MSB_REG, (uint16_t)c->par_p5);
+	coeff[BME680_P6_REG] = (uint8_t)c->par_p6;
+	coeff[BME680_P7_REG] = (uint8_t)c->par_p7;
+	put16(coeff, BME680_P8_LSB_REG, BME680_P8_MSB_REG, (uint16_t)c->par_p8);
+	put16(coeff, BME680_P9_LSB_REG, BME680_P9_MSB_REG, (uint16_t)c->par_p9);
+	coeff[BME680_P10_REG] = c->par_p10;
+
+	/* H1 and H2 share a register: H1 in the low nibble, H2 in the high one */
+	coeff[BME680_H2_MSB_REG] = (uint8_t)(c->par_h2 >> BME680_HUM_REG_SHIFT_VAL);
+	coeff[BME680_H1_LSB_REG] = (uint8_t)((c->par_h2 << BME680_HUM_REG_SHIFT_VAL) & 0xf0)
+			| (c->par_h1 & BME680_BIT_H1_DATA_MSK);
+	coeff[BME680_H1_MSB_REG] = (uint8_t)(c->par_h1 >> BME680_HUM_REG_SHIFT_VAL);
+	coeff[BME680_H3_REG] = (uint8_t)c->par_h3;
+	coeff[BME680_H4_REG] = (uint8_t)c->par_h4;
+	coeff[BME680_H5_REG] = (uint8_t)c->par_h5;
+	coeff[BME680_H6_REG] = c->par_h6;
+	coeff[BME680_H7_REG] = (uint8_t)c->par_h7;
+
+	coeff[BME680_GH1_REG] = (uint8_t)c->par_gh1;
+	put16(coeff, BME680_GH2_LSB_REG, BME680_GH2_MSB_REG, (uint16_t)c->par_gh2);
+	coeff[BME680_GH3_REG] = (uint8_t)c->par_gh3;
+
+	memcpy(&sim->regs[BME680_COEFF_ADDR1], coeff, BME680_COEFF_ADDR1_LEN);
+	memcpy(&sim->regs[BME680_COEFF_ADDR2], &coeff[SIM_COEFF2_OFS], BME680_COEFF_ADDR2_LEN);
+
+	sim->regs[BME680_ADDR_RES_HEAT_RANGE_ADDR] = (uint8_t)(c->res_heat_range * 16) & BME680_RHRANGE_MSK;
+	sim->regs[BME680_ADDR_RES_HEAT_VAL_ADDR] = (uint8_t)c->res_heat_val;
+	sim->regs[BME680_ADDR_RANGE_SW_ERR_ADDR] = (uint8_t)(c->range_sw_err * 16) & BME680_RSERROR_MSK;
+}
+
+/***********************************************************************
+ * @name sim_reset()
+ * @brief Power-on state: control and field registers cleared, sleep mode
+ * @return void
+ ***********************************************************************/
+static void sim_reset(struct bme680_sim *sim)
+{
+	memset(&sim->regs[BME680_FIELD0_ADDR], 0, BME680_FIELD_LENGTH);
+	memset(&sim->regs[BME680_SHADOW_START], 0, BME680_SHADOW_LEN);
+	/* Field registers read 0x80000 until the first conversion */
+	sim->regs[BME680_FIELD0_ADDR + 2] = 0x80;
+	sim->regs[BME680_FIELD0_ADDR + 5] = 0x80;
+	sim->regs[BME680_FIELD0_ADDR + 8] = 0x80;
+	sim->regs[BME680_CHIP_ID_ADDR] = BME680_CHIP_ID;
+	sim->regs[BME680_MEM_PAGE_ADDR] = 0;
+	sim->converting = 0;
+	sim->filt_valid = 0;
+}
+
+/***********************************************************************
+ * @name sim_gauss()
+ * @brief Deterministic unit normal deviate (xorshift32 and Box-Muller)
+ * @return deviate
+ ***********************************************************************/
+static double sim_gauss(struct bme680_sim *sim)
+{
+	double u1, u2;
+
+	sim->rng ^= sim->rng << 13;
+	sim->rng ^= sim->rng >> 17;
+	sim->rng ^= sim->rng << 5;
+	u1 = (sim->rng + 1.0) / 4294967297.0;
+	sim->rng ^= sim->rng << 13;
+	sim->rng ^= sim->rng >> 17;
+	sim->rng ^= sim->rng << 5;
+	u2 = sim->rng / 4294967296.0;
+
+	return sqrt(-2.0 * log(u1)) * cos(6.283185307179586 * u2);
+}
+
+/***********************************************************************
+ * @name sim_t_fine()
+ * @brief Forward float temperature compensation of the Bosch driver
+ * @return t_fine for adc
+ ***********************************************************************/
+static double sim_t_fine(const struct bme680_calib_data *c, double adc)
+{
+	double var1, var2;
+
+	var1 = (adc / 16384.0 - c->par_t1 / 1024.0) * c->par_t2;
+	var2 = (adc / 131072.0 - c->par_t1 / 8192.0) * (adc / 131072.0 - c->par_t1 / 8192.0) * (c->par_t3 * 16.0);
+
+	return var1 + var2;
+}
+
+/***********************************************************************
+ * @name sim_pressure()
+ * @brief Forward float pressure compensation of the Bosch driver
+ * @return Pa for adc
+ ***********************************************************************/
+static double sim_pressure(const struct bme680_calib_data *c, double t_fine, double adc)
+{
+	double var1, var2, var3, pres;
+
+	var1 = t_fine / 2.0 - 64000.0;
+	var2 = var1 * var1 * (c->par_p6 / 131072.0);
+	var2 = var2 + var1 * c->par_p5 * 2.0;
+	var2 = var2 / 4.0 + c->par_p4 * 65536.0;
+	var1 = (c->par_p3 * var1 * var1 / 16384.0 + c->par_p2 * var1) / 524288.0;
+	var1 = (1.0 + var1 / 32768.0) * c->par_p1;
+	pres = 1048576.0 - adc;
+	pres = (pres - var2 / 4096.0) * 6250.0 / var1;
+	var1 = c->par_p9 * pres * pres / 2147483648.0;
+	var2 = pres * (c->par_p8 / 32768.0);
+	var3 = (pres / 256.0) * (pres / 256.0) * (pres / 256.0) * (c->par_p10 / 131072.0);
+
+	return pres + (var1 + var2 + var3 + c->par_p7 * 128.0) / 16.0;
+}
+
+/***********************************************************************
+ * @name sim_humidity()
+ * @brief Forward float humidity compensation of the Bosch driver, unclamped
+ * @return %rH for adc
+ ***********************************************************************/
+static double sim_humidity(const struct bme680_calib_data *c, double t_fine, double adc)
+{
+	double temp_comp = t_fine / 5120.0;
+	double var1, var2;
+
+	var1 = adc - (c->par_h1 * 16.0 + (c->par_h3 / 2.0) * temp_comp);
+	var2 = var1 * ((c->par_h2 / 262144.0) * (1.0 + (c->par_h4 / 16384.0) * temp_comp
+			+ (c->par_h5 / 1048576.0) * temp_comp * temp_comp));
+
+	return var2 + ((c->par_h6 / 16384.0) + (c->par_h7 / 2097152.0) * temp_comp) * var2 * var2;
+}
+
+/***********************************************************************
+ * @name sim_invert()
+ * @brief Bisects the ADC code in [0, max] whose compensated value is
+ *        closest to target. which: 0 temperature, 1 pressure, 2 humidity.
+ * @return ADC code
+ ***********************************************************************/
+static uint32_t sim_invert(const struct bme680_calib_data *c, uint8_t which, double t_fine, double target,
+		uint32_t max)
+{
+	uint32_t lo = 0, hi = max, mid;
+	double value;
+	int rising;
+
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		switch (which) {
+		case 0:
+			value = sim_t_fine(c, mid) / 5120.0;
+			rising = 1;
+			break;
+		case 1:
+			value = sim_pressure(c, t_fine, mid);
+			rising = 0;
+			break;
+		default:
+			value = sim_humidity(c, t_fine, mid);
+			rising = 1;
+			break;
+		}
+		if ((value < target) == rising)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	return lo;
+}
+
+/***********************************************************************
+ * @name sim_gas_adc()
+ * @brief Picks the gas range whose ADC code sits nearest mid-scale and
+ *        inverts the float gas compensation for it
+ * @return ADC code in bits 15:6, range in bits 3:0
+ ***********************************************************************/
+static uint16_t sim_gas_adc(const struct bme680_calib_data *c, double ohm)
+{
+	double var1 = 1340.0 + 5.0 * c->range_sw_err;
+	double var2, var3, x, adc, best_adc = 0.0;
+	uint8_t range, best = 0;
+
+	for (range = 0; range < 16; range++) {
+		var2 = var1 * (1.0 + sim_k1_range[range] / 100.0);
+		var3 = 1.0 + sim_k2_range[range] / 100.0;
+		x = 1.0 / (ohm * var3 * 0.000000125 * (double)(1 << range));
+		adc = 512.0 + var2 * (x - 1.0);
+		if ((adc >= 0.0) && (adc <= 1023.0) && (fabs(adc - 512.0) < fabs(best_adc - 512.0))) {
+			best = range;
+			best_adc = adc;
+		}
+	}
+
+	return (uint16_t)(((uint16_t)lround(best_adc) << 6) | best);
+}
+
+/***********************************************************************
+ * @name sim_duration()
+ * @brief Conversion time for the programmed settings, as
+ *        bme680_get_profile_dur() computes it
+ * @return ms
+ ***********************************************************************/
+static uint32_t sim_duration(const struct bme680_sim *sim)
+{
+	static const uint8_t os_to_meas_cycles[8] = { 0, 1, 2, 4, 8, 16, 16, 16 };
+	uint8_t ctrl_meas = sim->regs[BME680_CONF_T_P_MODE_ADDR];
+	uint8_t ctrl_gas = sim->regs[BME680_CONF_ODR_RUN_GAS_NBC_ADDR];
+	uint8_t wait = sim->regs[BME680_GAS_WAIT0_ADDR + (ctrl_gas & BME680_NBCONV_MSK)];
+	uint32_t cycles, dur;
+
+	cycles = os_to_meas_cycles[(ctrl_meas & BME680_OST_MSK) >> 5];
+	cycles += os_to_meas_cycles[(ctrl_meas & BME680_OSP_MSK) >> 2];
+	cycles += os_to_meas_cycles[sim->regs[BME680_CONF_OS_H_ADDR] & BME680_OSH_MSK];
+
+	dur = (cycles * 1963 + 477 * 4 + 477 * 5 + 500) / 1000 + 1;
+	if (ctrl_gas & BME680_RUN_GAS_MSK)
+		dur += (uint32_t)(wait & 0x3f) << (2 * (wait >> 6));
+
+	return dur;
+}
+
+/***********************************************************************
+ * @name sim_convert()
+ * @brief Finishes a conversion: samples the scenario at conv_end and
+ *        writes the field registers
+ * @return void
+ ***********************************************************************/
+static void sim_convert(struct bme680_sim *sim)
+{
+	static const uint8_t filter_coeff[8] = { 0, 1, 3, 7, 15, 31, 63, 127 };
+	uint8_t ctrl_meas = sim->regs[BME680_CONF_T_P_MODE_ADDR];
+	uint8_t ctrl_gas = sim->regs[BME680_CONF_ODR_RUN_GAS_NBC_ADDR];
+	uint8_t step = ctrl_gas & BME680_NBCONV_MSK;
+	uint8_t wait = sim->regs[BME680_GAS_WAIT0_ADDR + step];
+	uint8_t os_t = (ctrl_meas & BME680_OST_MSK) >> 5;
+	uint8_t os_p = (ctrl_meas & BME680_OSP_MSK) >> 2;
+	uint8_t os_h = sim->regs[BME680_CONF_OS_H_ADDR] & BME680_OSH_MSK;
+	uint8_t coeff = filter_coeff[(sim->regs[BME680_CONF_ODR_FILT_ADDR] & BME680_FILTER_MSK) >> 2];
+	struct bme680_sim_env env;
+	uint32_t adc_t, adc_p, adc_h;
+	uint16_t gas;
+	uint8_t *field = &sim->regs[BME680_FIELD0_ADDR];
+	double t_fine;
+
+	sim->scenario(sim->conv_end, &env);
+	env.gas_resistance *= exp(-SIM_GAS_HUM_K * (env.humidity - SIM_GAS_HUM_REF));
+	sim->env = env;
+
+	/* RMS noise falls with the square root of the oversampling */
+	if (sim->noise > 0.0) {
+		env.temperature += sim->noise * 0.01 * sim_gauss(sim) / sqrt(os_t ? 1 << (os_t - 1) : 1);
+		env.pressure += sim->noise * 1.5 * sim_gauss(sim) / sqrt(os_p ? 1 << (os_p - 1) : 1);
+		env.humidity += sim->noise * 0.02 * sim_gauss(sim) / sqrt(os_h ? 1 << (os_h - 1) : 1);
+		env.gas_resistance *= 1.0 + sim->noise * 0.005 * sim_gauss(sim);
+	}
+
+	adc_t = sim_invert(&sim->calib, 0, 0.0, env.temperature, 0xfffff);
+	if (sim->filt_valid && coeff) {
+		sim->filt_temp = (sim->filt_temp * coeff + adc_t) / (coeff + 1);
+	} else {
+		sim->filt_temp = adc_t;
+	}
+	adc_t = (uint32_t)lround(sim->filt_temp);
+	t_fine = sim_t_fine(&sim->calib, adc_t);
+
+	adc_p = sim_invert(&sim->calib, 1, t_fine, env.pressure, 0xfffff);
+	if (sim->filt_valid && coeff)
+		sim->filt_pres = (sim->filt_pres * coeff + adc_p) / (coeff + 1);
+	else
+		sim->filt_pres = adc_p;
+	adc_p = (uint32_t)lround(sim->filt_pres);
+	sim->filt_valid = 1;
+
+	adc_h = sim_invert(&sim->calib, 2, t_fine, env.humidity, 0xffff);
+
+	/* Skipped channels read 0x80000 / 0x8000 like the real part */
+	if (!os_t)
+		adc_t = 0x80000;
+	if (!os_p)
+		adc_p = 0x80000;
+	if (!os_h)
+		adc_h = 0x8000;
+
+	field[0] = BME680_NEW_DATA_MSK | step;
+	field[1]++;
+	field[2] = (uint8_t)(adc_p >> 12);
+	field[3] = (uint8_t)(adc_p >> 4);
+	field[4] = (uint8_t)(adc_p << 4);
+	field[5] = (uint8_t)(adc_t >> 12);
+	field[6] = (uint8_t)(adc_t >> 4);
+	field[7] = (uint8_t)(adc_t << 4);
+	field[8] = (uint8_t)(adc_h >> 8);
+	field[9] = (uint8_t)adc_h;
+
+	if (ctrl_gas & BME680_RUN_GAS_MSK) {
+		gas = sim_gas_adc(&sim->calib, env.gas_resistance);
+		field[13] = (uint8_t)(gas >> 8);
+		field[14] = (uint8_t)gas | BME680_GASM_VALID_MSK;
+		if (sim->regs[BME680_RES_HEAT0_ADDR + step]
+				&& ((uint32_t)(wait & 0x3f) << (2 * (wait >> 6))) >= SIM_HEAT_STAB_MS)
+			field[14] |= BME680_HEAT_STAB_MSK;
+	} else {
+		field[13] = 0;
+		field[14] = 0;
+	}
+
+	/* Back to sleep */
+	sim->regs[BME680_CONF_T_P_MODE_ADDR] &= ~BME680_MODE_MSK;
+	sim->converting = 0;
+	sim->conversions++;
+}
+
+/***********************************************************************
+ * @name sim_update()
+ * @brief Completes a conversion whose time has come
+ * @return void
+ ***********************************************************************/
+static void sim_update(struct bme680_sim *sim)
+{
+	if (sim->converting && (int32_t)(sim_now - sim->conv_end) >= 0)
+		sim_convert(sim);
+}
+
+/***********************************************************************
+ * @name sim_lookup()
+ * @brief Finds the attached simulator answering dev_id
+ * @return simulator, or NULL if none (a NACK)
+ ***********************************************************************/
+static struct bme680_sim *sim_lookup(uint8_t dev_id)
+{
+	uint8_t i;
+
+	for (i = 0; i < BME680_SIM_MAX; i++) {
+		if (sim_table[i] != NULL && sim_table[i]->dev_id == dev_id) {
+			sim_update(sim_table[i]);
+			return sim_table[i];
+		}
+	}
+
+	return NULL;
+}
+
+/***********************************************************************
+ * @name sim_addr()
+ * @brief Maps a bus address to the I2C address map; on SPI the 7-bit
+ *        address is looked up in the page spi_mem_page selects
+ * @return register address
+ ***********************************************************************/
+static uint8_t sim_addr(const struct bme680_sim *sim, uint8_t bus_addr)
+{
+	if (!sim->spi)
+		return bus_addr;
+	bus_addr &= BME680_SPI_WR_MSK;
+	if (bus_addr == SIM_SPI_STATUS)
+		return BME680_MEM_PAGE_ADDR;
+
+	return (sim->regs[BME680_MEM_PAGE_ADDR] & BME680_MEM_PAGE_MSK) ? bus_addr : (bus_addr | 0x80);
+}
+
+/***********************************************************************
+ * @name sim_store()
+ * @brief Applies one register write, with the side effects of soft
+ *        reset and forced mode
+ * @return void
+ ***********************************************************************/
+static void sim_store(struct bme680_sim *sim, uint8_t reg_addr, uint8_t value)
+{
+	if (reg_addr == BME680_SOFT_RESET_ADDR) {
+		if (value == BME680_SOFT_RESET_CMD)
+			sim_reset(sim);
+		return;
+	}
+	if (reg_addr == BME680_MEM_PAGE_ADDR) {
+		sim->regs[reg_addr] = value & BME680_MEM_PAGE_MSK;
+		return;
+	}
+
+	/* Only the control window is writable */
+	if ((reg_addr < BME680_SHADOW_START) || (reg_addr >= BME680_SHADOW_START + BME680_SHADOW_LEN))
+		return;
+
+	sim->regs[reg_addr] = value;
+	if ((reg_addr == BME680_CONF_T_P_MODE_ADDR) && ((value & BME680_MODE_MSK) == BME680_FORCED_MODE)
+			&& !sim->converting) {
+		sim->converting = 1;
+		sim->conv_end = sim_now + sim_duration(sim) + sim->conv_extra;
+		sim->regs[BME680_FIELD0_ADDR] = SIM_MEASURING
+				| ((sim->regs[BME680_CONF_ODR_RUN_GAS_NBC_ADDR] & BME680_RUN_GAS_MSK) ? SIM_GAS_MEASURING : 0);
+	}
+}
+
+/***********************************************************************
+ * @name bme680_sim_init()
+ * @brief Powers up a simulated sensor with the default calibration
+ * @return void
+ ***********************************************************************/
+void bme680_sim_init(struct bme680_sim *sim, uint8_t dev_id, bme680_sim_scenario_fptr_t scenario, double noise)
+{
+	memset(sim, 0, sizeof(*sim));
+	sim->dev_id = dev_id;
+	sim->scenario = scenario;
+	sim->noise = noise;
+	sim->rng = 0x2545F491UL ^ dev_id;
+	sim->calib = sim_calib;
+	sim_load_calib(sim);
+	sim_reset(sim);
+}
+
+/***********************************************************************
+ * @name bme680_sim_set_calib()
+ * @brief Gives the sensor another factory calibration, as a different
+ *        part would have
+ * @return void
+ ***********************************************************************/
+void bme680_sim_set_calib(struct bme680_sim *sim, const struct bme680_calib_data *calib)
+{
+	sim->calib = *calib;
+	sim_load_calib(sim);
+}
+
+/***********************************************************************
+ * @name bme680_sim_attach()
+ * @brief Puts sim on the virtual bus and points dev's bus, delay and
+ *        tick functions at the simulator
+ * @return BME680_OK, or BME680_E_DEV_NOT_FOUND if the bus is full
+ ***********************************************************************/
+int8_t bme680_sim_attach(struct bme680_sim *sim, struct bme680_dev *dev, enum bme680_intf intf)
+{
+	uint8_t i;
+
+	for (i = 0; i < BME680_SIM_MAX; i++) {
+		if (sim_table[i] == NULL || sim_table[i] == sim)
+			break;
+	}
+	if (i == BME680_SIM_MAX)
+		return BME680_E_DEV_NOT_FOUND;
+
+	sim_table[i] = sim;
+	sim->spi = (intf == BME680_SPI_INTF);
+	dev->dev_id = sim->dev_id;
+	dev->intf = intf;
+	dev->read = bme680_sim_read;
+	dev->write = bme680_sim_write;
+	dev->read_async = bme680_sim_read_async;
+	dev->delay_ms = bme680_sim_delay;
+	dev->get_tick = bme680_sim_tick;
+
+	return BME680_OK;
+}
+
+/***********************************************************************
+ * @name bme680_sim_read()
+ * @brief bme680_com_fptr_t read: registers reg_addr onwards
+ * @return 0, or -1 if no simulated sensor has dev_id
+ ***********************************************************************/
+int8_t bme680_sim_read(uint8_t dev_id, uint8_t reg_addr, uint8_t *data, uint16_t len)
+{
+	struct bme680_sim *sim = sim_lookup(dev_id);
+	uint16_t i;
+
+	if (sim == NULL)
+		return -1;
+
+	/* I2C register auto-increment; SPI stays within the page */
+	for (i = 0; i < len; i++)
+		data[i] = sim->regs[sim_addr(sim, (uint8_t)(reg_addr + i))];
+	sim->reads++;
+	sim->bytes += len + (sim->spi ? 1 : 3);
+
+	return 0;
+}
+
+/***********************************************************************
+ * @name bme680_sim_write()
+ * @brief bme680_com_fptr_t write: data[0] goes to reg_addr, the rest
+ *        are address/value pairs as bme680_set_regs() sends them
+ * @return 0, or -1 if no simulated sensor has dev_id
+ ***********************************************************************/
+int8_t bme680_sim_write(uint8_t dev_id, uint8_t reg_addr, uint8_t *data, uint16_t len)
+{
+	struct bme680_sim *sim = sim_lookup(dev_id);
+	uint16_t i;
+
+	if (sim == NULL)
+		return -1;
+
+	if (len > 0)
+		sim_store(sim, sim_addr(sim, reg_addr), data[0]);
+	for (i = 1; i + 1 < len; i += 2)
+		sim_store(sim, sim_addr(sim, data[i]), data[i + 1]);
+	sim->writes++;
+	sim->bytes += len + (sim->spi ? 1 : 2);
+
+	return 0;
+}
+
+/***********************************************************************
+ * @name bme680_sim_read_async()
+ * @brief bme680_com_async_fptr_t read, completed before it returns
+ * @return as bme680_sim_read()
+ ***********************************************************************/
+int8_t bme680_sim_read_async(uint8_t dev_id, uint8_t reg_addr, uint8_t *data, uint16_t len,
+		bme680_com_cplt_fptr_t cplt, void *ctx)
+{
+	int8_t rslt = bme680_sim_read(dev_id, reg_addr, data, len);
+
+	if (rslt == 0)
+		cplt(0, ctx);
+
+	return rslt;
+}
+
+/***********************************************************************
+ * @name bme680_sim_delay()
+ * @brief bme680_delay_fptr_t: advances virtual time
+ * @return void
+ ***********************************************************************/
+void bme680_sim_delay(uint32_t period)
+{
+	sim_now += period;
+}
+
+/***********************************************************************
+ * @name bme680_sim_tick()
+ * @brief bme680_tick_fptr_t / meas_tick_fptr_t: virtual milliseconds
+ * @return virtual time
+ ***********************************************************************/
+uint32_t bme680_sim_tick(void)
+{
+	return sim_now;
+}
+
+/***********************************************************************
+ * @name bme680_sim_now()
+ * @brief Virtual time shared by every simulated sensor
+ * @return ms
+ ***********************************************************************/
+uint32_t bme680_sim_now(void)
+{
+	return sim_now;
+}
+
+/***********************************************************************
+ * @name bme680_sim_advance()
+ * @brief Moves virtual time on, e.g. for a main loop that would sleep
+ * @return void
+ ***********************************************************************/
+void bme680_sim_advance(uint32_t ms)
+{
+	sim_now += ms;
+}
+
+/* ---------------------------------------------------------------------
+ * Scenarios. The baseline is a mine gallery at about 1600 m: 22 degC,
+ * 833 hPa, 25 %rH and 12 kOhm, safe for every statemachine.c threshold.
+ * ------------------------------------------------------------------- */
+
+/* Linear move from a to b between t0 and t1 */
+static double ramp(uint32_t t, uint32_t t0, uint32_t t1, double a, double b)
+{
+	if (t <= t0)
+		return a;
+	if (t >= t1)
+		return b;
+	return a + (b - a) * (double)(t - t0) / (double)(t1 - t0);
+}
+
+static void scen_steady(uint32_t t_ms, struct bme680_sim_env *env)
+{
+	env->temperature = 22.0;
+	env->pressure = 83300.0;
+	env->humidity = 25.0;
+	env->gas_resistance = 12000.0;
+}
+
+static void scen_temp_ramp(uint32_t t_ms, struct bme680_sim_env *env)
+{
+	scen_steady(t_ms, env);
+	env->temperature = ramp(t_ms, 60000, 660000, 22.0, 28.0);
+}
+
+static void scen_pres_spike(uint32_t t_ms, struct bme680_sim_env *env)
+{
+	scen_steady(t_ms, env);
+	env->pressure += ramp(t_ms, 120000, 125000, 0.0, 300.0) - ramp(t_ms, 180000, 240000, 0.0, 300.0);
+}
+
+static void scen_humid(uint32_t t_ms, struct bme680_sim_env *env)
+{
+	scen_steady(t_ms, env);
+	env->humidity = ramp(t_ms, 60000, 360000, 25.0, 32.0);
+}
+
+/* Saturating air: the dew point closes in on the air temperature */
+static void scen_damp(uint32_t t_ms, struct bme680_sim_env *env)
+{
+	scen_steady(t_ms, env);
+	env->humidity = ramp(t_ms, 60000, 360000, 25.0, 96.0);
+}
+
+/* Reducing gases lower the plate resistance */
+static void scen_gas_leak(uint32_t t_ms, struct bme680_sim_env *env)
+{
+	scen_steady(t_ms, env);
+	env->gas_resistance = ramp(t_ms, 60000, 120000, 12000.0, 5000.0)
+			+ ramp(t_ms, 300000, 600000, 0.0, 7000.0);
+}
+
+/* Clean air, the plate ageing: 15 % less resistance over 15 min, a few
+ * months of drift squeezed into one run */
+static void scen_drift(uint32_t t_ms, struct bme680_sim_env *env)
+{
+	scen_steady(t_ms, env);
+	env->gas_resistance = ramp(t_ms, 0, 900000, 12000.0, 10200.0);
+}
+
+/* Blast: heat, overpressure and bad air together */
+static void scen_fire(uint32_t t_ms, struct bme680_sim_env *env)
+{
+	scen_steady(t_ms, env);
+	env->temperature = ramp(t_ms, 60000, 180000, 22.0, 30.0);
+	env->pressure = ramp(t_ms, 60000, 90000, 83300.0, 83700.0);
+	env->gas_resistance = ramp(t_ms, 60000, 120000, 12000.0, 4000.0);
+}
+
+const struct bme680_sim_scenario bme680_sim_scenarios[] = {
+	{ "steady", "constant baseline conditions", scen_steady },
+	{ "temp_ramp", "22 -> 28 degC from 1 to 11 min", scen_temp_ramp },
+	{ "pres_spike", "+300 Pa step at 2 min, decays 3-4 min", scen_pres_spike },
+	{ "humid", "25 -> 32 %rH from 1 to 6 min, gas plate follows", scen_humid },
+	{ "damp", "25 -> 96 %rH from 1 to 6 min, dew point within 1 degC", scen_damp },
+	{ "gas_leak", "12 -> 5 kOhm at 1-2 min, back by 10 min", scen_gas_leak },
+	{ "drift", "clean air, gas plate 12 -> 10.2 kOhm over 15 min", scen_drift },
+	{ "fire", "heat, overpressure and bad air from 1 min", scen_fire },
+	{ NULL, NULL, NULL }
+};
+
+/***********************************************************************
+ * @name bme680_sim_find()
+ * @brief Looks up a built-in scenario by name
+ * @return scenario, or NULL if unknown
+ ***********************************************************************/
+const struct bme680_sim_scenario *bme680_sim_find(const char *name)
+{
+	const struct bme680_sim_scenario *s;
+
+	for (s = bme680_sim_scenarios; s->name != NULL; s++) {
+		if (strcmp(s->name, name) == 0)
+			return s;
+	}
+
+	return NULL;
+}
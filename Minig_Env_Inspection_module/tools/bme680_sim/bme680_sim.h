@@ -0,0 +1,94 @@
+/**
+  ******************************************************************************
+  * @file           : bme680_sim.h
+  * @brief          : Register-level BME680 I2C/SPI simulator for host builds
+  ******************************************************************************
+  * A simulated sensor answers the bme680_dev read/write/delay_ms/get_tick
+  * function pointers with the register map of bme680_defs.h: chip-id, the
+  * two coefficient blocks and res_heat/range_sw_err, the shadowed control
+  * window, soft reset and the field registers. A forced mode write starts a
+  * conversion that takes as long as bme680_get_profile_dur() predicts for
+  * the programmed oversampling and heater step, plus conv_extra; until
+  * then the field registers keep the previous result.
+  *
+  * The environment comes from a scenario evaluated at the end of every
+  * conversion, plus optional noise that shrinks with oversampling. The
+  * readings are turned into ADC codes by inverting the Bosch float
+  * compensation, and T/P go through the IIR filter set in config.
+  *
+  * Time is virtual: delays and polls only advance bme680_sim_now(), so a
+  * day of sampling replays in well under a second. One clock is shared by
+  * all simulated sensors, which are told apart by dev_id.
+  *
+  * On SPI the sensor decodes 7-bit addresses through spi_mem_page (bit 4
+  * of status, 0x73 in both pages) the way the real part does, so the
+  * driver's page switching is exercised too. bytes counts what goes over
+  * the wire, addressing included: len + 3 for an I2C read, len + 2 for an
+  * I2C write and len + 1 for either on SPI.
+  ******************************************************************************/
+
+#ifndef BME680_SIM_H_
+#define BME680_SIM_H_
+
+#include <stdint.h>
+#include "bme680.h"
+
+#define BME680_SIM_MAX		4		/* sensors attached at once */
+
+/* Conditions around the sensor */
+struct bme680_sim_env {
+	double temperature;			/* degC */
+	double pressure;			/* Pa */
+	double humidity;			/* %rH */
+	double gas_resistance;		/* Ohm */
+};
+
+/* Fills env for virtual time t_ms */
+typedef void (*bme680_sim_scenario_fptr_t)(uint32_t t_ms, struct bme680_sim_env *env);
+
+struct bme680_sim_scenario {
+	const char *name;
+	const char *desc;
+	bme680_sim_scenario_fptr_t fn;
+};
+
+/* Built-in scenarios, terminated by an entry with name NULL */
+extern const struct bme680_sim_scenario bme680_sim_scenarios[];
+
+struct bme680_sim {
+	uint8_t dev_id;
+	uint8_t spi;				/* on SPI rather than I2C */
+	uint8_t regs[256];				/* I2C address map */
+	struct bme680_calib_data calib;	/* what the coefficient registers decode to */
+	bme680_sim_scenario_fptr_t scenario;
+	double noise;				/* noise scale, 0 for none */
+	uint32_t rng;
+	uint8_t converting;
+	uint32_t conv_end;
+	int32_t conv_extra;			/* ms added to every conversion; the part runs slow */
+	double filt_temp;			/* IIR state of the T and P ADC codes */
+	double filt_pres;
+	uint8_t filt_valid;
+	struct bme680_sim_env env;	/* environment of the last conversion */
+	uint32_t conversions;
+	uint32_t reads;				/* bus transactions and wire bytes */
+	uint32_t writes;
+	uint32_t bytes;
+};
+
+void bme680_sim_init(struct bme680_sim *sim, uint8_t dev_id, bme680_sim_scenario_fptr_t scenario, double noise);
+void bme680_sim_set_calib(struct bme680_sim *sim, const struct bme680_calib_data *calib);
+int8_t bme680_sim_attach(struct bme680_sim *sim, struct bme680_dev *dev, enum bme680_intf intf);
+const struct bme680_sim_scenario *bme680_sim_find(const char *name);
+
+uint32_t bme680_sim_now(void);
+void bme680_sim_advance(uint32_t ms);
+
+int8_t bme680_sim_read(uint8_t dev_id, uint8_t reg_addr, uint8_t *data, uint16_t len);
+int8_t bme680_sim_write(uint8_t dev_id, uint8_t reg_addr, uint8_t *data, uint16_t len);
+int8_t bme680_sim_read_async(uint8_t dev_id, uint8_t reg_addr, uint8_t *data, uint16_t len,
+		bme680_com_cplt_fptr_t cplt, void *ctx);
+void bme680_sim_delay(uint32_t period);
+uint32_t bme680_sim_tick(void);
+
+#endif /* BME680_SIM_H_ */
@@ -0,0 +1,282 @@
+/**
+  ******************************************************************************
+  * @file           : engine_test.c
+  * @brief          : Checks meas_engine.c and sensor_array.c against the simulator
+  ******************************************************************************
+  * One simulated BME680 whose conversions take conv_extra ms longer than
+  * bme680_get_profile_dur() predicts. Each case runs both with the polled
+  * field read and with the read_async path. Virtual time moves 1 ms per
+  * service call, as in app_tasks.c's sample task.
+  *   on time   the sample arrives at the profile duration, no errors
+  *   slow      the engine keeps polling and the sample arrives within one
+  *             poll period of the end of the conversion
+  *   timeout   a conversion that outlasts MEAS_ENGINE_MAX_POLLS polls is
+  *             reported as BME680_W_NO_NEW_DATA. A trigger while the sensor
+  *             still converts is refused with BME680_W_MEAS_BUSY, and the
+  *             trigger after the conversion ends works again.
+  *   refused   sensor_array over 10 periods, one conversion of which
+  *             outlasts the timeout and the next trigger time. The refused
+  *             trigger is retried in its own period, so only the timed out
+  *             sample is lost and the slot keeps its phase.
+  *   scan      main.c's ten-step BME680_GAS_SCAN profile. Loading it takes
+  *             2 bus writes, res_heat_x and gas_wait_x; ctrl_gas_1 already
+  *             selects step 0, so the shadow skips it. Every sample then
+  *             takes 2 (ctrl_gas_1 for its step and ctrl_meas), except the
+  *             first, whose step is already selected. Three passes give
+  *             three scans with every step valid and heat-stable.
+  * Prints one line per case and exits 1 if any fails.
+  *
+  *     make engine_test && ./engine_test
+  ******************************************************************************
+**/
+
+#include <stdio.h>
+#include <string.h>
+
+#include "bme680_sim.h"
+#include "meas_engine.h"
+#include "sensor_array.h"
+
+#define PERIOD_MS		1000
+#define PERIODS			10
+
+static struct bme680_sim sim;
+static struct bme680_dev dev;
+static struct meas_engine eng;
+
+static int8_t last_rslt;
+static uint32_t done_at, delivered;
+
+/* main.c's BME680_GAS_SCAN profile */
+static const struct bme680_heatr_profile scan_profile = {
+	.heatr_temp = { 200, 220, 240, 260, 280, 300, 320, 340, 360, 380 },
+	.heatr_dur = { 100, 100, 100, 100, 100, 100, 100, 100, 100, 100 },
+	.len = BME680_HEATR_STEPS
+};
+static struct meas_gas_scan last_scan;
+static uint32_t scans;
+
+static void steady(uint32_t t_ms, struct bme680_sim_env *env)
+{
+	env->temperature = 22.0;
+	env->pressure = 98000.0;
+	env->humidity = 45.0;
+	env->gas_resistance = 80000.0;
+}
+
+/* A fresh sensor with main.c's settings */
+static int setup(int async, int32_t extra)
+{
+	memset(&dev, 0, sizeof(dev));
+	bme680_sim_init(&sim, 0x77, steady, 0.0);
+	bme680_sim_attach(&sim, &dev, BME680_I2C_INTF);
+	if (!async)
+		dev.read_async = NULL;
+	dev.amb_temp = 25;
+	if (bme680_init(&dev) != BME680_OK)
+		return -1;
+
+	dev.tph_sett.os_temp = BME680_OS_8X;
+	dev.tph_sett.os_pres = BME680_OS_4X;
+	dev.tph_sett.os_hum = BME680_OS_2X;
+	dev.tph_sett.filter = BME680_FILTER_SIZE_3;
+	dev.gas_sett.run_gas = BME680_ENABLE_GAS_MEAS;
+	dev.gas_sett.heatr_temp = 320;
+	dev.gas_sett.heatr_dur = 150;
+	dev.power_mode = BME680_FORCED_MODE;
+	if (bme680_set_sensor_settings(BME680_OST_SEL | BME680_OSP_SEL | BME680_OSH_SEL | BME680_FILTER_SEL
+			| BME680_GAS_SENSOR_SEL, &dev) != BME680_OK)
+		return -1;
+
+	sim.conv_extra = extra;
+	return 0;
+}
+
+static void engine_ready(int8_t rslt, const struct bme680_field_data *data, void *ctx)
+{
+	last_rslt = rslt;
+	done_at = bme680_sim_now();
+	if (rslt == BME680_OK)
+		delivered++;
+}
+
+/* Services the engine until it goes idle or limit ms pass */
+static void run_engine(uint32_t limit)
+{
+	uint32_t end = bme680_sim_now() + limit;
+
+	while (meas_engine_busy(&eng) && (int32_t)(bme680_sim_now() - end) < 0) {
+		bme680_sim_advance(1);
+		meas_engine_service(&eng);
+	}
+}
+
+static int report(const char *name, int async, int ok, const char *detail)
+{
+	printf("%-8s %-6s %s  %s\n", name, async ? "async" : "polled", ok ? "pass" : "FAIL", detail);
+	return !ok;
+}
+
+/* One conversion, extra ms late; ok if it arrives within a poll period of the sensor */
+static int case_late(const char *name, int async, int32_t extra)
+{
+	char detail[96];
+	uint32_t t0, reads, sensor;
+	uint16_t dur;
+	int ok;
+
+	if (setup(async, extra) != 0)
+		return report(name, async, 0, "setup failed");
+	meas_engine_init(&eng, &dev, bme680_sim_tick, engine_ready, NULL);
+	bme680_get_profile_dur(&dur, &dev);
+	delivered = 0;
+	reads = sim.reads;
+	t0 = bme680_sim_now();
+	ok = meas_engine_start(&eng) == BME680_OK;
+	sensor = sim.conv_end - t0;
+	run_engine(2000);
+
+	/* The async path compensates on the service call after the read */
+	ok = ok && last_rslt == BME680_OK && delivered == 1 && eng.errors == 0 && done_at - t0 >= sensor
+			&& done_at - t0 <= sensor + BME680_POLL_PERIOD_MS + (async ? 1 : 0);
+	snprintf(detail, sizeof(detail), "profile %u ms, sensor %u ms, sample at %u ms, %u reads", dur, sensor,
+			done_at - t0, sim.reads - reads);
+	return report(name, async, ok, detail);
+}
+
+static int case_timeout(int async)
+{
+	char detail[96];
+	int8_t refused, again;
+	uint32_t t0, sensor, gave_up;
+	int32_t extra = MEAS_ENGINE_MAX_POLLS * BME680_POLL_PERIOD_MS + 50;
+	int ok;
+
+	if (setup(async, extra) != 0)
+		return report("timeout", async, 0, "setup failed");
+	meas_engine_init(&eng, &dev, bme680_sim_tick, engine_ready, NULL);
+	delivered = 0;
+	t0 = bme680_sim_now();
+	ok = meas_engine_start(&eng) == BME680_OK;
+	sensor = sim.conv_end - t0;
+	ok = ok && meas_engine_start(&eng) == BME680_W_MEAS_BUSY;
+	run_engine(2000);
+	gave_up = done_at - t0;
+	ok = ok && last_rslt == BME680_W_NO_NEW_DATA && delivered == 0 && eng.errors == 1 && gave_up < sensor;
+
+	/* The sensor has not finished: the next trigger is refused */
+	refused = meas_engine_start(&eng);
+	ok = ok && refused == BME680_W_MEAS_BUSY && !meas_engine_busy(&eng);
+
+	bme680_sim_advance(sim.conv_end - bme680_sim_now());
+	sim.conv_extra = 0;
+	again = meas_engine_start(&eng);
+	run_engine(2000);
+	ok = ok && again == BME680_OK && last_rslt == BME680_OK && delivered == 1;
+
+	snprintf(detail, sizeof(detail), "gave up at %u ms of %u, retrigger %d, after the sensor %d", gave_up, sensor,
+			refused, again);
+	return report("timeout", async, ok, detail);
+}
+
+static void array_sample(uint8_t idx, int8_t rslt, const struct bme680_field_data *data, void *ctx)
+{
+	if (rslt == BME680_OK)
+		delivered++;
+}
+
+static uint8_t bus_idle(uint8_t dev_id)
+{
+	return 0;
+}
+
+static int case_refused(int async)
+{
+	struct sensor_array arr;
+	struct sensor_node *node;
+	char detail[112];
+	uint32_t t0, end;
+	uint8_t armed = 1;
+	int ok;
+
+	if (setup(async, 0) != 0)
+		return report("refused", async, 0, "setup failed");
+	sensor_array_init(&arr, bme680_sim_tick, bus_idle, PERIOD_MS, array_sample, NULL);
+	sensor_array_add(&arr, &dev);
+	node = &arr.node[0];
+	delivered = 0;
+	t0 = bme680_sim_now();
+	end = t0 + PERIODS * PERIOD_MS;
+	sensor_array_start(&arr);
+
+	while ((int32_t)(bme680_sim_now() - end) < 0) {
+		/* The third conversion runs past the next trigger time */
+		if (armed && sim.conversions == 2 && !sim.converting)
+			sim.conv_extra = PERIOD_MS + 150;
+		if (armed && sim.converting && sim.conv_extra != 0) {
+			sim.conv_extra = 0;
+			armed = 0;
+		}
+		sensor_array_service(&arr);
+		bme680_sim_advance(1);
+	}
+
+	ok = delivered == PERIODS - 1 && node->health.errors == 1 && node->health.refused > 0
+			&& (node->next_trigger - t0) % PERIOD_MS == 0;
+	snprintf(detail, sizeof(detail), "%u samples in %u periods, %u timeout, %u triggers refused, slot +%u ms",
+			delivered, PERIODS, node->health.errors, node->health.refused, (node->next_trigger - t0) % PERIOD_MS);
+	return report("refused", async, ok, detail);
+}
+
+static void scan_done(const struct meas_gas_scan *scan, void *ctx)
+{
+	last_scan = *scan;
+	scans++;
+}
+
+static int case_scan(int async)
+{
+	char detail[112];
+	uint32_t writes, load, per_sample, i, n = 3 * BME680_HEATR_STEPS, all = (1U << BME680_HEATR_STEPS) - 1;
+	int ok;
+
+	if (setup(async, 0) != 0)
+		return report("scan", async, 0, "setup failed");
+	meas_engine_init(&eng, &dev, bme680_sim_tick, engine_ready, NULL);
+	meas_engine_set_scan(&eng, scan_done);
+	scans = 0;
+	delivered = 0;
+
+	writes = sim.writes;
+	ok = bme680_set_heatr_profile(&scan_profile, &dev) == BME680_OK;
+	load = sim.writes - writes;
+
+	writes = sim.writes;
+	for (i = 0; ok && i < n; i++) {
+		ok = meas_engine_start(&eng) == BME680_OK;
+		run_engine(2000);
+	}
+	per_sample = sim.writes - writes;
+
+	ok = ok && load == 2 && per_sample == 2 * n - 1 && delivered == n && scans == 3 && last_scan.len == BME680_HEATR_STEPS
+			&& last_scan.valid == all;
+	snprintf(detail, sizeof(detail), "load %u writes, %u writes in %u samples, %u scans, valid 0x%03x", load,
+			per_sample, n, scans, last_scan.valid);
+	return report("scan", async, ok, detail);
+}
+
+int main(void)
+{
+	int failed = 0, async;
+
+	for (async = 0; async <= 1; async++) {
+		failed += case_late("on time", async, 0);
+		failed += case_late("slow", async, 35);
+		failed += case_timeout(async);
+		failed += case_refused(async);
+		failed += case_scan(async);
+	}
+	printf("%d failed\n", failed);
+
+	return failed ? 1 : 0;
+}
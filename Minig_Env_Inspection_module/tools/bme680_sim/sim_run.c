@@ -0,0 +1,648 @@
+/**
+  ******************************************************************************
+  * @file           : sim_run.c
+  * @brief          : Runs the firmware's BME680 stack against the simulator
+  ******************************************************************************
+  * Brings up bme680_sim sensors through the real bme680_init() and
+  * bme680_set_sensor_settings(), samples them every period of virtual time
+  * the way main.c does, with os_ctrl adapting sensor 0's oversampling, and
+  * feeds sensor 0 to sensor_statemachine(). At the
+  * end it prints the largest error of the compensated readings against the
+  * scenario, LED changes, the peak air-quality index, bus traffic,
+  * dev->stats and the speed-up over real time. With -w sensor 0's field
+  * bursts are recorded as a frame_log capture for frame_replay. With -T
+  * the loop is main.c's task set under task_sched, in virtual time, and
+  * the task table is printed at the end; execution times are host ns.
+  * -B boots sensor 0 through calib_cache.c instead, on a RAM stand-in for
+  * flash sector 7, and prints the bus traffic of each boot: plain
+  * bme680_init(), a cold boot that fills the cache, a cached boot, a boot
+  * after the part is swapped and one after calib_cache_invalidate().
+  * With -d an asynchronous field read holds its bus for its wire time,
+  * rounded up to a whole ms, before it completes, so sensor_array has to
+  * defer the other nodes on that bus; any access that still finds the bus
+  * busy is counted as a collision. -1 puts every sensor on I2C1.
+  *
+  *     make && ./sim_run [-s scenario] [-t seconds] [-p period_ms] [-n sensors]
+  *                       [-N noise] [-f] [-b] [-S] [-c] [-v] [-w capture]
+  *                       [-T display_ms] [-B] [-d] [-1]
+  *   -s  scenario, see -l for the list (default steady)
+  *   -t  virtual run time in seconds (default 900)
+  *   -p  sample period in ms (default 5000, main.c's BME680_SAMPLE_PERIOD_MS)
+  *   -n  number of sensors, 1 to BME680_SIM_MAX, sampled by sensor_array
+  *   -N  noise scale, 0 for noise-free readings (default 1)
+  *   -f  fixed oversampling and filter, no os_ctrl
+  *   -b  blocking driver calls instead of the sensor_array/meas_engine path
+  *   -S  sensors on SPI (chip selects 0..n-1) instead of I2C
+  *   -c  print one CSV line per sensor 0 sample
+  *   -v  show the state machine console output
+  *   -w  record sensor 0 to a capture file
+  *   -T  run main.c's tasks, the display refreshed every display_ms
+  *   -B  boot traffic with and without the calibration cache
+  *   -d  field reads hold the bus until their last byte
+  *   -1  all sensors on I2C1 (0x77..0x74, more than a real bus can take)
+  *   -l  list the scenarios
+  ******************************************************************************
+**/
+
+#include <math.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "main.h"
+#include "bme680_sim.h"
+#include "calib_cache.h"
+#include "frame_log.h"
+#include "os_ctrl.h"
+#include "sensor_array.h"
+#include "statemachine.h"
+#include "task_sched.h"
+#include "stm32f4xx_hal.h"
+
+GPIO_TypeDef host_gpiod;
+static int verbose;
+static int csv;
+
+/* Same bus/address positions as main.c; bit 7 selects I2C2 */
+static const uint8_t sim_ids[BME680_SIM_MAX] = { 0x77, 0x76, 0x80 | 0x77, 0x80 | 0x76 };
+static const uint8_t sim_ids_bus1[BME680_SIM_MAX] = { 0x77, 0x76, 0x75, 0x74 };
+
+/* Wire time per byte: 9 clocks at 400 kHz I2C, 8 at spi_transport.c's 6 MHz */
+#define I2C_BYTE_US		22.5
+#define SPI_BYTE_US		(8.0 / 6.0)
+
+static struct bme680_sim sims[BME680_SIM_MAX];
+static struct bme680_dev devs[BME680_SIM_MAX];
+static struct sensor_array sensors;
+static struct os_ctrl os_ctrl;
+static int adaptive = 1;
+
+/* Largest |reading - scenario| of sensor 0 per channel, in degC, Pa, %rH, % */
+static double max_err[4];
+static uint32_t led_changes;
+static uint32_t samples;
+static uint16_t aq_max;
+
+static struct frame_log capture;
+
+/* main.c's sample and telemetry periods, and its task set for -T */
+#define SIM_SAMPLE_PERIOD_MS	5000
+#define SIM_TELEMETRY_MS	5000
+
+static struct task_sched tasks;
+static struct bme680_field_data latest, shown;
+static struct derived_data derived;
+static int tasked, ready;
+static uint32_t seq, frames;
+
+/* -d: the field read in flight on each bus, completed at done_at */
+struct sim_bus {
+	uint8_t busy;
+	int8_t rslt;
+	uint32_t done_at;
+	bme680_com_cplt_fptr_t cplt;
+	void *ctx;
+};
+
+static struct sim_bus buses[2];
+static int held, held_spi;
+static uint32_t collisions;
+
+void HAL_GPIO_WritePin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin, GPIO_PinState PinState)
+{
+	if (PinState == GPIO_PIN_SET)
+		GPIOx->ODR |= GPIO_Pin;
+	else
+		GPIOx->ODR &= ~(uint32_t)GPIO_Pin;
+}
+
+void myprintf(const char *fmt, ...)
+{
+	va_list args;
+
+	if (!verbose)
+		return;
+	va_start(args, fmt);
+	vprintf(fmt, args);
+	va_end(args);
+}
+
+static double now_s(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* Checks a sensor 0 sample against the scenario and runs the state machine */
+static void sample0(const struct bme680_field_data *data, const struct derived_data *derived)
+{
+	const struct bme680_sim_env *env = &sims[0].env;
+	uint32_t leds = host_gpiod.ODR;
+	double t = data->temperature / (double)BME680_TEMP_SCALE;
+	double p = data->pressure / (double)BME680_PRES_SCALE;
+	double h = data->humidity / (double)BME680_HUM_SCALE;
+	double g = data->gas_resistance / (double)BME680_GAS_SCALE;
+
+	samples++;
+	if (sims[0].noise == 0.0) {
+		max_err[0] = fmax(max_err[0], fabs(t - env->temperature));
+		max_err[1] = fmax(max_err[1], fabs(p - env->pressure));
+		max_err[2] = fmax(max_err[2], fabs(h - env->humidity));
+		max_err[3] = fmax(max_err[3], fabs(g - env->gas_resistance) * 100.0 / env->gas_resistance);
+	}
+
+	frame_log_add(&capture, bme680_sim_now(), &sims[0].regs[BME680_FIELD0_ADDR]);
+
+	sensor_statemachine(data, derived);
+	if (host_gpiod.ODR != leds)
+		led_changes++;
+	if (air_quality.index > aq_max)
+		aq_max = air_quality.index;
+
+	if (csv)
+		printf("%u,%u,%.2f,%.2f,%.3f,%.0f,%.2f,%.2f,%.3f,%.0f,%u,%04x\n", bme680_sim_now(), data->meas_index,
+				env->temperature, env->pressure, env->humidity, env->gas_resistance, t, p, h, g,
+				air_quality.index, (unsigned)host_gpiod.ODR);
+}
+
+/* app_tasks.c's BME680_Ready() for sensor 0 */
+static void array_ready(uint8_t idx, int8_t rslt, const struct bme680_field_data *data, void *ctx)
+{
+	uint16_t meas_dur;
+
+	if (idx != 0 || rslt != BME680_OK)
+		return;
+
+	if (tasked) {
+		latest = *data;
+		ready = 1;
+	} else {
+		derived_compute(data, DERIVED_SEA_LEVEL_PA, &derived);
+		sample0(data, &derived);
+	}
+	if (adaptive) {
+		bme680_get_profile_dur(&meas_dur, &sensors.node[0].dev);
+		if (os_ctrl_update(&os_ctrl, data, bme680_sim_now(), meas_dur))
+			os_ctrl_apply(&os_ctrl, &sensors.node[0].dev);
+	}
+}
+
+/* Bit 7 of dev_id selects I2C2; the SPI sensors share one bus */
+static struct sim_bus *bus_of(uint8_t dev_id)
+{
+	return &buses[(!held_spi && (dev_id & 0x80)) ? 1 : 0];
+}
+
+static uint8_t bus_idle(uint8_t dev_id)
+{
+	return bus_of(dev_id)->busy;
+}
+
+static int8_t held_read(uint8_t dev_id, uint8_t reg_addr, uint8_t *data, uint16_t len)
+{
+	if (bus_of(dev_id)->busy)
+		collisions++;
+	return bme680_sim_read(dev_id, reg_addr, data, len);
+}
+
+static int8_t held_write(uint8_t dev_id, uint8_t reg_addr, uint8_t *data, uint16_t len)
+{
+	if (bus_of(dev_id)->busy)
+		collisions++;
+	return bme680_sim_write(dev_id, reg_addr, data, len);
+}
+
+/* Reads at once but completes only once the last byte would be on the wire */
+static int8_t held_read_async(uint8_t dev_id, uint8_t reg_addr, uint8_t *data, uint16_t len,
+		bme680_com_cplt_fptr_t cplt, void *ctx)
+{
+	struct sim_bus *bus = bus_of(dev_id);
+	double us = (len + (held_spi ? 1 : 3)) * (held_spi ? SPI_BYTE_US : I2C_BYTE_US);
+
+	if (bus->busy) {
+		collisions++;
+		return -1;
+	}
+	bus->rslt = bme680_sim_read(dev_id, reg_addr, data, len);
+	if (bus->rslt != 0)
+		return bus->rslt;
+	bus->busy = 1;
+	bus->done_at = bme680_sim_now() + (uint32_t)ceil(us / 1000.0);
+	bus->cplt = cplt;
+	bus->ctx = ctx;
+
+	return 0;
+}
+
+/* Completes the reads whose time is up, as the DMA interrupts would */
+static void bus_service(void)
+{
+	struct sim_bus *bus;
+	int i;
+
+	for (i = 0; i < 2; i++) {
+		bus = &buses[i];
+		if (bus->busy && (int32_t)(bme680_sim_now() - bus->done_at) >= 0) {
+			bus->busy = 0;
+			bus->cplt(bus->rslt, bus->ctx);
+		}
+	}
+}
+
+static void capture_write(const void *buf, uint16_t len, void *ctx)
+{
+	fwrite(buf, 1, len, ctx);
+}
+
+/* main.c's blocking loop before the measurement engine */
+static void run_blocking(uint32_t period, uint32_t end)
+{
+	struct bme680_field_data data;
+	uint32_t t_next = bme680_sim_now();
+	uint16_t dur;
+
+	while ((int32_t)(bme680_sim_now() - end) < 0) {
+		bme680_set_sensor_mode(&devs[0]);
+		bme680_get_profile_dur(&dur, &devs[0]);
+		bme680_sim_delay(dur);
+		if (bme680_get_sensor_data(&data, &devs[0]) == BME680_OK && (data.status & BME680_NEW_DATA_MSK)) {
+			derived_compute(&data, DERIVED_SEA_LEVEL_PA, &derived);
+			sample0(&data, &derived);
+		}
+
+		t_next += period;
+		if ((int32_t)(t_next - bme680_sim_now()) > 0)
+			bme680_sim_advance(t_next - bme680_sim_now());
+	}
+}
+
+/* main.c's BME680_Read() loop: service, then sleep to the next tick */
+static void run_array(uint32_t end)
+{
+	sensor_array_start(&sensors);
+	while ((int32_t)(bme680_sim_now() - end) < 0) {
+		sensor_array_service(&sensors);
+		bme680_sim_advance(1);
+		bus_service();
+	}
+}
+
+/* app_tasks.c's tasks, minus the hardware: the display task formats the OLED
+ * rows into a buffer and the telemetry task prints through myprintf() */
+static void task_sample(void *ctx)
+{
+	sensor_array_service(&sensors);
+}
+
+static void task_compensate(void *ctx)
+{
+	if (!ready)
+		return;
+	ready = 0;
+	shown = latest;
+	derived_compute(&shown, DERIVED_SEA_LEVEL_PA, &derived);
+	seq++;
+}
+
+static void task_state(void *ctx)
+{
+	static uint32_t done;
+
+	if (done == seq)
+		return;
+	done = seq;
+	sample0(&shown, &derived);
+}
+
+static void task_display(void *ctx)
+{
+	char row[6][24];
+
+	if (seq == 0)
+		return;
+	snprintf(row[0], sizeof(row[0]), "ESD PROJECT 2023");
+	snprintf(row[1], sizeof(row[1]), "Dew:%.2fC %ldm ", derived.dew_point / 100.0, (long)(derived.height / 100));
+	snprintf(row[2], sizeof(row[2]), "Temp:%.2fdegC", shown.temperature / (double)BME680_TEMP_SCALE);
+	snprintf(row[3], sizeof(row[3]), "Humi:%.2f %%rH ", shown.humidity / (double)BME680_HUM_SCALE);
+	snprintf(row[4], sizeof(row[4]), "Press:%.2fhPa", shown.pressure / (100.0 * BME680_PRES_SCALE));
+	snprintf(row[5], sizeof(row[5]), "AIRQUAL:%.2fKohms ", shown.gas_resistance / (1000.0 * BME680_GAS_SCALE));
+	frames += row[0][0] != 0;
+}
+
+static void task_telemetry(void *ctx)
+{
+	if (seq == 0)
+		return;
+	myprintf("\n %u ms: %.2f C %.2f hPa %.3f %%rH, gas index %u\n", bme680_sim_now(),
+			shown.temperature / (double)BME680_TEMP_SCALE, shown.pressure / (100.0 * BME680_PRES_SCALE),
+			shown.humidity / (double)BME680_HUM_SCALE, air_quality.index);
+}
+
+static uint32_t host_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint32_t)(ts.tv_sec * 1000000000ULL + ts.tv_nsec);
+}
+
+static void idle_advance(void)
+{
+	bme680_sim_advance(1);
+	bus_service();
+}
+
+/* main.c's task_sched loop; idle time advances virtual time by a tick */
+static void run_tasks(uint32_t display, uint32_t end)
+{
+	sensor_array_start(&sensors);
+	task_sched_init(&tasks, bme680_sim_tick, host_ns, 1000000, idle_advance);
+	task_sched_add(&tasks, "sample", task_sample, NULL, 1, 5, 0);
+	task_sched_add(&tasks, "compensate", task_compensate, NULL, 50, 50, 0);
+	task_sched_add(&tasks, "state", task_state, NULL, 100, 100, 10);
+	task_sched_add(&tasks, "display", task_display, NULL, display, 100, 20);
+	task_sched_add(&tasks, "telemetry", task_telemetry, NULL, SIM_TELEMETRY_MS, 500, 30);
+	task_sched_start(&tasks);
+	while ((int32_t)(bme680_sim_now() - end) < 0)
+		task_sched_run(&tasks);
+}
+
+/* Flash sector 7 for calib_cache.c: erased to 0xFF, programming only clears bits */
+uint32_t host_flash[HOST_FLASH_WORDS];
+
+HAL_StatusTypeDef HAL_FLASH_Unlock(void)
+{
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_FLASH_Lock(void)
+{
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_FLASHEx_Erase(FLASH_EraseInitTypeDef *pEraseInit, uint32_t *SectorError)
+{
+	memset(host_flash, 0xFF, sizeof(host_flash));
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_FLASH_Program(uint32_t TypeProgram, uint32_t Address, uint64_t Data)
+{
+	uint32_t word = (Address - CALIB_CACHE_ADDR) / 4;
+
+	if (word >= HOST_FLASH_WORDS)
+		return HAL_ERROR;
+	host_flash[word] &= (uint32_t)Data;
+	return HAL_OK;
+}
+
+/* Powers sensor 0 up with calib and boots it one way; prints its bus traffic */
+static int boot_once(const char *name, int spi, const struct bme680_calib_data *calib, int cached,
+		enum calib_cache_src expect)
+{
+	static const char *const src_names[] = { "cache", "sensor", "sensor, not saved" };
+	struct bme680_sim *sim = &sims[0];
+	struct bme680_dev *dev = &devs[0];
+	enum calib_cache_src src = CALIB_FROM_SENSOR;
+	int8_t rslt;
+	int ok;
+
+	bme680_sim_init(sim, spi ? 0 : sim_ids[0], bme680_sim_scenarios[0].fn, 0.0);
+	bme680_sim_set_calib(sim, calib);
+	memset(dev, 0, sizeof(*dev));
+	bme680_sim_attach(sim, dev, spi ? BME680_SPI_INTF : BME680_I2C_INTF);
+	dev->amb_temp = 25;
+
+	rslt = cached ? calib_cache_init(dev, &src) : bme680_init(dev);
+	ok = rslt == BME680_OK && (!cached || src == expect) && dev->calib.par_t1 == calib->par_t1
+			&& dev->calib.par_h1 == calib->par_h1 && dev->calib.par_gh2 == calib->par_gh2
+			&& dev->calib.res_heat_val == calib->res_heat_val;
+	fprintf(stderr, "%-12s %5u %6u %5u  %s%s\n", name, sim->reads, sim->writes, sim->bytes,
+			cached ? src_names[src] : "sensor", ok ? "" : "  CHECK FAILED");
+	return !ok;
+}
+
+/* Cold, cached, swapped-part and invalidated boots of sensor 0 */
+static int boot_report(int spi)
+{
+	struct bme680_calib_data calib, other;
+	int bad = 0;
+
+	bme680_sim_init(&sims[0], 0, bme680_sim_scenarios[0].fn, 0.0);
+	calib = sims[0].calib;
+	/* Another part: every trimmed coefficient a little off */
+	other = calib;
+	other.par_t1 += 17;
+	other.par_h1 += 3;
+	other.par_gh2 -= 40;
+	other.res_heat_val += 2;
+
+	fprintf(stderr, "boot on %s    reads writes bytes  calibration from\n", spi ? "SPI" : "I2C");
+	bad += boot_once("bme680_init", spi, &calib, 0, CALIB_FROM_SENSOR);
+	HAL_FLASHEx_Erase(NULL, NULL);
+	bad += boot_once("cold", spi, &calib, 1, CALIB_FROM_SENSOR);
+	bad += boot_once("cached", spi, &calib, 1, CALIB_FROM_CACHE);
+	bad += boot_once("swapped", spi, &other, 1, CALIB_FROM_SENSOR);
+	bad += boot_once("swapped 2nd", spi, &other, 1, CALIB_FROM_CACHE);
+	calib_cache_invalidate();
+	bad += boot_once("invalidated", spi, &other, 1, CALIB_FROM_SENSOR);
+
+	return bad ? 1 : 0;
+}
+
+int main(int argc, char **argv)
+{
+	const struct bme680_sim_scenario *scen = bme680_sim_scenarios;
+	const struct bme680_meas_stats *st;
+	uint32_t seconds = 900, period = SIM_SAMPLE_PERIOD_MS, display = 1000, reads = 0, writes = 0, bytes = 0, readouts = 0;
+	uint32_t array_samples = 0, deferred = 0, errors = 0;
+	int count = 1, blocking = 0, spi = 0, boot = 0, bus1 = 0, opt, i;
+	double noise = 1.0, t0, wall;
+	FILE *out = NULL;
+
+	while ((opt = getopt(argc, argv, "s:t:p:n:N:fbScvw:T:Bd1l")) != -1) {
+		switch (opt) {
+		case 's':
+			scen = bme680_sim_find(optarg);
+			if (scen == NULL) {
+				fprintf(stderr, "unknown scenario %s, -l lists them\n", optarg);
+				return 1;
+			}
+			break;
+		case 't':
+			seconds = strtoul(optarg, NULL, 0);
+			break;
+		case 'p':
+			period = strtoul(optarg, NULL, 0);
+			break;
+		case 'n':
+			count = atoi(optarg);
+			break;
+		case 'N':
+			noise = atof(optarg);
+			break;
+		case 'f':
+			adaptive = 0;
+			break;
+		case 'b':
+			blocking = 1;
+			break;
+		case 'S':
+			spi = 1;
+			break;
+		case 'c':
+			csv = 1;
+			break;
+		case 'v':
+			verbose = 1;
+			break;
+		case 'w':
+			out = fopen(optarg, "wb");
+			if (out == NULL) {
+				perror(optarg);
+				return 1;
+			}
+			break;
+		case 'T':
+			tasked = 1;
+			display = strtoul(optarg, NULL, 0);
+			break;
+		case 'B':
+			boot = 1;
+			break;
+		case 'd':
+			held = 1;
+			break;
+		case '1':
+			bus1 = 1;
+			break;
+		case 'l':
+			for (scen = bme680_sim_scenarios; scen->name != NULL; scen++)
+				printf("%-12s %s\n", scen->name, scen->desc);
+			return 0;
+		default:
+			fprintf(stderr, "usage: %s [-s scenario] [-t seconds] [-p period_ms] [-n sensors] [-N noise] "
+					"[-f] [-b] [-S] [-c] [-v] [-w capture] [-T display_ms] [-B] [-d] [-1] [-l]\n", argv[0]);
+			return 1;
+		}
+	}
+	if (boot)
+		return boot_report(spi);
+	if (count < 1 || count > BME680_SIM_MAX || (blocking && count != 1)) {
+		fprintf(stderr, "-n takes 1 to %d sensors, -b only 1\n", BME680_SIM_MAX);
+		return 1;
+	}
+	if (blocking && tasked) {
+		fprintf(stderr, "-b and -T are different loops\n");
+		return 1;
+	}
+	if (blocking && held) {
+		fprintf(stderr, "-d needs the sensor_array path\n");
+		return 1;
+	}
+	if (blocking)
+		adaptive = 0;
+	held_spi = spi;
+
+	if (csv)
+		printf("t_ms,meas_index,env_t,env_p,env_h,env_g,temperature,pressure,humidity,gas_resistance,aq_index,leds\n");
+
+	sensor_array_init(&sensors, bme680_sim_tick, bus_idle, period, array_ready, NULL);
+	for (i = 0; i < count; i++) {
+		bme680_sim_init(&sims[i], spi ? i : bus1 ? sim_ids_bus1[i] : sim_ids[i], scen->fn, noise);
+		bme680_sim_attach(&sims[i], &devs[i], spi ? BME680_SPI_INTF : BME680_I2C_INTF);
+		if (held) {
+			devs[i].read = held_read;
+			devs[i].write = held_write;
+			devs[i].read_async = held_read_async;
+		}
+		devs[i].amb_temp = 25;
+		if (bme680_init(&devs[i]) != BME680_OK) {
+			fprintf(stderr, "sensor %d: bme680_init failed\n", i);
+			return 1;
+		}
+
+		/* main.c's settings: the top os_ctrl level */
+		os_ctrl_init(&os_ctrl, OS_CTRL_LEVELS - 1);
+		os_ctrl_settings(&os_ctrl, &devs[i].tph_sett);
+		devs[i].gas_sett.run_gas = BME680_ENABLE_GAS_MEAS;
+		devs[i].gas_sett.heatr_temp = 320;
+		devs[i].gas_sett.heatr_dur = 150;
+		devs[i].power_mode = BME680_FORCED_MODE;
+		if (bme680_set_sensor_settings(BME680_OST_SEL | BME680_OSP_SEL | BME680_OSH_SEL | BME680_FILTER_SEL
+				| BME680_GAS_SENSOR_SEL, &devs[i]) != BME680_OK) {
+			fprintf(stderr, "sensor %d: bme680_set_sensor_settings failed\n", i);
+			return 1;
+		}
+		if (!blocking)
+			sensor_array_add(&sensors, &devs[i]);
+	}
+	if (out != NULL)
+		frame_log_begin(&capture, &devs[0], capture_write, out);
+
+	t0 = now_s();
+	if (blocking)
+		run_blocking(period, bme680_sim_now() + seconds * 1000);
+	else if (tasked)
+		run_tasks(display, bme680_sim_now() + seconds * 1000);
+	else
+		run_array(bme680_sim_now() + seconds * 1000);
+	wall = now_s() - t0;
+
+	for (i = 0; i < count; i++) {
+		reads += sims[i].reads;
+		writes += sims[i].writes;
+		bytes += sims[i].bytes;
+		readouts += blocking ? devs[i].stats.samples : sensors.node[i].dev.stats.samples;
+		array_samples += sensors.node[i].health.samples;
+		deferred += sensors.node[i].health.deferred;
+		errors += sensors.node[i].health.errors;
+	}
+	st = blocking ? &devs[0].stats : &sensors.node[0].dev.stats;
+
+	fprintf(stderr, "scenario %s, %u s virtual, %d sensor(s) on %s, %s path\n", scen->name, seconds, count,
+			spi ? "SPI" : bus1 ? "I2C1" : "I2C", blocking ? "blocking" : tasked ? "task_sched" : "sensor_array");
+	if (!blocking)
+		fprintf(stderr, "array: period %u ms, %u samples, %.2f samples/s, %u deferred, %u errors, %u collisions\n",
+				sensors.period, array_samples, array_samples / (double)seconds, deferred, errors, collisions);
+	fprintf(stderr, "sensor 0: %u samples, %u LED changes, final LEDs %04x\n", samples, led_changes,
+			(unsigned)host_gpiod.ODR);
+	fprintf(stderr, "air quality: index max %u, final %u, baseline %u ohms at %u %%rH\n", aq_max,
+			air_quality.index, fx_exp2(air_quality.baseline), AQ_HUM_REF / 1000);
+	if (out != NULL) {
+		fprintf(stderr, "capture: %u frames\n", capture.frames);
+		fclose(out);
+	}
+	if (noise == 0.0)
+		fprintf(stderr, "max error: %.3f degC %.2f Pa %.3f %%rH %.2f %% gas\n", max_err[0], max_err[1],
+				max_err[2], max_err[3]);
+	if (adaptive)
+		fprintf(stderr, "os_ctrl: level %u, %u changes, %.1f%% busy\n", os_ctrl.level, os_ctrl.changes,
+				os_ctrl_duty(&os_ctrl));
+	fprintf(stderr, "stats: %u readouts, %u gaps, %u stale, latency avg %u max %u ms\n", st->samples, st->gaps,
+			st->stale, st->samples ? st->lat_sum / st->samples : 0, st->lat_max);
+	fprintf(stderr, "bus: %u reads, %u writes, %u bytes\n", reads, writes, bytes);
+	if (readouts)
+		fprintf(stderr, "per sample: %.2f transactions, %.1f bytes, %.0f us on the wire\n",
+				(double)(reads + writes) / readouts, (double)bytes / readouts,
+				bytes * (spi ? SPI_BYTE_US : I2C_BYTE_US) / readouts);
+	if (tasked) {
+		for (i = 0; i < tasks.count; i++) {
+			const struct task *task = &tasks.task[i];
+
+			/* task_sched_share() is in tenths of a percent, too coarse at host speed */
+			fprintf(stderr, "task %-10s: %u runs, %u overruns, %u skipped, wcet %.1f us, %.4f%% CPU\n",
+					task->name, task->runs, task->overruns, task->skipped, task->wcet / 1000.0,
+					task->busy / (seconds * 1e4));
+		}
+		fprintf(stderr, "task idle      : %u wake-ups, %u display frames\n", tasks.idles, frames);
+	}
+	fprintf(stderr, "%.3f s wall, %.0fx real time\n", wall, wall > 0 ? seconds / wall : 0.0);
+
+	return 0;
+}
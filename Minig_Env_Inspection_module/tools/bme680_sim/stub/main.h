@@ -0,0 +1,43 @@
+/**
+  ******************************************************************************
+  * @file           : main.h
+  * @brief          : Host stand-in for main.h, just the flash calls of
+  *                   calib_cache.c; implemented by sim_run.c
+  ******************************************************************************/
+
+#ifndef MAIN_H_
+#define MAIN_H_
+
+#include <stdint.h>
+
+typedef enum {
+	HAL_OK = 0,
+	HAL_ERROR,
+	HAL_BUSY,
+	HAL_TIMEOUT
+} HAL_StatusTypeDef;
+
+typedef struct {
+	uint32_t TypeErase;
+	uint32_t Banks;
+	uint32_t Sector;
+	uint32_t NbSectors;
+	uint32_t VoltageRange;
+} FLASH_EraseInitTypeDef;
+
+#define FLASH_TYPEERASE_SECTORS		0U
+#define FLASH_VOLTAGE_RANGE_3		2U
+#define FLASH_SECTOR_7				7U
+#define FLASH_TYPEPROGRAM_WORD		2U
+
+/* Sector 7 as far as the cache record reaches */
+#define HOST_FLASH_WORDS			128
+extern uint32_t host_flash[HOST_FLASH_WORDS];
+#define CALIB_CACHE_RECORD			((const struct calib_record *)(const void *)host_flash)
+
+HAL_StatusTypeDef HAL_FLASH_Unlock(void);
+HAL_StatusTypeDef HAL_FLASH_Lock(void);
+HAL_StatusTypeDef HAL_FLASHEx_Erase(FLASH_EraseInitTypeDef *pEraseInit, uint32_t *SectorError);
+HAL_StatusTypeDef HAL_FLASH_Program(uint32_t TypeProgram, uint32_t Address, uint64_t Data);
+
+#endif /* MAIN_H_ */
@@ -0,0 +1,447 @@
+/**
+  ******************************************************************************
+  * @file           : comp_check.c
+  * @brief          : Checks the integer compensation of bme680.c against the reference
+  ******************************************************************************
+  * The ref_* functions below are the driver's integer calc_* functions as
+  * they were before the compensation plan, reading the calibration
+  * directly. bme680.c is included rather than linked so that its static
+  * calc_* functions can be called one by one.
+  *
+  * For every random calibration set the plan is built once and every
+  * random ADC sample is compensated by both. Temperature, t_fine,
+  * pressure and humidity must match bit for bit, and so must the heater
+  * resistance code for 0..400 degC at the plan's ambient temperature and
+  * at another one. Samples where the reference pressure formula would
+  * divide by zero are skipped and counted. Then both are timed over the
+  * same samples.
+  *
+  * Gas resistance is checked exhaustively: every 10-bit ADC code in every
+  * one of the 16 ranges, for each range_sw_err from -8 to 7, against the
+  * reference's 64-bit division. It also counts how often the single
+  * precision estimate of comp_gas_resistance() was already exact, one
+  * count off, or further, and times both over all codes and ranges.
+  *
+  *     make && ./comp_check [-s sets] [-n samples] [-S seed]
+  *   -s  calibration sets (default 2000)
+  *   -n  ADC samples per set (default 500)
+  *   -S  random seed (default 1)
+  * Prints the mismatches per quantity and the time per sample, exits 1
+  * on any mismatch, the gas check included.
+  ******************************************************************************
+**/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../../Core/Src/bme680.c"
+
+#ifdef BME680_FLOAT_POINT_COMPENSATION
+#error comp_check checks the integer compensation
+#endif
+
+enum {
+	Q_TEMP,
+	Q_T_FINE,
+	Q_PRES,
+	Q_HUM,
+	Q_HEAT,
+	Q_HEAT_AMB,
+	QUANTITIES
+};
+
+static const char *const q_name[QUANTITIES] = {
+	"temperature", "t_fine", "pressure", "humidity", "heater code", "heater code, new amb_temp"
+};
+
+struct sample {
+	uint32_t temp_adc;
+	uint32_t pres_adc;
+	uint16_t hum_adc;
+};
+
+static uint32_t rng_state = 1;
+
+static uint32_t rng(void)
+{
+	/* xorshift32 */
+	rng_state ^= rng_state << 13;
+	rng_state ^= rng_state >> 17;
+	rng_state ^= rng_state << 5;
+	return rng_state;
+}
+
+static int32_t rng_range(int32_t lo, int32_t hi)
+{
+	return lo + (int32_t)(rng() % (uint32_t)(hi - lo + 1));
+}
+
+static double now_s(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int16_t ref_temperature(uint32_t temp_adc, struct bme680_calib_data *calib)
+{
+	int64_t var1;
+	int64_t var2;
+	int64_t var3;
+
+	var1 = ((int32_t) temp_adc >> 3) - ((int32_t) calib->par_t1 << 1);
+	var2 = (var1 * (int32_t) calib->par_t2) >> 11;
+	var3 = ((var1 >> 1) * (var1 >> 1)) >> 12;
+	var3 = ((var3) * ((int32_t) calib->par_t3 << 4)) >> 14;
+	calib->t_fine = (int32_t) (var2 + var3);
+
+	return (int16_t) (((calib->t_fine * 5) + 128) >> 8);
+}
+
+/* Returns 0 and leaves *out alone where the reference would divide by zero */
+static int ref_pressure(uint32_t pres_adc, const struct bme680_calib_data *calib, uint32_t *out)
+{
+	int32_t var1;
+	int32_t var2;
+	int32_t var3;
+	int32_t pressure_comp;
+
+	var1 = (((int32_t)calib->t_fine) >> 1) - 64000;
+	var2 = ((((var1 >> 2) * (var1 >> 2)) >> 11) *
+		(int32_t)calib->par_p6) >> 2;
+	var2 = var2 + ((var1 * (int32_t)calib->par_p5) << 1);
+	var2 = (var2 >> 2) + ((int32_t)calib->par_p4 << 16);
+	var1 = (((((var1 >> 2) * (var1 >> 2)) >> 13) *
+		((int32_t)calib->par_p3 << 5)) >> 3) +
+		(((int32_t)calib->par_p2 * var1) >> 1);
+	var1 = var1 >> 18;
+	var1 = ((32768 + var1) * (int32_t)calib->par_p1) >> 15;
+	if (var1 == 0 || var1 == -1)
+		return 0;
+	pressure_comp = 1048576 - pres_adc;
+	pressure_comp = (int32_t)((pressure_comp - (var2 >> 12)) * ((uint32_t)3125));
+	if (pressure_comp >= BME680_MAX_OVERFLOW_VAL)
+		pressure_comp = ((pressure_comp / var1) << 1);
+	else
+		pressure_comp = ((pressure_comp << 1) / var1);
+	var1 = ((int32_t)calib->par_p9 * (int32_t)(((pressure_comp >> 3) *
+		(pressure_comp >> 3)) >> 13)) >> 12;
+	var2 = ((int32_t)(pressure_comp >> 2) *
+		(int32_t)calib->par_p8) >> 13;
+	var3 = ((int32_t)(pressure_comp >> 8) * (int32_t)(pressure_comp >> 8) *
+		(int32_t)(pressure_comp >> 8) *
+		(int32_t)calib->par_p10) >> 17;
+
+	pressure_comp = (int32_t)(pressure_comp) + ((var1 + var2 + var3 +
+		((int32_t)calib->par_p7 << 7)) >> 4);
+
+	*out = (uint32_t)pressure_comp;
+	return 1;
+}
+
+static uint32_t ref_humidity(uint16_t hum_adc, const struct bme680_calib_data *calib)
+{
+	int32_t var1;
+	int32_t var2;
+	int32_t var3;
+	int32_t var4;
+	int32_t var5;
+	int32_t var6;
+	int32_t temp_scaled;
+	int32_t calc_hum;
+
+	temp_scaled = (((int32_t) calib->t_fine * 5) + 128) >> 8;
+	var1 = (int32_t) (hum_adc - ((int32_t) ((int32_t) calib->par_h1 * 16)))
+		- (((temp_scaled * (int32_t) calib->par_h3) / ((int32_t) 100)) >> 1);
+	var2 = ((int32_t) calib->par_h2
+		* (((temp_scaled * (int32_t) calib->par_h4) / ((int32_t) 100))
+			+ (((temp_scaled * ((temp_scaled * (int32_t) calib->par_h5) / ((int32_t) 100))) >> 6)
+				/ ((int32_t) 100)) + (int32_t) (1 << 14))) >> 10;
+	var3 = var1 * var2;
+	var4 = (int32_t) calib->par_h6 << 7;
+	var4 = ((var4) + ((temp_scaled * (int32_t) calib->par_h7) / ((int32_t) 100))) >> 4;
+	var5 = ((var3 >> 14) * (var3 >> 14)) >> 10;
+	var6 = (var4 * var5) >> 1;
+	calc_hum = (((var3 + var6) >> 10) * ((int32_t) 1000)) >> 12;
+
+	if (calc_hum > 100000) /* Cap at 100%rH */
+		calc_hum = 100000;
+	else if (calc_hum < 0)
+		calc_hum = 0;
+
+	return (uint32_t) calc_hum;
+}
+
+static uint32_t ref_gas_resistance(uint16_t gas_res_adc, uint8_t gas_range, const struct bme680_calib_data *calib)
+{
+	int64_t var1;
+	uint64_t var2;
+	int64_t var3;
+	/**Look up table 1 for the possible gas range values */
+	uint32_t lookupTable1[16] = { UINT32_C(2147483647), UINT32_C(2147483647), UINT32_C(2147483647), UINT32_C(2147483647),
+		UINT32_C(2147483647), UINT32_C(2126008810), UINT32_C(2147483647), UINT32_C(2130303777),
+		UINT32_C(2147483647), UINT32_C(2147483647), UINT32_C(2143188679), UINT32_C(2136746228),
+		UINT32_C(2147483647), UINT32_C(2126008810), UINT32_C(2147483647), UINT32_C(2147483647) };
+	/**Look up table 2 for the possible gas range values */
+	uint32_t lookupTable2[16] = { UINT32_C(4096000000), UINT32_C(2048000000), UINT32_C(1024000000), UINT32_C(512000000),
+		UINT32_C(255744255), UINT32_C(127110228), UINT32_C(64000000), UINT32_C(32258064), UINT32_C(16016016),
+		UINT32_C(8000000), UINT32_C(4000000), UINT32_C(2000000), UINT32_C(1000000), UINT32_C(500000),
+		UINT32_C(250000), UINT32_C(125000) };
+
+	var1 = (int64_t) ((1340 + (5 * (int64_t) calib->range_sw_err)) *
+		((int64_t) lookupTable1[gas_range])) >> 16;
+	var2 = (((int64_t) ((int64_t) gas_res_adc << 15) - (int64_t) (16777216)) + var1);
+	var3 = (((int64_t) lookupTable2[gas_range] * (int64_t) var1) >> 9);
+
+	return (uint32_t) ((var3 + ((int64_t) var2 >> 1)) / (int64_t) var2);
+}
+
+static uint8_t ref_heater_res(uint16_t temp, int8_t amb_temp, const struct bme680_calib_data *calib)
+{
+	int32_t var1;
+	int32_t var2;
+	int32_t var3;
+	int32_t var4;
+	int32_t var5;
+	int32_t heatr_res_x100;
+
+	if (temp > 400) /* Cap temperature */
+		temp = 400;
+
+	var1 = (((int32_t) amb_temp * calib->par_gh3) / 1000) * 256;
+	var2 = (calib->par_gh1 + 784) * (((((calib->par_gh2 + 154009) * temp * 5) / 100) + 3276800) / 10);
+	var3 = var1 + (var2 / 2);
+	var4 = (var3 / (calib->res_heat_range + 4));
+	var5 = (131 * calib->res_heat_val) + 65536;
+	heatr_res_x100 = (int32_t) (((var4 / var5) - 250) * 34);
+
+	return (uint8_t) ((heatr_res_x100 + 50) / 100);
+}
+
+/* Every coefficient over the range its register field can hold. par_p1
+ * stays off zero, where both formulas divide by zero on every sample. */
+static void random_calib(struct bme680_calib_data *c)
+{
+	c->par_t1 = (uint16_t)rng();
+	c->par_t2 = (int16_t)rng();
+	c->par_t3 = (int8_t)rng();
+	c->par_p1 = (uint16_t)rng_range(1024, 65535);
+	c->par_p2 = (int16_t)rng();
+	c->par_p3 = (int8_t)rng();
+	c->par_p4 = (int16_t)rng();
+	c->par_p5 = (int16_t)rng();
+	c->par_p6 = (int8_t)rng();
+	c->par_p7 = (int8_t)rng();
+	c->par_p8 = (int16_t)rng();
+	c->par_p9 = (int16_t)rng();
+	c->par_p10 = (uint8_t)rng();
+	c->par_h1 = (uint16_t)(rng() & 0xfff);
+	c->par_h2 = (uint16_t)(rng() & 0xfff);
+	c->par_h3 = (int8_t)rng();
+	c->par_h4 = (int8_t)rng();
+	c->par_h5 = (int8_t)rng();
+	c->par_h6 = (uint8_t)rng();
+	c->par_h7 = (int8_t)rng();
+	c->par_gh1 = (int8_t)rng();
+	c->par_gh2 = (int16_t)rng();
+	c->par_gh3 = (int8_t)rng();
+	c->res_heat_range = (uint8_t)rng_range(0, 3);
+	c->res_heat_val = (int8_t)rng();
+	c->range_sw_err = (int8_t)rng_range(-8, 7);
+}
+
+static void random_samples(struct sample *s, uint32_t n)
+{
+	uint32_t i;
+
+	for (i = 0; i < n; i++) {
+		s[i].temp_adc = rng() & 0xfffff;
+		s[i].pres_adc = rng() & 0xfffff;
+		s[i].hum_adc = (uint16_t)rng();
+	}
+}
+
+/* Compares one calibration set over the samples; returns the skipped count */
+static uint32_t check_set(struct bme680_dev *dev, const struct sample *s, uint32_t n, uint32_t *miss)
+{
+	struct bme680_calib_data ref = dev->calib;
+	uint32_t i, pres, skipped = 0;
+	uint16_t temp;
+	int8_t amb;
+
+	for (i = 0; i < n; i++) {
+		miss[Q_TEMP] += calc_temperature(s[i].temp_adc, dev) != ref_temperature(s[i].temp_adc, &ref);
+		miss[Q_T_FINE] += dev->calib.t_fine != ref.t_fine;
+		if (ref_pressure(s[i].pres_adc, &ref, &pres))
+			miss[Q_PRES] += calc_pressure(s[i].pres_adc, dev) != pres;
+		else
+			skipped++;
+		miss[Q_HUM] += calc_humidity(s[i].hum_adc, dev) != ref_humidity(s[i].hum_adc, &ref);
+	}
+
+	for (temp = 0; temp <= 400; temp++)
+		miss[Q_HEAT] += calc_heater_res(temp, dev) != ref_heater_res(temp, dev->amb_temp, &ref);
+
+	/* amb_temp updated after the plan was built */
+	amb = dev->amb_temp;
+	dev->amb_temp = (int8_t)rng_range(-40, 85);
+	for (temp = 0; temp <= 400; temp++)
+		miss[Q_HEAT_AMB] += calc_heater_res(temp, dev) != ref_heater_res(temp, dev->amb_temp, &ref);
+	dev->amb_temp = amb;
+
+	return skipped;
+}
+
+/* Time per sample of temperature, pressure and humidity, both ways */
+static void timing(struct bme680_dev *dev, const struct sample *s, uint32_t n)
+{
+	struct bme680_calib_data ref = dev->calib;
+	volatile uint32_t sink = 0;
+	double t0, t_ref, t_plan;
+	uint32_t i, pres, pass, passes = 20000000 / n + 1;
+
+	t0 = now_s();
+	for (pass = 0; pass < passes; pass++) {
+		for (i = 0; i < n; i++) {
+			sink += (uint16_t)ref_temperature(s[i].temp_adc, &ref);
+			if (ref_pressure(s[i].pres_adc, &ref, &pres))
+				sink += pres;
+			sink += ref_humidity(s[i].hum_adc, &ref);
+		}
+	}
+	t_ref = now_s() - t0;
+
+	t0 = now_s();
+	for (pass = 0; pass < passes; pass++) {
+		for (i = 0; i < n; i++) {
+			sink += (uint16_t)calc_temperature(s[i].temp_adc, dev);
+			sink += calc_pressure(s[i].pres_adc, dev);
+			sink += calc_humidity(s[i].hum_adc, dev);
+		}
+	}
+	t_plan = now_s() - t0;
+
+	printf("time per T+P+H sample: reference %.1f ns, plan %.1f ns\n", t_ref * 1e9 / ((double)passes * n),
+			t_plan * 1e9 / ((double)passes * n));
+}
+
+/* Every code, range and range_sw_err; returns the mismatches */
+static uint32_t check_gas(struct bme680_dev *dev)
+{
+	const struct bme680_comp_plan *plan = &dev->plan;
+	volatile uint32_t sink = 0;
+	uint32_t cases = 0, miss = 0, exact = 0, one_off = 0, worse = 0, direct = 0, est;
+	int64_t var3;
+	int32_t var2, off;
+	uint16_t code;
+	uint8_t range;
+	int8_t err;
+	double t0, t_ref, t_plan;
+	int pass;
+
+	for (err = -8; err <= 7; err++) {
+		dev->calib.range_sw_err = err;
+		bme680_build_comp_plan(dev);
+		for (range = 0; range < 16; range++) {
+			for (code = 0; code < 1024; code++) {
+				cases++;
+				miss += calc_gas_resistance(code, range, dev) != ref_gas_resistance(code, range, &dev->calib);
+
+				/* comp_gas_resistance()'s estimate, before the correction */
+				var2 = ((int32_t) code << 15) + plan->gas_ofs[range];
+				var3 = plan->gas_var3[range] + (var2 >> 1);
+				if (var2 <= 0) {
+					direct++;
+					continue;
+				}
+				est = (uint32_t) ((plan->gas_var3f[range] / (float) var2) + 0.5f);
+				off = (int32_t) (est - (uint32_t) (var3 / var2));
+				if (off == 0)
+					exact++;
+				else if (off == 1 || off == -1)
+					one_off++;
+				else
+					worse++;
+			}
+		}
+	}
+
+	printf("gas: %u codes x ranges x range_sw_err, %u mismatches\n", cases, miss);
+	printf("  estimate exact %u, one off %u, further %u, 64-bit division %u\n", exact, one_off, worse, direct);
+
+	dev->calib.range_sw_err = 0;
+	bme680_build_comp_plan(dev);
+	t0 = now_s();
+	for (pass = 0; pass < 200; pass++)
+		for (range = 0; range < 16; range++)
+			for (code = 0; code < 1024; code++)
+				sink += ref_gas_resistance(code, range, &dev->calib);
+	t_ref = now_s() - t0;
+	t0 = now_s();
+	for (pass = 0; pass < 200; pass++)
+		for (range = 0; range < 16; range++)
+			for (code = 0; code < 1024; code++)
+				sink += calc_gas_resistance(code, range, dev);
+	t_plan = now_s() - t0;
+	printf("time per gas sample: reference %.1f ns, plan %.1f ns\n", t_ref * 1e9 / (200.0 * 16 * 1024),
+			t_plan * 1e9 / (200.0 * 16 * 1024));
+
+	return miss;
+}
+
+int main(int argc, char **argv)
+{
+	struct bme680_dev dev = { 0 };
+	struct sample *s;
+	uint32_t sets = 2000, n = 500, set, q, skipped = 0, miss[QUANTITIES] = { 0 }, total = 0;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "s:n:S:")) != -1) {
+		switch (opt) {
+		case 's':
+			sets = strtoul(optarg, NULL, 0);
+			break;
+		case 'n':
+			n = strtoul(optarg, NULL, 0);
+			break;
+		case 'S':
+			rng_state = strtoul(optarg, NULL, 0);
+			break;
+		default:
+			fprintf(stderr, "usage: %s [-s sets] [-n samples] [-S seed]\n", argv[0]);
+			return 2;
+		}
+	}
+	if (n == 0 || rng_state == 0) {
+		fprintf(stderr, "samples and seed must not be 0\n");
+		return 2;
+	}
+
+	s = malloc(n * sizeof(*s));
+	if (s == NULL)
+		return 2;
+
+	for (set = 0; set < sets; set++) {
+		random_calib(&dev.calib);
+		dev.amb_temp = (int8_t)rng_range(-40, 85);
+		bme680_build_comp_plan(&dev);
+		random_samples(s, n);
+		skipped += check_set(&dev, s, n, miss);
+	}
+
+	printf("%u calibration sets x %u samples, %u skipped (reference divides by zero)\n", sets, n, skipped);
+	for (q = 0; q < QUANTITIES; q++) {
+		printf("  %-26s %u mismatches\n", q_name[q], miss[q]);
+		total += miss[q];
+	}
+
+	timing(&dev, s, n);
+	free(s);
+
+	total += check_gas(&dev);
+
+	return total ? 1 : 0;
+}
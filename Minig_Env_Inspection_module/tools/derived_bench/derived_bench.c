@@ -0,0 +1,166 @@
+/**
+  ******************************************************************************
+  * @file           : derived_bench.c
+  * @brief          : Accuracy and speed of derived.c against libm on the host
+  ******************************************************************************
+  * Sweeps temperature, humidity and pressure over the BME680's operating
+  * range (-40..85 degC, 0..100 %rH, 300..1100 hPa). Every point goes
+  * through the firmware's derived_compute() (fixed point) and
+  * derived_reference() (float libm). Both are compared with the same model
+  * evaluated in double. It prints the largest error of each metric and the
+  * time per call of both.
+  *
+  *     make && ./derived_bench [-r repeat] [-p p_ref]
+  *   -r  timing passes over the sweep (default 20)
+  *   -p  reference pressure in Pa (default DERIVED_SEA_LEVEL_PA)
+  * Build with FLOAT=1 to feed the float build's bme680_field_data.
+  ******************************************************************************
+**/
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "derived.h"
+
+#define METRICS		5
+
+/* Below 540 hPa (about 5 km up) the height series loses its centimetres;
+ * the last row is the range a mine and its surface can have */
+#define MINE_PA_MIN	54000
+
+static const char *const metric_name[METRICS] = {
+	"dew point  [centi degC]", "dew spread [centi degC]", "abs humid  [centi g/m3]", "height     [cm]",
+	"  >540 hPa [cm]"
+};
+
+/* derived.c's model in double, same units as struct derived_data */
+static void truth(double t, double rh, double p, double p_ref, double *out)
+{
+	double q, gamma, td;
+
+	if (rh < 0.001)
+		rh = 0.001;
+	q = 17.62 * t / (243.12 + t);
+	gamma = log(rh / 100.0) + q;
+	td = 243.12 * gamma / (17.62 - gamma);
+	out[0] = td * 100.0;
+	out[1] = (t - td) * 100.0;
+	out[2] = 216.673 * 6.112 * (rh / 100.0) * exp(q) / (t + 273.15) * 100.0;
+	out[3] = 29.2712 * (t + 273.15) * log(p_ref / p) * 100.0;
+	out[4] = (p >= MINE_PA_MIN) ? out[3] : 0.0;
+}
+
+static double now_s(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* Times fn over the sweep; the sum keeps the calls from being dropped */
+static double bench(void (*fn)(const struct bme680_field_data *, uint32_t, struct derived_data *),
+		const struct bme680_field_data *in, size_t count, uint32_t p_ref, int repeat)
+{
+	struct derived_data out;
+	volatile int32_t sink = 0;
+	double t0;
+	size_t i;
+	int pass;
+
+	t0 = now_s();
+	for (pass = 0; pass < repeat; pass++) {
+		for (i = 0; i < count; i++) {
+			fn(&in[i], p_ref, &out);
+			sink += out.dew_point + out.height + (int32_t)out.abs_humidity;
+		}
+	}
+	(void)sink;
+
+	return (now_s() - t0) * 1e9 / ((double)count * repeat);
+}
+
+int main(int argc, char **argv)
+{
+	struct bme680_field_data *in;
+	struct derived_data fx, ref;
+	double exact[METRICS], got_fx[METRICS], got_ref[METRICS], err_fx[METRICS] = { 0 }, err_ref[METRICS] = { 0 };
+	double t, rh, p;
+	uint32_t p_ref = DERIVED_SEA_LEVEL_PA;
+	size_t count = 0, i;
+	int repeat = 20, opt, m;
+
+	while ((opt = getopt(argc, argv, "r:p:")) != -1) {
+		switch (opt) {
+		case 'r':
+			repeat = atoi(optarg) > 0 ? atoi(optarg) : 1;
+			break;
+		case 'p':
+			p_ref = strtoul(optarg, NULL, 0);
+			break;
+		default:
+			fprintf(stderr, "usage: %s [-r repeat] [-p p_ref]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	/* 0.5 degC, 1 %rH and 16 hPa steps, with odd offsets so the points
+	 * do not all land on table knots */
+	in = malloc(251 * 100 * 51 * sizeof(*in));
+	if (in == NULL) {
+		perror("malloc");
+		return 1;
+	}
+	for (t = -40.0; t <= 85.0; t += 0.5) {
+		for (rh = 0.37; rh <= 100.0; rh += 1.0) {
+			for (p = 30000.0 + 13.7 * (count % 7); p <= 110000.0; p += 1600.0) {
+				struct bme680_field_data *d = &in[count++];
+
+#ifndef BME680_FLOAT_POINT_COMPENSATION
+				d->temperature = (int16_t)lround(t * BME680_TEMP_SCALE);
+				d->humidity = (uint32_t)lround(rh * BME680_HUM_SCALE);
+				d->pressure = (uint32_t)lround(p * BME680_PRES_SCALE);
+#else
+				d->temperature = t;
+				d->humidity = rh;
+				d->pressure = p;
+#endif
+			}
+		}
+	}
+
+	for (i = 0; i < count; i++) {
+		/* The truth takes the inputs exactly as both paths see them */
+		truth((double)in[i].temperature / BME680_TEMP_SCALE, (double)in[i].humidity / BME680_HUM_SCALE,
+				(double)in[i].pressure / BME680_PRES_SCALE, p_ref, exact);
+		derived_compute(&in[i], p_ref, &fx);
+		derived_reference(&in[i], p_ref, &ref);
+		got_fx[0] = fx.dew_point;
+		got_fx[1] = fx.dew_spread;
+		got_fx[2] = fx.abs_humidity;
+		got_fx[3] = fx.height;
+		got_fx[4] = (exact[4] != 0.0) ? fx.height : 0.0;
+		got_ref[0] = ref.dew_point;
+		got_ref[1] = ref.dew_spread;
+		got_ref[2] = ref.abs_humidity;
+		got_ref[3] = ref.height;
+		got_ref[4] = (exact[4] != 0.0) ? ref.height : 0.0;
+		for (m = 0; m < METRICS; m++) {
+			err_fx[m] = fmax(err_fx[m], fabs(got_fx[m] - exact[m]));
+			err_ref[m] = fmax(err_ref[m], fabs(got_ref[m] - exact[m]));
+		}
+	}
+
+	printf("%zu points, p_ref %u Pa\n", count, p_ref);
+	printf("max |error|                fixed     libm\n");
+	for (m = 0; m < METRICS; m++)
+		printf("%s %8.2f %8.2f\n", metric_name[m], err_fx[m], err_ref[m]);
+	printf("ns/call                 %8.1f %8.1f\n", bench(derived_compute, in, count, p_ref, repeat),
+			bench(derived_reference, in, count, p_ref, repeat));
+
+	free(in);
+	return 0;
+}
@@ -0,0 +1,311 @@
+/**
+  ******************************************************************************
+  * @file           : fmt_bench.c
+  * @brief          : Correctness and speed of fixfmt.c against snprintf on the host
+  ******************************************************************************
+  * First a table of edge cases: rounding ties, negative values that round
+  * to zero, padding flags and output cut off by a short buffer. Then a
+  * sweep of random values, decimals, precisions and widths against glibc's
+  * "%*.*f" on the same value as a long double. Ties are left out of the
+  * sweep because printf rounds them to even, not away from zero. Any
+  * difference is printed and makes the run exit 1.
+  *
+  * fmt_printf() is checked the same way: every conversion the firmware's
+  * format strings use, with random values, widths and a short buffer,
+  * against glibc's snprintf on the same arguments.
+  *
+  * The timing formats the OLED rows of a sample, as BME680_FormatRow()
+  * does, three ways:
+  *   - with fixfmt.c
+  *   - with integer snprintf, as the display did before
+  *   - with fmt_printf() on the same format strings
+  *   - with "%.2f" on floats, as the float build did
+  *
+  *     make && ./fmt_bench [-n values] [-r rows]
+  *   -n  values in the sweep (default 1000000)
+  *   -r  samples timed per path (default 2000000)
+  * "make size" gives the formatter's code size.
+  ******************************************************************************
+**/
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "fixfmt.h"
+
+#define ROW_LEN		32			/* wider than SCRATCH_ROW_LEN, so no path is cut short */
+
+struct fmt_case {
+	int32_t value;
+	int is_signed;
+	uint8_t decimals, prec, width, flags;
+	uint8_t size;				/* buffer bytes, 0 for FMT_VALUE_LEN */
+	const char *expect;
+};
+
+static const struct fmt_case cases[] = {
+	{ 2345, 1, 2, 2, 0, 0, 0, "23.45" },
+	{ -2345, 1, 2, 2, 0, 0, 0, "-23.45" },
+	{ 5, 1, 2, 2, 0, 0, 0, "0.05" },
+	{ -5, 1, 2, 2, 0, 0, 0, "-0.05" },
+	{ 125, 1, 2, 1, 0, 0, 0, "1.3" },		/* tie, away from zero */
+	{ -125, 1, 2, 1, 0, 0, 0, "-1.3" },
+	{ -4, 1, 2, 1, 0, 0, 0, "0.0" },		/* no sign on zero */
+	{ 995, 1, 2, 1, 0, 0, 0, "10.0" },		/* carry into a new digit */
+	{ 45678, 0, 3, 2, 0, 0, 0, "45.68" },
+	{ 101325, 0, 2, 2, 0, 0, 0, "1013.25" },
+	{ 150, 1, 2, 0, 0, 0, 0, "2" },
+	{ 7, 1, 0, 3, 0, 0, 0, "7.000" },
+	{ 0, 1, 0, 0, 0, 0, 0, "0" },
+	{ INT32_MIN, 1, 0, 0, 0, 0, 0, "-2147483648" },
+	{ -1, 0, 9, 9, 0, 0, 0, "4.294967295" },
+	{ -123, 1, 1, 1, 8, 0, 0, "   -12.3" },
+	{ -123, 1, 1, 1, 8, FMT_ZERO, 0, "-00012.3" },
+	{ -123, 1, 1, 1, 8, FMT_LEFT, 0, "-12.3   " },
+	{ 123, 1, 1, 1, 2, 0, 0, "12.3" },		/* width below the length */
+	{ 123456, 1, 2, 2, 0, 0, 5, "1234" },	/* cut to the buffer */
+	{ 123456, 1, 2, 2, 0, 0, 1, "" },
+};
+
+static double now_s(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static uint32_t rng(uint64_t *state)
+{
+	*state = *state * 6364136223846793005ULL + 1442695040888963407ULL;
+	return (uint32_t)(*state >> 32);
+}
+
+static void fmt_one(char *buf, size_t size, int32_t value, int is_signed, uint8_t decimals, uint8_t prec,
+		uint8_t width, uint8_t flags)
+{
+	if (is_signed)
+		fmt_dec(buf, buf + size, value, decimals, prec, width, flags);
+	else
+		fmt_udec(buf, buf + size, (uint32_t)value, decimals, prec, width, flags);
+}
+
+static int check_cases(void)
+{
+	char buf[FMT_VALUE_LEN];
+	size_t i;
+	int failed = 0;
+
+	for (i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+		const struct fmt_case *c = &cases[i];
+
+		memset(buf, 'x', sizeof(buf));
+		fmt_one(buf, c->size ? c->size : sizeof(buf), c->value, c->is_signed, c->decimals, c->prec, c->width,
+				c->flags);
+		if (strcmp(buf, c->expect) != 0) {
+			printf("case %zu: %ld/%u/%u/%u: \"%s\", expected \"%s\"\n", i, (long)c->value, c->decimals, c->prec,
+					c->width, buf, c->expect);
+			failed++;
+		}
+	}
+	return failed;
+}
+
+static int check_sweep(long count)
+{
+	static const uint32_t pow10[] = { 1, 10, 100, 1000, 10000, 100000 };
+	static const char *const flag_fmt[] = { "%*.*Lf", "%-*.*Lf", "%0*.*Lf" };
+	static const uint8_t flag_set[] = { 0, FMT_LEFT, FMT_ZERO };
+	char got[64], want[64];
+	uint64_t state = 1;
+	long i, ties = 0, failed = 0;
+
+	for (i = 0; i < count; i++) {
+		uint32_t r = rng(&state);
+		int32_t value = (int32_t)rng(&state) >> (r & 15);
+		uint8_t decimals = r >> 4 & 3, prec = (r >> 6) % 5, width = (r >> 9) % 14, f = (r >> 13) % 3;
+		long double x = (long double)value / pow10[decimals];
+
+		/* A tie, or a negative value that rounds to zero: printf differs */
+		if (prec < decimals) {
+			uint32_t div = pow10[decimals - prec];
+			uint32_t mag = value < 0 ? 0U - (uint32_t)value : (uint32_t)value;
+
+			if (mag % div * 2 == div || (value < 0 && mag * 2 < div)) {
+				ties++;
+				continue;
+			}
+		}
+		fmt_dec(got, got + sizeof(got), value, decimals, prec, width, flag_set[f]);
+		snprintf(want, sizeof(want), flag_fmt[f], width, prec, x);
+		if (strcmp(got, want) != 0 && failed++ < 10)
+			printf("sweep: %ld/%u/%u/%u/%u: \"%s\", printf \"%s\"\n", (long)value, decimals, prec, width,
+					flag_set[f], got, want);
+	}
+	printf("sweep: %ld values, %ld ties skipped, %ld differ\n", count, ties, failed);
+	return failed != 0;
+}
+
+/* Both into a buffer of size; a difference is printed and counted */
+#define CHECK_PRINTF(size, ...)														\
+	do {																			\
+		fmt_printf(got, got + (size), __VA_ARGS__);								\
+		snprintf(want, (size), __VA_ARGS__);										\
+		if (strcmp(got, want) != 0 && failed++ < 10)								\
+			printf("printf: %s: \"%s\", snprintf \"%s\"\n", #__VA_ARGS__, got, want);	\
+	} while (0)
+
+static int check_printf(long count)
+{
+	static const char *const names[] = { "", "ok", "TIMEOUT", "i2c_fault" };
+	char got[64], want[64];
+	uint64_t state = 3;
+	long i, failed = 0;
+
+	for (i = 0; i < count; i++) {
+		uint32_t r = rng(&state), u = rng(&state) >> (r & 31);
+		int32_t d = (int32_t)u;
+		const char *name = names[r >> 5 & 3];
+		size_t size = (r >> 7 & 7) ? sizeof(got) : 1 + (r >> 10) % 8;
+
+		CHECK_PRINTF(size, "%d %i|%ld", d, -d, (long)d);
+		CHECK_PRINTF(size, "%u|%lu|%02lu|%03lu", u, (unsigned long)u, (unsigned long)(u % 100),
+				(unsigned long)(u % 1000));
+		CHECK_PRINTF(size, "%02X %x %lX %08X", u & 0xff, u, (unsigned long)u, u);
+		CHECK_PRINTF(size, "[%-10s][%-7s][%s][%7s]", name, name, name, name);
+		CHECK_PRINTF(size, "%5d|%-5d|%05d|%c%%", d % 1000, d % 1000, d % 1000, 'A' + (r & 15));
+		CHECK_PRINTF(size, "%s%lu.%02lu%%", d < 0 ? "-" : "", (unsigned long)(u / 100), (unsigned long)(u % 100));
+		CHECK_PRINTF(size, "%hu %lu", (unsigned short)u, 0UL);
+	}
+	printf("printf: %ld argument sets, %ld differ\n", count, failed);
+	return failed != 0;
+}
+
+/* The OLED rows of one sample; integer inputs in the firmware's units */
+struct sample {
+	int32_t dew, height, temp;
+	uint32_t hum, pres, gas;
+};
+
+static void rows_fixfmt(const struct sample *s, char *row)
+{
+	char *end = row + ROW_LEN, *p;
+
+	p = fmt_str(row, end, "Dew:");
+	p = fmt_dec(p, end, s->dew, 2, 2, 0, 0);
+	p = fmt_str(p, end, "C ");
+	p = fmt_dec(p, end, s->height, 2, 0, 0, 0);
+	fmt_str(p, end, "m ");
+	p = fmt_str(row, end, "Temp:");
+	p = fmt_dec(p, end, s->temp, 2, 2, 0, 0);
+	fmt_str(p, end, "degC");
+	p = fmt_str(row, end, "Humi:");
+	p = fmt_udec(p, end, s->hum, 3, 2, 0, 0);
+	fmt_str(p, end, " %rH ");
+	p = fmt_str(row, end, "Press:");
+	p = fmt_udec(p, end, s->pres, 2, 2, 0, 0);
+	fmt_str(p, end, "hPa");
+	p = fmt_str(row, end, "AIRQUAL:");
+	p = fmt_udec(p, end, s->gas, 3, 2, 0, 0);
+	fmt_str(p, end, "Kohms ");
+}
+
+#define CENTI_ABS(v)	((uint32_t)(((int32_t)(v) < 0) ? -(int32_t)(v) : (int32_t)(v)))
+#define CENTI_ARG(v)	(((int32_t)(v) < 0) ? "-" : ""), (unsigned long)(CENTI_ABS(v) / 100), \
+						(unsigned long)(CENTI_ABS(v) % 100)
+
+static void rows_snprintf(const struct sample *s, char *row)
+{
+	snprintf(row, ROW_LEN, "Dew:%s%lu.%02luC %ldm ", CENTI_ARG(s->dew), (long)(s->height / 100));
+	snprintf(row, ROW_LEN, "Temp:%s%lu.%02ludegC", CENTI_ARG(s->temp));
+	snprintf(row, ROW_LEN, "Humi:%s%lu.%02lu %%rH ", CENTI_ARG(s->hum / 10));
+	snprintf(row, ROW_LEN, "Press:%s%lu.%02luhPa", CENTI_ARG(s->pres));
+	snprintf(row, ROW_LEN, "AIRQUAL:%s%lu.%02luKohms ", CENTI_ARG(s->gas / 10));
+}
+
+static void rows_fmt_printf(const struct sample *s, char *row)
+{
+	char *end = row + ROW_LEN;
+
+	fmt_printf(row, end, "Dew:%s%lu.%02luC %ldm ", CENTI_ARG(s->dew), (long)(s->height / 100));
+	fmt_printf(row, end, "Temp:%s%lu.%02ludegC", CENTI_ARG(s->temp));
+	fmt_printf(row, end, "Humi:%s%lu.%02lu %%rH ", CENTI_ARG(s->hum / 10));
+	fmt_printf(row, end, "Press:%s%lu.%02luhPa", CENTI_ARG(s->pres));
+	fmt_printf(row, end, "AIRQUAL:%s%lu.%02luKohms ", CENTI_ARG(s->gas / 10));
+}
+
+static void rows_float(const struct sample *s, char *row)
+{
+	snprintf(row, ROW_LEN, "Dew:%.2fC %ldm ", s->dew / 100.0f, (long)(s->height / 100));
+	snprintf(row, ROW_LEN, "Temp:%.2fdegC", s->temp / 100.0f);
+	snprintf(row, ROW_LEN, "Humi:%.2f %%rH ", s->hum / 1000.0f);
+	snprintf(row, ROW_LEN, "Press:%.2fhPa", s->pres / 100.0f);
+	snprintf(row, ROW_LEN, "AIRQUAL:%.2fKohms ", s->gas / 1000.0f);
+}
+
+static double bench(void (*fn)(const struct sample *, char *), const struct sample *in, size_t count, long rows)
+{
+	char row[ROW_LEN];
+	volatile char sink = 0;
+	double t0 = now_s();
+	long i;
+
+	for (i = 0; i < rows; i++) {
+		fn(&in[i % count], row);
+		sink += row[5];
+	}
+	(void)sink;
+	return (now_s() - t0) * 1e9 / rows;
+}
+
+int main(int argc, char **argv)
+{
+	static struct sample in[4096];
+	long count = 1000000, rows = 2000000;
+	uint64_t state = 7;
+	double t_fix, t_int, t_printf, t_float;
+	size_t i;
+	int opt, failed;
+
+	while ((opt = getopt(argc, argv, "n:r:")) != -1) {
+		switch (opt) {
+		case 'n':
+			count = atol(optarg);
+			break;
+		case 'r':
+			rows = atol(optarg) > 0 ? atol(optarg) : 1;
+			break;
+		default:
+			fprintf(stderr, "usage: %s [-n values] [-r rows]\n", argv[0]);
+			return 2;
+		}
+	}
+
+	failed = check_cases();
+	printf("cases: %zu, %d failed\n", sizeof(cases) / sizeof(cases[0]), failed);
+	failed += check_sweep(count);
+	failed += check_printf(count / 10);
+
+	/* Readings over the sensor's range */
+	for (i = 0; i < sizeof(in) / sizeof(in[0]); i++) {
+		in[i].temp = (int32_t)(rng(&state) % 12501) - 4000;
+		in[i].dew = in[i].temp - (int32_t)(rng(&state) % 3000);
+		in[i].height = (int32_t)(rng(&state) % 900001) - 450000;
+		in[i].hum = rng(&state) % 100001;
+		in[i].pres = 30000 + rng(&state) % 80001;
+		in[i].gas = 1000 + rng(&state) % 5000000;
+	}
+	t_fix = bench(rows_fixfmt, in, sizeof(in) / sizeof(in[0]), rows);
+	t_int = bench(rows_snprintf, in, sizeof(in) / sizeof(in[0]), rows);
+	t_printf = bench(rows_fmt_printf, in, sizeof(in) / sizeof(in[0]), rows);
+	t_float = bench(rows_float, in, sizeof(in) / sizeof(in[0]), rows);
+	printf("5 OLED rows: fixfmt %.0f ns, integer snprintf %.0f ns (x%.1f), fmt_printf %.0f ns (x%.1f), "
+			"float snprintf %.0f ns (x%.1f)\n", t_fix, t_int, t_int / t_fix, t_printf, t_printf / t_fix, t_float,
+			t_float / t_fix);
+
+	return failed ? 1 : 0;
+}
@@ -0,0 +1,344 @@
+/**
+  ******************************************************************************
+  * @file           : frame_replay.c
+  * @brief          : Host replay of BME680 field-frame captures
+  ******************************************************************************
+  * Maps a capture written by frame_log (see Core/Inc/frame_log.h) and runs
+  * every frame through the firmware's bme680_compensate_field(),
+  * derived_compute() and sensor_statemachine(), exactly as app_tasks.c calls
+  * them. The digest
+  * covers every compensated sample and the LED state after it, so two
+  * builds replaying the same capture can be compared bit for bit.
+  *
+  * Capture on target with BME680_FRAME_LOG defined and save USART2 raw:
+  *     stty -F /dev/ttyACM0 115200 raw && cat /dev/ttyACM0 > run.bmef
+  * or record one from the simulator with bme680_sim's sim_run -w.
+  * Replay:
+  *     make && ./frame_replay [-c] [-v] [-a] [-b] [-r repeat] run.bmef
+  *   -c  print one CSV line per frame
+  *   -v  show the state machine console output
+  *   -a  benchmark the air-quality engine alone, with and without
+  *       humidity compensation, on the compensated frames
+  *   -b  compensate the new frames again with bme680_compensate_batch(),
+  *       check every value against bme680_compensate_field() and time
+  *       both; exits 1 on a mismatch
+  *   -r  replay the capture repeat times for timing
+  * Build with FLOAT=1 to replay through the float compensation pipeline
+  * (BME680_FLOAT_POINT_COMPENSATION); CSV values are in field units.
+  ******************************************************************************
+**/
+
+#include <fcntl.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "air_quality.h"
+#include "frame_log.h"
+#include "statemachine.h"
+#include "stm32f4xx_hal.h"
+
+GPIO_TypeDef host_gpiod;
+static int verbose;
+
+void HAL_GPIO_WritePin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin, GPIO_PinState PinState)
+{
+	if (PinState == GPIO_PIN_SET)
+		GPIOx->ODR |= GPIO_Pin;
+	else
+		GPIOx->ODR &= ~(uint32_t)GPIO_Pin;
+}
+
+void myprintf(const char *fmt, ...)
+{
+	va_list args;
+
+	if (!verbose)
+		return;
+	va_start(args, fmt);
+	vprintf(fmt, args);
+	va_end(args);
+}
+
+/* The driver only talks to the bus in init and settings calls */
+static int8_t no_bus(uint8_t dev_id, uint8_t reg_addr, uint8_t *data, uint16_t len)
+{
+	return -1;
+}
+
+static void no_delay(uint32_t period)
+{
+}
+
+/* FNV-1a, 64 bit */
+static uint64_t digest_add(uint64_t h, const void *buf, size_t len)
+{
+	const uint8_t *p = buf;
+
+	while (len--)
+		h = (h ^ *p++) * 0x100000001B3ULL;
+	return h;
+}
+
+static double now_s(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* Runs a fresh engine over the samples repeat times and prints its cost
+ * and the index it reached; 100 and 200 are statemachine.c's GasHiModerate
+ * and GasHiDanger */
+static void aq_bench(const char *name, int32_t hum_slope, const struct bme680_field_data *sample, uint32_t count,
+		int repeat)
+{
+	struct aq_engine aq;
+	uint32_t i, moderate = 0, danger = 0;
+	uint16_t index, peak = 0;
+	volatile uint16_t sink;
+	double t0, wall;
+	int pass;
+
+	aq_init(&aq, hum_slope);
+	for (i = 0; i < count; i++) {
+		index = aq_update(&aq, &sample[i]);
+		if (index > peak)
+			peak = index;
+		if (index >= 200)
+			danger++;
+		else if (index >= 100)
+			moderate++;
+	}
+
+	t0 = now_s();
+	for (pass = 0; pass < repeat; pass++) {
+		aq_init(&aq, hum_slope);
+		for (i = 0; i < count; i++)
+			sink = aq_update(&aq, &sample[i]);
+	}
+	wall = now_s() - t0;
+	(void)sink;
+
+	fprintf(stderr, "aq %-12s index max %3u, %u samples >= 100, %u >= 200, baseline %u ohms, %.1f ns/sample\n",
+			name, peak, moderate, danger, fx_exp2(aq.baseline), count ? wall * 1e9 / ((double)count * repeat) : 0.0);
+}
+
+/* Decodes the raw fields of the new frames into arrays, as the driver's
+ * parse_field_data() does, runs them through bme680_compensate_batch() and
+ * compares every value with the per-frame results in sample. Then times
+ * both paths; the batch time includes the decode. Returns the mismatches. */
+static uint32_t batch_bench(const struct frame_log_view *view, struct bme680_dev *dev,
+		const struct bme680_field_data *sample, uint32_t count, int repeat)
+{
+	struct bme680_raw_batch raw;
+	struct bme680_comp_batch comp;
+	struct bme680_field_data data;
+	uint32_t *temp_adc, *pres_adc, *idx;
+	uint16_t *hum_adc, *gas_adc;
+	uint8_t *gas_range;
+	const uint8_t *buff;
+	uint32_t i, n = 0, miss = 0;
+	double t0, t_field, t_batch;
+	int pass;
+
+	idx = calloc(count ? count : 1, sizeof(*idx));
+	temp_adc = calloc(count ? count : 1, sizeof(*temp_adc));
+	pres_adc = calloc(count ? count : 1, sizeof(*pres_adc));
+	hum_adc = calloc(count ? count : 1, sizeof(*hum_adc));
+	gas_adc = calloc(count ? count : 1, sizeof(*gas_adc));
+	gas_range = calloc(count ? count : 1, sizeof(*gas_range));
+	comp.temperature = calloc(count ? count : 1, sizeof(*comp.temperature));
+	comp.pressure = calloc(count ? count : 1, sizeof(*comp.pressure));
+	comp.humidity = calloc(count ? count : 1, sizeof(*comp.humidity));
+	comp.gas_resistance = calloc(count ? count : 1, sizeof(*comp.gas_resistance));
+	if (idx == NULL || temp_adc == NULL || pres_adc == NULL || hum_adc == NULL || gas_adc == NULL
+			|| gas_range == NULL || comp.temperature == NULL || comp.pressure == NULL || comp.humidity == NULL
+			|| comp.gas_resistance == NULL) {
+		perror("calloc");
+		exit(1);
+	}
+	raw.temp_adc = temp_adc;
+	raw.pres_adc = pres_adc;
+	raw.hum_adc = hum_adc;
+	raw.gas_adc = gas_adc;
+	raw.gas_range = gas_range;
+
+	for (i = 0; i < view->count && n < count; i++) {
+		if (view->frame[i].field[0] & BME680_NEW_DATA_MSK)
+			idx[n++] = i;
+	}
+
+	t0 = now_s();
+	for (pass = 0; pass < repeat; pass++) {
+		for (i = 0; i < n; i++) {
+			buff = view->frame[idx[i]].field;
+			pres_adc[i] = ((uint32_t)buff[2] << 12) | ((uint32_t)buff[3] << 4) | (buff[4] >> 4);
+			temp_adc[i] = ((uint32_t)buff[5] << 12) | ((uint32_t)buff[6] << 4) | (buff[7] >> 4);
+			hum_adc[i] = (uint16_t)(((uint16_t)buff[8] << 8) | buff[9]);
+			gas_adc[i] = (uint16_t)(((uint16_t)buff[13] << 2) | (buff[14] >> 6));
+			gas_range[i] = buff[14] & BME680_GAS_RANGE_MSK;
+		}
+		bme680_compensate_batch(&raw, &comp, n, dev);
+	}
+	t_batch = now_s() - t0;
+
+	for (i = 0; i < n; i++) {
+		if (comp.temperature[i] != sample[i].temperature || comp.pressure[i] != sample[i].pressure
+				|| comp.humidity[i] != sample[i].humidity || comp.gas_resistance[i] != sample[i].gas_resistance)
+			miss++;
+	}
+
+	t0 = now_s();
+	for (pass = 0; pass < repeat; pass++) {
+		for (i = 0; i < n; i++)
+			bme680_compensate_field(view->frame[idx[i]].field, &data, dev);
+	}
+	t_field = now_s() - t0;
+
+	fprintf(stderr, "batch: %u of %u frames differ from bme680_compensate_field()\n", miss + (count - n), count);
+	if (n)
+		fprintf(stderr, "batch: per frame %.1f ns/sample, batch %.1f ns/sample with decode\n",
+				t_field * 1e9 / ((double)n * repeat), t_batch * 1e9 / ((double)n * repeat));
+
+	free(idx);
+	free(temp_adc);
+	free(pres_adc);
+	free(hum_adc);
+	free(gas_adc);
+	free(gas_range);
+	free(comp.temperature);
+	free(comp.pressure);
+	free(comp.humidity);
+	free(comp.gas_resistance);
+
+	return miss + (count - n);
+}
+
+int main(int argc, char **argv)
+{
+	struct frame_log_view view;
+	struct bme680_dev dev;
+	struct bme680_field_data data, *sample = NULL;
+	struct derived_data derived;
+	const struct frame_log_frame *f;
+	struct stat st;
+	uint64_t digest = 0xCBF29CE484222325ULL;
+	uint32_t i, fresh = 0, dropped = 0, span, miss = 0;
+	int csv = 0, aq = 0, batch = 0, repeat = 1, pass, opt, fd;
+	double t0, wall;
+	void *map;
+
+	while ((opt = getopt(argc, argv, "cvabr:")) != -1) {
+		switch (opt) {
+		case 'c': csv = 1; break;
+		case 'v': verbose = 1; break;
+		case 'a': aq = 1; break;
+		case 'b': batch = 1; break;
+		case 'r': repeat = atoi(optarg) > 0 ? atoi(optarg) : 1; break;
+		default:
+			fprintf(stderr, "usage: %s [-c] [-v] [-a] [-b] [-r repeat] capture\n", argv[0]);
+			return 2;
+		}
+	}
+	if (optind >= argc) {
+		fprintf(stderr, "usage: %s [-c] [-v] [-a] [-b] [-r repeat] capture\n", argv[0]);
+		return 2;
+	}
+
+	fd = open(argv[optind], O_RDONLY);
+	if (fd < 0 || fstat(fd, &st) < 0) {
+		perror(argv[optind]);
+		return 1;
+	}
+	map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (map == MAP_FAILED) {
+		perror("mmap");
+		return 1;
+	}
+	madvise(map, st.st_size, MADV_SEQUENTIAL);
+
+	if (frame_log_open(&view, map, (uint32_t)st.st_size) != BME680_OK) {
+		fprintf(stderr, "%s: not a capture of this format\n", argv[optind]);
+		return 1;
+	}
+
+	memset(&dev, 0, sizeof(dev));
+	memset(&data, 0, sizeof(data));	/* padding is part of the digest */
+	memset(&derived, 0, sizeof(derived));
+	dev.intf = BME680_I2C_INTF;
+	dev.read = no_bus;
+	dev.write = no_bus;
+	dev.delay_ms = no_delay;
+	frame_log_load(&view, &dev);
+	if (aq || batch) {
+		sample = calloc(view.count ? view.count : 1, sizeof(*sample));
+		if (sample == NULL) {
+			perror("calloc");
+			return 1;
+		}
+	}
+
+	if (csv)
+		printf("t_ms,seq,status,gas_index,meas_index,temperature,pressure,humidity,gas_resistance,aq_index,dew_point,abs_humidity,height,leds\n");
+
+	t0 = now_s();
+	for (pass = 0; pass < repeat; pass++) {
+		for (i = 0; i < view.count; i++) {
+			int8_t rslt;
+
+			f = &view.frame[i];
+			rslt = bme680_compensate_field(f->field, &data, &dev);
+			if (rslt == BME680_OK) {
+				derived_compute(&data, DERIVED_SEA_LEVEL_PA, &derived);
+				sensor_statemachine(&data, &derived);
+			}
+			if (pass != 0)
+				continue;
+
+			if (rslt == BME680_OK && sample != NULL)
+				sample[fresh] = data;
+			if (rslt == BME680_OK)
+				fresh++;
+			if (i != 0 && (uint8_t)(f->seq - view.frame[i - 1].seq) != 1)
+				dropped += (uint8_t)(f->seq - view.frame[i - 1].seq - 1);
+
+			digest = digest_add(digest, &data, sizeof(data));
+			digest = digest_add(digest, &host_gpiod.ODR, sizeof(host_gpiod.ODR));
+
+			if (csv)
+				printf("%u,%u,%u,%u,%u,%.9g,%.9g,%.9g,%.9g,%u,%d,%u,%d,%04x\n", f->t_ms, f->seq, data.status,
+						data.gas_index, data.meas_index, (double)data.temperature, (double)data.pressure,
+						(double)data.humidity, (double)data.gas_resistance, air_quality.index,
+						derived.dew_point, derived.abs_humidity, derived.height, (unsigned)host_gpiod.ODR);
+		}
+	}
+	wall = now_s() - t0;
+
+	span = view.count ? view.frame[view.count - 1].t_ms - view.frame[0].t_ms : 0;
+	fprintf(stderr, "sensor 0x%02x chip 0x%02x: %u frames, %u new, %u dropped, %.1f s recorded\n",
+			view.hdr->dev_id, view.hdr->chip_id, view.count, fresh, dropped, span / 1000.0);
+	fprintf(stderr, "digest %016llx\n", (unsigned long long)digest);
+	if (wall > 0 && view.count)
+		fprintf(stderr, "%d pass(es) in %.3f s: %.0f frames/s, %.0fx real time\n", repeat, wall,
+				view.count * (double)repeat / wall, span * (double)repeat / 1000.0 / wall);
+	if (batch)
+		miss = batch_bench(&view, &dev, sample, fresh, repeat);
+	if (aq) {
+		fprintf(stderr, "aq engine: %zu bytes of state, %u samples\n", sizeof(struct aq_engine), fresh);
+		aq_bench("compensated", AQ_HUM_SLOPE, sample, fresh, repeat);
+		aq_bench("raw", 0, sample, fresh, repeat);
+	}
+	free(sample);
+
+	munmap(map, st.st_size);
+	close(fd);
+
+	return miss ? 1 : 0;
+}
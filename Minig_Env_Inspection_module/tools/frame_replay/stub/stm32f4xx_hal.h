@@ -0,0 +1,31 @@
+/**
+  ******************************************************************************
+  * @file           : stm32f4xx_hal.h
+  * @brief          : Host stand-in for the HAL, just enough for statemachine.c
+  ******************************************************************************/
+
+#ifndef STM32F4XX_HAL_H_
+#define STM32F4XX_HAL_H_
+
+#include <stdint.h>
+
+typedef struct {
+	uint32_t ODR;
+} GPIO_TypeDef;
+
+typedef enum {
+	GPIO_PIN_RESET = 0,
+	GPIO_PIN_SET
+} GPIO_PinState;
+
+#define GPIO_PIN_12		((uint16_t)0x1000)
+#define GPIO_PIN_14		((uint16_t)0x4000)
+#define GPIO_PIN_15		((uint16_t)0x8000)
+
+extern GPIO_TypeDef host_gpiod;
+#define GPIOD			(&host_gpiod)
+
+void HAL_GPIO_WritePin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin, GPIO_PinState PinState);
+void myprintf(const char *fmt, ...);
+
+#endif /* STM32F4XX_HAL_H_ */
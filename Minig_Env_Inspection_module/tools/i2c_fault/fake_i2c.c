@@ -0,0 +1,362 @@
+/**
+  ******************************************************************************
+  * @file           : fake_i2c.c
+  * @brief          : Simulated HAL with two I2C buses and fault injection
+  ******************************************************************************
+  * Stands in for the HAL calls of i2c_transport.c and ssd1306.c, and for
+  * the register-level i2c_ll engine underneath the former. Each bus
+  * can misbehave per device: NACKs, clock stretching, bus errors and a
+  * slave that hangs holding SDA low until SCL is pulsed. Time is virtual;
+  * transfers complete from __WFI(), with __get_IPSR() non-zero while
+  * their callbacks run, and HAL_GetTick()/cyccnt_read() follow the
+  * simulated wire. A read buffer is filled with 0x5A only when its
+  * transfer completes without error, as DMA would leave it.
+  ******************************************************************************
+**/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "main.h"
+#include "cyccnt.h"
+#include "i2c_transport.h"
+#include "i2c_ll.h"
+#include "fake_i2c.h"
+
+#define FAULT_MAX		8
+#define BUSY_FLAG_MS	25			/* I2C_TIMEOUT_BUSY_FLAG of the HAL */
+
+static const char *const fault_names[] = { "nack", "stretch", "berr", "hang" };
+
+struct fault {
+	uint8_t dev_id;
+	uint8_t kind;
+	double prob;
+	uint32_t us;
+};
+
+GPIO_TypeDef host_gpiob;
+uint32_t SystemCoreClock = 96000000;
+
+static I2C_TypeDef i2c1_inst = { 0 }, i2c2_inst = { 1 };
+static DMA_HandleTypeDef dma_dummy;
+I2C_HandleTypeDef hi2c1 = { .Instance = &i2c1_inst, .hdmatx = &dma_dummy, .hdmarx = &dma_dummy };
+I2C_HandleTypeDef hi2c2 = { .Instance = &i2c2_inst, .hdmatx = NULL, .hdmarx = &dma_dummy };
+
+struct fake_bus fake[2] = { { .init = 1 }, { .init = 1 } };
+static struct fault faults[FAULT_MAX];
+static int fault_count;
+static uint8_t in_isr;
+static uint32_t rng = 1;
+uint64_t now_ns;
+uint32_t injected[FAULT_KINDS];
+
+/* ------------------------------------------------------------------ */
+
+void fake_i2c_seed(uint32_t seed)
+{
+	rng = seed | 1;
+}
+
+double fake_i2c_rnd(void)
+{
+	rng ^= rng << 13;
+	rng ^= rng >> 17;
+	rng ^= rng << 5;
+	return rng / 4294967296.0;
+}
+
+uint32_t HAL_GetTick(void)
+{
+	return (uint32_t)(now_ns / 1000000ULL);
+}
+
+/* Every read costs a few cycles, so busy-waits on it make progress */
+uint32_t cyccnt_read(void)
+{
+	now_ns += 20;
+	return (uint32_t)(now_ns * 96 / 1000);
+}
+
+void __disable_irq(void)
+{
+}
+
+void __enable_irq(void)
+{
+}
+
+uint32_t __get_PRIMASK(void)
+{
+	return 0;
+}
+
+void __set_PRIMASK(uint32_t primask)
+{
+}
+
+/* Non-zero while a completion callback runs, as in a handler */
+uint32_t __get_IPSR(void)
+{
+	return in_isr;
+}
+
+static struct fake_bus *fake_of(I2C_HandleTypeDef *hi2c)
+{
+	return &fake[hi2c->Instance->bus];
+}
+
+static I2C_HandleTypeDef *handle_of(uint8_t bus)
+{
+	return bus ? &hi2c2 : &hi2c1;
+}
+
+/* Ends a due transfer through the HAL or i2c_ll callbacks */
+static void fire(uint8_t bus)
+{
+	struct fake_bus *b = &fake[bus];
+	I2C_HandleTypeDef *hi2c = handle_of(bus);
+
+	if (!b->pending || b->done_ns > now_ns)
+		return;
+
+	b->pending = 0;
+	if (b->rx && b->error == 0)
+		memset(b->data, 0x5A, b->len);
+	hi2c->ErrorCode = b->error;
+	in_isr = 1;
+	if (b->ll)
+		i2c_ll_done_callback(bus, (b->error == 0) ? I2C_LL_OK
+				: (b->error == HAL_I2C_ERROR_AF) ? I2C_LL_NACK : I2C_LL_ERROR);
+	else if (b->error)
+		HAL_I2C_ErrorCallback(hi2c);
+	else if (b->rx)
+		HAL_I2C_MemRxCpltCallback(hi2c);
+	else
+		HAL_I2C_MemTxCpltCallback(hi2c);
+	in_isr = 0;
+}
+
+/* Sleeps to the next DMA completion or SysTick, whichever is first */
+void __WFI(void)
+{
+	uint64_t next = (now_ns / 1000000ULL + 1) * 1000000ULL;
+	uint8_t i;
+
+	for (i = 0; i < 2; i++) {
+		if (fake[i].pending && fake[i].done_ns < next)
+			next = fake[i].done_ns;
+	}
+	if (next > now_ns)
+		now_ns = next;
+	for (i = 0; i < 2; i++)
+		fire(i);
+}
+
+uint8_t host_i2c_flag(I2C_HandleTypeDef *hi2c, uint32_t flag)
+{
+	return (flag == I2C_FLAG_BUSY) && fake_of(hi2c)->hung;
+}
+
+void HAL_GPIO_Init(GPIO_TypeDef *GPIOx, GPIO_InitTypeDef *GPIO_Init)
+{
+}
+
+/* SCL rising edges while a slave hangs count towards its release */
+void HAL_GPIO_WritePin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin, GPIO_PinState PinState)
+{
+	struct fake_bus *b = NULL;
+
+	if (GPIO_Pin == GPIO_PIN_6)
+		b = &fake[0];
+	else if (GPIO_Pin == GPIO_PIN_10)
+		b = &fake[1];
+	if (b == NULL || b->init)
+		return;
+
+	if (PinState == GPIO_PIN_SET && !b->scl && b->hung && --b->release == 0)
+		b->hung = 0;
+	b->scl = (PinState == GPIO_PIN_SET);
+}
+
+GPIO_PinState HAL_GPIO_ReadPin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin)
+{
+	if (GPIO_Pin == GPIO_PIN_7)
+		return fake[0].hung ? GPIO_PIN_RESET : GPIO_PIN_SET;
+	if (GPIO_Pin == GPIO_PIN_3)
+		return fake[1].hung ? GPIO_PIN_RESET : GPIO_PIN_SET;
+	return GPIO_PIN_SET;
+}
+
+HAL_StatusTypeDef HAL_I2C_Init(I2C_HandleTypeDef *hi2c)
+{
+	fake_of(hi2c)->init = 1;
+	hi2c->ErrorCode = HAL_I2C_ERROR_NONE;
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_I2C_DeInit(I2C_HandleTypeDef *hi2c)
+{
+	struct fake_bus *b = fake_of(hi2c);
+
+	b->init = 0;
+	b->pending = 0;
+	b->scl = 1;
+	return HAL_OK;
+}
+
+/* Every device answers; faults only hit register transactions */
+HAL_StatusTypeDef HAL_I2C_IsDeviceReady(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint32_t Trials,
+		uint32_t Timeout)
+{
+	return fake_of(hi2c)->init ? HAL_OK : HAL_BUSY;
+}
+
+uint32_t HAL_I2C_GetError(I2C_HandleTypeDef *hi2c)
+{
+	return hi2c->ErrorCode;
+}
+
+/* Draws the fault, if any, that hits this transaction */
+static const struct fault *draw(I2C_HandleTypeDef *hi2c, uint16_t dev_addr)
+{
+	uint8_t dev_id = (uint8_t)((dev_addr >> 1) | (hi2c->Instance->bus ? I2C_BUS2_FLAG : 0));
+	int i;
+
+	for (i = 0; i < fault_count; i++) {
+		if (faults[i].dev_id == dev_id && fake_i2c_rnd() < faults[i].prob) {
+			injected[faults[i].kind]++;
+			return &faults[i];
+		}
+	}
+
+	return NULL;
+}
+
+static void hang(struct fake_bus *b)
+{
+	b->hung = 1;
+	b->release = 1 + (uint8_t)(fake_i2c_rnd() * 8);
+}
+
+/* DMA transfer: the address phase is polled, the rest ends from __WFI() */
+static HAL_StatusTypeDef mem_dma(I2C_HandleTypeDef *hi2c, uint16_t dev_addr, uint8_t *data, uint16_t len,
+		uint8_t rx)
+{
+	struct fake_bus *b = fake_of(hi2c);
+	const struct fault *f;
+	uint64_t wire = (len + (rx ? 3 : 2)) * BYTE_NS;
+
+	hi2c->ErrorCode = HAL_I2C_ERROR_NONE;
+	if (!b->init || b->pending)
+		return HAL_BUSY;
+	if (b->hung) {
+		now_ns += BUSY_FLAG_MS * 1000000ULL;
+		return HAL_BUSY;
+	}
+
+	f = draw(hi2c, dev_addr);
+	if (f != NULL && f->kind == FAULT_NACK) {
+		now_ns += BYTE_NS;
+		hi2c->ErrorCode = HAL_I2C_ERROR_AF;
+		return HAL_ERROR;
+	}
+
+	now_ns += 2 * BYTE_NS;
+	b->rx = rx;
+	b->data = data;
+	b->len = len;
+	b->ll = 0;
+	b->error = 0;
+	if (f != NULL && f->kind == FAULT_HANG) {
+		hang(b);
+		return HAL_OK;			/* never completes */
+	}
+	if (f != NULL && f->kind == FAULT_STRETCH)
+		wire += f->us * 1000ULL;
+	if (f != NULL && f->kind == FAULT_BERR) {
+		wire /= 2;
+		b->error = HAL_I2C_ERROR_BERR;
+	}
+	b->pending = 1;
+	b->done_ns = now_ns + wire;
+	return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_I2C_Mem_Read_DMA(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint16_t MemAddress,
+		uint16_t MemAddSize, uint8_t *pData, uint16_t Size)
+{
+	return mem_dma(hi2c, DevAddress, pData, Size, 1);
+}
+
+HAL_StatusTypeDef HAL_I2C_Mem_Write_DMA(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint16_t MemAddress,
+		uint16_t MemAddSize, uint8_t *pData, uint16_t Size)
+{
+	return mem_dma(hi2c, DevAddress, pData, Size, 0);
+}
+
+/* i2c_ll job: the whole transaction, address phase included, ends from
+ * __WFI(); a slave that hangs never lets it finish */
+int8_t i2c_ll_start(uint8_t bus, uint8_t addr, uint8_t reg_addr, uint8_t *data, uint16_t len, uint8_t read)
+{
+	struct fake_bus *b = &fake[bus];
+	const struct fault *f;
+	uint64_t wire = (len + (read ? 3 : 2)) * BYTE_NS;
+
+	if (read && (len == 0))
+		return -1;
+
+	b->rx = read;
+	b->ll = 1;
+	b->error = 0;
+	if (b->hung)
+		return 0;
+
+	f = draw(handle_of(bus), addr << 1);
+	if (f != NULL && f->kind == FAULT_HANG) {
+		hang(b);
+		return 0;
+	}
+	if (f != NULL && f->kind == FAULT_NACK) {
+		wire = BYTE_NS;
+		b->error = HAL_I2C_ERROR_AF;
+	}
+	if (f != NULL && f->kind == FAULT_STRETCH)
+		wire += f->us * 1000ULL;
+	if (f != NULL && f->kind == FAULT_BERR) {
+		wire /= 2;
+		b->error = HAL_I2C_ERROR_BERR;
+	}
+	b->data = data;
+	b->len = len;
+	b->pending = 1;
+	b->done_ns = now_ns + wire;
+	return 0;
+}
+
+void i2c_ll_abort(uint8_t bus)
+{
+	fake[bus].pending = 0;
+	fake[bus].ll = 0;
+}
+
+int fake_i2c_fault(char *spec)
+{
+	struct fault *f = &faults[fault_count];
+	char *dev = strtok(spec, ":"), *kind = strtok(NULL, ":"), *prob = strtok(NULL, ":"), *us = strtok(NULL, ":");
+	int k;
+
+	if (fault_count == FAULT_MAX || dev == NULL || kind == NULL || prob == NULL)
+		return -1;
+	for (k = 0; k < FAULT_KINDS && strcmp(kind, fault_names[k]) != 0; k++)
+		;
+	if (k == FAULT_KINDS)
+		return -1;
+
+	f->dev_id = (uint8_t)strtoul(dev, NULL, 0);
+	f->kind = (uint8_t)k;
+	f->prob = atof(prob);
+	f->us = us ? (uint32_t)strtoul(us, NULL, 0) : 10000;
+	fault_count++;
+	return 0;
+}
@@ -0,0 +1,46 @@
+/**
+  ******************************************************************************
+  * @file           : fake_i2c.h
+  * @brief          : Simulated HAL with two I2C buses and fault injection
+  ******************************************************************************/
+
+#ifndef FAKE_I2C_H_
+#define FAKE_I2C_H_
+
+#include <stdint.h>
+
+#define BYTE_NS			22500ULL	/* 9 clocks at 400 kHz */
+
+enum fault_kind {
+	FAULT_NACK,
+	FAULT_STRETCH,
+	FAULT_BERR,
+	FAULT_HANG,
+	FAULT_KINDS
+};
+
+/* One simulated bus */
+struct fake_bus {
+	uint8_t init;
+	uint8_t hung;				/* a slave holds SDA low */
+	uint8_t release;			/* SCL pulses until it lets go */
+	uint8_t scl;				/* SCL level while driven as GPIO */
+	uint8_t pending;			/* transfer in flight */
+	uint8_t ll;					/* it is an i2c_ll job */
+	uint8_t rx;
+	uint8_t *data;				/* read buffer, filled on completion */
+	uint16_t len;
+	uint64_t done_ns;
+	uint32_t error;				/* ErrorCode it ends with, 0 for success */
+};
+
+extern struct fake_bus fake[2];
+extern uint64_t now_ns;
+extern uint32_t injected[FAULT_KINDS];
+
+void fake_i2c_seed(uint32_t seed);
+double fake_i2c_rnd(void);
+/* Adds a dev:nack|stretch|berr|hang:prob[:us] fault; 0 on success */
+int fake_i2c_fault(char *spec);
+
+#endif /* FAKE_I2C_H_ */
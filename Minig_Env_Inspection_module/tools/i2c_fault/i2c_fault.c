@@ -0,0 +1,140 @@
+/**
+  ******************************************************************************
+  * @file           : i2c_fault.c
+  * @brief          : Fault injection run of i2c_transport.c on a simulated bus
+  ******************************************************************************
+  * Links the firmware's i2c_transport.c against the simulated HAL of
+  * fake_i2c.c, whose two I2C buses can misbehave per device: NACKs, clock
+  * stretching, bus errors and a slave that hangs holding SDA low until SCL
+  * is pulsed.
+  *
+  * Every loop runs the main.c bus traffic: a status poll and an async field
+  * read of the BME680 at 0x77 on I2C1, an OLED page (three commands and 128
+  * data bytes) at 0x3C on I2C1, and a sync read and a register write of the
+  * BME680 at 0x76 on I2C2. At the end it prints i2c_dev_stats the way
+  * BME680_Stats() does, the recoveries and the longest loop, which the
+  * deadlines must keep bounded whatever the faults.
+  *
+  *     make && ./i2c_fault [-n loops] [-s seed] [-f dev:fault:prob[:us]]...
+  *   -n  loops to run (default 10000)
+  *   -s  random seed (default 1)
+  *   -f  inject a fault on dev (dev_id as in main.c, 0xF6 is 0x76 on I2C2)
+  *       with probability prob per transaction; fault is one of
+  *         nack     address not acknowledged
+  *         stretch  the slave stretches the clock by us microseconds
+  *         berr     bus error part way through a transfer
+  *         hang     the slave holds SDA low until SCL is pulsed
+  *       e.g. -f 0x77:hang:0.01 -f 0x3c:stretch:0.05:12000 -f 0xf6:nack:0.1
+  ******************************************************************************
+**/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "main.h"
+#include "cyccnt.h"
+#include "i2c_transport.h"
+#include "fake_i2c.h"
+
+#define LOOP_IDLE_MS	10
+
+static volatile int async_done;
+static int8_t async_rslt;
+
+static void field_cplt(int8_t rslt, void *ctx)
+{
+	async_rslt = rslt;
+	async_done = 1;
+}
+
+/* One pass of main.c's bus traffic */
+static void run_loop(uint32_t *async_fail)
+{
+	uint8_t buf[128] = { 0 };
+	uint8_t reg = 0;
+
+	/* BME680 0x77 on I2C1: status poll, then the field read the engine queues */
+	user_i2c_read(0x77, 0x1D, buf, 1);
+	async_done = 0;
+	if (user_i2c_read_async(0x77, 0x1D, buf, 15, field_cplt, NULL) == 0) {
+		while (!async_done) {
+			i2c_transport_service();
+			__WFI();
+		}
+		if (async_rslt != 0)
+			(*async_fail)++;
+	} else {
+		(*async_fail)++;
+	}
+
+	/* OLED page on I2C1, as SSD1306_UpdateScreen() sends it */
+	if (user_i2c_write(0x3C, 0x00, &reg, 1) == 0 && user_i2c_write(0x3C, 0x00, &reg, 1) == 0
+			&& user_i2c_write(0x3C, 0x00, &reg, 1) == 0)
+		user_i2c_write(0x3C, 0x40, buf, sizeof(buf));
+
+	/* BME680 0x76 on I2C2: blocking read and a control register write */
+	user_i2c_read(I2C_BUS2_FLAG | 0x76, 0x1D, buf, 15);
+	user_i2c_write(I2C_BUS2_FLAG | 0x76, 0x74, &reg, 1);
+
+	i2c_transport_service();
+}
+
+int main(int argc, char **argv)
+{
+	uint32_t loops = 10000, n, async_fail = 0;
+	uint64_t t0, dt, worst = 0, total = 0;
+	const struct i2c_dev_stats *st;
+	int opt, i, bin;
+
+	while ((opt = getopt(argc, argv, "n:s:f:")) != -1) {
+		switch (opt) {
+		case 'n':
+			loops = strtoul(optarg, NULL, 0);
+			break;
+		case 's':
+			fake_i2c_seed(strtoul(optarg, NULL, 0));
+			break;
+		case 'f':
+			if (fake_i2c_fault(optarg) == 0)
+				break;
+			/* fall through */
+		default:
+			fprintf(stderr, "usage: %s [-n loops] [-s seed] [-f dev:nack|stretch|berr|hang:prob[:us]]...\n",
+					argv[0]);
+			return 1;
+		}
+	}
+
+	i2c_transport_init();
+	for (n = 0; n < loops; n++) {
+		t0 = now_ns;
+		run_loop(&async_fail);
+		dt = now_ns - t0;
+		total += dt;
+		if (dt > worst)
+			worst = dt;
+		now_ns += LOOP_IDLE_MS * 1000000ULL;
+	}
+
+	printf("%u loops, injected %u nack, %u stretch, %u berr, %u hang\n", loops, injected[FAULT_NACK],
+			injected[FAULT_STRETCH], injected[FAULT_BERR], injected[FAULT_HANG]);
+	printf("dev    xfers  nacks errors  touts  avg_us  max_us | <250 <500 <1m <2m <4m <8m <16m more\n");
+	for (i = 0; i < I2C_TRANSPORT_DEVS; i++) {
+		st = &i2c_dev_stats[i];
+		if (!st->used)
+			continue;
+		printf("%u:%02X %7u %6u %6u %6u %7u %7u |", (st->dev_id & I2C_BUS2_FLAG) ? 2 : 1,
+				I2C_DEV_ADDR(st->dev_id), st->xfers, st->nacks, st->errors, st->timeouts,
+				st->xfers ? st->lat_sum / st->xfers : 0, st->lat_max);
+		for (bin = 0; bin < I2C_LAT_BINS; bin++)
+			printf(" %u", st->lat_hist[bin]);
+		printf("\n");
+	}
+	printf("recoveries %u, async reads failed %u, still hung %u/%u\n", i2c_stats.recoveries, async_fail,
+			fake[0].hung, fake[1].hung);
+	printf("loop time avg %.2f ms, max %.2f ms\n", total / 1e6 / (loops ? loops : 1), worst / 1e6);
+
+	return 0;
+}
@@ -0,0 +1,217 @@
+/**
+  ******************************************************************************
+  * @file           : sched_run.c
+  * @brief          : Run of i2c_sched.c and the OLED frame push on a simulated bus
+  ******************************************************************************
+  * Links the firmware's i2c_sched.c, i2c_transport.c and ssd1306.c against
+  * the simulated HAL of fake_i2c.c and drives I2C1 the way main.c does: two
+  * BME680s at 0x77 and 0x76, each due every -p ms half a period apart, take
+  * a ctrl_meas write and an async 15-byte field read; every -d ms the OLED
+  * at 0x3C gets a full frame. With -b the frame goes out through the serial
+  * SSD1306_UpdateScreen() and the sensors use the transport directly, which
+  * is how the firmware ran before the scheduler.
+  *
+  * It prints how long each sensor sample waited from its due time until its
+  * field data was in (bins of 250 << n us, as i2c_dev_stats), and with the
+  * scheduler the queueing latency of every class as BME680_Stats() does.
+  *
+  *     make sched_run && ./sched_run [-b] [-a] [-t seconds] [-p ms] [-d ms] [-s seed] [-f fault]...
+  *   -b  serial baseline
+  *   -a  queue frames as I2C_CLASS_ALARM instead of I2C_CLASS_DISPLAY
+  *   -t  virtual seconds to run (default 60)
+  *   -p  sensor period in ms (default 35, off the frame period so the phases drift)
+  *   -d  frame period in ms (default 100)
+  *   -s  random seed (default 1)
+  *   -f  fault as in i2c_fault
+  ******************************************************************************
+**/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "main.h"
+#include "cyccnt.h"
+#include "i2c_transport.h"
+#include "i2c_sched.h"
+#include "ssd1306.h"
+#include "fake_i2c.h"
+
+#define SENSORS		2
+
+struct sensor {
+	uint8_t dev_id;
+	volatile uint8_t busy;
+	uint8_t field[15];
+	uint64_t due_ns;
+	uint32_t samples;
+	uint32_t failed;
+	uint32_t lat_hist[I2C_LAT_BINS];
+	uint64_t lat_sum;			/* us */
+	uint32_t lat_max;			/* us */
+};
+
+static struct sensor sensor[SENSORS] = { { .dev_id = 0x77 }, { .dev_id = 0x76 } };
+static uint64_t period_ns = 35000000ULL;
+
+/* Field read completion; in interrupt context for DMA reads */
+static void field_cplt(int8_t rslt, void *ctx)
+{
+	struct sensor *s = ctx;
+	uint32_t us = (uint32_t)((now_ns - s->due_ns) / 1000);
+	uint8_t bin = 0;
+
+	if (rslt != 0)
+		s->failed++;
+	s->samples++;
+	while (bin < I2C_LAT_BINS - 1 && us >= ((uint32_t)I2C_LAT_BIN0_US << bin))
+		bin++;
+	s->lat_hist[bin]++;
+	s->lat_sum += us;
+	if (us > s->lat_max)
+		s->lat_max = us;
+	s->due_ns += period_ns;
+	s->busy = 0;
+}
+
+/* Trigger and field read of a due sensor */
+static void sample(struct sensor *s, int baseline)
+{
+	uint8_t ctrl_meas = 0x55;
+
+	s->busy = 1;
+	if (baseline) {
+		user_i2c_write(s->dev_id, 0x74, &ctrl_meas, 1);
+		if (user_i2c_read_async(s->dev_id, 0x1D, s->field, sizeof(s->field), field_cplt, s) != 0)
+			field_cplt(-1, s);
+	} else {
+		i2c_sched_write(s->dev_id, 0x74, &ctrl_meas, 1);
+		if (i2c_sched_read_async(s->dev_id, 0x1D, s->field, sizeof(s->field), field_cplt, s) != 0)
+			field_cplt(-1, s);
+	}
+}
+
+int main(int argc, char **argv)
+{
+	static const char *const class_name[I2C_CLASSES] = { "sensor", "alarm", "display" };
+	uint64_t end_ns, frame_ns, next_frame, t0, frame_sum = 0;
+	uint32_t seconds = 60, frames = 0, samples, lat_hist[I2C_LAT_BINS] = { 0 }, lat_max = 0, failed = 0;
+	uint64_t lat_sum = 0;
+	uint8_t cls = I2C_CLASS_DISPLAY;
+	const struct i2c_class_stats *st;
+	int baseline = 0, opt, i, bin;
+
+	frame_ns = 100000000ULL;
+	while ((opt = getopt(argc, argv, "bat:p:d:s:f:")) != -1) {
+		switch (opt) {
+		case 'b':
+			baseline = 1;
+			break;
+		case 'a':
+			cls = I2C_CLASS_ALARM;
+			break;
+		case 't':
+			seconds = strtoul(optarg, NULL, 0);
+			break;
+		case 'p':
+			period_ns = strtoull(optarg, NULL, 0) * 1000000ULL;
+			break;
+		case 'd':
+			frame_ns = strtoull(optarg, NULL, 0) * 1000000ULL;
+			break;
+		case 's':
+			fake_i2c_seed(strtoul(optarg, NULL, 0));
+			break;
+		case 'f':
+			if (fake_i2c_fault(optarg) == 0)
+				break;
+			/* fall through */
+		default:
+			fprintf(stderr, "usage: %s [-b] [-a] [-t seconds] [-p ms] [-d ms] [-s seed] [-f fault]...\n",
+					argv[0]);
+			return 1;
+		}
+	}
+	if (period_ns == 0 || frame_ns == 0) {
+		fprintf(stderr, "periods must be at least 1 ms\n");
+		return 1;
+	}
+
+	i2c_transport_init();
+	if (!SSD1306_Init()) {
+		fprintf(stderr, "SSD1306_Init failed\n");
+		return 1;
+	}
+	memset(i2c_sched_stats, 0, sizeof(i2c_sched_stats));
+
+	t0 = now_ns;
+	end_ns = now_ns + seconds * 1000000000ULL;
+	next_frame = now_ns;
+	for (i = 0; i < SENSORS; i++)
+		sensor[i].due_ns = now_ns + i * period_ns / SENSORS;
+
+	while (now_ns < end_ns) {
+		for (i = 0; i < SENSORS; i++) {
+			if (!sensor[i].busy && now_ns >= sensor[i].due_ns)
+				sample(&sensor[i], baseline);
+		}
+
+		if (now_ns >= next_frame) {
+			SSD1306_Fill((frames & 1) ? SSD1306_COLOR_WHITE : SSD1306_COLOR_BLACK);
+			if (baseline) {
+				t0 = now_ns;
+				SSD1306_UpdateScreen();
+				frame_sum += now_ns - t0;
+			} else {
+				SSD1306_UpdateScreenAsync(cls);
+			}
+			frames++;
+			next_frame += frame_ns;
+		}
+
+		if (baseline) {
+			i2c_transport_service();
+		} else {
+			i2c_sched_service();
+			SSD1306_Service();
+		}
+		__WFI();
+	}
+
+	for (i = 0, samples = 0; i < SENSORS; i++) {
+		samples += sensor[i].samples;
+		failed += sensor[i].failed;
+		lat_sum += sensor[i].lat_sum;
+		if (sensor[i].lat_max > lat_max)
+			lat_max = sensor[i].lat_max;
+		for (bin = 0; bin < I2C_LAT_BINS; bin++)
+			lat_hist[bin] += sensor[i].lat_hist[bin];
+	}
+
+	printf("%s, %u s, sensors every %llu ms, frames every %llu ms\n", baseline ? "serial baseline" : "scheduler",
+			seconds, (unsigned long long)(period_ns / 1000000), (unsigned long long)(frame_ns / 1000000));
+	printf("frames %u", frames);
+	if (baseline)
+		printf(", %.2f ms each, blocking the loop", frame_sum / 1e6 / (frames ? frames : 1));
+	printf("\n");
+	printf("                 count  avg_us  max_us | <250 <500 <1m <2m <4m <8m <16m more\n");
+	printf("sample due-data %6u %7llu %7u |", samples, (unsigned long long)(samples ? lat_sum / samples : 0),
+			lat_max);
+	for (bin = 0; bin < I2C_LAT_BINS; bin++)
+		printf(" %u", lat_hist[bin]);
+	printf("\n");
+	if (!baseline) {
+		for (i = 0; i < I2C_CLASSES; i++) {
+			st = &i2c_sched_stats[i];
+			printf("queue %-9s %6u %7u %7u |", class_name[i], st->started,
+					st->started ? st->lat_sum / st->started : 0, st->lat_max);
+			for (bin = 0; bin < I2C_LAT_BINS; bin++)
+				printf(" %u", st->lat_hist[bin]);
+			printf("  (depth %u, %u rejected)\n", st->depth_max, st->rejected);
+		}
+	}
+	printf("samples failed %u, recoveries %u\n", failed, i2c_stats.recoveries);
+
+	return 0;
+}
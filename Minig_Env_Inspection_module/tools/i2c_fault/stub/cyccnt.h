@@ -0,0 +1,19 @@
+/**
+  ******************************************************************************
+  * @file           : cyccnt.h
+  * @brief          : Host stand-in for the DWT cycle counter; counts virtual
+  *                   SYSCLK cycles, see fake_i2c.c
+  ******************************************************************************/
+
+#ifndef CYCCNT_H_
+#define CYCCNT_H_
+
+#include <stdint.h>
+
+static inline void cyccnt_init(void)
+{
+}
+
+uint32_t cyccnt_read(void);
+
+#endif /* CYCCNT_H_ */
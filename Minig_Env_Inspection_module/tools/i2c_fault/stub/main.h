@@ -0,0 +1,103 @@
+/**
+  ******************************************************************************
+  * @file           : main.h
+  * @brief          : Host stand-in for main.h and the HAL, just enough for
+  *                   i2c_transport.c and ssd1306.c; implemented by fake_i2c.c
+  ******************************************************************************/
+
+#ifndef MAIN_H_
+#define MAIN_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+typedef enum {
+	HAL_OK = 0,
+	HAL_ERROR,
+	HAL_BUSY,
+	HAL_TIMEOUT
+} HAL_StatusTypeDef;
+
+typedef struct {
+	uint32_t ODR;
+} GPIO_TypeDef;
+
+typedef enum {
+	GPIO_PIN_RESET = 0,
+	GPIO_PIN_SET
+} GPIO_PinState;
+
+typedef struct {
+	uint32_t Pin;
+	uint32_t Mode;
+	uint32_t Pull;
+	uint32_t Speed;
+	uint32_t Alternate;
+} GPIO_InitTypeDef;
+
+#define GPIO_PIN_3				((uint16_t)0x0008)
+#define GPIO_PIN_6				((uint16_t)0x0040)
+#define GPIO_PIN_7				((uint16_t)0x0080)
+#define GPIO_PIN_10				((uint16_t)0x0400)
+#define GPIO_MODE_OUTPUT_OD		0x00000011U
+#define GPIO_PULLUP				0x00000001U
+#define GPIO_SPEED_FREQ_HIGH	0x00000002U
+
+extern GPIO_TypeDef host_gpiob;
+#define GPIOB					(&host_gpiob)
+
+typedef struct {
+	uint8_t bus;
+} I2C_TypeDef;
+
+typedef struct {
+	uint8_t unused;
+} DMA_HandleTypeDef;
+
+typedef struct {
+	I2C_TypeDef *Instance;
+	DMA_HandleTypeDef *hdmatx;
+	DMA_HandleTypeDef *hdmarx;
+	uint32_t ErrorCode;
+} I2C_HandleTypeDef;
+
+#define I2C_MEMADD_SIZE_8BIT	0x00000001U
+#define I2C_FLAG_BUSY			0x00100002U
+
+#define HAL_I2C_ERROR_NONE		0x00000000U
+#define HAL_I2C_ERROR_BERR		0x00000001U
+#define HAL_I2C_ERROR_ARLO		0x00000002U
+#define HAL_I2C_ERROR_AF		0x00000004U
+#define HAL_I2C_ERROR_TIMEOUT	0x00000020U
+
+#define __HAL_I2C_GET_FLAG(__HANDLE__, __FLAG__)	host_i2c_flag((__HANDLE__), (__FLAG__))
+
+extern uint32_t SystemCoreClock;
+
+uint32_t HAL_GetTick(void);
+void HAL_GPIO_Init(GPIO_TypeDef *GPIOx, GPIO_InitTypeDef *GPIO_Init);
+void HAL_GPIO_WritePin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin, GPIO_PinState PinState);
+GPIO_PinState HAL_GPIO_ReadPin(GPIO_TypeDef *GPIOx, uint16_t GPIO_Pin);
+HAL_StatusTypeDef HAL_I2C_Init(I2C_HandleTypeDef *hi2c);
+HAL_StatusTypeDef HAL_I2C_DeInit(I2C_HandleTypeDef *hi2c);
+HAL_StatusTypeDef HAL_I2C_IsDeviceReady(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint32_t Trials,
+		uint32_t Timeout);
+HAL_StatusTypeDef HAL_I2C_Mem_Read_DMA(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint16_t MemAddress,
+		uint16_t MemAddSize, uint8_t *pData, uint16_t Size);
+HAL_StatusTypeDef HAL_I2C_Mem_Write_DMA(I2C_HandleTypeDef *hi2c, uint16_t DevAddress, uint16_t MemAddress,
+		uint16_t MemAddSize, uint8_t *pData, uint16_t Size);
+uint32_t HAL_I2C_GetError(I2C_HandleTypeDef *hi2c);
+void HAL_I2C_MemRxCpltCallback(I2C_HandleTypeDef *hi2c);
+void HAL_I2C_MemTxCpltCallback(I2C_HandleTypeDef *hi2c);
+void HAL_I2C_ErrorCallback(I2C_HandleTypeDef *hi2c);
+
+uint8_t host_i2c_flag(I2C_HandleTypeDef *hi2c, uint32_t flag);
+
+void __WFI(void);
+void __disable_irq(void);
+void __enable_irq(void);
+uint32_t __get_PRIMASK(void);
+void __set_PRIMASK(uint32_t primask);
+uint32_t __get_IPSR(void);
+
+#endif /* MAIN_H_ */
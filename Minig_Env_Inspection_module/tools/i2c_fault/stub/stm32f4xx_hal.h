@@ -0,0 +1,12 @@
+/**
+  ******************************************************************************
+  * @file           : stm32f4xx_hal.h
+  * @brief          : Host stand-in for the HAL umbrella header of ssd1306.h
+  ******************************************************************************/
+
+#ifndef STM32F4XX_HAL_H_
+#define STM32F4XX_HAL_H_
+
+#include "main.h"
+
+#endif /* STM32F4XX_HAL_H_ */
@@ -0,0 +1,222 @@
+/**
+  ******************************************************************************
+  * @file           : xfer_test.c
+  * @brief          : Checks transfer completion of i2c_transport.c on the simulated HAL
+  ******************************************************************************
+  * Drives user_i2c_read_async() and the synchronous hooks against
+  * fake_i2c.c and checks how every transfer completes:
+  *   dma       a 15-byte field read returns at once and runs on HAL DMA;
+  *             the bus reads busy and the buffer is untouched until the
+  *             completion interrupt, whose callback runs once, in
+  *             interrupt context, with 0
+  *   ll        a 1-byte read runs on i2c_ll and completes the same way
+  *   refused   a second asynchronous read on a busy bus is refused and
+  *             the first still completes
+  *   sync      a synchronous read on a busy bus waits for the transfer
+  *             in flight, whose callback has run by the time it returns
+  *   buses     reads on I2C1 and I2C2 are in flight together and each
+  *             completes on its own
+  *   nack      a NACKed address fails the start, no callback
+  *   berr      a bus error completes once with -1 and recovers the bus
+  *   hang      a slave holding SDA low is expired at the deadline by
+  *             i2c_transport_service(), once, with -1, and recovered
+  * Prints one line per case and exits 1 if any fails.
+  *
+  *     make xfer_test && ./xfer_test
+  ******************************************************************************
+**/
+
+#include <stdio.h>
+#include <string.h>
+
+#include "main.h"
+#include "cyccnt.h"
+#include "i2c_transport.h"
+#include "fake_i2c.h"
+
+#define FIELD_LEN		15
+
+/* Devices that only answer with a fault */
+#define DEV_NACK		0x60
+#define DEV_BERR		0x61
+#define DEV_HANG		0x62
+
+struct cplt_log {
+	uint32_t calls;
+	int8_t rslt;
+	uint32_t ipsr;				/* __get_IPSR() seen by the callback */
+	uint64_t at_ns;
+};
+
+static void cplt(int8_t rslt, void *ctx)
+{
+	struct cplt_log *log = ctx;
+
+	log->calls++;
+	log->rslt = rslt;
+	log->ipsr = __get_IPSR();
+	log->at_ns = now_ns;
+}
+
+/* Sleeps as the main loop would until cplt has run or limit_ms pass */
+static void wait_for(struct cplt_log *log, uint32_t limit_ms)
+{
+	uint64_t end = now_ns + limit_ms * 1000000ULL;
+
+	while (log->calls == 0 && now_ns < end) {
+		__WFI();
+		i2c_transport_service();
+	}
+}
+
+static int all(const uint8_t *buf, uint16_t len, uint8_t value)
+{
+	while (len--) {
+		if (*buf++ != value)
+			return 0;
+	}
+	return 1;
+}
+
+static int report(const char *name, int ok, const char *detail)
+{
+	printf("%-8s %s  %s\n", name, ok ? "pass" : "FAIL", detail);
+	return !ok;
+}
+
+/* One asynchronous read of len bytes from 0x77 on I2C1 */
+static int case_read(const char *name, uint16_t len, uint32_t *counter)
+{
+	struct cplt_log log = { 0 };
+	uint8_t buf[FIELD_LEN] = { 0 };
+	uint32_t before = *counter;
+	uint64_t t0 = now_ns;
+	char detail[96];
+	int ok;
+
+	ok = user_i2c_read_async(0x77, 0x1D, buf, len, cplt, &log) == 0;
+	ok = ok && log.calls == 0 && i2c_transport_busy(0x77) && all(buf, len, 0) && *counter == before + 1;
+	wait_for(&log, 50);
+	ok = ok && log.calls == 1 && log.rslt == 0 && log.ipsr != 0 && !i2c_transport_busy(0x77)
+			&& all(buf, len, 0x5A);
+
+	/* Nothing more arrives later */
+	now_ns += 10 * 1000000ULL;
+	i2c_transport_service();
+	ok = ok && log.calls == 1;
+
+	snprintf(detail, sizeof(detail), "%u bytes, callback %u time(s) after %.0f us, rslt %d", len, log.calls,
+			(log.at_ns - t0) / 1e3, log.rslt);
+	return report(name, ok, detail);
+}
+
+static int case_refused(void)
+{
+	struct cplt_log first = { 0 }, second = { 0 };
+	uint8_t a[FIELD_LEN], b[FIELD_LEN];
+	int8_t rslt;
+	int ok;
+
+	ok = user_i2c_read_async(0x77, 0x1D, a, FIELD_LEN, cplt, &first) == 0;
+	rslt = user_i2c_read_async(0x76, 0x1D, b, FIELD_LEN, cplt, &second);
+	ok = ok && rslt == -1;
+	wait_for(&first, 50);
+	now_ns += 10 * 1000000ULL;
+	i2c_transport_service();
+	ok = ok && first.calls == 1 && first.rslt == 0 && second.calls == 0;
+
+	return report("refused", ok, "second read on the busy bus refused, first completed");
+}
+
+static int case_sync(void)
+{
+	struct cplt_log log = { 0 };
+	uint8_t a[FIELD_LEN], b[FIELD_LEN] = { 0 };
+	int8_t rslt;
+	int ok;
+
+	ok = user_i2c_read_async(0x77, 0x1D, a, FIELD_LEN, cplt, &log) == 0;
+	rslt = user_i2c_read(0x76, 0x1D, b, FIELD_LEN);
+	ok = ok && rslt == 0 && log.calls == 1 && log.rslt == 0 && all(b, FIELD_LEN, 0x5A)
+			&& !i2c_transport_busy(0x77);
+
+	return report("sync", ok, "synchronous read waited for the transfer in flight");
+}
+
+static int case_buses(void)
+{
+	struct cplt_log one = { 0 }, two = { 0 };
+	uint8_t a[FIELD_LEN] = { 0 }, b[FIELD_LEN] = { 0 };
+	int ok;
+
+	ok = user_i2c_read_async(0x77, 0x1D, a, FIELD_LEN, cplt, &one) == 0;
+	ok = ok && user_i2c_read_async(I2C_BUS2_FLAG | 0x77, 0x1D, b, FIELD_LEN, cplt, &two) == 0;
+	ok = ok && i2c_transport_busy(0x77) && i2c_transport_busy(I2C_BUS2_FLAG | 0x77);
+	wait_for(&one, 50);
+	wait_for(&two, 50);
+	ok = ok && one.calls == 1 && two.calls == 1 && one.rslt == 0 && two.rslt == 0 && all(a, FIELD_LEN, 0x5A)
+			&& all(b, FIELD_LEN, 0x5A);
+
+	return report("buses", ok, "I2C1 and I2C2 in flight together, both completed");
+}
+
+static int case_nack(void)
+{
+	struct cplt_log log = { 0 };
+	uint8_t buf[FIELD_LEN];
+	uint32_t nacks = i2c_stats.errors;
+	int8_t rslt;
+	int ok;
+
+	rslt = user_i2c_read_async(DEV_NACK, 0x1D, buf, FIELD_LEN, cplt, &log);
+	now_ns += 10 * 1000000ULL;
+	i2c_transport_service();
+	ok = rslt == -1 && log.calls == 0 && !i2c_transport_busy(DEV_NACK) && i2c_stats.errors == nacks + 1;
+
+	return report("nack", ok, "start failed, no callback");
+}
+
+/* A transfer that fails after it started: one callback with -1, then a recovery */
+static int case_fail(const char *name, uint8_t dev_id, uint32_t limit_ms)
+{
+	struct cplt_log log = { 0 };
+	uint8_t buf[FIELD_LEN] = { 0 };
+	uint32_t recoveries = i2c_stats.recoveries;
+	uint64_t t0 = now_ns;
+	char detail[96];
+	int ok;
+
+	ok = user_i2c_read_async(dev_id, 0x1D, buf, FIELD_LEN, cplt, &log) == 0;
+	wait_for(&log, limit_ms);
+	now_ns += 10 * 1000000ULL;
+	i2c_transport_service();
+	ok = ok && log.calls == 1 && log.rslt == -1 && all(buf, FIELD_LEN, 0) && !i2c_transport_busy(dev_id)
+			&& i2c_stats.recoveries == recoveries + 1 && !fake[0].hung;
+
+	snprintf(detail, sizeof(detail), "callback %u time(s) after %.2f ms, rslt %d, %u recovery", log.calls,
+			(log.at_ns - t0) / 1e6, log.rslt, i2c_stats.recoveries - recoveries);
+	return report(name, ok, detail);
+}
+
+int main(void)
+{
+	char nack[] = "0x60:nack:1", berr[] = "0x61:berr:1", hang[] = "0x62:hang:1";
+	int failed = 0;
+
+	fake_i2c_fault(nack);
+	fake_i2c_fault(berr);
+	fake_i2c_fault(hang);
+	i2c_transport_init();
+
+	failed += case_read("dma", FIELD_LEN, &i2c_stats.dma_xfers);
+	failed += case_read("ll", 1, &i2c_stats.ll_xfers);
+	failed += case_refused();
+	failed += case_sync();
+	failed += case_buses();
+	failed += case_nack();
+	failed += case_fail("berr", DEV_BERR, 50);
+	failed += case_fail("hang", DEV_HANG, 50);
+	printf("%d failed\n", failed);
+
+	return failed ? 1 : 0;
+}
@@ -0,0 +1,241 @@
+/**
+  ******************************************************************************
+  * @file           : log_ring_bench.c
+  * @brief          : Enqueue cost and drain behaviour of the console ring
+  ******************************************************************************
+  * First it times log_ring_write() on the host for both overflow policies.
+  * One case has room in the ring. The other has a full ring, where the
+  * write is refused (DROP_NEWEST) or overwrites the oldest bytes
+  * (DROP_OLDEST).
+  *
+  * Then it drains the ring through a simulated UART in virtual time. Each
+  * chunk takes len * 10 bit times (8N1) at the baud rate. The producer
+  * offers lines in bursts of the size the telemetry report writes. For
+  * every offered load the run prints what went out, what was dropped or
+  * overwritten, and the peak fill. Byte counts must balance, and with
+  * DROP_NEWEST the stream received must be exactly the lines accepted.
+  * Either failing makes the run exit 1.
+  *
+  *     make && ./log_ring_bench [-b baud] [-l len] [-B burst] [-r lines/s] [-t s] [-p newest|oldest]
+  *   -b  UART baud rate (default 115200)
+  *   -l  bytes per line (default 64)
+  *   -B  lines per burst (default 40)
+  *   -r  offered lines per second (default a sweep of 50..150 % of the UART)
+  *   -t  simulated seconds (default 60)
+  *   -p  policy to simulate (default both)
+  ******************************************************************************
+**/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "log_ring.h"
+
+#define TIMED_WRITES	2000000
+#define LINE_LEN_MAX	256
+
+static const char *const policy_name[] = { "drop-newest", "drop-oldest" };
+
+/* Simulated UART: one chunk in flight, finished at done_ns */
+struct uart_sim {
+	uint64_t now_ns;
+	uint64_t done_ns;
+	uint16_t len;
+	uint32_t baud;
+	uint64_t out;				/* bytes on the wire */
+	/* DROP_NEWEST check: accepted line numbers and the byte expected next */
+	uint32_t *accepted;
+	uint32_t checked, pos;
+	uint32_t line_len;
+	int mismatch;
+};
+
+static double now_s(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* Line n: a letter of its own, ending in a newline */
+static void make_line(uint8_t *line, uint32_t len, uint32_t n)
+{
+	memset(line, 'a' + n % 26, len - 1);
+	line[len - 1] = '\n';
+}
+
+static uint8_t line_byte(uint32_t len, uint32_t n, uint32_t pos)
+{
+	return pos == len - 1 ? '\n' : (uint8_t)('a' + n % 26);
+}
+
+/* Never completes, so the ring only fills */
+static int8_t tx_stall(const uint8_t *buf, uint16_t len, void *ctx)
+{
+	return 0;
+}
+
+static int8_t tx_uart(const uint8_t *buf, uint16_t len, void *ctx)
+{
+	struct uart_sim *uart = ctx;
+	uint16_t i;
+
+	uart->len = len;
+	uart->done_ns = uart->now_ns + (uint64_t)len * 10 * 1000000000ULL / uart->baud;
+	if (uart->accepted != NULL) {
+		for (i = 0; i < len; i++) {
+			if (buf[i] != line_byte(uart->line_len, uart->accepted[uart->checked], uart->pos))
+				uart->mismatch = 1;
+			if (++uart->pos == uart->line_len) {
+				uart->pos = 0;
+				uart->checked++;
+			}
+		}
+	}
+	return 0;
+}
+
+/* ns per write: with room (ring refilled from empty), and into a full ring */
+static void bench_enqueue(enum log_ring_policy policy, uint32_t len)
+{
+	static struct log_ring ring;
+	uint8_t line[LINE_LEN_MAX];
+	uint32_t per_fill = LOG_RING_SIZE / len, done = 0, i;
+	double t0, room = 0.0, full;
+
+	make_line(line, len, 0);
+	while (done < TIMED_WRITES) {
+		log_ring_init(&ring, policy, tx_stall, NULL);
+		t0 = now_s();
+		for (i = 0; i < per_fill; i++)
+			log_ring_write(&ring, line, (uint16_t)len);
+		room += now_s() - t0;
+		done += per_fill;
+	}
+
+	t0 = now_s();
+	for (i = 0; i < TIMED_WRITES; i++)
+		log_ring_write(&ring, line, (uint16_t)len);
+	full = now_s() - t0;
+
+	printf("%-12s %9.1f %9.2f %9.1f %9.2f\n", policy_name[policy], room * 1e9 / done, room * 1e9 / done / len,
+			full * 1e9 / TIMED_WRITES, full * 1e9 / TIMED_WRITES / len);
+}
+
+/* Offers rate lines/s in bursts for seconds of virtual time; returns 1 on a failed check */
+static int simulate(enum log_ring_policy policy, uint32_t baud, uint32_t len, uint32_t burst, double rate,
+		double seconds)
+{
+	static struct log_ring ring;
+	struct uart_sim uart = { 0 };
+	uint8_t line[LINE_LEN_MAX];
+	uint64_t end_ns = (uint64_t)(seconds * 1e9), burst_ns = (uint64_t)(burst / rate * 1e9), next_ns = 0;
+	uint32_t offered = 0, lines = 0, i, fill;
+	int bad;
+
+	uart.baud = baud;
+	uart.line_len = len;
+	if (policy == LOG_RING_DROP_NEWEST) {
+		uart.accepted = malloc(((size_t)(rate * seconds) + 2 * burst + 1) * sizeof(*uart.accepted));
+		if (uart.accepted == NULL)
+			exit(2);
+	}
+	log_ring_init(&ring, policy, tx_uart, &uart);
+
+	while (next_ns < end_ns) {
+		/* Completions due before the next burst */
+		while (ring.busy && uart.done_ns <= next_ns) {
+			uart.now_ns = uart.done_ns;
+			uart.out += uart.len;
+			log_ring_tx_done(&ring);
+		}
+		uart.now_ns = next_ns;
+		for (i = 0; i < burst; i++, offered++) {
+			/* Noted before the write: it may start the transmitter */
+			make_line(line, len, offered);
+			if (uart.accepted != NULL)
+				uart.accepted[lines] = offered;
+			if (log_ring_write(&ring, line, (uint16_t)len) != 0)
+				lines++;
+		}
+		next_ns += burst_ns;
+	}
+	while (ring.busy && uart.done_ns <= end_ns) {
+		uart.now_ns = uart.done_ns;
+		uart.out += uart.len;
+		log_ring_tx_done(&ring);
+	}
+
+	fill = log_ring_fill(&ring);
+	bad = ring.stats.written != ring.stats.sent + ring.stats.overwritten + fill || uart.mismatch;
+	printf("%-12s %8.0f %8.0f %8.0f %8.1f%% %8lu %9lu %8u %8u%s\n", policy_name[policy], rate * len,
+			(double)uart.out / seconds, baud / 10.0, uart.out * 1000.0 / seconds / baud,
+			(unsigned long)ring.stats.dropped, (unsigned long)ring.stats.overwritten, ring.stats.fill_max,
+			ring.stats.chunks, bad ? "  CHECK FAILED" : "");
+	free(uart.accepted);
+	return bad;
+}
+
+int main(int argc, char **argv)
+{
+	static const double loads[] = { 0.5, 0.9, 1.1, 1.5 };
+	uint32_t baud = 115200, len = 64, burst = 40;
+	double rate = 0.0, seconds = 60.0;
+	int policy = -1, opt, p, i, failed = 0;
+
+	while ((opt = getopt(argc, argv, "b:l:B:r:t:p:")) != -1) {
+		switch (opt) {
+		case 'b':
+			baud = strtoul(optarg, NULL, 0);
+			break;
+		case 'l':
+			len = strtoul(optarg, NULL, 0);
+			break;
+		case 'B':
+			burst = strtoul(optarg, NULL, 0);
+			break;
+		case 'r':
+			rate = atof(optarg);
+			break;
+		case 't':
+			seconds = atof(optarg);
+			break;
+		case 'p':
+			policy = strcmp(optarg, "oldest") == 0 ? LOG_RING_DROP_OLDEST : LOG_RING_DROP_NEWEST;
+			break;
+		default:
+			fprintf(stderr, "usage: %s [-b baud] [-l len] [-B burst] [-r lines/s] [-t s] [-p newest|oldest]\n",
+					argv[0]);
+			return 2;
+		}
+	}
+	if (len < 2 || len > LINE_LEN_MAX || burst == 0 || baud == 0 || seconds <= 0.0) {
+		fprintf(stderr, "need 2 <= len <= %d and a nonzero burst, baud and time\n", LINE_LEN_MAX);
+		return 2;
+	}
+
+	printf("enqueue, %u-byte lines, ring %u, chunk %u\n", len, LOG_RING_SIZE, LOG_RING_CHUNK);
+	printf("%-12s %9s %9s %9s %9s\n", "policy", "ns/write", "ns/byte", "full ns/w", "ns/byte");
+	for (p = LOG_RING_DROP_NEWEST; p <= LOG_RING_DROP_OLDEST; p++)
+		bench_enqueue(p, len);
+
+	printf("\ndrain, %u baud, bursts of %u lines, %.0f s\n", baud, burst, seconds);
+	printf("%-12s %8s %8s %8s %9s %8s %9s %8s %8s\n", "policy", "offer/s", "out/s", "uart/s", "busy",
+			"dropped", "overwrit", "fill_max", "chunks");
+	for (p = LOG_RING_DROP_NEWEST; p <= LOG_RING_DROP_OLDEST; p++) {
+		if (policy >= 0 && p != policy)
+			continue;
+		if (rate > 0.0) {
+			failed |= simulate(p, baud, len, burst, rate, seconds);
+			continue;
+		}
+		for (i = 0; i < (int)(sizeof(loads) / sizeof(loads[0])); i++)
+			failed |= simulate(p, baud, len, burst, loads[i] * baud / 10.0 / len, seconds);
+	}
+
+	return failed;
+}
@@ -0,0 +1,52 @@
+#!/bin/sh
+# Builds the firmware twice with the CubeIDE Debug flags, once with the
+# integer compensation pipeline and once with BME680_FLOAT_POINT_COMPENSATION,
+# and prints the size of each image and the difference.
+#
+#   tools/pipeline_compare/pipeline_compare.sh [extra cflags...]
+#
+# Extra flags go to both builds, e.g. -DBME680_COMP_BENCH to get the
+# "Comp/Gas/Format: cycles/sample" lines on USART2 when each image is
+# flashed. Images are left in build/{int,float}/firmware.elf
+# next to this script.
+set -e
+
+cd "$(dirname "$0")/../.."
+PREFIX=${PREFIX:-arm-none-eabi-}
+OUT=tools/pipeline_compare/build
+
+CFLAGS="-mcpu=cortex-m4 -std=gnu11 -g3 -DDEBUG -DUSE_HAL_DRIVER -DSTM32F411xE -O0
+	-ffunction-sections -fdata-sections --specs=nano.specs -mfpu=fpv4-sp-d16
+	-mfloat-abi=hard -mthumb -ICore/Inc -IDrivers/STM32F4xx_HAL_Driver/Inc
+	-IDrivers/STM32F4xx_HAL_Driver/Inc/Legacy -IDrivers/CMSIS/Device/ST/STM32F4xx/Include
+	-IDrivers/CMSIS/Include $*"
+LDFLAGS="-mcpu=cortex-m4 -T STM32F411VETX_FLASH.ld --specs=nosys.specs -Wl,--gc-sections
+	-static --specs=nano.specs -mfpu=fpv4-sp-d16 -mfloat-abi=hard -mthumb
+	-Wl,--start-group -lc -lm -Wl,--end-group"
+
+build() {
+	dir=$OUT/$1
+	shift
+	rm -rf "$dir"
+	mkdir -p "$dir"
+	for src in Core/Src/*.c Drivers/STM32F4xx_HAL_Driver/Src/*.c Core/Startup/*.s; do
+		case $src in
+		*.s) lang="-x assembler-with-cpp" ;;
+		*) lang= ;;
+		esac
+		${PREFIX}gcc $CFLAGS "$@" $lang -c "$src" -o "$dir/$(basename "$src").o"
+	done
+	${PREFIX}gcc -o "$dir/firmware.elf" "$dir"/*.o $LDFLAGS
+}
+
+build int
+build float -DBME680_FLOAT_POINT_COMPENSATION
+
+${PREFIX}size $OUT/int/firmware.elf $OUT/float/firmware.elf | awk '
+	NR == 1 { printf "%-8s %8s %8s %8s\n", "build", "text", "data", "bss"; next }
+	{ t[NR] = $1; d[NR] = $2; b[NR] = $3 }
+	END {
+		printf "%-8s %8d %8d %8d\n", "int", t[2], d[2], b[2]
+		printf "%-8s %8d %8d %8d\n", "float", t[3], d[3], b[3]
+		printf "%-8s %+8d %+8d %+8d\n", "delta", t[3] - t[2], d[3] - d[2], b[3] - b[2]
+	}'
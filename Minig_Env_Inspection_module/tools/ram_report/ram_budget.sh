@@ -0,0 +1,59 @@
+#!/bin/sh
+# Builds the firmware with the CubeIDE Debug flags plus -fstack-usage and a
+# link map, and prints ram_report's per-module RAM and stack budget for it.
+# Like the Debug configuration, it links without -u _printf_float and
+# -u _scanf_float. By default the build is also zero-heap: with
+# -DBME680_ZERO_HEAP, _sbrk() is undefined (see sysmem.c), so the link
+# fails if anything still reaches malloc; the firmware formats through
+# fixfmt.c, not newlib's printf family, for that. HEAP=1 builds the
+# ordinary image and lists what pulls the allocator in.
+#
+#   tools/ram_report/ram_budget.sh [extra cflags...]
+#
+# The image, map and .su files are left in build/ next to this script.
+set -e
+
+cd "$(dirname "$0")/../.."
+PREFIX=${PREFIX:-arm-none-eabi-}
+OUT=tools/ram_report/build
+
+if [ "${HEAP:-0}" = 1 ]; then
+	MODE=
+	CHECK=
+else
+	MODE=-DBME680_ZERO_HEAP
+	CHECK=-z
+fi
+
+CFLAGS="-mcpu=cortex-m4 -std=gnu11 -g3 -DDEBUG -DUSE_HAL_DRIVER -DSTM32F411xE -O0
+	-ffunction-sections -fdata-sections -fstack-usage --specs=nano.specs -mfpu=fpv4-sp-d16
+	-mfloat-abi=hard -mthumb -ICore/Inc -IDrivers/STM32F4xx_HAL_Driver/Inc
+	-IDrivers/STM32F4xx_HAL_Driver/Inc/Legacy -IDrivers/CMSIS/Device/ST/STM32F4xx/Include
+	-IDrivers/CMSIS/Include $MODE $*"
+LDFLAGS="-mcpu=cortex-m4 -T STM32F411VETX_FLASH.ld --specs=nosys.specs -Wl,-Map=$OUT/firmware.map
+	-Wl,--gc-sections -static --specs=nano.specs -mfpu=fpv4-sp-d16 -mfloat-abi=hard -mthumb
+	-Wl,--start-group -lc -lm -Wl,--end-group"
+
+rm -rf "$OUT"
+mkdir -p "$OUT"
+for src in Core/Src/*.c Drivers/STM32F4xx_HAL_Driver/Src/*.c Core/Startup/*.s; do
+	case $src in
+	*.s) lang="-x assembler-with-cpp" ;;
+	*) lang= ;;
+	esac
+	${PREFIX}gcc $CFLAGS $lang -c "$src" -o "$OUT/$(basename "$src" | sed 's/\.[cs]$//').o"
+done
+${PREFIX}gcc -o "$OUT/firmware.elf" "$OUT"/*.o $LDFLAGS
+
+# Flash: the image, then the formatters in it. fixfmt.c against what is
+# left of newlib's printf family; the bench rows of a HEAP=1
+# BME680_COMP_BENCH build still use snprintf.
+${PREFIX}size "$OUT/firmware.elf"
+${PREFIX}nm -S "$OUT/firmware.elf" | awk '
+	function hex(s,   n, i) { n = 0; for (i = 1; i <= length(s); i++) n = n * 16 + index("0123456789abcdef", tolower(substr(s, i, 1))) - 1; return n }
+	NF == 4 && $4 ~ /^fmt_/ { fix += hex($2) }
+	NF == 4 && $4 != "myprintf" && $4 !~ /^fmt_/ && $4 ~ /printf|_dtoa_r|__sfputs_r|__ssputs_r|_svfiprintf|__ieee754/ { pf += hex($2) }
+	END { printf "flash: fixfmt %d bytes, printf family %d bytes\n", fix, pf }'
+
+make -s -C tools/ram_report
+tools/ram_report/ram_report $CHECK "$OUT/firmware.map" "$OUT"/*.su
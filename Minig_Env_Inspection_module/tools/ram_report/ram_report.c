@@ -0,0 +1,291 @@
+/**
+  ******************************************************************************
+  * @file           : ram_report.c
+  * @brief          : Per-module RAM and stack budget from a GNU ld map file
+  ******************************************************************************
+  * Reads the .map the firmware link writes (-Wl,-Map) and sums every input
+  * section placed in the RAM region by module. A module is an object file,
+  * or a whole archive for library members. Padding is listed as (fill).
+  * The heap and stack reservations of ._user_heap_stack are reported apart
+  * from the static data. They come from _Min_Heap_Size and _Min_Stack_Size
+  * in the linker script.
+  *
+  * The .su files from -fstack-usage can follow the map. Each module then
+  * also shows its largest stack frame and the function that has it. Frames
+  * only: the call depth is not known here. A frame marked dynamic is
+  * flagged with '*'.
+  *
+  * The archive list at the top of the map tells which object pulled
+  * newlib's allocator in. Those references are printed. With -z they fail
+  * the run, to check an image before it is built with BME680_ZERO_HEAP.
+  *
+  *     make && ./ram_report [-z] [-n rows] file.map [file.su ...]
+  *   -z  exit 1 if anything references malloc and friends or _sbrk
+  *   -n  modules to list, largest first (default all)
+  * ram_budget.sh builds the firmware and runs it on the result.
+  ******************************************************************************
+**/
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define LINE_MAX_LEN	4096
+#define NAME_LEN		64
+#define MODULES_MAX		256
+
+struct module {
+	char name[NAME_LEN];
+	uint64_t data;				/* initialised, also takes flash for its image */
+	uint64_t bss;
+	uint32_t frame;				/* largest stack frame, from the .su files */
+	char func[NAME_LEN];
+	int dynamic;
+};
+
+static struct module modules[MODULES_MAX];
+static int module_count;
+
+static const char *const heap_syms[] = {
+	"malloc", "_malloc_r", "calloc", "_calloc_r", "realloc", "_realloc_r", "free", "_free_r", "_sbrk", "_sbrk_r",
+	NULL
+};
+
+/* Path without its directories; map files from Windows hosts use '\\' */
+static const char *base_name(const char *path)
+{
+	const char *base = path, *p;
+
+	for (p = path; *p != '\0'; p++)
+		if (*p == '/' || *p == '\\')
+			base = p + 1;
+	return base;
+}
+
+/* Module key of a path: the file name, or the archive for "lib.a(member.o)" */
+static void module_key(const char *path, char *key)
+{
+	const char *base = base_name(path), *paren;
+	size_t len;
+
+	paren = strchr(base, '(');
+	len = paren != NULL ? (size_t)(paren - base) : strlen(base);
+	if (len >= NAME_LEN)
+		len = NAME_LEN - 1;
+	memcpy(key, base, len);
+	key[len] = '\0';
+}
+
+static struct module *module_get(const char *key)
+{
+	int i;
+
+	for (i = 0; i < module_count; i++)
+		if (strcmp(modules[i].name, key) == 0)
+			return &modules[i];
+	if (module_count == MODULES_MAX) {
+		fprintf(stderr, "more than %d modules\n", MODULES_MAX);
+		exit(1);
+	}
+	snprintf(modules[module_count].name, NAME_LEN, "%s", key);
+	return &modules[module_count++];
+}
+
+static void chomp(char *line)
+{
+	size_t len = strlen(line);
+
+	while (len > 0 && (line[len - 1] == '\n' || line[len - 1] == '\r' || line[len - 1] == ' '))
+		line[--len] = '\0';
+}
+
+/* Lists the archive members pulled in for an allocator symbol */
+static int heap_refs(FILE *map)
+{
+	char line[LINE_MAX_LEN], sym[NAME_LEN], ref[LINE_MAX_LEN];
+	int found = 0, i;
+
+	/* Each member is followed by an indented "referrer (symbol)" line */
+	while (fgets(line, sizeof(line), map) != NULL) {
+		chomp(line);
+		if (strncmp(line, "Memory Configuration", 20) == 0 || strncmp(line, "Discarded input", 15) == 0)
+			break;
+		if (line[0] != ' ' || sscanf(line, " %4095s (%63[^)])", ref, sym) != 2)
+			continue;
+		for (i = 0; heap_syms[i] != NULL; i++) {
+			if (strcmp(sym, heap_syms[i]) != 0)
+				continue;
+			printf("heap: %s referenced by %s\n", sym, base_name(ref));
+			found = 1;
+		}
+	}
+	rewind(map);
+	return found;
+}
+
+static int in_ram(uint64_t addr, uint64_t origin, uint64_t length)
+{
+	return addr >= origin && addr < origin + length;
+}
+
+int main(int argc, char **argv)
+{
+	char line[LINE_MAX_LEN], next[LINE_MAX_LEN], name[LINE_MAX_LEN], file[LINE_MAX_LEN], key[NAME_LEN];
+	char out[LINE_MAX_LEN] = "", func[LINE_MAX_LEN], kind[LINE_MAX_LEN];
+	uint64_t ram_origin = 0, ram_length = 0, addr, size, heap = 0, stack = 0, total_data = 0, total_bss = 0;
+	uint64_t out_addr = 0;
+	uint32_t frame, max_frame = 0;
+	int zero = 0, rows = MODULES_MAX, opt, in_map = 0, heap_found, i, j;
+	const char *max_func = "";
+	struct module tmp;
+	FILE *map, *su;
+
+	while ((opt = getopt(argc, argv, "zn:")) != -1) {
+		switch (opt) {
+		case 'z':
+			zero = 1;
+			break;
+		case 'n':
+			rows = atoi(optarg);
+			break;
+		default:
+			fprintf(stderr, "usage: %s [-z] [-n rows] file.map [file.su ...]\n", argv[0]);
+			return 2;
+		}
+	}
+	if (optind >= argc) {
+		fprintf(stderr, "usage: %s [-z] [-n rows] file.map [file.su ...]\n", argv[0]);
+		return 2;
+	}
+	map = fopen(argv[optind], "r");
+	if (map == NULL) {
+		perror(argv[optind]);
+		return 2;
+	}
+
+	heap_found = heap_refs(map);
+
+	while (fgets(line, sizeof(line), map) != NULL) {
+		chomp(line);
+		if (!in_map) {
+			if (sscanf(line, "RAM %" SCNx64 " %" SCNx64, &ram_origin, &ram_length) == 2)
+				continue;
+			if (strncmp(line, "Linker script and memory map", 28) == 0)
+				in_map = 1;
+			continue;
+		}
+
+		if (strstr(line, "_Min_Heap_Size = ") != NULL)
+			sscanf(strstr(line, "= ") + 2, "%" SCNx64, &heap);
+		if (strstr(line, "_Min_Stack_Size = ") != NULL)
+			sscanf(strstr(line, "= ") + 2, "%" SCNx64, &stack);
+
+		/* Output section: its name at column 0, the address maybe wrapped
+		 * onto the next line */
+		if (line[0] == '.' || line[0] == '/') {
+			sscanf(line, "%4095s", out);
+			if (sscanf(line, "%*s %" SCNx64, &out_addr) != 1) {
+				if (fgets(next, sizeof(next), map) == NULL)
+					break;
+				if (sscanf(next, " %" SCNx64, &out_addr) != 1)
+					out_addr = 0;
+			}
+			continue;
+		}
+		if (!in_ram(out_addr, ram_origin, ram_length) || strcmp(out, "._user_heap_stack") == 0)
+			continue;
+
+		/* Input section: " name addr size file", or the name alone and
+		 * the rest on the next line. *fill* has no file. */
+		if (line[0] != ' ' || (line[1] != '.' && line[1] != '*' && strncmp(line + 1, "COMMON", 6) != 0))
+			continue;
+		if (line[1] == '*' && strncmp(line + 1, "*fill*", 6) != 0)
+			continue;
+		file[0] = '\0';
+		if (sscanf(line, " %4095s %" SCNx64 " %" SCNx64 " %4095[^\n]", name, &addr, &size, file) < 3) {
+			if (fgets(next, sizeof(next), map) == NULL)
+				break;
+			chomp(next);
+			if (sscanf(next, " %" SCNx64 " %" SCNx64 " %4095[^\n]", &addr, &size, file) < 2)
+				continue;
+		}
+		if (size == 0)
+			continue;
+		if (file[0] == '\0')
+			strcpy(key, "(fill)");
+		else
+			module_key(file, key);
+		if (strncmp(out, ".data", 5) == 0) {
+			module_get(key)->data += size;
+			total_data += size;
+		} else {
+			module_get(key)->bss += size;
+			total_bss += size;
+		}
+	}
+	fclose(map);
+
+	/* x.su describes x.o; path:line:col:function<TAB>bytes<TAB>static|dynamic[,bounded] */
+	for (i = optind + 1; i < argc; i++) {
+		su = fopen(argv[i], "r");
+		if (su == NULL) {
+			perror(argv[i]);
+			return 2;
+		}
+		module_key(argv[i], key);
+		if (strlen(key) > 3 && strcmp(key + strlen(key) - 3, ".su") == 0)
+			strcpy(key + strlen(key) - 3, ".o");
+		while (fgets(line, sizeof(line), su) != NULL) {
+			struct module *mod;
+			char *colon = strrchr(line, ':');
+
+			if (colon == NULL || sscanf(colon + 1, "%4095s %" SCNu32 " %4095s", func, &frame, kind) != 3)
+				continue;
+			mod = module_get(key);
+			if (frame > mod->frame) {
+				mod->frame = frame;
+				snprintf(mod->func, NAME_LEN, "%.63s", func);
+				mod->dynamic = strncmp(kind, "dynamic", 7) == 0;
+			}
+		}
+		fclose(su);
+	}
+
+	/* Largest RAM first */
+	for (i = 1; i < module_count; i++) {
+		tmp = modules[i];
+		for (j = i; j > 0 && modules[j - 1].data + modules[j - 1].bss < tmp.data + tmp.bss; j--)
+			modules[j] = modules[j - 1];
+		modules[j] = tmp;
+	}
+
+	printf("%-28s %8s %8s %8s %8s  %s\n", "module", "data", "bss", "total", "frame", "function");
+	for (i = 0; i < module_count && i < rows; i++) {
+		struct module *mod = &modules[i];
+
+		printf("%-28s %8" PRIu64 " %8" PRIu64 " %8" PRIu64, mod->name, mod->data, mod->bss, mod->data + mod->bss);
+		if (mod->frame)
+			printf(" %7" PRIu32 "%c  %s", mod->frame, mod->dynamic ? '*' : ' ', mod->func);
+		printf("\n");
+	}
+	for (i = 0; i < module_count; i++) {
+		if (modules[i].frame > max_frame) {
+			max_frame = modules[i].frame;
+			max_func = modules[i].func;
+		}
+	}
+
+	printf("%-28s %8" PRIu64 " %8" PRIu64 " %8" PRIu64 "\n", "static", total_data, total_bss,
+			total_data + total_bss);
+	printf("heap reserve %" PRIu64 ", stack reserve %" PRIu64 ", RAM %" PRIu64 ", left %" PRId64 " bytes\n", heap,
+			stack, ram_length, (int64_t)(ram_length - total_data - total_bss - heap - stack));
+	if (max_frame)
+		printf("largest frame %" PRIu32 " bytes in %s, %.0f%% of the stack reserve\n", max_frame, max_func,
+				stack ? max_frame * 100.0 / stack : 0.0);
+	if (!heap_found)
+		printf("heap: no allocator linked\n");
+
+	return (zero && heap_found) ? 1 : 0;
+}
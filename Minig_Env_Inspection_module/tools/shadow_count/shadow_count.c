@@ -0,0 +1,180 @@
+/**
+  ******************************************************************************
+  * @file           : shadow_count.c
+  * @brief          : Counts the I2C transactions of common driver operations
+  ******************************************************************************
+  * A register-file fake of the BME680 stands behind dev->read and dev->write:
+  * the chip-id, a fixed calibration pattern, the control registers and the
+  * field registers. A write of forced mode finishes the conversion at once,
+  * so the measurement engine's first field read sees new data. Writes are
+  * decoded as the driver sends them, address/data pairs after the first
+  * register.
+  *
+  * After bme680_init() it counts reads + writes of
+  *   settings  the first bme680_set_sensor_settings() with main.c's values
+  *   same      the same call again
+  *   change    an oversampling and filter change, as os_ctrl_apply() makes
+  *   forced    one forced-mode cycle through meas_engine, the mean of ten
+  * and prints a checksum of 0x5a-0x75 at the end, so two builds can be
+  * shown to leave the same registers behind.
+  *
+  * make builds it twice: shadow_count on the current driver, and
+  * shadow_count_before on bme680.c, meas_engine.c and their headers as
+  * they were before the register shadow (BEFORE, a git revision).
+  *
+  *     make && ./shadow_count_before && ./shadow_count
+  ******************************************************************************
+**/
+
+#include <stdio.h>
+#include <string.h>
+
+#include "bme680.h"
+#include "meas_engine.h"
+
+#define DEV_ID			0x77
+#define CYCLES			10
+
+static uint8_t regs[256];
+static uint32_t reads, writes, now_ms;
+
+static void fake_write_reg(uint8_t reg_addr, uint8_t value)
+{
+	if (reg_addr == BME680_SOFT_RESET_ADDR) {
+		if (value == BME680_SOFT_RESET_CMD)
+			memset(&regs[0x5a], 0, 0x76 - 0x5a);
+		return;
+	}
+	regs[reg_addr] = value;
+
+	/* The conversion ends at once: new data, back to sleep */
+	if (reg_addr == BME680_CONF_T_P_MODE_ADDR && (value & BME680_MODE_MSK) == BME680_FORCED_MODE) {
+		regs[BME680_FIELD0_ADDR] = BME680_NEW_DATA_MSK;
+		regs[BME680_FIELD0_ADDR + 1]++;
+		regs[reg_addr] &= ~BME680_MODE_MSK;
+	}
+}
+
+static int8_t fake_read(uint8_t dev_id, uint8_t reg_addr, uint8_t *data, uint16_t len)
+{
+	uint16_t i;
+
+	for (i = 0; i < len; i++)
+		data[i] = regs[(uint8_t)(reg_addr + i)];
+	reads++;
+	return 0;
+}
+
+/* First register, then address/data pairs */
+static int8_t fake_write(uint8_t dev_id, uint8_t reg_addr, uint8_t *data, uint16_t len)
+{
+	uint16_t i;
+
+	fake_write_reg(reg_addr, data[0]);
+	for (i = 1; i + 1 < len; i += 2)
+		fake_write_reg(data[i], data[i + 1]);
+	writes++;
+	return 0;
+}
+
+static void fake_delay(uint32_t period)
+{
+	now_ms += period;
+}
+
+static uint32_t fake_tick(void)
+{
+	return now_ms;
+}
+
+/* Chip-id and a calibration that keeps every divisor away from zero */
+static void fake_power_up(void)
+{
+	uint16_t i;
+
+	memset(regs, 0, sizeof(regs));
+	for (i = 0; i < 256; i++)
+		regs[i] = (uint8_t)(i * 37 + 11);
+	memset(&regs[0x1d], 0, 0x76 - 0x1d);
+	regs[BME680_CHIP_ID_ADDR] = BME680_CHIP_ID;
+	regs[0x8e] = 0x16;			/* par_p1 = 0x9116 */
+	regs[0x8f] = 0x91;
+}
+
+static void settings(struct bme680_dev *dev, uint8_t os_t, uint8_t os_p, uint8_t os_h, uint8_t filter)
+{
+	dev->tph_sett.os_temp = os_t;
+	dev->tph_sett.os_pres = os_p;
+	dev->tph_sett.os_hum = os_h;
+	dev->tph_sett.filter = filter;
+	dev->gas_sett.run_gas = BME680_ENABLE_GAS_MEAS;
+	dev->gas_sett.heatr_temp = 320;
+	dev->gas_sett.heatr_dur = 150;
+	dev->power_mode = BME680_FORCED_MODE;
+	bme680_set_sensor_settings(BME680_OST_SEL | BME680_OSP_SEL | BME680_OSH_SEL | BME680_FILTER_SEL
+			| BME680_GAS_SENSOR_SEL, dev);
+}
+
+static void ready(int8_t rslt, const struct bme680_field_data *data, void *ctx)
+{
+	(*(uint32_t *)ctx)++;
+}
+
+static void report(const char *name, uint32_t r, uint32_t w, uint32_t n)
+{
+	printf("  %-9s %5.1f transactions (%.1f reads, %.1f writes)\n", name, (r + w) / (double)n, r / (double)n,
+			w / (double)n);
+}
+
+int main(void)
+{
+	struct bme680_dev dev;
+	struct meas_engine eng;
+	uint32_t r, w, done = 0, sum = 0;
+	int i;
+
+	fake_power_up();
+	memset(&dev, 0, sizeof(dev));
+	dev.dev_id = DEV_ID;
+	dev.intf = BME680_I2C_INTF;
+	dev.read = fake_read;
+	dev.write = fake_write;
+	dev.delay_ms = fake_delay;
+	dev.amb_temp = 25;
+	if (bme680_init(&dev) != BME680_OK) {
+		fprintf(stderr, "bme680_init failed\n");
+		return 1;
+	}
+	printf("I2C transactions:\n");
+
+	r = reads, w = writes;
+	settings(&dev, BME680_OS_8X, BME680_OS_4X, BME680_OS_2X, BME680_FILTER_SIZE_3);
+	report("settings", reads - r, writes - w, 1);
+
+	r = reads, w = writes;
+	settings(&dev, BME680_OS_8X, BME680_OS_4X, BME680_OS_2X, BME680_FILTER_SIZE_3);
+	report("same", reads - r, writes - w, 1);
+
+	r = reads, w = writes;
+	settings(&dev, BME680_OS_2X, BME680_OS_1X, BME680_OS_1X, BME680_FILTER_SIZE_15);
+	report("change", reads - r, writes - w, 1);
+
+	/* The polled field read; the asynchronous one has its own transport */
+	dev.read_async = NULL;
+	meas_engine_init(&eng, &dev, fake_tick, ready, &done);
+	r = reads, w = writes;
+	for (i = 0; i < CYCLES; i++) {
+		meas_engine_start(&eng);
+		while (meas_engine_busy(&eng)) {
+			now_ms++;
+			meas_engine_service(&eng);
+		}
+	}
+	report("forced", reads - r, writes - w, CYCLES);
+
+	for (i = 0x5a; i < 0x76; i++)
+		sum = sum * 31 + regs[i];
+	printf("%u samples, registers 0x5a-0x75 sum %08x\n", done, sum);
+
+	return done == CYCLES ? 0 : 1;
+}
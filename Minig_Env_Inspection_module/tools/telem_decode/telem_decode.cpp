@@ -0,0 +1,289 @@
+/**
+  ******************************************************************************
+  * @file           : telem_decode.cpp
+  * @brief          : Decodes binary telemetry from a capture file or a serial port
+  ******************************************************************************
+  * Reads the USART2 stream of a firmware built without BME680_TEXT_TELEMETRY
+  * and prints one CSV row per good frame, in the units of telemetry.h
+  * turned to degC, Pa, %rH, ohm, g/m3 and m. Statistics go to stderr at the
+  * end: frames, lost sequence numbers and every kind of rejected frame.
+  * A serial port or pty is read live, and -b sets it raw at a baud rate.
+  *
+  * -t is the self test. The firmware's telem_encode() frames synthetic
+  * samples into memory and corrupts one bit in every k-th frame. The
+  * decoder then has to return every other frame unchanged, reject the
+  * corrupted ones and count them as lost. The whole stream is decoded
+  * again for timing.
+  *
+  *     make && ./telem_decode [-q] [-b baud] [capture | /dev/ttyACM0]
+  *     ./telem_decode -t [-n frames] [-e k]
+  *   -q  statistics only, no rows
+  *   -b  baud rate for a serial port (8N1 raw)
+  *   -t  self test and decode rate
+  *   -n  frames for -t (default 1000000)
+  *   -e  corrupt every k-th frame for -t, 0 for none (default 1000)
+  ******************************************************************************
+**/
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include <fcntl.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include "telem_decoder.hpp"
+
+namespace {
+
+constexpr size_t read_size = 65536;
+
+/* "-12.34" from -1234 and 2 decimals */
+const char *fixed(char *buf, size_t size, long v, int decimals)
+{
+	long div = 1;
+
+	for (int i = 0; i < decimals; i++)
+		div *= 10;
+	std::snprintf(buf, size, "%s%ld.%0*ld", v < 0 ? "-" : "", labs(v) / div, decimals, labs(v) % div);
+	return buf;
+}
+
+void print_frame(const telemetry::Frame &f)
+{
+	const telem_sample &s = f.sample;
+	char t[16], h[16], dew[16], ah[16], z[16];
+
+	std::printf("%u,%u,%lu,%s,%lu,%s,%lu,%s,%s,%s,%u,%u,0x%02X\n", f.seq, s.node, (unsigned long)s.t_ms,
+			fixed(t, sizeof(t), s.temperature, 2), (unsigned long)s.pressure, fixed(h, sizeof(h), s.humidity, 3),
+			(unsigned long)s.gas_resistance, fixed(dew, sizeof(dew), s.dew_point, 2),
+			fixed(ah, sizeof(ah), s.abs_humidity, 2), fixed(z, sizeof(z), s.height, 2), s.gas_index, s.state,
+			s.status);
+}
+
+void print_stats(const telemetry::Stats &st)
+{
+	std::fprintf(stderr,
+			"%llu bytes, %llu frames, %llu lost, %llu bad (cobs %llu, length %llu, crc %llu, type %llu, "
+			"oversize %llu), %llu empty\n",
+			(unsigned long long)st.bytes, (unsigned long long)st.frames, (unsigned long long)st.lost,
+			(unsigned long long)st.bad(), (unsigned long long)st.cobs_errors, (unsigned long long)st.length_errors,
+			(unsigned long long)st.crc_errors, (unsigned long long)st.type_errors,
+			(unsigned long long)st.oversize, (unsigned long long)st.empty);
+}
+
+speed_t baud_code(long baud)
+{
+	switch (baud) {
+	case 9600: return B9600;
+	case 19200: return B19200;
+	case 38400: return B38400;
+	case 57600: return B57600;
+	case 115200: return B115200;
+	case 230400: return B230400;
+	case 460800: return B460800;
+	case 921600: return B921600;
+	default: return B0;
+	}
+}
+
+int set_raw(int fd, long baud)
+{
+	struct termios tio;
+	speed_t code = baud_code(baud);
+
+	if (code == B0) {
+		std::fprintf(stderr, "unsupported baud rate %ld\n", baud);
+		return -1;
+	}
+	if (tcgetattr(fd, &tio) != 0)
+		return -1;
+	cfmakeraw(&tio);
+	cfsetispeed(&tio, code);
+	cfsetospeed(&tio, code);
+	tio.c_cflag |= CLOCAL | CREAD;
+	tio.c_cc[VMIN] = 1;
+	tio.c_cc[VTIME] = 0;
+	return tcsetattr(fd, TCSANOW, &tio);
+}
+
+int decode_fd(int fd, bool rows)
+{
+	std::vector<uint8_t> buf(read_size);
+	telemetry::Decoder dec;
+	bool live = isatty(fd);
+	ssize_t got;
+
+	if (rows)
+		std::printf("seq,node,t_ms,temp_C,pres_Pa,hum_rH,gas_ohm,dew_C,abs_g_m3,height_m,index,state,status\n");
+	for (;;) {
+		got = read(fd, buf.data(), buf.size());
+		if (got < 0 && errno == EINTR)
+			continue;
+		/* A pty whose other side closed reads EIO: the end of the stream */
+		if (got < 0 && errno == EIO && live)
+			break;
+		if (got < 0) {
+			perror("read");
+			return 2;
+		}
+		if (got == 0)
+			break;
+		dec.feed(buf.data(), got, [rows](const telemetry::Frame &f) {
+			if (rows)
+				print_frame(f);
+		});
+		if (live)
+			std::fflush(stdout);
+	}
+	print_stats(dec.stats());
+	return 0;
+}
+
+/* Synthetic sample number i, spread over every field's range */
+telem_sample sample_for(uint64_t i)
+{
+	telem_sample s {};
+
+	s.node = i % 3;
+	s.t_ms = static_cast<uint32_t>(i * 50);
+	s.temperature = static_cast<int16_t>(-4000 + (i * 37) % 12501);
+	s.pressure = 30000 + (i * 101) % 80001;
+	s.humidity = (i * 211) % 100001;
+	s.gas_resistance = 1000 + (i * 7919) % 5000000;
+	s.dew_point = static_cast<int16_t>(s.temperature - (i * 13) % 3000);
+	s.abs_humidity = (i * 17) % 35000;
+	s.height = static_cast<int32_t>((i * 97) % 900001) - 450000;
+	s.gas_index = i % 501;
+	s.state = i % 4 == 3 ? TELEM_STATE_NONE : i % 4;
+	s.status = 0xB0;
+	return s;
+}
+
+bool same(const telem_sample &a, const telem_sample &b)
+{
+	return a.node == b.node && a.t_ms == b.t_ms && a.temperature == b.temperature && a.pressure == b.pressure
+			&& a.humidity == b.humidity && a.gas_resistance == b.gas_resistance && a.dew_point == b.dew_point
+			&& a.abs_humidity == b.abs_humidity && a.height == b.height && a.gas_index == b.gas_index
+			&& a.state == b.state && a.status == b.status;
+}
+
+int self_test(uint64_t count, uint64_t every)
+{
+	std::vector<uint8_t> stream;
+	uint8_t frame[TELEM_FRAME_MAX];
+	uint64_t corrupted = 0, mismatches = 0, index = 0, passes = 0;
+	bool first = true;
+	uint16_t last_seq = 0;
+	volatile long sink = 0;
+
+	stream.reserve(count * TELEM_FRAME_MAX);
+	for (uint64_t i = 0; i < count; i++) {
+		telem_sample s = sample_for(i);
+		uint16_t len = telem_encode(&s, static_cast<uint16_t>(i), frame);
+
+		/* Never the first or last frame, so every corruption is a gap */
+		if (every != 0 && i % every == every / 2 && i != 0 && i + 1 != count) {
+			frame[i % (len - 1)] ^= 0x01;
+			corrupted++;
+		}
+		stream.insert(stream.end(), frame, frame + len);
+	}
+
+	/* Checked pass, in pieces that split frames */
+	telemetry::Decoder check;
+	for (size_t pos = 0; pos < stream.size(); pos += 4093) {
+		size_t len = std::min<size_t>(4093, stream.size() - pos);
+
+		check.feed(stream.data() + pos, len, [&](const telemetry::Frame &f) {
+			index = first ? f.seq : index + static_cast<uint16_t>(f.seq - last_seq);
+			first = false;
+			last_seq = f.seq;
+			if (!same(f.sample, sample_for(index)))
+				mismatches++;
+		});
+	}
+	const telemetry::Stats &st = check.stats();
+	print_stats(st);
+
+	/* Timed passes over the whole stream */
+	auto t0 = std::chrono::steady_clock::now();
+	double secs;
+	do {
+		telemetry::Decoder dec;
+
+		for (size_t pos = 0; pos < stream.size(); pos += read_size)
+			dec.feed(stream.data() + pos, std::min(read_size, stream.size() - pos),
+					[&sink](const telemetry::Frame &f) { sink += f.sample.temperature; });
+		passes++;
+		secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+	} while (secs < 1.0);
+
+	std::printf("%llu frames of %u bytes, %llu corrupted\n", (unsigned long long)count,
+			(unsigned)(stream.size() / (count ? count : 1)), (unsigned long long)corrupted);
+	std::printf("decode: %.1f Mframes/s, %.0f MB/s\n", passes * count / secs / 1e6,
+			passes * stream.size() / secs / 1e6);
+
+	bool ok = st.frames == count - corrupted && st.lost == corrupted && st.bad() >= corrupted && mismatches == 0;
+	std::printf("%s: %llu good, %llu lost, %llu mismatched\n", ok ? "pass" : "FAIL",
+			(unsigned long long)st.frames, (unsigned long long)st.lost, (unsigned long long)mismatches);
+	return ok ? 0 : 1;
+}
+
+} /* namespace */
+
+int main(int argc, char **argv)
+{
+	bool rows = true, test = false;
+	long baud = 0;
+	uint64_t count = 1000000, every = 1000;
+	int opt, fd = STDIN_FILENO, rc;
+
+	while ((opt = getopt(argc, argv, "qb:tn:e:")) != -1) {
+		switch (opt) {
+		case 'q':
+			rows = false;
+			break;
+		case 'b':
+			baud = std::strtol(optarg, nullptr, 0);
+			break;
+		case 't':
+			test = true;
+			break;
+		case 'n':
+			count = std::strtoull(optarg, nullptr, 0);
+			break;
+		case 'e':
+			every = std::strtoull(optarg, nullptr, 0);
+			break;
+		default:
+			std::fprintf(stderr, "usage: %s [-q] [-b baud] [capture | tty]\n       %s -t [-n frames] [-e k]\n",
+					argv[0], argv[0]);
+			return 2;
+		}
+	}
+	if (test)
+		return self_test(count, every);
+
+	if (optind < argc) {
+		fd = open(argv[optind], O_RDONLY | O_NOCTTY);
+		if (fd < 0) {
+			perror(argv[optind]);
+			return 2;
+		}
+	}
+	if (baud != 0 && isatty(fd) && set_raw(fd, baud) != 0) {
+		perror("serial setup");
+		return 2;
+	}
+	std::setvbuf(stdout, nullptr, _IOFBF, 1 << 16);
+	rc = decode_fd(fd, rows);
+	if (fd != STDIN_FILENO)
+		close(fd);
+	return rc;
+}
@@ -0,0 +1,127 @@
+/**
+  ******************************************************************************
+  * @file           : telem_decoder.cpp
+  * @brief          : Streaming decoder of the firmware's binary telemetry
+  ******************************************************************************
+**/
+
+#include <array>
+
+#include "telem_decoder.hpp"
+
+namespace telemetry {
+
+namespace {
+
+/* CRC-16/CCITT-FALSE a byte at a time; telem_crc16() on the target is the
+ * same CRC bit by bit */
+constexpr std::array<uint16_t, 256> crc16_table()
+{
+	std::array<uint16_t, 256> table {};
+
+	for (unsigned i = 0; i < 256; i++) {
+		uint16_t crc = static_cast<uint16_t>(i << 8);
+
+		for (int bit = 0; bit < 8; bit++)
+			crc = static_cast<uint16_t>((crc << 1) ^ ((crc & 0x8000) ? 0x1021 : 0));
+		table[i] = crc;
+	}
+	return table;
+}
+
+constexpr std::array<uint16_t, 256> crc_table = crc16_table();
+
+inline uint16_t get16(const uint8_t *p)
+{
+	return static_cast<uint16_t>(p[0] | p[1] << 8);
+}
+
+inline uint32_t get32(const uint8_t *p)
+{
+	return static_cast<uint32_t>(p[0]) | static_cast<uint32_t>(p[1]) << 8 | static_cast<uint32_t>(p[2]) << 16
+			| static_cast<uint32_t>(p[3]) << 24;
+}
+
+} /* namespace */
+
+uint16_t crc16(const uint8_t *buf, size_t len)
+{
+	uint16_t crc = 0xFFFF;
+
+	while (len--)
+		crc = static_cast<uint16_t>((crc << 8) ^ crc_table[(crc >> 8) ^ *buf++]);
+	return crc;
+}
+
+bool cobs_decode(const uint8_t *in, size_t len, uint8_t *out, size_t out_max, size_t *out_len)
+{
+	const uint8_t *end = in + len;
+	size_t pos = 0;
+
+	while (in < end) {
+		uint8_t code = *in++;
+		size_t run = code - 1u;
+
+		if (code == 0 || run > static_cast<size_t>(end - in) || pos + run > out_max)
+			return false;
+		std::memcpy(out + pos, in, run);
+		pos += run;
+		in += run;
+		/* A block short of 0xFF stood for a zero, unless it ends the frame */
+		if (code != 0xFF && in < end) {
+			if (pos == out_max)
+				return false;
+			out[pos++] = 0;
+		}
+	}
+	*out_len = pos;
+	return true;
+}
+
+Result decode_frame(const uint8_t *in, size_t len, Frame &frame)
+{
+	uint8_t payload[TELEM_SAMPLE_LEN + TELEM_CRC_LEN];
+	telem_sample &s = frame.sample;
+	size_t plen;
+
+	if (len > TELEM_FRAME_MAX - 1)
+		return Result::length_error;
+	if (!cobs_decode(in, len, payload, sizeof(payload), &plen))
+		return Result::cobs_error;
+	if (plen != sizeof(payload))
+		return Result::length_error;
+	if (crc16(payload, TELEM_SAMPLE_LEN) != get16(payload + TELEM_SAMPLE_LEN))
+		return Result::crc_error;
+	if (payload[0] != TELEM_TYPE_SAMPLE)
+		return Result::type_error;
+
+	s.node = payload[1];
+	frame.seq = get16(payload + 2);
+	s.t_ms = get32(payload + 4);
+	s.temperature = static_cast<int16_t>(get16(payload + 8));
+	s.pressure = get32(payload + 10);
+	s.humidity = get32(payload + 14);
+	s.gas_resistance = get32(payload + 18);
+	s.dew_point = static_cast<int16_t>(get16(payload + 22));
+	s.abs_humidity = get16(payload + 24);
+	s.height = static_cast<int32_t>(get32(payload + 26));
+	s.gas_index = get16(payload + 30);
+	s.state = payload[32];
+	s.status = payload[33];
+	return Result::ok;
+}
+
+void Decoder::carry(const uint8_t *buf, size_t len)
+{
+	if (overflow_)
+		return;
+	if (fill_ + len > pending_max) {
+		overflow_ = true;
+		stats_.oversize++;
+		return;
+	}
+	std::memcpy(pending_ + fill_, buf, len);
+	fill_ += len;
+}
+
+} /* namespace telemetry */
@@ -0,0 +1,146 @@
+/**
+  ******************************************************************************
+  * @file           : telem_decoder.hpp
+  * @brief          : Streaming decoder of the firmware's binary telemetry
+  ******************************************************************************
+  * Splits a byte stream at the 0x00 delimiters, COBS-decodes each frame and
+  * checks its length, CRC16 and type (the format is in telemetry.h). A good
+  * frame is handed to the caller as a telemetry::Frame. A bad one only counts
+  * in the Stats. Bytes may arrive in pieces of any size. A frame split
+  * across two feed() calls is carried over. Otherwise frames are decoded
+  * in place with no copy.
+  *
+  * Gaps in the sequence number count as lost frames. The count includes
+  * frames the target dropped when its console ring was full and frames
+  * that failed a check here.
+  *
+  *     telemetry::Decoder dec;
+  *     dec.feed(buf, len, [](const telemetry::Frame &f) { ... });
+  ******************************************************************************
+**/
+
+#ifndef TELEM_DECODER_HPP_
+#define TELEM_DECODER_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include "telemetry.h"
+
+namespace telemetry {
+
+struct Frame {
+	uint16_t seq;
+	telem_sample sample;
+};
+
+struct Stats {
+	uint64_t bytes = 0;
+	uint64_t frames = 0;		/* good frames */
+	uint64_t empty = 0;			/* delimiters with nothing before them */
+	uint64_t cobs_errors = 0;	/* a code byte pointing past the frame */
+	uint64_t length_errors = 0;
+	uint64_t crc_errors = 0;
+	uint64_t type_errors = 0;	/* good CRC, unknown type */
+	uint64_t oversize = 0;		/* longer than any frame; skipped to the next delimiter */
+	uint64_t lost = 0;			/* sequence numbers skipped */
+
+	uint64_t bad() const
+	{
+		return cobs_errors + length_errors + crc_errors + type_errors + oversize;
+	}
+};
+
+enum class Result { ok, cobs_error, length_error, crc_error, type_error };
+
+uint16_t crc16(const uint8_t *buf, size_t len);
+/* Decodes len COBS bytes, the delimiter excluded, into out; false if a
+ * code byte overruns the input or the output would exceed out_max */
+bool cobs_decode(const uint8_t *in, size_t len, uint8_t *out, size_t out_max, size_t *out_len);
+/* Checks and unpacks one frame without its delimiter */
+Result decode_frame(const uint8_t *in, size_t len, Frame &frame);
+
+class Decoder {
+public:
+	/* Feeds len bytes; calls on_frame for every good frame completed */
+	template <typename F>
+	void feed(const uint8_t *buf, size_t len, F &&on_frame)
+	{
+		const uint8_t *end = buf + len;
+
+		stats_.bytes += len;
+		while (buf < end) {
+			const uint8_t *zero = static_cast<const uint8_t *>(std::memchr(buf, 0, end - buf));
+
+			if (zero == nullptr) {
+				carry(buf, end - buf);
+				return;
+			}
+			if (fill_ == 0 && !overflow_) {
+				frame_done(buf, zero - buf, on_frame);
+			} else {
+				carry(buf, zero - buf);
+				if (!overflow_)
+					frame_done(pending_, fill_, on_frame);
+				fill_ = 0;
+				overflow_ = false;
+			}
+			buf = zero + 1;
+		}
+	}
+
+	const Stats &stats() const
+	{
+		return stats_;
+	}
+
+private:
+	static constexpr size_t pending_max = TELEM_FRAME_MAX;
+
+	void carry(const uint8_t *buf, size_t len);
+
+	template <typename F>
+	void frame_done(const uint8_t *buf, size_t len, F &on_frame)
+	{
+		Frame frame;
+
+		if (len == 0) {
+			stats_.empty++;
+			return;
+		}
+		switch (decode_frame(buf, len, frame)) {
+		case Result::ok:
+			break;
+		case Result::cobs_error:
+			stats_.cobs_errors++;
+			return;
+		case Result::length_error:
+			stats_.length_errors++;
+			return;
+		case Result::crc_error:
+			stats_.crc_errors++;
+			return;
+		case Result::type_error:
+			stats_.type_errors++;
+			return;
+		}
+		if (have_seq_)
+			stats_.lost += static_cast<uint16_t>(frame.seq - next_seq_);
+		have_seq_ = true;
+		next_seq_ = static_cast<uint16_t>(frame.seq + 1);
+		stats_.frames++;
+		on_frame(frame);
+	}
+
+	uint8_t pending_[pending_max];
+	size_t fill_ = 0;
+	bool overflow_ = false;
+	bool have_seq_ = false;
+	uint16_t next_seq_ = 0;
+	Stats stats_;
+};
+
+} /* namespace telemetry */
+
+#endif /* TELEM_DECODER_HPP_ */